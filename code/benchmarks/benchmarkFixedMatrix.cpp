@@ -0,0 +1,153 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ *
+ * @author Pablo Alvarado
+ * @date   29.12.2017
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Benchmarks of the fixed size matrices against the dynamic ones
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "FixedMatrix.hpp"
+
+BOOST_AUTO_TEST_SUITE( Matrix )
+
+/**
+ * Benchmark for many small products: c[i] = a[i]*b[i] + a[i] on N x N
+ * matrices, where the size is the number of matrices
+ */
+template<class M,size_t N>
+class benchSmall {
+protected:
+  /// State of the benchmarked evaluation
+  std::vector<M> _a;
+  std::vector<M> _b;
+  std::vector<M> _c;
+
+  /// New matrix with some entries
+  virtual M create(const size_t i) const = 0;
+
+public:
+  virtual ~benchSmall() {}
+
+  /// Prepare the evaluation of given size
+  void prepare(const size_t size) {
+    _a.clear();
+    _b.clear();
+    _c.clear();
+    for (size_t i=0;i<size;++i) {
+      _a.push_back(create(i));
+      _b.push_back(create(i+1));
+      _c.push_back(create(0));
+    }
+  }
+};
+
+/// Small products with FixedMatrix
+template<typename T,size_t N>
+class benchSmallFixed : public benchSmall<anpi::FixedMatrix<T,N,N>,N> {
+  typedef anpi::FixedMatrix<T,N,N> matrix;
+
+  matrix create(const size_t i) const {
+    matrix m(anpi::DoNotInitialize);
+    for (size_t k=0;k<N*N;++k) {
+      m.data()[k] = T((i*7 + k*3) % 11)/T(11);
+    }
+    return m;
+  }
+
+public:
+  // Evaluate all products
+  inline void eval() {
+    for (size_t i=0;i<this->_a.size();++i) {
+      this->_c[i] = this->_a[i]*this->_b[i] + this->_a[i];
+    }
+  }
+};
+
+/// Small products with the dynamic Matrix
+template<typename T,size_t N>
+class benchSmallDynamic : public benchSmall<anpi::Matrix<T>,N> {
+  typedef anpi::Matrix<T> matrix;
+
+  matrix create(const size_t i) const {
+    matrix m(N,N,anpi::DoNotInitialize);
+    for (size_t k=0;k<N*N;++k) {
+      m(k/N,k%N) = T((i*7 + k*3) % 11)/T(11);
+    }
+    return m;
+  }
+
+public:
+  // Evaluate all products
+  inline void eval() {
+    for (size_t i=0;i<this->_a.size();++i) {
+      this->_c[i] = this->_a[i]*this->_b[i] + this->_a[i];
+    }
+  }
+};
+
+/// Benchmark the fixed and dynamic types for N x N matrices
+template<typename T,size_t N>
+void benchSmallSize(const std::vector<size_t>& sizes,
+                    const size_t repetitions,
+                    const std::string& file,
+                    const std::string& name,
+                    const std::string& dynamicColor,
+                    const std::string& fixedColor) {
+  std::vector<anpi::benchmark::measurement> times;
+
+  {
+    benchSmallDynamic<T,N> bs;
+
+    // Measure the dynamic matrices
+    ANPI_BENCHMARK(sizes,repetitions,times,bs);
+
+    ::anpi::benchmark::write("small_" + file + "_dynamic.txt",times);
+    ::anpi::benchmark::plotRange(times,"Dynamic " + name,dynamicColor);
+  }
+
+  {
+    benchSmallFixed<T,N> bs;
+
+    // Measure the fixed matrices
+    ANPI_BENCHMARK(sizes,repetitions,times,bs);
+
+    ::anpi::benchmark::write("small_" + file + "_fixed.txt",times);
+    ::anpi::benchmark::plotRange(times,"Fixed " + name,fixedColor);
+  }
+}
+
+/**
+ * Compare the fixed and the dynamic matrices
+ */
+BOOST_AUTO_TEST_CASE( FixedMatrix ) {
+
+  std::vector<size_t> sizes = {   1000,   2000,   5000,
+                                 10000,  20000,  50000,
+                                100000, 200000 };
+
+  const size_t repetitions=5;
+
+  benchSmallSize<float,2>(sizes,repetitions,"2x2_float","2x2 (float)","r","m");
+  benchSmallSize<float,3>(sizes,repetitions,"3x3_float","3x3 (float)","g","c");
+  benchSmallSize<float,4>(sizes,repetitions,"4x4_float","4x4 (float)","b","k");
+
+  ::anpi::benchmark::show();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -42,9 +42,9 @@ namespace anpi {
     /**
      * Compute measurement statistics for each size
      */
-    void computeStats(const std::vector<size_t>& sizes,
-                      const anpi::Matrix<std::chrono::duration<double> >& mat,
-                      std::vector<measurement>& times) {
+    inline void computeStats(const std::vector<size_t>& sizes,
+                             const anpi::Matrix<std::chrono::duration<double> >& mat,
+                             std::vector<measurement>& times) {
 
       const size_t nums = sizes.size();
       times.resize(nums);
@@ -82,8 +82,8 @@ namespace anpi {
      * # Minimum
      * # Maximum  
      */
-    void write(std::ostream& stream,
-               const std::vector<measurement>& m) {
+    inline void write(std::ostream& stream,
+                      const std::vector<measurement>& m) {
       for (auto i : m) {
         stream << i.size    << " \t";
         stream << i.average << " \t";
@@ -96,8 +96,8 @@ namespace anpi {
     /**
      * Save a file with each measurement in a row
      */
-    void write(const std::string& filename,
-               const std::vector<measurement>& m) {
+    inline void write(const std::string& filename,
+                      const std::vector<measurement>& m) {
       std::ofstream os(filename.c_str());
       write(os,m);
       os.close();
@@ -113,9 +113,9 @@ namespace anpi {
      * # Minimum
      * # Maximum  
      */
-    void plot(const std::vector<measurement>& m,
-              const std::string& legend,
-              const std::string& color = "r") {
+    inline void plot(const std::vector<measurement>& m,
+                     const std::string& legend,
+                     const std::string& color = "r") {
       std::vector<double> x(m.size()),y(m.size());
 
       for (size_t i=0;i<m.size();++i) {
@@ -138,9 +138,9 @@ namespace anpi {
      * # Minimum
      * # Maximum  
      */
-    void plotRange(const std::vector<measurement>& m,
-                   const std::string& legend,
-                   const std::string& color) {
+    inline void plotRange(const std::vector<measurement>& m,
+                          const std::string& legend,
+                          const std::string& color) {
       std::vector<double> x(m.size()),y(m.size()),miny(m.size()),maxy(m.size());
 
       for (size_t i=0;i<m.size();++i) {
@@ -156,7 +156,7 @@ namespace anpi {
       plotter.plot(x,y,miny,maxy,legend,color);
     }
     
-    void show() {
+    inline void show() {
        static anpi::Plot2d<double> plotter;
        plotter.show();
     }
@@ -0,0 +1,188 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ *
+ * @author Pablo Alvarado
+ * @date   29.12.2017
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <algorithm>
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * Benchmarks of the storage orders of the matrices
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "MatrixLayout.hpp"
+
+BOOST_AUTO_TEST_SUITE( Matrix )
+
+typedef anpi::aligned_row_allocator<float> layoutAlloc;
+
+/// Square matrices of the given type, with some entries
+template<class M>
+class benchLayout {
+protected:
+  /// State of the benchmarked evaluation
+  M _a;
+  M _b;
+  M _c;
+  /// Result of the traversals, so that they are not optimized away
+  float _sum;
+
+public:
+  /// Prepare the evaluation of given size
+  void prepare(const size_t size) {
+    anpi::Matrix<float> a(size,size,anpi::DoNotInitialize);
+    for (size_t r=0;r<size;++r) {
+      for (size_t c=0;c<size;++c) {
+        a(r,c) = float((r*7 + c*3) % 11);
+      }
+    }
+    _a = M(a);
+    _b = M(a);
+    _sum = 0.f;
+  }
+};
+
+/// Sum of all entries, traversing the matrix row by row
+template<class M>
+class benchRowTraversal : public benchLayout<M> {
+public:
+  inline void eval() {
+    const M& a = this->_a;
+    for (size_t r=0;r<a.rows();++r) {
+      for (size_t c=0;c<a.cols();++c) {
+        this->_sum += a(r,c);
+      }
+    }
+  }
+};
+
+/// Sum of all entries, traversing the matrix column by column
+template<class M>
+class benchColumnTraversal : public benchLayout<M> {
+public:
+  inline void eval() {
+    const M& a = this->_a;
+    for (size_t c=0;c<a.cols();++c) {
+      for (size_t r=0;r<a.rows();++r) {
+        this->_sum += a(r,c);
+      }
+    }
+  }
+};
+
+/**
+ * Sum of a(i,j)*a(j,i) over all entries, traversing 32 x 32 blocks,
+ * as the blocked algorithms do
+ */
+template<class M>
+class benchBlockTraversal : public benchLayout<M> {
+public:
+  inline void eval() {
+    const M& a = this->_a;
+    const size_t n = a.rows();
+    const size_t b = 32;
+    for (size_t r=0;r<n;r+=b) {
+      for (size_t c=0;c<n;c+=b) {
+        for (size_t i=r;i<std::min(r+b,n);++i) {
+          for (size_t j=c;j<std::min(c+b,n);++j) {
+            this->_sum += a(i,j)*a(j,i);
+          }
+        }
+      }
+    }
+  }
+};
+
+/// Element-wise sum c = a + b, which runs on the storages
+template<class M>
+class benchLayoutAdd : public benchLayout<M> {
+public:
+  inline void eval() {
+    this->_c = this->_a + this->_b;
+  }
+};
+
+/// Conversion from and to the row-major layout
+template<class M>
+class benchLayoutConversion : public benchLayout<M> {
+protected:
+  /// Row-major copy
+  anpi::Matrix<float> _r;
+
+public:
+  void prepare(const size_t size) {
+    benchLayout<M>::prepare(size);
+    _r = anpi::Matrix<float>(this->_a);
+  }
+
+  inline void eval() {
+    this->_a.fill(_r);
+    _r.fill(this->_a);
+  }
+};
+
+/// Measure the given benchmark for the three layouts
+template<template<class> class Bench>
+void benchLayouts(const std::vector<size_t>& sizes,
+                  const size_t repetitions,
+                  const std::string& name) {
+  std::vector<anpi::benchmark::measurement> times;
+
+  {
+    Bench< anpi::Matrix<float,layoutAlloc> > b;
+    ANPI_BENCHMARK(sizes,repetitions,times,b);
+    ::anpi::benchmark::write(name + "_row_major.txt",times);
+    ::anpi::benchmark::plotRange(times,name + " row-major","r");
+  }
+
+  {
+    Bench< anpi::Matrix<float,layoutAlloc,anpi::column_major> > b;
+    ANPI_BENCHMARK(sizes,repetitions,times,b);
+    ::anpi::benchmark::write(name + "_column_major.txt",times);
+    ::anpi::benchmark::plotRange(times,name + " column-major","g");
+  }
+
+  {
+    Bench< anpi::Matrix<float,layoutAlloc,anpi::tiled<> > > b;
+    ANPI_BENCHMARK(sizes,repetitions,times,b);
+    ::anpi::benchmark::write(name + "_tiled.txt",times);
+    ::anpi::benchmark::plotRange(times,name + " tiled","b");
+  }
+
+  ::anpi::benchmark::show();
+}
+
+/**
+ * Compare the layouts on traversals in the three orders, on the
+ * element-wise sum and on the conversions from the row-major layout
+ */
+BOOST_AUTO_TEST_CASE( Layouts ) {
+
+  std::vector<size_t> sizes = {  256,  384,  512,  768,
+                                1024, 1536, 2048, 3072,
+                                4096};
+
+  const size_t repetitions=10;
+
+  benchLayouts<benchRowTraversal>(sizes,repetitions,"row_traversal");
+  benchLayouts<benchColumnTraversal>(sizes,repetitions,"column_traversal");
+  benchLayouts<benchBlockTraversal>(sizes,repetitions,"block_traversal");
+  benchLayouts<benchLayoutAdd>(sizes,repetitions,"layout_add");
+  benchLayouts<benchLayoutConversion>(sizes,repetitions,"layout_conversion");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
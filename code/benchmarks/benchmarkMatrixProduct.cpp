@@ -0,0 +1,185 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ *
+ * @author Pablo Alvarado
+ * @date   29.12.2017
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <complex>
+
+/**
+ * Benchmarks for the matrix product
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "Allocator.hpp"
+
+BOOST_AUTO_TEST_SUITE( Matrix )
+
+/// Benchmark for the product of square matrices
+template<typename T>
+class benchProduct {
+protected:
+  /// Maximum allowed size for the square matrices
+  const size_t _maxSize;
+
+  /// A large matrix holding
+  anpi::Matrix<T> _data;
+
+  /// State of the benchmarked evaluation
+  anpi::Matrix<T> _a;
+  anpi::Matrix<T> _b;
+  anpi::Matrix<T> _c;
+public:
+  /// Construct
+  benchProduct(const size_t maxSize)
+    : _maxSize(maxSize),_data(maxSize,maxSize,anpi::DoNotInitialize) {
+
+    for (size_t r=0;r<_maxSize;++r) {
+      for (size_t c=0;c<_maxSize;++c) {
+        _data(r,c)=T((r*7+c*3)%11)/T(11);
+      }
+    }
+  }
+
+  /// Prepare the evaluation of given size
+  void prepare(const size_t size) {
+    assert (size<=this->_maxSize);
+    this->_a=std::move(anpi::Matrix<T>(size,size,_data.data()));
+    this->_b=this->_a;
+    this->_c=anpi::Matrix<T>(size,size,T(0));
+  }
+};
+
+/// Textbook triple loop, as usually written by hand
+template<typename T>
+class benchProductNaive : public benchProduct<T> {
+public:
+  /// Constructor
+  benchProductNaive(const size_t n) : benchProduct<T>(n) { }
+
+  // Evaluate the product
+  inline void eval() {
+    const size_t n = this->_a.rows();
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<n;++j) {
+        T sum(0);
+        for (size_t p=0;p<n;++p) {
+          sum += this->_a(i,p)*this->_b(p,j);
+        }
+        this->_c(i,j)=sum;
+      }
+    }
+  }
+};
+
+/// Provide the evaluation method for the fallback product
+template<typename T>
+class benchProductFallback : public benchProduct<T> {
+public:
+  /// Constructor
+  benchProductFallback(const size_t n) : benchProduct<T>(n) { }
+
+  // Evaluate the product
+  inline void eval() {
+    anpi::fallback::gemm(T(1),this->_a,this->_b,T(0),this->_c);
+  }
+};
+
+/// Provide the evaluation method for the blocked SIMD product
+template<typename T>
+class benchProductSIMD : public benchProduct<T> {
+public:
+  /// Constructor
+  benchProductSIMD(const size_t n) : benchProduct<T>(n) { }
+
+  // Evaluate the product
+  inline void eval() {
+    anpi::simd::gemm(T(1),this->_a,this->_b,T(0),this->_c);
+  }
+};
+
+/**
+ * Print the performance of the product of square matrices in GFLOP/s
+ */
+inline void reportGFlops(const std::string& name,
+                         const std::vector<anpi::benchmark::measurement>& times) {
+  std::cout << name << std::endl;
+  for (const auto& m : times) {
+    const double n = static_cast<double>(m.size);
+    std::cout << "  " << m.size << " \t"
+              << 2.0*n*n*n/m.average*1.0e-9 << " GFLOP/s" << std::endl;
+  }
+}
+
+/**
+ * Compare the products
+ */
+BOOST_AUTO_TEST_CASE( Product ) {
+
+  std::vector<size_t> sizes = {  24,  32,  48,  64,
+                                 96, 128, 192, 256,
+                                384, 512};
+
+  const size_t n=sizes.back();
+  const size_t repetitions=5;
+  std::vector<anpi::benchmark::measurement> times;
+
+  {
+    benchProductNaive<double> bp(n);
+
+    // Measure the textbook product
+    ANPI_BENCHMARK(sizes,repetitions,times,bp);
+
+    ::anpi::benchmark::write("product_double_naive.txt",times);
+    ::anpi::benchmark::plotRange(times,"Naive (double)","r");
+    reportGFlops("Naive (double)",times);
+  }
+
+  {
+    benchProductFallback<double> bp(n);
+
+    // Measure the fallback product
+    ANPI_BENCHMARK(sizes,repetitions,times,bp);
+
+    ::anpi::benchmark::write("product_double_fb.txt",times);
+    ::anpi::benchmark::plotRange(times,"Fallback (double)","b");
+    reportGFlops("Fallback (double)",times);
+  }
+
+  {
+    benchProductSIMD<double> bp(n);
+
+    // Measure the blocked product
+    ANPI_BENCHMARK(sizes,repetitions,times,bp);
+
+    ::anpi::benchmark::write("product_double_simd.txt",times);
+    ::anpi::benchmark::plotRange(times,"SIMD (double)","g");
+    reportGFlops("SIMD (double)",times);
+  }
+
+  {
+    benchProductSIMD<float> bp(n);
+
+    // Measure the blocked product
+    ANPI_BENCHMARK(sizes,repetitions,times,bp);
+
+    ::anpi::benchmark::write("product_float_simd.txt",times);
+    ::anpi::benchmark::plotRange(times,"SIMD (float)","m");
+    reportGFlops("SIMD (float)",times);
+  }
+
+  ::anpi::benchmark::show();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ *
+ * @author Pablo Alvarado
+ * @date   29.12.2017
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Benchmarks of the blocked QR factorization against the unblocked one
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "QR.hpp"
+
+BOOST_AUTO_TEST_SUITE( Matrix )
+
+/**
+ * Benchmark for the QR factorization of tall matrices with the given
+ * number of columns, where the size is the number of rows
+ */
+template<typename T>
+class benchQR {
+protected:
+  /// Number of columns
+  const size_t _cols;
+
+  /// State of the benchmarked evaluation
+  anpi::Matrix<T> _a;
+  anpi::Matrix<T> _b;
+
+public:
+  /// Construct
+  benchQR(const size_t cols) : _cols(cols) {}
+
+  /// Prepare the evaluation of given size
+  void prepare(const size_t size) {
+    _a = anpi::Matrix<T>(size,_cols,anpi::DoNotInitialize);
+    for (size_t r=0;r<size;++r) {
+      for (size_t c=0;c<_cols;++c) {
+        _a(r,c) = T((r*7 + c*3 + (r*c) % 5) % 11)/T(11);
+      }
+    }
+  }
+};
+
+/// Blocked factorization
+template<typename T>
+class benchQRBlocked : public benchQR<T> {
+  /// Reused factorization
+  anpi::QR<T> _qr;
+
+public:
+  /// Constructor
+  benchQRBlocked(const size_t cols) : benchQR<T>(cols) { }
+
+  // Evaluate the factorization
+  inline void eval() {
+    _qr.factorize(this->_a);
+  }
+};
+
+/// Unblocked factorization
+template<typename T>
+class benchQRUnblocked : public benchQR<T> {
+  /// Copy factorized in place
+  anpi::Matrix<T> _qr;
+  std::vector<T> _tau;
+
+public:
+  /// Constructor
+  benchQRUnblocked(const size_t cols) : benchQR<T>(cols) { }
+
+  // Evaluate the factorization
+  inline void eval() {
+    _qr = this->_a;
+    _tau.resize(this->_a.cols());
+    anpi::detail::householderQR(_qr.view(),_tau.data());
+  }
+};
+
+/**
+ * Compare the blocked and unblocked QR factorizations of tall
+ * matrices with 200 columns
+ */
+BOOST_AUTO_TEST_CASE( QR ) {
+
+  std::vector<size_t> sizes = {  500,  1000,  2000,
+                                5000, 10000 };
+
+  const size_t repetitions=5;
+  const size_t cols=200;
+  std::vector<anpi::benchmark::measurement> times;
+
+  {
+    benchQRUnblocked<double> bq(cols);
+
+    // Measure the unblocked factorization
+    ANPI_BENCHMARK(sizes,repetitions,times,bq);
+
+    ::anpi::benchmark::write("qr_double_unblocked.txt",times);
+    ::anpi::benchmark::plotRange(times,"Unblocked (double)","r");
+  }
+
+  {
+    benchQRBlocked<double> bq(cols);
+
+    // Measure the blocked factorization
+    ANPI_BENCHMARK(sizes,repetitions,times,bq);
+
+    ::anpi::benchmark::write("qr_double_blocked.txt",times);
+    ::anpi::benchmark::plotRange(times,"Blocked (double)","g");
+  }
+
+  ::anpi::benchmark::show();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ *
+ * @author Pablo Alvarado
+ * @date   29.12.2017
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Benchmarks of the sparse matrix-vector product against the dense one
+ */
+#include "benchmarkFramework.hpp"
+#include "Matrix.hpp"
+#include "SparseMatrix.hpp"
+
+BOOST_AUTO_TEST_SUITE( Matrix )
+
+/**
+ * Benchmark for the products y = a*x of square matrices with the given
+ * fraction of non-zero entries and vectors x
+ */
+template<typename T>
+class benchSparse {
+protected:
+  /// Fraction of non-zero entries
+  const double _density;
+
+  /// State of the benchmarked evaluation
+  anpi::SparseMatrix<T> _a;
+  anpi::Matrix<T> _x;
+  anpi::Matrix<T> _y;
+
+public:
+  /// Construct
+  benchSparse(const double density) : _density(density) {}
+
+  /// Prepare the evaluation of given size
+  void prepare(const size_t size) {
+    // the same number of entries in each row, spread over the columns
+    const size_t perRow = std::max(size_t(_density*size),size_t(1));
+    const size_t step = size/perRow;
+    std::vector< anpi::sparse_entry<T> > entries;
+    entries.reserve(size*perRow);
+    for (size_t r=0;r<size;++r) {
+      for (size_t j=0;j<perRow;++j) {
+        entries.push_back({r,(r + j*step) % size,T((r*7 + j*3) % 11)/T(11)});
+      }
+    }
+    _a = anpi::SparseMatrix<T>(size,size,entries);
+    _x = anpi::Matrix<T>(size,1,T(1));
+    _y = anpi::Matrix<T>(size,1,T(0));
+  }
+};
+
+/// Product with the sparse matrix
+template<typename T>
+class benchSparseProduct : public benchSparse<T> {
+public:
+  /// Constructor
+  benchSparseProduct(const double density) : benchSparse<T>(density) { }
+
+  // Evaluate the product
+  inline void eval() {
+    anpi::spmv(T(1),this->_a,this->_x.view(),T(0),this->_y.view());
+  }
+};
+
+/// Product with the dense copy of the sparse matrix
+template<typename T>
+class benchDenseProduct : public benchSparse<T> {
+protected:
+  /// Dense copy of the matrix
+  anpi::Matrix<T> _dense;
+
+public:
+  /// Constructor
+  benchDenseProduct(const double density) : benchSparse<T>(density) { }
+
+  /// Prepare the evaluation of given size
+  void prepare(const size_t size) {
+    benchSparse<T>::prepare(size);
+    _dense = this->_a.toMatrix();
+  }
+
+  // Evaluate the product
+  inline void eval() {
+    anpi::gemm(T(1),_dense,this->_x,T(0),this->_y);
+  }
+};
+
+/**
+ * Compare the sparse and dense matrix-vector products
+ */
+BOOST_AUTO_TEST_CASE( SparseMatrix ) {
+
+  std::vector<size_t> sizes = {  256,  384,  512,  768,
+                                1024, 1536, 2048, 3072,
+                                4096};
+
+  const size_t repetitions=20;
+  std::vector<anpi::benchmark::measurement> times;
+
+  {
+    benchDenseProduct<float> bp(0.01);
+
+    // Measure the dense product, which does not depend on the density
+    ANPI_BENCHMARK(sizes,repetitions,times,bp);
+
+    ::anpi::benchmark::write("spmv_float_dense.txt",times);
+    ::anpi::benchmark::plotRange(times,"Dense (float)","r");
+  }
+
+  const double densities[] = { 0.001, 0.01, 0.1 };
+  const char* names[] = { "0.1%", "1%", "10%" };
+  const char* files[] = { "0_1", "1", "10" };
+  const char* colors[] = { "g", "b", "m" };
+
+  for (size_t d=0;d<3;++d) {
+    benchSparseProduct<float> bp(densities[d]);
+
+    // Measure the sparse product
+    ANPI_BENCHMARK(sizes,repetitions,times,bp);
+
+    ::anpi::benchmark::write(std::string("spmv_float_sparse_") + files[d] +
+                             ".txt",times);
+    ::anpi::benchmark::plotRange(times,std::string("Sparse ") + names[d] +
+                                 " (float)",colors[d]);
+  }
+
+  ::anpi::benchmark::show();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,11 +12,24 @@
 #define ANPI_ALLOCATOR_HPP
 
 #include <boost/align/aligned_allocator.hpp>
+#include <cstdint>
+#include <new>
 #include "HasType.hpp"
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 namespace anpi {
 
-# if defined __AVX512F__
+  /*
+   * The SIMD kernels select the instruction set at runtime, so that on
+   * x86 the memory is aligned for the widest registers (AVX-512), even
+   * if the compiler does not target them.
+   */
+# if defined __x86_64__ || defined __i386__
+  static const size_t DefaultAlignment = 64;
+# elif defined __AVX512F__
   static const size_t DefaultAlignment = 64;
 # elif defined __AVX2__
   static const size_t DefaultAlignment = 32;
@@ -34,7 +47,9 @@ namespace anpi {
   static const size_t DefaultAlignment = 16;
 # elif defined __SSE__
   static const size_t DefaultAlignment = 16;
-# endif  
+# else
+  static const size_t DefaultAlignment = 16;
+# endif
   
   /**
    * Use the boost version of aligned_allocator
@@ -73,6 +88,169 @@ namespace anpi {
     typedef std::true_type row_aligned;
   };
 
+  /**
+   * Aligned allocator placing large blocks on transparent huge pages.
+   *
+   * Sweeping through a large matrix on 4 KiB pages misses the TLB
+   * every few rows.  Blocks of at least hugePageSize bytes are mapped
+   * on their own at an address aligned to hugePageSize, and the kernel
+   * is asked to back them with huge pages (MADV_HUGEPAGE).  If the
+   * kernel does not support transparent huge pages, or has them
+   * disabled, the blocks just stay on normal pages.
+   *
+   * Smaller blocks, which would waste most of a huge page, and all
+   * blocks on systems other than Linux, are allocated as with the
+   * aligned_allocator.
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class hugepage_allocator : public aligned_allocator<T,Align> {
+  public:
+    typedef typename aligned_allocator<T,Align>::pointer   pointer;
+    typedef typename aligned_allocator<T,Align>::size_type size_type;
+
+    /// Size of the huge pages, and minimum size of the blocks using them
+    static constexpr size_t hugePageSize = size_t(2)<<20;
+
+    /// Inherit all constructors
+    using aligned_allocator<T,Align>::aligned_allocator;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef hugepage_allocator<U, Align> other;
+    };
+
+    /// Allocate n entries
+    pointer allocate(const size_type n) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+      if (_huge(n)) {
+        return static_cast<pointer>(_map(_mapped(n)));
+      }
+#endif
+      return aligned_allocator<T,Align>::allocate(n);
+    }
+
+    /// Release the n entries at p
+    void deallocate(const pointer p,const size_type n) noexcept {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+      if (_huge(n)) {
+        ::munmap(p,_mapped(n));
+        return;
+      }
+#endif
+      aligned_allocator<T,Align>::deallocate(p,n);
+    }
+
+  private:
+    /*
+     * Matrices without row padding release fewer entries than they
+     * allocate, but never less than the last aligned block.  Rounding
+     * to Align first gives the same decisions in both cases.
+     */
+    static inline size_t _bytes(const size_type n) {
+      return (n*sizeof(T) + Align - 1)/Align*Align;
+    }
+
+    /// Check if n entries are placed on huge pages
+    static inline bool _huge(const size_type n) {
+      return _bytes(n) >= hugePageSize;
+    }
+
+    /// Bytes mapped for n entries: whole huge pages
+    static inline size_t _mapped(const size_type n) {
+      const size_t page = hugePageSize;
+      return (_bytes(n) + page - 1)/page*page;
+    }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    /// Map length bytes aligned to the huge page size
+    static void* _map(const size_t length) {
+      const size_t page = hugePageSize;
+
+      // map one page more, and unmap the misaligned head and tail
+      void* mem = ::mmap(nullptr,length + page,PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+      if (mem == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      char* raw = static_cast<char*>(mem);
+      const size_t misalign = reinterpret_cast<std::uintptr_t>(raw) % page;
+      const size_t head = (misalign == 0) ? 0 : page - misalign;
+      if (head != 0) {
+        ::munmap(raw,head);
+      }
+      ::munmap(raw + head + length,page - head);
+
+      // only a hint: without THP support the pages stay small
+      ::madvise(raw + head,length,MADV_HUGEPAGE);
+      return raw + head;
+    }
+#endif
+  };
+
+  /**
+   * The hugepage_allocator, additionally padding each row to a
+   * multiple of Align bytes, as the aligned_row_allocator does
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class hugepage_row_allocator : public hugepage_allocator<T,Align> {
+  public:
+    /// Inherit all constructors
+    using hugepage_allocator<T,Align>::hugepage_allocator;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef hugepage_row_allocator<U, Align> other;
+    };
+
+    /// Type to identify this as a row-aligned allocator
+    typedef std::true_type row_aligned;
+  };
+
+  /**
+   * The aligned_allocator, additionally requesting copy-on-write for
+   * the anpi::Matrix using it.
+   *
+   * Copies of such matrices share their memory block, which is only
+   * duplicated when one of them is about to be modified (see
+   * anpi::Matrix).
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class shared_allocator : public aligned_allocator<T,Align> {
+  public:
+    /// Inherit all constructors
+    using aligned_allocator<T,Align>::aligned_allocator;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef shared_allocator<U, Align> other;
+    };
+
+    /// Type to identify this as a copy-on-write allocator
+    typedef std::true_type copy_on_write;
+  };
+
+  /**
+   * The aligned_row_allocator, additionally requesting copy-on-write
+   * for the anpi::Matrix using it
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class shared_row_allocator : public aligned_row_allocator<T,Align> {
+  public:
+    /// Inherit all constructors
+    using aligned_row_allocator<T,Align>::aligned_row_allocator;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef shared_row_allocator<U, Align> other;
+    };
+
+    /// Type to identify this as a copy-on-write allocator
+    typedef std::true_type copy_on_write;
+  };
 
   /**
    * Check if a class is an aligned_allocator or an aligned_row_allocator
@@ -94,10 +272,39 @@ namespace anpi {
     static const bool value = true;
   };
 
+  // Specialization for the hugepage_allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::hugepage_allocator<T,A> > {
+    static const bool value = true;
+  };
+
+  // Specialization for the hugepage_row_allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::hugepage_row_allocator<T,A> > {
+    static const bool value = true;
+  };
+
+  // Specialization for the shared_allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::shared_allocator<T,A> > {
+    static const bool value = true;
+  };
+
+  // Specialization for the shared_row_allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::shared_row_allocator<T,A> > {
+    static const bool value = true;
+  };
+
   /**
    * Create metafunction has_type_row_aligned<T>
    */
   GENERATE_HAS_TYPE(row_aligned);
+
+  /**
+   * Create metafunction has_type_copy_on_write<T>
+   */
+  GENERATE_HAS_TYPE(copy_on_write);
   
   /**
    * Extract alignment of an allocator
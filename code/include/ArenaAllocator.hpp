@@ -0,0 +1,294 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_ARENA_ALLOCATOR_HPP
+#define ANPI_ARENA_ALLOCATOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#include <boost/align/aligned_alloc.hpp>
+
+#include "Allocator.hpp"
+
+namespace anpi
+{
+  /**
+   * Scoped memory region for short-lived matrices.
+   *
+   * While an arena exists, all arena_allocator instances of the same
+   * thread take their memory from it, by just advancing a pointer
+   * ("bump allocation").  Releasing the memory costs nothing, and the
+   * whole region is reused as soon as all its blocks have been
+   * released, so that loops creating temporaries do not call malloc
+   * at all after the first iteration:
+   *
+   * \code
+   * typedef anpi::Matrix<float,anpi::arena_allocator<float> > matrix;
+   *
+   * for (size_t i=0;i<iterations;++i) {
+   *   anpi::Arena arena;
+   *   matrix d = a + b;  // a, b and d use the arena allocator
+   *   matrix e = d * c;
+   *   ...
+   * } // everything is released at once
+   * \endcode
+   *
+   * Arenas can be nested: the innermost one of each thread is used.
+   * The matrices allocated in an arena must be destroyed before it,
+   * in the same thread.  Without an arena, the arena_allocator falls
+   * back to the aligned heap allocation.
+   */
+  class Arena {
+  public:
+    /// Initial capacity of the arenas in bytes
+    static constexpr size_t defaultCapacity = size_t(1)<<20;
+
+  private:
+    /// Header of each memory chunk of the arena
+    struct Chunk {
+      /// Previously allocated chunk
+      Chunk* previous;
+      /// Size in bytes of the chunk, including this header
+      size_t size;
+    };
+
+    /// Alignment of the chunks
+    static constexpr size_t chunkAlignment = 4096;
+
+    /// Last allocated chunk, used for new blocks
+    Chunk* _chunk;
+    /// Next free byte in the last chunk
+    char* _top;
+    /// End of the last chunk
+    char* _end;
+    /// Number of blocks not yet released
+    size_t _live;
+    /// Total size in bytes of all chunks
+    size_t _capacity;
+    /// Arena active before this one was created
+    Arena* _outer;
+
+  public:
+    /// Create an arena and make it the active one of this thread
+    explicit Arena(const size_t capacity=defaultCapacity)
+      : _chunk(nullptr),_top(nullptr),_end(nullptr),
+        _live(0),_capacity(0),_outer(active()) {
+      _grow(capacity);
+      active() = this;
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// Free all memory and reactivate the previous arena
+    ~Arena() {
+      assert( (_live == 0) && "matrices outlive their arena" );
+      assert( (active() == this) && "arenas destroyed out of order" );
+      _release();
+      active() = _outer;
+    }
+
+    /// Number of blocks not yet released
+    inline size_t live() const { return _live; }
+
+    /// Total size in bytes reserved by this arena
+    inline size_t capacity() const { return _capacity; }
+
+    /// The innermost arena of this thread, or nullptr
+    static inline Arena*& active() {
+      static thread_local Arena* current = nullptr;
+      return current;
+    }
+
+    /**
+     * Reserve n bytes aligned to align, preceded by head bytes of
+     * which the allocator uses the last two pointers.
+     */
+    inline char* allocate(const size_t n,
+                          const size_t align,
+                          const size_t head) {
+      char* p = _align(_top + head,align);
+      if (p + n > _end) {
+        _grow(n + head + align);
+        p = _align(_top + head,align);
+      }
+
+      // remember where the block began, to release it in LIFO order
+      reinterpret_cast<char**>(p)[-2] = _top;
+      reinterpret_cast<Arena**>(p)[-1] = this;
+
+      _top = p + n;
+      ++_live;
+      return p;
+    }
+
+    /// Release the block p of n bytes
+    inline void deallocate(char* p,const size_t n) {
+      assert(_live > 0);
+      if (--_live == 0) {
+        _reset();
+      } else if (p + n == _top) {
+        // the last block is reused right away
+        _top = reinterpret_cast<char**>(p)[-2];
+      }
+    }
+
+  private:
+    // Round p up to the next multiple of align
+    static inline char* _align(char* p,const size_t align) {
+      const std::uintptr_t a = reinterpret_cast<std::uintptr_t>(p);
+      return reinterpret_cast<char*>((a + align - 1)/align*align);
+    }
+
+    // Add a new chunk of at least n bytes
+    void _grow(const size_t n) {
+      // each new chunk at least doubles the capacity
+      const size_t size = std::max(n + sizeof(Chunk),2*_capacity);
+      void* mem = boost::alignment::aligned_alloc(chunkAlignment,size);
+      if (mem == nullptr) {
+        throw std::bad_alloc();
+      }
+
+      Chunk* chunk = static_cast<Chunk*>(mem);
+      chunk->previous = _chunk;
+      chunk->size = size;
+
+      _chunk = chunk;
+      _top = reinterpret_cast<char*>(chunk + 1);
+      _end = reinterpret_cast<char*>(chunk) + size;
+      _capacity += size;
+    }
+
+    // Free all chunks
+    void _release() {
+      while (_chunk != nullptr) {
+        Chunk* previous = _chunk->previous;
+        boost::alignment::aligned_free(_chunk);
+        _chunk = previous;
+      }
+      _top = _end = nullptr;
+      _capacity = 0;
+    }
+
+    /*
+     * Start again at the beginning of the arena.  If it needed several
+     * chunks, they are replaced by a single one of the total size, so
+     * that the next round fits in one.
+     */
+    void _reset() {
+      if (_chunk->previous != nullptr) {
+        const size_t capacity = _capacity;
+        _release();
+        _grow(capacity);
+      } else {
+        _top = reinterpret_cast<char*>(_chunk + 1);
+      }
+    }
+  };
+
+  /**
+   * Allocator taking the memory from the active anpi::Arena.
+   *
+   * Like the aligned_row_allocator, it aligns the memory to Align bytes
+   * and asks anpi::Matrix to pad each row to a multiple of Align bytes.
+   * The allocator is stateless, so that matrices may exchange their
+   * memory with move operations and swap().  Each block is preceded by
+   * a small header, which identifies the arena it belongs to, or the
+   * heap if no arena was active when it was allocated.
+   */
+  template<class T, std::size_t Align=DefaultAlignment>
+  class arena_allocator {
+  public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    /// Change the stored type
+    template<class U>
+    struct rebind {
+      typedef arena_allocator<U, Align> other;
+    };
+
+    /// Type to identify this as a row-aligned allocator
+    typedef std::true_type row_aligned;
+
+  private:
+    /// Alignment of the blocks
+    static constexpr size_t alignment =
+      (Align > alignof(T)) ? Align : alignof(T);
+
+    /// Bytes before each block, holding two pointers
+    static constexpr size_t head =
+      (2*sizeof(void*) + alignment - 1)/alignment*alignment;
+
+  public:
+    arena_allocator() noexcept {}
+
+    template<class U>
+    arena_allocator(const arena_allocator<U,Align>&) noexcept {}
+
+    /// Allocate n entries from the active arena, or from the heap
+    pointer allocate(const size_type n) {
+      const size_t bytes = n*sizeof(T);
+      Arena* arena = Arena::active();
+      if (arena != nullptr) {
+        return reinterpret_cast<pointer>(arena->allocate(bytes,alignment,head));
+      }
+
+      void* mem = boost::alignment::aligned_alloc(alignment,head + bytes);
+      if (mem == nullptr) {
+        throw std::bad_alloc();
+      }
+      char* p = static_cast<char*>(mem) + head;
+      reinterpret_cast<Arena**>(p)[-1] = nullptr;
+      return reinterpret_cast<pointer>(p);
+    }
+
+    /// Release the n entries at ptr
+    void deallocate(const pointer ptr,const size_type n) noexcept {
+      char* p = reinterpret_cast<char*>(ptr);
+      Arena* arena = reinterpret_cast<Arena**>(p)[-1];
+      if (arena != nullptr) {
+        arena->deallocate(p,n*sizeof(T));
+      } else {
+        boost::alignment::aligned_free(p - head);
+      }
+    }
+
+    /// All arena allocators can release the memory of each other
+    template<class U>
+    inline bool operator==(const arena_allocator<U,Align>&) const noexcept {
+      return true;
+    }
+
+    template<class U>
+    inline bool operator!=(const arena_allocator<U,Align>&) const noexcept {
+      return false;
+    }
+  };
+
+  // Specialization for the arena allocator
+  template<typename T, std::size_t A>
+  struct is_aligned_alloc< anpi::arena_allocator<T,A> > {
+    static const bool value = true;
+  };
+
+} // namespace anpi
+
+#endif
@@ -0,0 +1,312 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_BATCHED_MATRIX_HPP
+#define ANPI_BATCHED_MATRIX_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "Allocator.hpp"
+#include "Exception.hpp"
+#include "Matrix.hpp"
+#include "bits/MatrixBatched.hpp"
+
+namespace anpi
+{
+  /**
+   * Batch of many small matrices with the same size, interleaved
+   * entry by entry.
+   *
+   * The entry (i,j) of all matrices of the batch is stored
+   * contiguously, as one row of an anpi::Matrix with rows()*cols()
+   * rows and batch() columns.  A register of the widest instruction
+   * set therefore holds the same entry of 8 or 16 matrices, and the
+   * batched operations compute all those matrices at once, one in each
+   * lane, without any shuffling.  This pays off for large batches of
+   * small matrices (up to about 16x16), which are too small for the
+   * blocked algorithms of single matrices.
+   *
+   * \code
+   * std::vector< anpi::Matrix<float> > a(10000,anpi::Matrix<float>(8,8));
+   * std::vector< anpi::Matrix<float> > b(10000,anpi::Matrix<float>(8,1));
+   * // ... fill the systems
+   * anpi::BatchedMatrix<float> ba(a),bb(b);
+   * anpi::BatchedMatrix<float> x = anpi::solve(ba,bb);  // a[i]*x[i] = b[i]
+   * std::vector< anpi::Matrix<float> > sol = x.matrices();
+   * \endcode
+   */
+  template<typename T,class Alloc=aligned_row_allocator<T> >
+  class BatchedMatrix {
+  public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+
+  private:
+    /// Rows of each matrix
+    size_t _rows;
+    /// Columns of each matrix
+    size_t _cols;
+    /// Row i*_cols+j holds the entry (i,j) of all matrices
+    Matrix<T,Alloc> _data;
+
+  public:
+    /// Empty batch
+    BatchedMatrix();
+
+    /// Batch of rows x cols matrices, with all entries set to initVal
+    BatchedMatrix(const size_t rows,
+                  const size_t cols,
+                  const size_t batch,
+                  const T initVal=T());
+
+    /// Batch of rows x cols matrices, not initialized
+    BatchedMatrix(const size_t rows,
+                  const size_t cols,
+                  const size_t batch,
+                  const InitializationType);
+
+    /// Batch with copies of the given matrices, all of the same size
+    template<class A>
+    explicit BatchedMatrix(const std::vector< Matrix<T,A> >& m);
+
+    /// Rows of each matrix
+    inline size_t rows() const { return _rows; }
+
+    /// Columns of each matrix
+    inline size_t cols() const { return _cols; }
+
+    /// Number of matrices
+    inline size_t batch() const { return _data.cols(); }
+
+    /// Check if the batch has no entries
+    inline bool empty() const { return _data.empty(); }
+
+    /**
+     * Distance between the lanes of consecutive entries.  The entry
+     * (i,j) of the matrix b is entry(0,0)[(i*cols()+j)*stride() + b].
+     */
+    inline size_t stride() const { return _data.dcols(); }
+
+    /// Entry (i,j) of all matrices, with batch() lanes
+    inline T* entry(const size_t i,const size_t j) {
+      assert( (i < _rows) && (j < _cols) );
+      return _data[i*_cols+j];
+    }
+
+    /// Entry (i,j) of all matrices, with batch() lanes
+    inline const T* entry(const size_t i,const size_t j) const {
+      assert( (i < _rows) && (j < _cols) );
+      return _data[i*_cols+j];
+    }
+
+    /// Entry (i,j) of the matrix b
+    inline T& operator()(const size_t b,const size_t i,const size_t j) {
+      return entry(i,j)[b];
+    }
+
+    /// Entry (i,j) of the matrix b
+    inline const T& operator()(const size_t b,
+                               const size_t i,
+                               const size_t j) const {
+      return entry(i,j)[b];
+    }
+
+    /// View of the interleaved storage, with one row per entry
+    inline MatrixView<T> storage() { return _data.view(); }
+
+    /// Read-only view of the interleaved storage, with one row per entry
+    inline ConstMatrixView<T> storage() const { return _data.view(); }
+
+    /// Copy of the matrix b
+    Matrix<T,Alloc> matrix(const size_t b) const;
+
+    /// Replace the matrix b with m, of rows() x cols()
+    void setMatrix(const size_t b,const ConstMatrixView<T>& m);
+
+    /// Copies of all matrices of the batch
+    template<class A=Alloc>
+    std::vector< Matrix<T,A> > matrices() const;
+
+    /**
+     * Reserve memory for a batch of rows x cols matrices, if the size
+     * changes.  The content is undefined afterwards.
+     */
+    void allocate(const size_t rows,const size_t cols,const size_t batch);
+
+    /// Set all entries of all matrices to val
+    inline void fill(const T val) { _data.fill(val); }
+
+    /// Exchange the content with the other batch
+    void swap(BatchedMatrix<T,Alloc>& other);
+
+    /**
+     * @name Comparison operators
+     */
+    //@{
+    bool operator==(const BatchedMatrix<T,Alloc>& other) const;
+
+    inline bool operator!=(const BatchedMatrix<T,Alloc>& other) const {
+      return !operator==(other);
+    }
+    //@}
+
+    /**
+     * @name Arithmetic operators
+     */
+    //@{
+
+    /// Sum the matrices of another batch to the ones in here
+    BatchedMatrix<T,Alloc>& operator+=(const BatchedMatrix<T,Alloc>& other);
+
+    /// Subtract the matrices of another batch from the ones in here
+    BatchedMatrix<T,Alloc>& operator-=(const BatchedMatrix<T,Alloc>& other);
+    //@}
+  };
+
+  /**
+   * @name Batched arithmetic
+   *
+   * All operations are computed independently for each matrix of the
+   * batch, with the matrices of a register processed simultaneously.
+   */
+  //@{
+
+  /// Sums a[i] + b[i]
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> operator+(const BatchedMatrix<T,Alloc>& a,
+                                   const BatchedMatrix<T,Alloc>& b);
+
+  /// Differences a[i] - b[i]
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> operator-(const BatchedMatrix<T,Alloc>& a,
+                                   const BatchedMatrix<T,Alloc>& b);
+
+  /**
+   * Products c[i] = a[i]*b[i].  c is resized, and may be a or b.
+   */
+  template<typename T,class Alloc>
+  void multiply(const BatchedMatrix<T,Alloc>& a,
+                const BatchedMatrix<T,Alloc>& b,
+                BatchedMatrix<T,Alloc>& c);
+
+  /// Products a[i]*b[i]
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> operator*(const BatchedMatrix<T,Alloc>& a,
+                                   const BatchedMatrix<T,Alloc>& b);
+  //@}
+
+  /**
+   * LU factorizations with partial pivoting of a batch of square
+   * matrices, P[i]*A[i] = L[i]*U[i], as in anpi::LU.
+   *
+   * Each matrix is pivoted independently: the pivots are searched and
+   * the rows exchanged lane by lane, which costs O(n^2) per matrix.
+   * The elimination, with O(n^3) operations, processes the matrices of
+   * a whole register at once.
+   *
+   * \code
+   * anpi::BatchedLU<double> lu(a);
+   * anpi::BatchedMatrix<double> x = lu.solve(b);  // a[i]*x[i] = b[i]
+   * \endcode
+   */
+  template<typename T,class Alloc=aligned_row_allocator<T> >
+  class BatchedLU {
+    static_assert( std::is_floating_point<T>::value,
+                   "LU factorization requires a real floating point type" );
+
+  public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+
+  private:
+    /// L below the diagonal (without its unit diagonal) and U above
+    BatchedMatrix<T,Alloc> _lu;
+    /// Row exchanged with row k at step k, of matrix b at k*batch()+b
+    std::vector<size_t> _pivots;
+    /// Matrices with some zero pivot
+    std::vector<char> _singular;
+
+  public:
+    /// Empty factorization
+    BatchedLU();
+
+    /**
+     * Factorize the square matrices of a.
+     *
+     * @throws anpi::Exception if the matrices are not square
+     */
+    explicit BatchedLU(const BatchedMatrix<T,Alloc>& a);
+
+    /**
+     * Replace the factorization with the one of the square matrices
+     * of a.
+     *
+     * @throws anpi::Exception if the matrices are not square
+     */
+    void factorize(const BatchedMatrix<T,Alloc>& a);
+
+    /// Number of rows (and columns) of the factorized matrices
+    inline size_t size() const { return _lu.rows(); }
+
+    /// Number of factorized matrices
+    inline size_t batch() const { return _lu.batch(); }
+
+    /// Check if the matrix b is singular
+    inline bool singular(const size_t b) const { return _singular[b] != 0; }
+
+    /// Check if some matrix of the batch is singular
+    bool singular() const;
+
+    /**
+     * Factors L and U packed in one batch: U on and above the diagonal
+     * and L below it, with its unit diagonal implicit.  The factors of
+     * singular matrices are undefined.
+     */
+    inline const BatchedMatrix<T,Alloc>& packed() const { return _lu; }
+
+    /// Row exchanged with row k at step k of the factorization of b
+    inline size_t pivot(const size_t b,const size_t k) const {
+      return _pivots[k*batch() + b];
+    }
+
+    /**
+     * Solve A[i]*X[i] = B[i] for all matrices of the batch,
+     * overwriting B with X.
+     *
+     * @throws anpi::Exception if some matrix is singular
+     */
+    void solveInPlace(BatchedMatrix<T,Alloc>& b) const;
+
+    /**
+     * Solutions X[i] of A[i]*X[i] = B[i].
+     *
+     * @throws anpi::Exception if some matrix is singular
+     */
+    BatchedMatrix<T,Alloc> solve(const BatchedMatrix<T,Alloc>& b) const;
+  };
+
+  /**
+   * Solutions X[i] of A[i]*X[i] = B[i] for a batch of systems.
+   *
+   * @throws anpi::Exception if the matrices are not square or some of
+   *         them is singular
+   */
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> solve(const BatchedMatrix<T,Alloc>& a,
+                               const BatchedMatrix<T,Alloc>& b);
+
+} // namespace anpi
+
+#include "BatchedMatrix.tpp"
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#include <algorithm>
+#include <utility>
+
+namespace anpi
+{
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc>::BatchedMatrix() : _rows(0),_cols(0),_data() {}
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc>::BatchedMatrix(const size_t rows,
+                                        const size_t cols,
+                                        const size_t batch,
+                                        const T initVal)
+    : _rows(rows),_cols(cols),_data(rows*cols,batch,initVal) {}
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc>::BatchedMatrix(const size_t rows,
+                                        const size_t cols,
+                                        const size_t batch,
+                                        const InitializationType it)
+    : _rows(rows),_cols(cols),_data(rows*cols,batch,it) {}
+
+  template<typename T,class Alloc>
+  template<class A>
+  BatchedMatrix<T,Alloc>::BatchedMatrix(const std::vector< Matrix<T,A> >& m)
+    : BatchedMatrix() {
+    if (m.empty()) {
+      return;
+    }
+    allocate(m.front().rows(),m.front().cols(),m.size());
+    for (size_t b=0;b<m.size();++b) {
+      setMatrix(b,m[b]);
+    }
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> BatchedMatrix<T,Alloc>::matrix(const size_t b) const {
+    assert( b < batch() );
+    Matrix<T,Alloc> m(_rows,_cols,DoNotInitialize);
+    for (size_t i=0;i<_rows;++i) {
+      T* mi = m[i];
+      for (size_t j=0;j<_cols;++j) {
+        mi[j] = _data(i*_cols+j,b);
+      }
+    }
+    return m;
+  }
+
+  template<typename T,class Alloc>
+  void BatchedMatrix<T,Alloc>::setMatrix(const size_t b,
+                                         const ConstMatrixView<T>& m) {
+    assert( b < batch() );
+    assert( (m.rows() == _rows) && (m.cols() == _cols) );
+    for (size_t i=0;i<_rows;++i) {
+      const T* mi = m[i];
+      for (size_t j=0;j<_cols;++j) {
+        _data(i*_cols+j,b) = mi[j];
+      }
+    }
+  }
+
+  template<typename T,class Alloc>
+  template<class A>
+  std::vector< Matrix<T,A> > BatchedMatrix<T,Alloc>::matrices() const {
+    std::vector< Matrix<T,A> > m;
+    m.reserve(batch());
+    for (size_t b=0;b<batch();++b) {
+      m.emplace_back(_rows,_cols,DoNotInitialize);
+    }
+
+    // each entry of the storage is read once, contiguously
+    for (size_t i=0;i<_rows;++i) {
+      for (size_t j=0;j<_cols;++j) {
+        const T* lanes = _data[i*_cols+j];
+        for (size_t b=0;b<m.size();++b) {
+          m[b](i,j) = lanes[b];
+        }
+      }
+    }
+    return m;
+  }
+
+  template<typename T,class Alloc>
+  void BatchedMatrix<T,Alloc>::allocate(const size_t rows,
+                                        const size_t cols,
+                                        const size_t batch) {
+    _data.allocate(rows*cols,batch);
+    _rows = rows;
+    _cols = cols;
+  }
+
+  template<typename T,class Alloc>
+  void BatchedMatrix<T,Alloc>::swap(BatchedMatrix<T,Alloc>& other) {
+    std::swap(_rows,other._rows);
+    std::swap(_cols,other._cols);
+    _data.swap(other._data);
+  }
+
+  template<typename T,class Alloc>
+  bool
+  BatchedMatrix<T,Alloc>::operator==(const BatchedMatrix<T,Alloc>& o) const {
+    return (_rows == o._rows) && (_cols == o._cols) && (_data == o._data);
+  }
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc>&
+  BatchedMatrix<T,Alloc>::operator+=(const BatchedMatrix<T,Alloc>& other) {
+    assert( (_rows == other._rows) && (_cols == other._cols) );
+    _data += other._data;
+    return *this;
+  }
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc>&
+  BatchedMatrix<T,Alloc>::operator-=(const BatchedMatrix<T,Alloc>& other) {
+    assert( (_rows == other._rows) && (_cols == other._cols) );
+    _data -= other._data;
+    return *this;
+  }
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> operator+(const BatchedMatrix<T,Alloc>& a,
+                                   const BatchedMatrix<T,Alloc>& b) {
+    assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+            (a.batch() == b.batch()) );
+    BatchedMatrix<T,Alloc> c(a.rows(),a.cols(),a.batch(),DoNotInitialize);
+    ::anpi::aimpl::add(a.storage(),b.storage(),c.storage());
+    return c;
+  }
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> operator-(const BatchedMatrix<T,Alloc>& a,
+                                   const BatchedMatrix<T,Alloc>& b) {
+    assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+            (a.batch() == b.batch()) );
+    BatchedMatrix<T,Alloc> c(a.rows(),a.cols(),a.batch(),DoNotInitialize);
+    ::anpi::aimpl::subtract(a.storage(),b.storage(),c.storage());
+    return c;
+  }
+
+  template<typename T,class Alloc>
+  void multiply(const BatchedMatrix<T,Alloc>& a,
+                const BatchedMatrix<T,Alloc>& b,
+                BatchedMatrix<T,Alloc>& c) {
+    assert( (a.cols() == b.rows()) && (a.batch() == b.batch()) );
+    if ((&c == &a) || (&c == &b)) {
+      // the products cannot overwrite their factors
+      BatchedMatrix<T,Alloc> tmp;
+      ::anpi::multiply(a,b,tmp);
+      c.swap(tmp);
+      return;
+    }
+
+    c.allocate(a.rows(),b.cols(),a.batch());
+    if (c.empty()) {
+      return;
+    }
+    ::anpi::aimpl::batchedProduct(a.rows(),a.cols(),b.cols(),
+                                  a.storage().data(),a.stride(),
+                                  b.storage().data(),b.stride(),
+                                  c.storage().data(),c.stride(),
+                                  a.batch());
+  }
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> operator*(const BatchedMatrix<T,Alloc>& a,
+                                   const BatchedMatrix<T,Alloc>& b) {
+    BatchedMatrix<T,Alloc> c;
+    ::anpi::multiply(a,b,c);
+    return c;
+  }
+
+  template<typename T,class Alloc>
+  BatchedLU<T,Alloc>::BatchedLU() : _lu(),_pivots(),_singular() {}
+
+  template<typename T,class Alloc>
+  BatchedLU<T,Alloc>::BatchedLU(const BatchedMatrix<T,Alloc>& a)
+    : BatchedLU() {
+    factorize(a);
+  }
+
+  template<typename T,class Alloc>
+  void BatchedLU<T,Alloc>::factorize(const BatchedMatrix<T,Alloc>& a) {
+    if (a.rows() != a.cols()) {
+      throw anpi::Exception("LU factorization of non-square matrices");
+    }
+
+    _lu = a;
+    _pivots.resize(size()*batch());
+    _singular.assign(batch(),char(0));
+    if (_lu.empty()) {
+      return;
+    }
+    ::anpi::aimpl::batchedLU(size(),_lu.storage().data(),_lu.stride(),
+                             _pivots.data(),batch(),_singular.data(),
+                             batch());
+  }
+
+  template<typename T,class Alloc>
+  bool BatchedLU<T,Alloc>::singular() const {
+    return std::find(_singular.begin(),_singular.end(),char(1)) !=
+           _singular.end();
+  }
+
+  template<typename T,class Alloc>
+  void BatchedLU<T,Alloc>::solveInPlace(BatchedMatrix<T,Alloc>& b) const {
+    assert( (b.rows() == size()) && (b.batch() == batch()) );
+    if (singular()) {
+      throw anpi::Exception("Singular matrix in linear system");
+    }
+    if (b.empty()) {
+      return;
+    }
+    ::anpi::aimpl::batchedSolve(size(),b.cols(),
+                                _lu.storage().data(),_lu.stride(),
+                                _pivots.data(),batch(),
+                                b.storage().data(),b.stride(),
+                                batch());
+  }
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc>
+  BatchedLU<T,Alloc>::solve(const BatchedMatrix<T,Alloc>& b) const {
+    BatchedMatrix<T,Alloc> x(b);
+    solveInPlace(x);
+    return x;
+  }
+
+  template<typename T,class Alloc>
+  BatchedMatrix<T,Alloc> solve(const BatchedMatrix<T,Alloc>& a,
+                               const BatchedMatrix<T,Alloc>& b) {
+    return BatchedLU<T,Alloc>(a).solve(b);
+  }
+
+} // namespace anpi
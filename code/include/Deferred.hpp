@@ -0,0 +1,370 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_DEFERRED_HPP
+#define ANPI_DEFERRED_HPP
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+
+namespace anpi
+{
+  /**
+   * Blocking of the fused element-wise passes of anpi::DeferredGraph.
+   *
+   * A fused pass evaluates all its operations on a strip of entries
+   * before moving to the next strip, so that the partial results of
+   * each strip stay in the cache instead of filling temporary matrices.
+   */
+  struct deferred_blocking {
+    /// Entries of each strip
+    static constexpr size_t strip = 1024;
+  };
+
+  /// Operations recorded in an anpi::DeferredGraph
+  enum class DeferredOp {
+    Input,          ///< A matrix given by the user
+    Add,            ///< a + b
+    Subtract,       ///< a - b
+    Multiply,       ///< Element-wise a * b
+    Divide,         ///< Element-wise a / b
+    Scale,          ///< a * s
+    DivideScalar,   ///< a / s
+    Product         ///< Matrix product a * b
+  };
+
+  /// Summary of the last evaluation of an anpi::DeferredGraph
+  struct deferred_statistics {
+    /// Nodes needed by the outputs
+    size_t nodes;
+    /// Passes over the memory: fused element-wise passes and products
+    size_t tasks;
+    /// Groups of independent tasks, each one run in parallel
+    size_t waves;
+    /// Largest number of buffers holding results at the same time
+    size_t buffers;
+    /// Buffers that had to be allocated, instead of recycled
+    size_t allocations;
+  };
+
+  template<typename T,class Alloc> class DeferredGraph;
+
+  /**
+   * Handle of a node of an anpi::DeferredGraph.
+   *
+   * The operators on handles do not compute anything: they record a
+   * new node in the graph and return its handle.  Handles are valid
+   * as long as their graph exists and is not cleared.
+   */
+  template<typename T,class Alloc=aligned_row_allocator<T> >
+  class Deferred {
+  public:
+    typedef T value_type;
+    typedef DeferredGraph<T,Alloc> graph_type;
+
+  private:
+    /// Graph holding the node
+    graph_type* _graph;
+    /// Index of the node in the graph
+    size_t _node;
+
+  public:
+    /// Invalid handle
+    inline Deferred() : _graph(nullptr),_node(0) {}
+
+    /// Handle of the given node
+    inline Deferred(graph_type* graph,const size_t node)
+      : _graph(graph),_node(node) {}
+
+    /// Graph holding the node
+    inline graph_type& graph() const { return *_graph; }
+
+    /// Index of the node in the graph
+    inline size_t node() const { return _node; }
+
+    /// Rows of the result
+    inline size_t rows() const;
+
+    /// Columns of the result
+    inline size_t cols() const;
+  };
+
+  /**
+   * Graph of matrix operations, which are evaluated at once.
+   *
+   * The matrices entering the graph are registered with input(), and
+   * the operators on the returned handles record new nodes.  The
+   * results requested with output() are computed by eval():
+   *
+   * \code
+   * anpi::DeferredGraph<float> g;
+   * auto a = g.input(ma);
+   * auto b = g.input(mb);
+   * auto s = a + b;
+   * g.output(anpi::multiply(s,s) - s*2.f,mc);   // element-wise
+   * g.output(s*a,md);                           // matrix product
+   * g.eval();
+   * \endcode
+   *
+   * The graph is analyzed as follows:
+   *
+   * - Identical operations on the same operands are recorded once
+   *   (common subexpression elimination), so that a + b is computed
+   *   once above.
+   * - Element-wise nodes used by one single element-wise node are
+   *   fused into it.  Each group is computed in one pass, strip by
+   *   strip (see deferred_blocking), without temporary matrices.
+   *   Results used several times, by products, or as outputs are
+   *   kept in buffers.
+   * - The passes are grouped in waves of independent tasks, which run
+   *   in parallel, one per thread.  A wave with one task splits it
+   *   among the threads instead.
+   * - Each buffer returns to a pool after its last reader, and is
+   *   reused by later results of the same size.  The pool is kept
+   *   between evaluations.
+   *
+   * The inputs are referenced, not copied, so that the graph can be
+   * evaluated again after they change.  Outputs are written at the
+   * end of the evaluation, so that they can also be inputs.
+   *
+   * The graph cannot be copied, as the handles refer to it.
+   */
+  template<typename T,class Alloc=aligned_row_allocator<T> >
+  class DeferredGraph {
+  public:
+    typedef T value_type;
+    typedef Matrix<T,Alloc> matrix_type;
+    typedef Deferred<T,Alloc> handle_type;
+
+  private:
+    /// A recorded operation
+    struct node {
+      DeferredOp op;
+      /// Operands, or the index of the input
+      size_t lhs,rhs;
+      /// Scalar operand
+      T scalar;
+      /// Size of the result
+      size_t rows,cols;
+    };
+
+    /// Key of the operations, to find repeated ones
+    struct node_key {
+      DeferredOp op;
+      size_t lhs,rhs;
+      T scalar;
+
+      bool operator<(const node_key& other) const;
+    };
+
+    /// All recorded nodes, each one after its operands
+    std::vector<node> _nodes;
+    /// Matrices of the input nodes
+    std::vector<const matrix_type*> _inputs;
+    /// Node of each recorded operation
+    std::map<node_key,size_t> _known;
+    /// Requested results: node and destination
+    std::vector< std::pair<size_t,matrix_type*> > _outputs;
+
+    /// All buffers, used or not; a deque does not move them
+    std::deque<matrix_type> _buffers;
+    /// Buffers not in use
+    std::vector<matrix_type*> _free;
+
+    /// Summary of the last evaluation
+    deferred_statistics _stats;
+
+    /**
+     * Step of a fused pass: with DeferredOp::Input it pushes the
+     * entries of a node on the stack, and otherwise it replaces the
+     * operands on the top of the stack with the result of op.
+     */
+    struct instruction {
+      DeferredOp op;
+      size_t node;
+      T scalar;
+    };
+
+    /// One pass over the memory: a fused element-wise group or a product
+    struct task {
+      /// Node computed
+      size_t node;
+      /// Nodes in buffers (or inputs) read by the task
+      std::vector<size_t> reads;
+      /// Fused pass, in postfix order
+      std::vector<instruction> program;
+      /// Largest size of the stack of the program
+      size_t depth;
+      /// Wave of the task
+      size_t level;
+    };
+
+    /// Record an operation, or find the same one recorded before
+    size_t record(const node& n);
+
+    /// Unused buffer, with the given size
+    matrix_type* acquire(const size_t rows,const size_t cols);
+
+    /**
+     * Append to t the program of node n, stopping at the nodes kept in
+     * buffers
+     */
+    void compile(const size_t n,const bool root,
+                 const std::vector<bool>& kept,task& t) const;
+
+    /// Run the fused pass t into dst, with the results of all nodes
+    void runFused(const task& t,
+                  const std::vector<const matrix_type*>& results,
+                  matrix_type& dst) const;
+
+  public:
+    DeferredGraph();
+    DeferredGraph(const DeferredGraph&) = delete;
+    DeferredGraph& operator=(const DeferredGraph&) = delete;
+
+    /**
+     * Node referring to the matrix m, which must exist and keep its
+     * size until the last evaluation.  Registering the same matrix
+     * again returns the same node.
+     */
+    handle_type input(const matrix_type& m);
+
+    /**
+     * Record the operation op (element-wise, or the product) on a and b.
+     *
+     * This is called by the operators on the handles.
+     */
+    handle_type apply(const DeferredOp op,
+                      const handle_type& a,
+                      const handle_type& b);
+
+    /**
+     * Record the operation op on a and the scalar s.
+     *
+     * This is called by the operators on the handles.
+     */
+    handle_type apply(const DeferredOp op,
+                      const handle_type& a,
+                      const T s);
+
+    /**
+     * Request the result of the given node, which eval() will leave
+     * in dst.  The request is kept for the later evaluations.
+     */
+    void output(const handle_type& d,matrix_type& dst);
+
+    /**
+     * Compute all requested outputs.
+     *
+     * @throws anpi::Exception if an input changed its size
+     */
+    void eval();
+
+    /**
+     * Compute only the result of the given node.
+     *
+     * @throws anpi::Exception if an input changed its size
+     */
+    matrix_type eval(const handle_type& d);
+
+    /// Rows of the result of the given node
+    inline size_t rows(const size_t n) const { return _nodes[n].rows; }
+
+    /// Columns of the result of the given node
+    inline size_t cols(const size_t n) const { return _nodes[n].cols; }
+
+    /// Number of recorded nodes
+    inline size_t size() const { return _nodes.size(); }
+
+    /// Summary of the last evaluation
+    inline const deferred_statistics& statistics() const { return _stats; }
+
+    /// Remove all nodes, outputs and buffers
+    void clear();
+  };
+
+  /**
+   * @name Deferred operations
+   *
+   * Both operands must belong to the same graph.
+   */
+  //@{
+
+  /// Sum of two nodes
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc> operator+(const Deferred<T,Alloc>& a,
+                                     const Deferred<T,Alloc>& b) {
+    return a.graph().apply(DeferredOp::Add,a,b);
+  }
+
+  /// Difference of two nodes
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc> operator-(const Deferred<T,Alloc>& a,
+                                     const Deferred<T,Alloc>& b) {
+    return a.graph().apply(DeferredOp::Subtract,a,b);
+  }
+
+  /// Element-wise product of two nodes
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc> multiply(const Deferred<T,Alloc>& a,
+                                    const Deferred<T,Alloc>& b) {
+    return a.graph().apply(DeferredOp::Multiply,a,b);
+  }
+
+  /// Element-wise quotient of two nodes
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc> divide(const Deferred<T,Alloc>& a,
+                                  const Deferred<T,Alloc>& b) {
+    return a.graph().apply(DeferredOp::Divide,a,b);
+  }
+
+  /// Matrix product of two nodes
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc> operator*(const Deferred<T,Alloc>& a,
+                                     const Deferred<T,Alloc>& b) {
+    return a.graph().apply(DeferredOp::Product,a,b);
+  }
+
+  /// Product of a node and a scalar
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc>
+  operator*(const Deferred<T,Alloc>& a,
+            const typename Deferred<T,Alloc>::value_type s) {
+    return a.graph().apply(DeferredOp::Scale,a,s);
+  }
+
+  /// Product of a scalar and a node
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc>
+  operator*(const typename Deferred<T,Alloc>::value_type s,
+            const Deferred<T,Alloc>& a) {
+    return a.graph().apply(DeferredOp::Scale,a,s);
+  }
+
+  /// Quotient of a node and a scalar
+  template<typename T,class Alloc>
+  inline Deferred<T,Alloc>
+  operator/(const Deferred<T,Alloc>& a,
+            const typename Deferred<T,Alloc>::value_type s) {
+    return a.graph().apply(DeferredOp::DivideScalar,a,s);
+  }
+  //@}
+
+} // namespace anpi
+
+#include "Deferred.tpp"
+
+#endif
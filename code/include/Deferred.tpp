@@ -0,0 +1,444 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace anpi
+{
+  namespace detail {
+
+    /// Check if the operation has two matrix operands
+    inline bool binaryOp(const DeferredOp op) {
+      return (op != DeferredOp::Input) &&
+             (op != DeferredOp::Scale) &&
+             (op != DeferredOp::DivideScalar);
+    }
+
+    /// out = a op b (or a op s) for n entries
+    template<typename T>
+    void deferredStrip(const DeferredOp op,
+                       const T* a,const T* b,const T s,
+                       T* out,const size_t n) {
+      const ConstMatrixView<T> va(a,1,n,n);
+      const MatrixView<T> vo(out,1,n,n);
+
+      switch (op) {
+      case DeferredOp::Add:
+        vo = va + ConstMatrixView<T>(b,1,n,n);
+        break;
+      case DeferredOp::Subtract:
+        vo = va - ConstMatrixView<T>(b,1,n,n);
+        break;
+      case DeferredOp::Multiply:
+        vo = ::anpi::multiply(va,ConstMatrixView<T>(b,1,n,n));
+        break;
+      case DeferredOp::Divide:
+        vo = ::anpi::divide(va,ConstMatrixView<T>(b,1,n,n));
+        break;
+      case DeferredOp::Scale:
+        vo = va*s;
+        break;
+      case DeferredOp::DivideScalar:
+        vo = va/s;
+        break;
+      default:
+        assert(false && "Not an element-wise operation");
+      }
+    }
+
+  } // namespace detail
+
+  template<typename T,class Alloc>
+  inline size_t Deferred<T,Alloc>::rows() const {
+    return _graph->rows(_node);
+  }
+
+  template<typename T,class Alloc>
+  inline size_t Deferred<T,Alloc>::cols() const {
+    return _graph->cols(_node);
+  }
+
+  template<typename T,class Alloc>
+  bool DeferredGraph<T,Alloc>::node_key::
+  operator<(const node_key& other) const {
+    if (op != other.op) return op < other.op;
+    if (lhs != other.lhs) return lhs < other.lhs;
+    if (rhs != other.rhs) return rhs < other.rhs;
+    // bitwise, as the scalars may have no ordering
+    return std::memcmp(&scalar,&other.scalar,sizeof(T)) < 0;
+  }
+
+  template<typename T,class Alloc>
+  DeferredGraph<T,Alloc>::DeferredGraph() : _stats() {}
+
+  template<typename T,class Alloc>
+  size_t DeferredGraph<T,Alloc>::record(const node& n) {
+    const node_key key = { n.op,n.lhs,n.rhs,n.scalar };
+    const auto it = _known.find(key);
+    if (it != _known.end()) {
+      return it->second;
+    }
+    _nodes.push_back(n);
+    _known.insert(std::make_pair(key,_nodes.size()-1));
+    return _nodes.size()-1;
+  }
+
+  template<typename T,class Alloc>
+  Deferred<T,Alloc>
+  DeferredGraph<T,Alloc>::input(const matrix_type& m) {
+    const auto it = std::find(_inputs.begin(),_inputs.end(),&m);
+    const size_t idx = it - _inputs.begin();
+    if (it == _inputs.end()) {
+      _inputs.push_back(&m);
+    }
+    const node n = { DeferredOp::Input,idx,0,T(),m.rows(),m.cols() };
+    return handle_type(this,record(n));
+  }
+
+  template<typename T,class Alloc>
+  Deferred<T,Alloc>
+  DeferredGraph<T,Alloc>::apply(const DeferredOp op,
+                                const handle_type& a,
+                                const handle_type& b) {
+    assert( (&a.graph() == this) && (&b.graph() == this) );
+    assert( ::anpi::detail::binaryOp(op) );
+
+    const node& na = _nodes[a.node()];
+    const node& nb = _nodes[b.node()];
+    node n = { op,a.node(),b.node(),T(),na.rows,na.cols };
+
+    if (op == DeferredOp::Product) {
+      assert( na.cols == nb.rows );
+      n.cols = nb.cols;
+    } else {
+      assert( (na.rows == nb.rows) && (na.cols == nb.cols) );
+    }
+
+    // a+b and b+a are the same node
+    if (((op == DeferredOp::Add) || (op == DeferredOp::Multiply)) &&
+        (n.lhs > n.rhs)) {
+      std::swap(n.lhs,n.rhs);
+    }
+    return handle_type(this,record(n));
+  }
+
+  template<typename T,class Alloc>
+  Deferred<T,Alloc>
+  DeferredGraph<T,Alloc>::apply(const DeferredOp op,
+                                const handle_type& a,
+                                const T s) {
+    assert( &a.graph() == this );
+    assert( (op == DeferredOp::Scale) || (op == DeferredOp::DivideScalar) );
+
+    const node& na = _nodes[a.node()];
+    const node n = { op,a.node(),0,s,na.rows,na.cols };
+    return handle_type(this,record(n));
+  }
+
+  template<typename T,class Alloc>
+  void DeferredGraph<T,Alloc>::output(const handle_type& d,matrix_type& dst) {
+    assert( &d.graph() == this );
+    _outputs.push_back(std::make_pair(d.node(),&dst));
+  }
+
+  template<typename T,class Alloc>
+  typename DeferredGraph<T,Alloc>::matrix_type*
+  DeferredGraph<T,Alloc>::acquire(const size_t rows,const size_t cols) {
+    // a buffer of the same size, or at least one without memory
+    auto it = std::find_if(_free.begin(),_free.end(),[&](matrix_type* m) {
+        return (m->rows() == rows) && (m->cols() == cols);
+      });
+    if (it == _free.end()) {
+      it = std::find_if(_free.begin(),_free.end(),[](matrix_type* m) {
+          return m->data() == nullptr;
+        });
+    }
+
+    if (it != _free.end()) {
+      matrix_type* m = *it;
+      *it = _free.back();
+      _free.pop_back();
+      m->allocate(rows,cols);
+      return m;
+    }
+
+    ++_stats.allocations;
+    _buffers.emplace_back(rows,cols,DoNotInitialize);
+    return &_buffers.back();
+  }
+
+  template<typename T,class Alloc>
+  void DeferredGraph<T,Alloc>::compile(const size_t n,
+                                       const bool root,
+                                       const std::vector<bool>& kept,
+                                       task& t) const {
+    const node& nd = _nodes[n];
+    if (!root && kept[n]) {
+      const instruction load = { DeferredOp::Input,n,T() };
+      t.program.push_back(load);
+      t.reads.push_back(n);
+      return;
+    }
+
+    compile(nd.lhs,false,kept,t);
+    if (::anpi::detail::binaryOp(nd.op)) {
+      compile(nd.rhs,false,kept,t);
+    }
+    const instruction step = { nd.op,n,nd.scalar };
+    t.program.push_back(step);
+  }
+
+  template<typename T,class Alloc>
+  void DeferredGraph<T,Alloc>::
+  runFused(const task& t,
+           const std::vector<const matrix_type*>& results,
+           matrix_type& dst) const {
+
+    // local copy, as std::min takes its arguments by reference
+    const size_t strip = deferred_blocking::strip;
+    const size_t steps = t.program.size();
+
+    // matrices with the same padding are processed as one long row
+    bool flat = true;
+    for (const size_t r : t.reads) {
+      flat = flat && (results[r]->dcols() == dst.dcols());
+    }
+    const size_t lines  = flat ? 1 : dst.rows();
+    const size_t length = flat ? dst.rows()*dst.dcols() : dst.cols();
+    if ((lines == 0) || (length == 0)) {
+      return;
+    }
+    const size_t strips = (length + strip - 1)/strip;
+
+    parallelRows(lines*strips,strip,[&](const size_t first,
+                                        const size_t last) {
+      std::vector<T> scratch(t.depth*strip);
+      std::vector<const T*> stack(t.depth);
+
+      for (size_t u=first;u<last;++u) {
+        const size_t line = u/strips;
+        const size_t off  = (u%strips)*strip;
+        const size_t n    = std::min(strip,length-off);
+        T* const out = dst[line] + off;
+
+        size_t top = 0;
+        for (size_t s=0;s<steps;++s) {
+          const instruction& in = t.program[s];
+          if (in.op == DeferredOp::Input) {
+            stack[top++] = (*results[in.node])[line] + off;
+            continue;
+          }
+
+          const T* b = ::anpi::detail::binaryOp(in.op) ? stack[--top] : nullptr;
+          T* res = (s+1 == steps) ? out : scratch.data() + (top-1)*strip;
+          ::anpi::detail::deferredStrip(in.op,stack[top-1],b,in.scalar,res,n);
+          stack[top-1] = res;
+        }
+
+        if (steps == 1) {
+          // the node is just a copy of another one
+          MatrixView<T>(out,1,n,n) = ConstMatrixView<T>(stack[0],1,n,n);
+        }
+      }
+    });
+  }
+
+  template<typename T,class Alloc>
+  void DeferredGraph<T,Alloc>::eval() {
+    _stats = deferred_statistics();
+
+    const size_t nodes = _nodes.size();
+    for (const node& nd : _nodes) {
+      if ((nd.op == DeferredOp::Input) &&
+          ((_inputs[nd.lhs]->rows() != nd.rows) ||
+           (_inputs[nd.lhs]->cols() != nd.cols))) {
+        throw anpi::Exception("Input of a deferred graph changed its size");
+      }
+    }
+
+    // nodes needed by the outputs, and how often each one is read
+    std::vector<bool> needed(nodes,false),kept(nodes,false);
+    std::vector<size_t> uses(nodes,0);
+    for (const auto& o : _outputs) {
+      needed[o.first] = true;
+      kept[o.first] = true;
+    }
+    for (size_t i=nodes;i-->0;) {
+      const node& nd = _nodes[i];
+      if (!needed[i] || (nd.op == DeferredOp::Input)) {
+        continue;
+      }
+      needed[nd.lhs] = true;
+      ++uses[nd.lhs];
+      if (::anpi::detail::binaryOp(nd.op)) {
+        needed[nd.rhs] = true;
+        ++uses[nd.rhs];
+      }
+      if (nd.op == DeferredOp::Product) {
+        // the factors must be in memory, and the product too
+        kept[i] = kept[nd.lhs] = kept[nd.rhs] = true;
+      }
+    }
+
+    // the element-wise nodes read once are fused into their reader
+    _stats.nodes = std::count(needed.begin(),needed.end(),true);
+    for (size_t i=0;i<nodes;++i) {
+      if (needed[i] &&
+          ((uses[i] > 1) || (_nodes[i].op == DeferredOp::Input))) {
+        kept[i] = true;
+      }
+    }
+
+    // one task per node in a buffer, after the tasks it reads
+    std::vector<task> tasks;
+    std::vector<size_t> level(nodes,0);
+    size_t waves = 0;
+    for (size_t i=0;i<nodes;++i) {
+      if (!needed[i] || !kept[i] || (_nodes[i].op == DeferredOp::Input)) {
+        continue;
+      }
+      task t;
+      t.node = i;
+      if (_nodes[i].op == DeferredOp::Product) {
+        t.reads.push_back(_nodes[i].lhs);
+        t.reads.push_back(_nodes[i].rhs);
+      } else {
+        compile(i,true,kept,t);
+      }
+
+      size_t top = 0;
+      t.depth = 0;
+      for (const instruction& in : t.program) {
+        if (in.op == DeferredOp::Input) {
+          t.depth = std::max(t.depth,++top);
+        } else if (::anpi::detail::binaryOp(in.op)) {
+          --top;
+        }
+      }
+
+      t.level = 0;
+      for (const size_t r : t.reads) {
+        t.level = std::max(t.level,level[r]);
+      }
+      level[i] = ++t.level;
+      waves = std::max(waves,t.level);
+      tasks.push_back(std::move(t));
+    }
+    _stats.tasks = tasks.size();
+    _stats.waves = waves;
+
+    // wave after which each buffer is not read anymore
+    std::vector<size_t> lastRead(nodes,0);
+    for (const task& t : tasks) {
+      for (const size_t r : t.reads) {
+        lastRead[r] = std::max(lastRead[r],t.level);
+      }
+    }
+    std::vector<bool> isOutput(nodes,false);
+    for (const auto& o : _outputs) {
+      isOutput[o.first] = true;
+    }
+
+    std::vector<const matrix_type*> results(nodes,nullptr);
+    std::vector<matrix_type*> buffers(nodes,nullptr);
+    for (size_t i=0;i<nodes;++i) {
+      if (needed[i] && (_nodes[i].op == DeferredOp::Input)) {
+        results[i] = _inputs[_nodes[i].lhs];
+      }
+    }
+
+    size_t live = 0;
+    std::vector<const task*> wave;
+    for (size_t w=1;w<=waves;++w) {
+      wave.clear();
+      for (const task& t : tasks) {
+        if (t.level == w) {
+          wave.push_back(&t);
+          buffers[t.node] = acquire(_nodes[t.node].rows,_nodes[t.node].cols);
+          results[t.node] = buffers[t.node];
+        }
+      }
+      live += wave.size();
+      _stats.buffers = std::max(_stats.buffers,live);
+
+      // independent tasks in parallel, or one task split among threads
+      parallelTasks(wave.size(),[&](const size_t k) {
+        const task& t = *wave[k];
+        const node& nd = _nodes[t.node];
+        if (nd.op == DeferredOp::Product) {
+          ::anpi::gemm(T(1),*results[nd.lhs],*results[nd.rhs],T(0),
+                       *buffers[t.node]);
+        } else {
+          runFused(t,results,*buffers[t.node]);
+        }
+      });
+
+      // recycle the buffers read for the last time
+      for (const task* t : wave) {
+        for (const size_t r : t->reads) {
+          if ((lastRead[r] == w) && (buffers[r] != nullptr) && !isOutput[r]) {
+            _free.push_back(buffers[r]);
+            buffers[r] = nullptr;
+            --live;
+          }
+        }
+      }
+    }
+
+    // deliver the outputs, swapping the buffers if possible
+    std::vector<matrix_type*> delivered(nodes,nullptr);
+    for (const auto& o : _outputs) {
+      const size_t i = o.first;
+      if (delivered[i] != nullptr) {
+        *o.second = *delivered[i];
+      } else if (buffers[i] == nullptr) {
+        *o.second = *results[i];
+      } else {
+        o.second->swap(*buffers[i]);
+        _free.push_back(buffers[i]);
+        buffers[i] = nullptr;
+      }
+      delivered[i] = o.second;
+    }
+  }
+
+  template<typename T,class Alloc>
+  typename DeferredGraph<T,Alloc>::matrix_type
+  DeferredGraph<T,Alloc>::eval(const handle_type& d) {
+    assert( &d.graph() == this );
+
+    matrix_type result;
+    std::vector< std::pair<size_t,matrix_type*> > outputs;
+    outputs.push_back(std::make_pair(d.node(),&result));
+    _outputs.swap(outputs);
+    try {
+      eval();
+    } catch (...) {
+      _outputs.swap(outputs);
+      throw;
+    }
+    _outputs.swap(outputs);
+    return result;
+  }
+
+  template<typename T,class Alloc>
+  void DeferredGraph<T,Alloc>::clear() {
+    _nodes.clear();
+    _inputs.clear();
+    _known.clear();
+    _outputs.clear();
+    _free.clear();
+    _buffers.clear();
+    _stats = deferred_statistics();
+  }
+
+} // namespace anpi
@@ -0,0 +1,366 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_FIXED_MATRIX_HPP
+#define ANPI_FIXED_MATRIX_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+
+#include "Matrix.hpp"
+
+namespace anpi
+{
+  namespace detail {
+
+    /**
+     * Call f(0), f(1), ..., f(N-1).  The recursion is resolved at
+     * compile time, and after inlining all indices are constants.
+     */
+    template<size_t N>
+    struct unroll {
+      template<class F>
+      static inline void __attribute__((__always_inline__)) apply(F& f) {
+        unroll<N-1>::apply(f);
+        f(N-1);
+      }
+    };
+
+    template<>
+    struct unroll<0> {
+      template<class F>
+      static inline void apply(F&) {}
+    };
+
+    /**
+     * Alignment of a block of the given bytes: the largest power of
+     * two dividing it, up to align.  Arrays of fixed matrices are
+     * therefore contiguous, with no padding between the matrices.
+     */
+    constexpr size_t fixedAlignment(const size_t bytes,
+                                    const size_t align=DefaultAlignment) {
+      return ((align <= 1) || (bytes % align == 0))
+        ? align : fixedAlignment(bytes,align/2);
+    }
+  } // namespace detail
+
+  /**
+   * Matrix of R x C entries of type T, with the dimensions fixed at
+   * compile time.
+   *
+   * The entries are stored row-major inside the object, without any
+   * padding between the rows, so that creating, copying or destroying
+   * a fixed matrix never touches the heap.  All arithmetic operations
+   * are unrolled at compile time.  This pays off for the small
+   * matrices (2x2, 3x3, 4x4, ...) of geometry and filters, where the
+   * allocation and the runtime sizes of anpi::Matrix cost more than
+   * the arithmetic itself:
+   *
+   * \code
+   * typedef anpi::FixedMatrix<float,3,3> mat3;
+   *
+   * const mat3 r = { {0,-1,0},{1,0,0},{0,0,1} };
+   * mat3 m = r*r + mat3(1.f);
+   * \endcode
+   *
+   * The views of a fixed matrix make it available to all functions
+   * working on views, like the reductions or the products with
+   * dynamic matrices:
+   *
+   * \code
+   * float s = anpi::sum(m.view());
+   * anpi::Matrix<float> d = m.toMatrix(); // dynamic copy
+   * anpi::gemm(1.f,m,d,0.f,e);           // e = m*d
+   * \endcode
+   */
+  template<typename T,size_t R,size_t C>
+  class FixedMatrix {
+    static_assert( (R > 0) && (C > 0), "Fixed matrices cannot be empty" );
+
+  public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+
+    /// Alignment of the entries
+    static constexpr size_t alignment =
+      (detail::fixedAlignment(R*C*sizeof(T)) > alignof(T))
+      ? detail::fixedAlignment(R*C*sizeof(T)) : alignof(T);
+
+  private:
+    /// Entries, stored row-major
+    alignas(alignment) T _data[R*C];
+
+  public:
+    /// All entries initialized with zero
+    FixedMatrix() {
+      fill(T(0));
+    }
+
+    /// Entries not initialized
+    explicit FixedMatrix(const InitializationType) {}
+
+    /// All entries initialized with the given value
+    explicit FixedMatrix(const T initVal) {
+      fill(initVal);
+    }
+
+    /**
+     * Constructs a fixed matrix from a std::initializer_list, which
+     * must have R rows of C entries
+     *
+     * \code
+     * anpi::FixedMatrix<int,2,3> m = { {1,2,3}, {4,5,6} };
+     * \endcode
+     */
+    FixedMatrix(std::initializer_list< std::initializer_list<T> > lst) {
+      assert( lst.size() == R );
+      T* p = _data;
+      for (const auto& row : lst) {
+        assert( row.size() == C );
+        p = std::copy(row.begin(),row.end(),p);
+      }
+    }
+
+    /// Copy of a view with R rows and C columns
+    explicit FixedMatrix(const ConstMatrixView<T>& other) {
+      assert( (other.rows() == R) && (other.cols() == C) );
+      for (size_t r=0;r<R;++r) {
+        std::copy(other[r],other[r]+C,_data + r*C);
+      }
+    }
+
+    /// Copy of a dynamic matrix with R rows and C columns
+    template<class Alloc>
+    explicit FixedMatrix(const Matrix<T,Alloc>& other)
+      : FixedMatrix(ConstMatrixView<T>(other)) {}
+
+    /// Number of rows
+    static constexpr size_t rows() { return R; }
+
+    /// Number of columns
+    static constexpr size_t cols() { return C; }
+
+    /// Distance in entries between the beginnings of two rows
+    static constexpr size_t dcols() { return C; }
+
+    /// Total number of entries (rows x cols)
+    static constexpr size_t entries() { return R*C; }
+
+    /// Fixed matrices are never empty
+    static constexpr bool empty() { return false; }
+
+    /// Pointer to the first entry
+    inline T* data() { return _data; }
+
+    /// Pointer to the first entry
+    inline const T* data() const { return _data; }
+
+    /// Return pointer to a given row
+    inline T* operator[](const size_t row) {
+      return _data + row*C;
+    }
+
+    /// Return read-only pointer to a given row
+    inline const T* operator[](const size_t row) const {
+      return _data + row*C;
+    }
+
+    /// Return reference to the element at the r row and c column
+    inline T& operator()(const size_t row,const size_t col) {
+      return _data[row*C + col];
+    }
+
+    /// Return const reference to the element at the r row and c column
+    inline const T& operator()(const size_t row,const size_t col) const {
+      return _data[row*C + col];
+    }
+
+    /// View of the whole matrix
+    inline MatrixView<T> view() {
+      return MatrixView<T>(_data,R,C,C);
+    }
+
+    /// Read-only view of the whole matrix
+    inline ConstMatrixView<T> view() const {
+      return ConstMatrixView<T>(_data,R,C,C);
+    }
+
+    /// Copy of this matrix with dynamic size
+    template<class Alloc=aligned_row_allocator<T> >
+    Matrix<T,Alloc> toMatrix() const {
+      Matrix<T,Alloc> m(R,C,DoNotInitialize);
+      m.view() = view();
+      return m;
+    }
+
+    /// Set all entries to val
+    inline void fill(const T val) {
+      auto f = [&](const size_t i) { _data[i] = val; };
+      detail::unroll<R*C>::apply(f);
+    }
+
+    /**
+     * @name Comparison operators
+     */
+    //@{
+    inline bool operator==(const FixedMatrix<T,R,C>& other) const {
+      bool equal = true;
+      auto f = [&](const size_t i) {
+        equal = equal && (_data[i] == other._data[i]);
+      };
+      detail::unroll<R*C>::apply(f);
+      return equal;
+    }
+
+    inline bool operator!=(const FixedMatrix<T,R,C>& other) const {
+      return !operator==(other);
+    }
+    //@}
+
+    /**
+     * @name Arithmetic operators
+     */
+    //@{
+
+    /// Sum another matrix to this one
+    inline FixedMatrix<T,R,C>& operator+=(const FixedMatrix<T,R,C>& other) {
+      auto f = [&](const size_t i) { _data[i] += other._data[i]; };
+      detail::unroll<R*C>::apply(f);
+      return *this;
+    }
+
+    /// Subtract another matrix from this one
+    inline FixedMatrix<T,R,C>& operator-=(const FixedMatrix<T,R,C>& other) {
+      auto f = [&](const size_t i) { _data[i] -= other._data[i]; };
+      detail::unroll<R*C>::apply(f);
+      return *this;
+    }
+
+    /// Multiply all entries by a scalar
+    inline FixedMatrix<T,R,C>& operator*=(const T s) {
+      auto f = [&](const size_t i) { _data[i] *= s; };
+      detail::unroll<R*C>::apply(f);
+      return *this;
+    }
+
+    /// Divide all entries by a scalar
+    inline FixedMatrix<T,R,C>& operator/=(const T s) {
+      auto f = [&](const size_t i) { _data[i] /= s; };
+      detail::unroll<R*C>::apply(f);
+      return *this;
+    }
+    //@}
+  };
+
+  // Fixed matrices are traversed by rows
+  template<typename T,size_t R,size_t C>
+  struct product_operand< FixedMatrix<T,R,C> > {
+    static constexpr bool value = true;
+    typedef T value_type;
+    static inline gemm_operand<T> get(const FixedMatrix<T,R,C>& m) {
+      return gemm_operand<T>{m.data(),R,C,C,1};
+    }
+  };
+
+  /**
+   * @name Arithmetic of fixed matrices
+   *
+   * The results are computed right away, with the loops unrolled.
+   */
+  //@{
+
+  /// Sum of two fixed matrices
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C> operator+(const FixedMatrix<T,R,C>& a,
+                                      const FixedMatrix<T,R,C>& b) {
+    FixedMatrix<T,R,C> c(a);
+    return c += b;
+  }
+
+  /// Difference of two fixed matrices
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C> operator-(const FixedMatrix<T,R,C>& a,
+                                      const FixedMatrix<T,R,C>& b) {
+    FixedMatrix<T,R,C> c(a);
+    return c -= b;
+  }
+
+  /// Negation of a fixed matrix
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C> operator-(const FixedMatrix<T,R,C>& a) {
+    FixedMatrix<T,R,C> c(DoNotInitialize);
+    auto f = [&](const size_t i) { c.data()[i] = -a.data()[i]; };
+    detail::unroll<R*C>::apply(f);
+    return c;
+  }
+
+  /// Product of a fixed matrix and a scalar
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C>
+  operator*(const FixedMatrix<T,R,C>& a,
+            const typename FixedMatrix<T,R,C>::value_type s) {
+    FixedMatrix<T,R,C> c(a);
+    return c *= s;
+  }
+
+  /// Product of a scalar and a fixed matrix
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C>
+  operator*(const typename FixedMatrix<T,R,C>::value_type s,
+            const FixedMatrix<T,R,C>& a) {
+    FixedMatrix<T,R,C> c(a);
+    return c *= s;
+  }
+
+  /// Quotient of a fixed matrix and a scalar
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,R,C>
+  operator/(const FixedMatrix<T,R,C>& a,
+            const typename FixedMatrix<T,R,C>::value_type s) {
+    FixedMatrix<T,R,C> c(a);
+    return c /= s;
+  }
+
+  /// Matrix product of two fixed matrices
+  template<typename T,size_t R,size_t K,size_t C>
+  inline FixedMatrix<T,R,C> operator*(const FixedMatrix<T,R,K>& a,
+                                      const FixedMatrix<T,K,C>& b) {
+    FixedMatrix<T,R,C> c(DoNotInitialize);
+    auto f = [&](const size_t i) {
+      const size_t r = i/C;
+      const size_t col = i%C;
+      T sum(0);
+      auto g = [&](const size_t k) { sum += a(r,k)*b(k,col); };
+      detail::unroll<K>::apply(g);
+      c.data()[i] = sum;
+    };
+    detail::unroll<R*C>::apply(f);
+    return c;
+  }
+
+  /// Transposed copy of a fixed matrix
+  template<typename T,size_t R,size_t C>
+  inline FixedMatrix<T,C,R> transpose(const FixedMatrix<T,R,C>& a) {
+    FixedMatrix<T,C,R> c(DoNotInitialize);
+    auto f = [&](const size_t i) { c(i%C,i/C) = a.data()[i]; };
+    detail::unroll<R*C>::apply(f);
+    return c;
+  }
+  //@}
+
+} // namespace anpi
+
+#endif
@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_HALF_FLOAT_HPP
+#define ANPI_HALF_FLOAT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+namespace anpi
+{
+  namespace detail {
+
+    /// Bits of a float
+    inline std::uint32_t floatBits(const float f) {
+      std::uint32_t u;
+      std::memcpy(&u,&f,sizeof(u));
+      return u;
+    }
+
+    /// Float with the given bits
+    inline float bitsFloat(const std::uint32_t u) {
+      float f;
+      std::memcpy(&f,&u,sizeof(f));
+      return f;
+    }
+
+    /**
+     * IEEE 754 binary16 bits of f, rounded to nearest even.  Values
+     * too large become infinite, and NaNs stay (quiet) NaNs.
+     */
+    inline std::uint16_t floatToHalf(const float f) {
+      std::uint32_t u = floatBits(f);
+      const std::uint32_t sign = (u >> 16) & 0x8000u;
+      u &= 0x7fffffffu;
+
+      if (u >= 0x47800000u) {
+        // 2^16 and above: infinity, or NaN
+        return std::uint16_t(sign | ((u > 0x7f800000u) ? 0x7e00u : 0x7c00u));
+      }
+      if (u < 0x38800000u) {
+        // below 2^-14: subnormal or zero.  Adding 0.5 leaves the
+        // mantissa of the half in the lowest bits, correctly rounded.
+        const float r = bitsFloat(u) + 0.5f;
+        return std::uint16_t(sign | (floatBits(r) - 0x3f000000u));
+      }
+      // normal: rebias the exponent and round the mantissa
+      const std::uint32_t odd = (u >> 13) & 1u;
+      u += 0xc8000fffu + odd;
+      return std::uint16_t(sign | (u >> 13));
+    }
+
+    /// Float value of the IEEE 754 binary16 bits h
+    inline float halfToFloat(const std::uint16_t h) {
+      const std::uint32_t sign = std::uint32_t(h & 0x8000u) << 16;
+      const std::uint32_t exp = (h >> 10) & 0x1fu;
+      const std::uint32_t mant = h & 0x3ffu;
+
+      if (exp == 0) {
+        // zero or subnormal: mant * 2^-24
+        const float m = float(mant)*5.9604644775390625e-8f;
+        return (sign != 0) ? -m : m;
+      }
+      if (exp == 0x1fu) {
+        return bitsFloat(sign | 0x7f800000u | (mant << 13));
+      }
+      return bitsFloat(sign | ((exp + 112u) << 23) | (mant << 13));
+    }
+
+    /**
+     * Bits of the bfloat16 nearest to f, rounded to nearest even.  NaNs
+     * stay (quiet) NaNs.
+     */
+    inline std::uint16_t floatToBfloat(const float f) {
+      const std::uint32_t u = floatBits(f);
+      if ((u & 0x7fffffffu) > 0x7f800000u) {
+        return std::uint16_t((u >> 16) | 0x40u);
+      }
+      return std::uint16_t((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+    }
+
+    /// Float value of the bfloat16 bits b
+    inline float bfloatToFloat(const std::uint16_t b) {
+      return bitsFloat(std::uint32_t(b) << 16);
+    }
+
+    /**
+     * Floating point number stored in 16 bits, computed as float.
+     *
+     * Conv provides the conversions of the bits from and to float.
+     * Each arithmetic operation converts the operands to float, and
+     * rounds the result back once.
+     */
+    template<class Conv>
+    class half_float {
+      /// Stored bits
+      std::uint16_t _bits;
+
+    public:
+      /// Zero
+      inline half_float() : _bits(0) {}
+
+      /// Nearest value to f
+      inline explicit half_float(const float f)
+        : _bits(Conv::fromFloat(f)) {}
+
+      /// Nearest value to d
+      inline explicit half_float(const double d)
+        : _bits(Conv::fromFloat(float(d))) {}
+
+      /// Nearest value to i
+      inline explicit half_float(const int i)
+        : _bits(Conv::fromFloat(float(i))) {}
+
+      /// Value with the given bits
+      static inline half_float fromBits(const std::uint16_t bits) {
+        half_float h;
+        h._bits = bits;
+        return h;
+      }
+
+      /// Stored bits
+      inline std::uint16_t bits() const { return _bits; }
+
+      /// Value as float, which is exact
+      inline operator float() const { return Conv::toFloat(_bits); }
+
+      /**
+       * @name Arithmetic operators, rounded once to 16 bits
+       */
+      //@{
+      inline half_float operator-() const {
+        return fromBits(std::uint16_t(_bits ^ 0x8000u));
+      }
+
+      inline half_float& operator+=(const half_float o) {
+        return *this = half_float(float(*this) + float(o));
+      }
+
+      inline half_float& operator-=(const half_float o) {
+        return *this = half_float(float(*this) - float(o));
+      }
+
+      inline half_float& operator*=(const half_float o) {
+        return *this = half_float(float(*this) * float(o));
+      }
+
+      inline half_float& operator/=(const half_float o) {
+        return *this = half_float(float(*this) / float(o));
+      }
+
+      friend inline half_float operator+(const half_float a,
+                                         const half_float b) {
+        return half_float(float(a) + float(b));
+      }
+
+      friend inline half_float operator-(const half_float a,
+                                         const half_float b) {
+        return half_float(float(a) - float(b));
+      }
+
+      friend inline half_float operator*(const half_float a,
+                                         const half_float b) {
+        return half_float(float(a) * float(b));
+      }
+
+      friend inline half_float operator/(const half_float a,
+                                         const half_float b) {
+        return half_float(float(a) / float(b));
+      }
+      //@}
+
+      /**
+       * @name Comparison operators, on the float values
+       */
+      //@{
+      friend inline bool operator==(const half_float a,const half_float b) {
+        return float(a) == float(b);
+      }
+
+      friend inline bool operator!=(const half_float a,const half_float b) {
+        return float(a) != float(b);
+      }
+
+      friend inline bool operator<(const half_float a,const half_float b) {
+        return float(a) < float(b);
+      }
+
+      friend inline bool operator<=(const half_float a,const half_float b) {
+        return float(a) <= float(b);
+      }
+
+      friend inline bool operator>(const half_float a,const half_float b) {
+        return float(a) > float(b);
+      }
+
+      friend inline bool operator>=(const half_float a,const half_float b) {
+        return float(a) >= float(b);
+      }
+      //@}
+    };
+
+    /// Conversions of IEEE 754 binary16
+    struct fp16_conversion {
+      static inline std::uint16_t fromFloat(const float f) {
+        return floatToHalf(f);
+      }
+      static inline float toFloat(const std::uint16_t h) {
+        return halfToFloat(h);
+      }
+    };
+
+    /// Conversions of bfloat16
+    struct bf16_conversion {
+      static inline std::uint16_t fromFloat(const float f) {
+        return floatToBfloat(f);
+      }
+      static inline float toFloat(const std::uint16_t b) {
+        return bfloatToFloat(b);
+      }
+    };
+
+  } // namespace detail
+
+  /**
+   * @name 16 bit floating point types
+   *
+   * Matrices of these types take half the memory of float matrices,
+   * which halves the bandwidth of the passes limited by memory.  The
+   * entries are converted to float when loaded, all operations are
+   * computed in float, and the results are rounded to 16 bits when
+   * stored.  The SIMD kernels convert whole registers at once (with
+   * F16C or AVX-512 for fp16); reductions accumulate in float.
+   *
+   * \code
+   * anpi::Matrix<anpi::fp16> a(1000,1000,anpi::fp16(1.f));
+   * anpi::Matrix<anpi::fp16> b = a + a;
+   * float s = anpi::sum(b);
+   * \endcode
+   */
+  //@{
+
+  /// IEEE 754 half precision: 5 exponent and 10 mantissa bits
+  typedef detail::half_float<detail::fp16_conversion> fp16;
+
+  /// bfloat16: the 8 exponent bits of float, and 7 mantissa bits
+  typedef detail::half_float<detail::bf16_conversion> bf16;
+  //@}
+
+  /// Type a half float is computed in, and the type itself otherwise
+  template<typename T>
+  struct compute_type {
+    typedef T type;
+  };
+
+  template<class Conv>
+  struct compute_type< detail::half_float<Conv> > {
+    typedef float type;
+  };
+
+  namespace detail {
+    /// Write the float value of a half float
+    template<class Conv>
+    inline std::ostream& operator<<(std::ostream& os,
+                                    const half_float<Conv> h) {
+      return os << float(h);
+    }
+  } // namespace detail
+
+} // namespace anpi
+
+namespace std {
+
+  template<>
+  class numeric_limits<anpi::fp16> {
+  public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = true;
+    static constexpr bool has_quiet_NaN = true;
+    static constexpr int digits = 11;
+    static constexpr int radix = 2;
+
+    static inline anpi::fp16 min() { return anpi::fp16::fromBits(0x0400); }
+    static inline anpi::fp16 max() { return anpi::fp16::fromBits(0x7bff); }
+    static inline anpi::fp16 lowest() { return anpi::fp16::fromBits(0xfbff); }
+    static inline anpi::fp16 epsilon() { return anpi::fp16::fromBits(0x1400); }
+    static inline anpi::fp16 infinity() { return anpi::fp16::fromBits(0x7c00); }
+    static inline anpi::fp16 quiet_NaN() { return anpi::fp16::fromBits(0x7e00); }
+  };
+
+  template<>
+  class numeric_limits<anpi::bf16> {
+  public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = true;
+    static constexpr bool has_quiet_NaN = true;
+    static constexpr int digits = 8;
+    static constexpr int radix = 2;
+
+    static inline anpi::bf16 min() { return anpi::bf16::fromBits(0x0080); }
+    static inline anpi::bf16 max() { return anpi::bf16::fromBits(0x7f7f); }
+    static inline anpi::bf16 lowest() { return anpi::bf16::fromBits(0xff7f); }
+    static inline anpi::bf16 epsilon() { return anpi::bf16::fromBits(0x3c00); }
+    static inline anpi::bf16 infinity() { return anpi::bf16::fromBits(0x7f80); }
+    static inline anpi::bf16 quiet_NaN() { return anpi::bf16::fromBits(0x7fc0); }
+  };
+
+} // namespace std
+
+#endif
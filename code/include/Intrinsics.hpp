@@ -12,6 +12,9 @@
 #define ANPI_INTRINSICS_HPP
 
 #include <cstdint>
+#include <type_traits>
+
+#include "HalfFloat.hpp"
 
 /*
  * Include the proper intrinsics headers for the current architecture
@@ -39,6 +42,48 @@
 #  endif
 #endif
 
+/*
+ * With GCC-compatible compilers on x86, the code for all supported
+ * instruction sets is compiled into the binary, each part inside a
+ * region with its own target options, independently of the -m flags
+ * given to the compiler.  The best instruction set supported by the
+ * running CPU is then selected at runtime.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define ANPI_SIMD_X86
+#  if defined(__clang__)
+#    define ANPI_SIMD_BEGIN_SSE2                                          \
+       _Pragma("clang attribute push(__attribute__((target(\"sse2\"))),apply_to=function)")
+#    define ANPI_SIMD_BEGIN_AVX                                           \
+       _Pragma("clang attribute push(__attribute__((target(\"avx2,fma,f16c\"))),apply_to=function)")
+#    define ANPI_SIMD_BEGIN_AVX512                                        \
+       _Pragma("clang attribute push(__attribute__((target(\"avx2,fma,f16c,avx512f,avx512bw,avx512dq\"))),apply_to=function)")
+#    define ANPI_SIMD_END                                                 \
+       _Pragma("clang attribute pop")
+#  else
+#    define ANPI_SIMD_BEGIN_SSE2                                          \
+       _Pragma("GCC push_options")                                      \
+       _Pragma("GCC diagnostic push")                                   \
+       _Pragma("GCC target(\"sse2\")")
+#    define ANPI_SIMD_BEGIN_AVX                                           \
+       _Pragma("GCC push_options")                                      \
+       _Pragma("GCC diagnostic push")                                   \
+       _Pragma("GCC target(\"avx2,fma,f16c\")")
+     /*
+      * The AVX-512 intrinsics start from _mm512_undefined_*() values,
+      * which GCC reports as "may be used uninitialized"
+      */
+#    define ANPI_SIMD_BEGIN_AVX512                                        \
+       _Pragma("GCC push_options")                                      \
+       _Pragma("GCC diagnostic push")                                   \
+       _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")      \
+       _Pragma("GCC target(\"avx2,fma,f16c,avx512f,avx512bw,avx512dq\")")
+#    define ANPI_SIMD_END                                                 \
+       _Pragma("GCC diagnostic pop")                                    \
+       _Pragma("GCC pop_options")
+#  endif
+#endif
+
 template <typename T>
 struct is_simd_type {
   static constexpr bool value =
@@ -51,11 +96,13 @@ struct is_simd_type {
     std::is_same<T,std::int16_t>::value  ||
     std::is_same<T,std::uint16_t>::value ||
     std::is_same<T,std::int8_t>::value   ||
-    std::is_same<T,std::uint8_t>::value;
+    std::is_same<T,std::uint8_t>::value  ||
+    std::is_same<T,anpi::fp16>::value    ||
+    std::is_same<T,anpi::bf16>::value;
 };
 
 
-#ifdef __AVX512F__
+#ifdef ANPI_SIMD_X86
 template<typename T> struct avx512_traits { };
 template<> struct avx512_traits<double> { typedef __m512d reg_type; };
 template<> struct avx512_traits<float> { typedef __m512 reg_type; };
@@ -69,7 +116,7 @@ template<> struct avx512_traits<int8_t> { typedef __m512i reg_type; };
 template<> struct avx512_traits<uint8_t> { typedef __m512i reg_type; };
 #endif
 
-#ifdef __AVX__
+#ifdef ANPI_SIMD_X86
 template<typename T> struct avx_traits { };
 template<> struct avx_traits<double> { typedef __m256d reg_type; };
 template<> struct avx_traits<float> { typedef __m256 reg_type; };
@@ -83,7 +130,7 @@ template<> struct avx_traits<int8_t> { typedef __m256i reg_type; };
 template<> struct avx_traits<uint8_t> { typedef __m256i reg_type; };
 #endif
 
-#ifdef __SSE2__
+#ifdef ANPI_SIMD_X86
 template<typename T> struct sse2_traits { };
 template<> struct sse2_traits<double> { typedef __m128d reg_type; };
 template<> struct sse2_traits<float> { typedef __m128 reg_type; };
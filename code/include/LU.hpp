@@ -0,0 +1,186 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_LU_HPP
+#define ANPI_LU_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+
+namespace anpi
+{
+  /**
+   * Blocking of the LU factorization.
+   *
+   * The columns are factorized in panels of nb columns.  Each panel
+   * leaves a trailing matrix to be updated with a product of nb inner
+   * dimension, which is where almost all the time is spent.
+   */
+  struct lu_blocking {
+    /// Columns of each panel
+    static constexpr size_t nb = 64;
+  };
+
+  /**
+   * LU factorization with partial pivoting of a square matrix A:
+   *
+   *   P*A = L*U
+   *
+   * with P a permutation, L lower triangular with ones on the diagonal
+   * and U upper triangular.  The factorization is computed once, when
+   * the object is constructed, and reused for all later solutions:
+   *
+   * \code
+   * anpi::LU<double> lu(a);
+   * anpi::Matrix<double> x = lu.solve(b);  // a*x = b
+   * anpi::Matrix<double> y = lu.solve(c);  // a*y = c, no refactoring
+   * double det = lu.determinant();
+   * \endcode
+   *
+   * The factorization is right-looking and blocked: after each panel
+   * of lu_blocking::nb columns, the trailing matrix is updated with the
+   * cache-blocked matrix product, with its rows distributed among the
+   * threads.
+   */
+  template<typename T,class Alloc=aligned_row_allocator<T> >
+  class LU {
+  public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+
+  private:
+    /// L below the diagonal (without its unit diagonal) and U above
+    Matrix<T,Alloc> _lu;
+    /// Row exchanged with row i at step i of the factorization
+    std::vector<size_t> _pivots;
+    /// Sign of the permutation: +1 or -1
+    int _sign;
+    /// Some pivot was zero
+    bool _singular;
+
+  public:
+    /// Empty factorization
+    LU();
+
+    /**
+     * Factorize the square matrix a.
+     *
+     * @throws anpi::Exception if a is not square
+     */
+    explicit LU(const ConstMatrixView<T>& a);
+
+    /**
+     * Factorize the square matrix a.
+     *
+     * @throws anpi::Exception if a is not square
+     */
+    template<class A>
+    explicit LU(const Matrix<T,A>& a) : LU(ConstMatrixView<T>(a)) {}
+
+    /**
+     * Replace the factorization with the one of the square matrix a.
+     *
+     * @throws anpi::Exception if a is not square
+     */
+    void factorize(const ConstMatrixView<T>& a);
+
+    /// Number of rows (and columns) of the factorized matrix
+    inline size_t size() const { return _lu.rows(); }
+
+    /// Check if the factorized matrix is singular
+    inline bool singular() const { return _singular; }
+
+    /**
+     * Factors L and U packed in one matrix: U on and above the diagonal
+     * and L below it, with its unit diagonal implicit.
+     */
+    inline const Matrix<T,Alloc>& packed() const { return _lu; }
+
+    /// Row exchanged with row i at step i of the factorization
+    inline const std::vector<size_t>& pivots() const { return _pivots; }
+
+    /// Row of A found at each row of P*A
+    std::vector<size_t> permutation() const;
+
+    /// Lower triangular factor L, with ones on its diagonal
+    Matrix<T,Alloc> lower() const;
+
+    /// Upper triangular factor U
+    Matrix<T,Alloc> upper() const;
+
+    /**
+     * Solve A*X = B for all columns of B, overwriting B with X.
+     *
+     * The columns are distributed among the threads.
+     *
+     * @throws anpi::Exception if the matrix is singular
+     */
+    void solveInPlace(const MatrixView<T>& b) const;
+
+    /**
+     * Solution X of A*X = B, for all columns of B.
+     *
+     * @throws anpi::Exception if the matrix is singular
+     */
+    template<class A>
+    Matrix<T,A> solve(const Matrix<T,A>& b) const;
+
+    /// Determinant of the factorized matrix
+    T determinant() const;
+
+    /**
+     * Inverse of the factorized matrix.
+     *
+     * @throws anpi::Exception if the matrix is singular
+     */
+    Matrix<T,Alloc> inverse() const;
+  };
+
+  /**
+   * @name Linear systems
+   *
+   * These functions factorize the matrix on each call.  To solve
+   * several systems with the same matrix, use anpi::LU directly.
+   */
+  //@{
+
+  /**
+   * Solution X of A*X = B.
+   *
+   * @throws anpi::Exception if a is not square or is singular
+   */
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> solve(const Matrix<T,Alloc>& a,const Matrix<T,Alloc>& b);
+
+  /**
+   * Determinant of a square matrix.
+   *
+   * @throws anpi::Exception if a is not square
+   */
+  template<typename T,class Alloc>
+  T determinant(const Matrix<T,Alloc>& a);
+
+  /**
+   * Inverse of a square matrix.
+   *
+   * @throws anpi::Exception if a is not square or is singular
+   */
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> inverse(const Matrix<T,Alloc>& a);
+  //@}
+
+} // namespace anpi
+
+#include "LU.tpp"
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace anpi
+{
+  namespace detail {
+
+    /**
+     * Solve L*X = B for a unit lower triangular L, overwriting B with X.
+     *
+     * The rows of B are solved in blocks: each block is first updated
+     * with the product of L and the blocks already solved, and then
+     * solved with the small triangle on the diagonal of L.
+     */
+    template<typename T>
+    void solveUnitLower(const ConstMatrixView<T>& l,const MatrixView<T>& b) {
+      const size_t n = l.rows();
+      const size_t m = b.cols();
+      const size_t nb = lu_blocking::nb;
+
+      for (size_t i0=0;i0<n;i0+=nb) {
+        const size_t ib = std::min(nb,n-i0);
+        const MatrixView<T> bi = b.block(i0,0,ib,m);
+        if (i0 > 0) {
+          gemm(T(-1),l.block(i0,0,ib,i0),b.block(0,0,i0,m),T(1),bi);
+        }
+
+        for (size_t i=1;i<ib;++i) {
+          const T* li = l[i0+i] + i0;
+          T* bii = bi[i];
+          for (size_t j=0;j<i;++j) {
+            const T lij = li[j];
+            const T* bj = bi[j];
+            for (size_t c=0;c<m;++c) {
+              bii[c] -= lij*bj[c];
+            }
+          }
+        }
+      }
+    }
+
+    /**
+     * Solve U*X = B for an upper triangular U, overwriting B with X.
+     *
+     * Like solveUnitLower(), but from the last block of rows upwards.
+     */
+    template<typename T>
+    void solveUpper(const ConstMatrixView<T>& u,const MatrixView<T>& b) {
+      const size_t n = u.rows();
+      const size_t m = b.cols();
+      const size_t nb = lu_blocking::nb;
+
+      for (size_t end=n;end>0;) {
+        const size_t ib = std::min(nb,end);
+        const size_t i0 = end-ib;
+        const MatrixView<T> bi = b.block(i0,0,ib,m);
+        if (end < n) {
+          gemm(T(-1),u.block(i0,end,ib,n-end),b.block(end,0,n-end,m),
+               T(1),bi);
+        }
+
+        for (size_t i=ib;i-- > 0;) {
+          const T* ui = u[i0+i] + i0;
+          T* bii = bi[i];
+          for (size_t j=i+1;j<ib;++j) {
+            const T uij = ui[j];
+            const T* bj = bi[j];
+            for (size_t c=0;c<m;++c) {
+              bii[c] -= uij*bj[c];
+            }
+          }
+          const T d = ui[i];
+          for (size_t c=0;c<m;++c) {
+            bii[c] /= d;
+          }
+        }
+        end = i0;
+      }
+    }
+
+    /**
+     * Call f(x) for views x of blocks of columns of b, distributed among
+     * the threads.  Each column represents the given work units.
+     */
+    template<typename T,class F>
+    void parallelColumns(const MatrixView<T>& b,const size_t work,F f) {
+      parallelRows(b.cols(),work,[&](const size_t first,const size_t last) {
+        if (first < last) {
+          f(b.block(0,first,b.rows(),last-first));
+        }
+      });
+    }
+
+  } // namespace detail
+
+  template<typename T,class Alloc>
+  LU<T,Alloc>::LU() : _lu(),_pivots(),_sign(1),_singular(false) {}
+
+  template<typename T,class Alloc>
+  LU<T,Alloc>::LU(const ConstMatrixView<T>& a) : LU() {
+    factorize(a);
+  }
+
+  template<typename T,class Alloc>
+  void LU<T,Alloc>::factorize(const ConstMatrixView<T>& a) {
+    if (a.rows() != a.cols()) {
+      throw anpi::Exception("LU factorization of a non-square matrix");
+    }
+
+    const size_t n = a.rows();
+    _lu.allocate(n,n);
+    _lu.view() = a;
+    _pivots.resize(n);
+    _sign = 1;
+    _singular = false;
+
+    const size_t nb = lu_blocking::nb;
+    for (size_t k=0;k<n;k+=nb) {
+      const size_t kb = std::min(nb,n-k);
+      const size_t kend = k+kb;
+
+      // Factorize the panel of columns [k,kend)
+      for (size_t j=k;j<kend;++j) {
+        // the largest entry of the column is the pivot
+        size_t p = j;
+        auto largest = std::abs(_lu(j,j));
+        for (size_t i=j+1;i<n;++i) {
+          const auto v = std::abs(_lu(i,j));
+          if (v > largest) {
+            largest = v;
+            p = i;
+          }
+        }
+
+        // the whole rows are exchanged, including L and the trailing part
+        _pivots[j] = p;
+        if (p != j) {
+          std::swap_ranges(_lu[j],_lu[j]+n,_lu[p]);
+          _sign = -_sign;
+        }
+
+        const T pivot = _lu(j,j);
+        if (pivot == T(0)) {
+          // the column is already eliminated
+          _singular = true;
+          continue;
+        }
+
+        const T* uj = _lu[j];
+        parallelRows(n-j-1,kend-j,[&](const size_t first,const size_t last) {
+          for (size_t i=j+1+first;i<j+1+last;++i) {
+            T* ai = _lu[i];
+            const T l = (ai[j] /= pivot);
+            for (size_t c=j+1;c<kend;++c) {
+              ai[c] -= l*uj[c];
+            }
+          }
+        });
+      }
+
+      if (kend < n) {
+        const size_t m = n-kend;
+
+        // U12 = L11^-1 * A12
+        const ConstMatrixView<T> l11 = _lu.block(k,k,kb,kb);
+        const MatrixView<T> a12 = _lu.block(k,kend,kb,m);
+        detail::parallelColumns(a12,kb*kb,[&](const MatrixView<T>& x) {
+          detail::solveUnitLower(l11,x);
+        });
+
+        // A22 = A22 - L21*U12, in blocks of rows
+        const ConstMatrixView<T> l21 = _lu.block(kend,k,m,kb);
+        const MatrixView<T> a22 = _lu.block(kend,kend,m,m);
+        parallelRows(m,m*kb,[&](const size_t first,const size_t last) {
+          if (first < last) {
+            gemm(T(-1),l21.block(first,0,last-first,kb),a12,
+                 T(1),a22.block(first,0,last-first,m));
+          }
+        });
+      }
+    }
+  }
+
+  template<typename T,class Alloc>
+  std::vector<size_t> LU<T,Alloc>::permutation() const {
+    std::vector<size_t> perm(size());
+    std::iota(perm.begin(),perm.end(),size_t(0));
+    for (size_t i=0;i<perm.size();++i) {
+      std::swap(perm[i],perm[_pivots[i]]);
+    }
+    return perm;
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> LU<T,Alloc>::lower() const {
+    const size_t n = size();
+    Matrix<T,Alloc> l(n,n,T(0));
+    for (size_t i=0;i<n;++i) {
+      std::copy(_lu[i],_lu[i]+i,l[i]);
+      l(i,i) = T(1);
+    }
+    return l;
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> LU<T,Alloc>::upper() const {
+    const size_t n = size();
+    Matrix<T,Alloc> u(n,n,T(0));
+    for (size_t i=0;i<n;++i) {
+      std::copy(_lu[i]+i,_lu[i]+n,u[i]+i);
+    }
+    return u;
+  }
+
+  template<typename T,class Alloc>
+  void LU<T,Alloc>::solveInPlace(const MatrixView<T>& b) const {
+    assert( b.rows() == size() );
+    if (_singular) {
+      throw anpi::Exception("Singular matrix in linear system");
+    }
+
+    const size_t n = size();
+    const size_t m = b.cols();
+
+    // B = P*B
+    for (size_t i=0;i<n;++i) {
+      if (_pivots[i] != i) {
+        std::swap_ranges(b[i],b[i]+m,b[_pivots[i]]);
+      }
+    }
+
+    // X = U^-1 * L^-1 * B
+    const ConstMatrixView<T> lu = _lu.view();
+    detail::parallelColumns(b,n*n,[&](const MatrixView<T>& x) {
+      detail::solveUnitLower(lu,x);
+      detail::solveUpper(lu,x);
+    });
+  }
+
+  template<typename T,class Alloc>
+  template<class A>
+  Matrix<T,A> LU<T,Alloc>::solve(const Matrix<T,A>& b) const {
+    Matrix<T,A> x(b);
+    solveInPlace(x.view());
+    return x;
+  }
+
+  template<typename T,class Alloc>
+  T LU<T,Alloc>::determinant() const {
+    T det = T(_sign);
+    for (size_t i=0;i<size();++i) {
+      det *= _lu(i,i);
+    }
+    return det;
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> LU<T,Alloc>::inverse() const {
+    const size_t n = size();
+    Matrix<T,Alloc> x(n,n,T(0));
+    for (size_t i=0;i<n;++i) {
+      x(i,i) = T(1);
+    }
+    solveInPlace(x.view());
+    return x;
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> solve(const Matrix<T,Alloc>& a,const Matrix<T,Alloc>& b) {
+    return LU<T,Alloc>(a).solve(b);
+  }
+
+  template<typename T,class Alloc>
+  T determinant(const Matrix<T,Alloc>& a) {
+    return LU<T,Alloc>(a).determinant();
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> inverse(const Matrix<T,Alloc>& a) {
+    return LU<T,Alloc>(a).inverse();
+  }
+
+} // namespace anpi
@@ -0,0 +1,476 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_MAPPED_MATRIX_HPP
+#define ANPI_MAPPED_MATRIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+#include "MatrixView.hpp"
+
+namespace anpi
+{
+  /**
+   * @name Binary matrix files
+   *
+   * A matrix file holds a header of 64 bytes followed by the entries of
+   * the matrix exactly as anpi::Matrix stores them in memory: rows()
+   * rows of dcols() entries each, including the padding of the rows.
+   * The payload starts at an offset multiple of the alignment, so that
+   * a memory mapping of the file has the same alignment as the matrix
+   * it was saved from.
+   *
+   * The entries are stored in the byte order of the machine that wrote
+   * them.  Files with the other byte order are rejected.
+   */
+  //@{
+
+  /// Header of the binary matrix files
+  struct matrix_file_header {
+    /// Identifies the file format: "ANPIMAT" and a terminating zero
+    char     magic[8];
+    /// Version of the file format
+    uint32_t version;
+    /// Written as 0x01020304, to detect files of the other byte order
+    uint32_t byteOrder;
+    /// Type of the entries (see matrix_dtype)
+    uint32_t dtype;
+    /// Size of each entry in bytes
+    uint32_t elementSize;
+    /// Number of rows
+    uint64_t rows;
+    /// Number of columns
+    uint64_t cols;
+    /// Number of entries between the beginnings of two rows
+    uint64_t dcols;
+    /// Alignment in bytes of the payload and of each row if padded
+    uint64_t alignment;
+    /// Position in bytes of the first entry, relative to the file start
+    uint64_t offset;
+  };
+
+  /**
+   * Code of the element type T stored in the header of the files.
+   *
+   * Integral types are identified by their size and sign, so that int
+   * and int32_t share the same code.  Other types get the code 0, and
+   * are then only checked by their size.
+   */
+  template<typename T>
+  struct matrix_dtype {
+  private:
+    static constexpr uint32_t integral(const size_t bytes) {
+      return (bytes==1) ? 1 : (bytes==2) ? 3 : (bytes==4) ? 5 :
+             (bytes==8) ? 7 : 0;
+    }
+  public:
+    static constexpr uint32_t value =
+      std::is_same<T,float>::value       ? 9  :
+      std::is_same<T,double>::value      ? 10 :
+      std::is_same<T,long double>::value ? 11 :
+      (std::is_integral<T>::value && (integral(sizeof(T)) != 0))
+      ? integral(sizeof(T)) + (std::is_unsigned<T>::value ? 1 : 0) : 0;
+  };
+
+  /**
+   * Save the matrix m into the given file, overwriting it.
+   *
+   * @throws anpi::Exception if the file cannot be written
+   */
+  template<typename T,class Alloc>
+  void save(const std::string& file,const Matrix<T,Alloc>& m);
+
+  /**
+   * Load the matrix m from the given file.
+   *
+   * The entries are read into the layout of m, which may have a
+   * padding different from the one stored in the file.  Use
+   * anpi::MappedMatrix to access files larger than the memory.
+   *
+   * @throws anpi::Exception if the file cannot be read or holds
+   *         entries of another type
+   */
+  template<typename T,class Alloc>
+  void load(const std::string& file,Matrix<T,Alloc>& m);
+  //@}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+  /// Access of a mapped matrix
+  enum MappingMode {
+    /// The entries can only be read
+    MapReadOnly,
+    /// Changes on the entries are written back to the file
+    MapReadWrite
+  };
+
+  /// Expected access pattern, given as hint to the operating system
+  enum AccessAdvice {
+    /// No special treatment
+    NormalAccess,
+    /// Read ahead aggressively, and free the pages read soon
+    SequentialAccess,
+    /// Do not read ahead
+    RandomAccess,
+    /// The pages will be needed soon: start reading them now
+    WillNeed,
+    /// The pages will not be needed soon: they may be freed
+    DontNeed
+  };
+
+  /**
+   * Matrix stored in a binary matrix file, mapped into memory.
+   *
+   * Opening a file just maps it, independently of its size: the
+   * operating system reads the pages of the file when they are first
+   * accessed, and may free them again under memory pressure.  This
+   * allows to process matrices larger than the physical memory, as
+   * long as each step of the algorithm works on a part of them.
+   *
+   * The entries are accessed through views, which work with all
+   * arithmetic operations of anpi::Matrix:
+   *
+   * \code
+   * anpi::MappedMatrix<double> a("a.mat");
+   * anpi::MappedMatrix<double> b("b.mat",a.rows(),a.cols()); // new file
+   * b.view() = a.view()*2.0;
+   * \endcode
+   *
+   * Algorithms going once through all rows should use the row
+   * iterators, which read the next rows ahead and free the ones
+   * already processed:
+   *
+   * \code
+   * double sum = 0;
+   * for (const auto& row : a) {
+   *   sum += std::accumulate(row.data(),row.data()+row.cols(),0.0);
+   * }
+   * \endcode
+   *
+   * Mapped matrices cannot be copied, but they can be moved.
+   */
+  template<typename T>
+  class MappedMatrix {
+  public:
+    typedef T value_type;
+
+    class row_iterator;
+
+    /**
+     * Number of bytes read ahead by the row iterators
+     */
+    static constexpr size_t streamWindow = size_t(4)<<20;
+
+  private:
+    /// Beginning of the mapping, which starts with the header
+    char* _map;
+    /// Length in bytes of the mapping
+    size_t _length;
+    /// First entry of the matrix
+    T* _data;
+    /// Number of rows
+    size_t _rows;
+    /// Number of columns
+    size_t _cols;
+    /// Dominant (real) number of columns
+    size_t _dcols;
+    /// Alignment of the rows in bytes
+    size_t _alignment;
+    /// Mapping mode
+    MappingMode _mode;
+
+  public:
+    /**
+     * @name Constructors
+     */
+    //@{
+
+    /// Empty matrix, not mapped to any file
+    MappedMatrix();
+
+    /**
+     * Map the given matrix file
+     *
+     * @throws anpi::Exception if the file cannot be opened or holds
+     *         entries of another type
+     */
+    explicit MappedMatrix(const std::string& file,
+                          const MappingMode mode=MapReadOnly);
+
+    /**
+     * Create a new matrix file of rows x cols entries, overwriting an
+     * existing one, and map it for reading and writing.
+     *
+     * Each row is padded to a multiple of alignment bytes, as done by
+     * anpi::aligned_row_allocator.  All entries are initially zero.
+     * The file system only allocates the pages of the file when they
+     * are written, so that even huge files are created in constant
+     * time.
+     *
+     * @throws anpi::Exception if the file cannot be created
+     */
+    MappedMatrix(const std::string& file,
+                 const size_t rows,
+                 const size_t cols,
+                 const size_t alignment=DefaultAlignment);
+
+    MappedMatrix(MappedMatrix<T>&& other) noexcept;
+    MappedMatrix(const MappedMatrix<T>&) = delete;
+
+    /// Unmap the file
+    ~MappedMatrix() noexcept;
+    //@}
+
+    MappedMatrix<T>& operator=(MappedMatrix<T>&& other) noexcept;
+    MappedMatrix<T>& operator=(const MappedMatrix<T>&) = delete;
+
+    /**
+     * @name File handling
+     */
+    //@{
+
+    /// Map the given matrix file, unmapping the previous one
+    void open(const std::string& file,const MappingMode mode=MapReadOnly);
+
+    /// Create a new matrix file, unmapping the previous one
+    void create(const std::string& file,
+                const size_t rows,
+                const size_t cols,
+                const size_t alignment=DefaultAlignment);
+
+    /// Write back all changes to the file, and wait until done
+    void flush();
+
+    /// Unmap the file.  Changes are written back eventually.
+    void close() noexcept;
+
+    /// Check if a file is mapped
+    inline bool isOpen() const { return _map != nullptr; }
+
+    /// Check if the entries can be modified
+    inline bool writable() const { return _mode == MapReadWrite; }
+    //@}
+
+    /**
+     * @name Access hints
+     *
+     * The hints let the operating system read ahead the pages to be
+     * accessed soon, or free the pages that will not be accessed again.
+     * They are not required for correctness.
+     */
+    //@{
+
+    /// Give the access hint for all entries
+    void advise(const AccessAdvice advice) const;
+
+    /// Give the access hint for the rows in [firstRow,lastRow)
+    void advise(const AccessAdvice advice,
+                const size_t firstRow,
+                const size_t lastRow) const;
+    //@}
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /// Distance in entries between the beginnings of two rows
+    inline size_t dcols() const { return _dcols; }
+
+    /// Alignment in bytes of the rows
+    inline size_t alignment() const { return _alignment; }
+
+    /// Total number of entries (rows x cols)
+    inline size_t entries() const { return _rows*_cols; }
+
+    /// Check if the matrix is empty (zero rows or columns)
+    inline bool empty() const { return (_rows==0) || (_cols==0); }
+
+    /// Pointer to the first entry
+    inline const T* data() const { return _data; }
+
+    /// Pointer to the first entry of a writable mapping
+    inline T* data() { assert(writable()); return _data; }
+
+    /// Return read-only pointer to a given row
+    inline const T* operator[](const size_t row) const {
+      return _data + row*_dcols;
+    }
+
+    /// Return pointer to a given row of a writable mapping
+    inline T* operator[](const size_t row) {
+      assert(writable());
+      return _data + row*_dcols;
+    }
+
+    /// Return const reference to the element at the r row and c column
+    inline const T& operator()(const size_t row,const size_t col) const {
+      return *(_data + (row*_dcols + col));
+    }
+
+    /// Return reference to the element at the r row and c column
+    inline T& operator()(const size_t row,const size_t col) {
+      assert(writable());
+      return *(_data + (row*_dcols + col));
+    }
+
+    /**
+     * @name Views
+     */
+    //@{
+
+    /// View of all entries
+    inline ConstMatrixView<T> view() const {
+      return ConstMatrixView<T>(_data,_rows,_cols,_dcols);
+    }
+
+    /// Writable view of all entries of a writable mapping
+    inline MatrixView<T> view() {
+      assert(writable());
+      return MatrixView<T>(_data,_rows,_cols,_dcols);
+    }
+
+    /// View of a block of nrows x ncols entries
+    inline ConstMatrixView<T> block(const size_t row,
+                                    const size_t col,
+                                    const size_t nrows,
+                                    const size_t ncols) const {
+      return view().block(row,col,nrows,ncols);
+    }
+
+    /// Writable view of a block of nrows x ncols entries
+    inline MatrixView<T> block(const size_t row,
+                               const size_t col,
+                               const size_t nrows,
+                               const size_t ncols) {
+      return view().block(row,col,nrows,ncols);
+    }
+    //@}
+
+    /**
+     * @name Streaming
+     *
+     * The iterators visit the rows in order, as views of one row.
+     */
+    //@{
+    row_iterator begin() const;
+    row_iterator end() const;
+    //@}
+
+  private:
+    /// Map the first length bytes of the open file descriptor
+    void _map_file(const int fd,const size_t length,const MappingMode mode);
+
+    /// Set the attributes from the header at the beginning of the map
+    void _read_header(const std::string& file);
+
+    /// Swap all attributes with other
+    void _swap(MappedMatrix<T>& other) noexcept;
+  };
+
+  /**
+   * Input iterator over the rows of a mapped matrix
+   *
+   * Each time the iterator enters a new window of streamWindow bytes,
+   * it asks the operating system to read the next window, and to free
+   * the window just left.  Going through the rows once thus keeps at
+   * most a few windows in memory, and rarely waits for the disk.
+   */
+  template<typename T>
+  class MappedMatrix<T>::row_iterator {
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef ConstMatrixView<T> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const ConstMatrixView<T>* pointer;
+    typedef ConstMatrixView<T> reference;
+
+  private:
+    /// Matrix being traversed
+    const MappedMatrix<T>* _matrix;
+    /// Current row
+    size_t _row;
+    /// Number of rows per window
+    size_t _window;
+    /// First row of the next window
+    size_t _next;
+
+  public:
+    inline row_iterator(const MappedMatrix<T>& matrix,const size_t row)
+      : _matrix(&matrix),_row(row) {
+      const size_t bytes = matrix.dcols()*sizeof(T);
+      _window = (bytes==0) ? 1 : std::max(size_t(1),streamWindow/bytes);
+      _next = _row + _window;
+      if (_row < _matrix->rows()) {
+        // the first window is needed right now, the second one soon
+        _matrix->advise(WillNeed,_row,
+                        std::min(_row + 2*_window,_matrix->rows()));
+      }
+    }
+
+    /// View of the current row
+    inline ConstMatrixView<T> operator*() const {
+      return ConstMatrixView<T>((*_matrix)[_row],1,_matrix->cols(),
+                                _matrix->dcols());
+    }
+
+    /// Index of the current row
+    inline size_t row() const { return _row; }
+
+    inline row_iterator& operator++() {
+      if (++_row == _next) {
+        _advance();
+      }
+      return *this;
+    }
+
+    inline row_iterator operator++(int) {
+      row_iterator tmp(*this);
+      ++(*this);
+      return tmp;
+    }
+
+    inline bool operator==(const row_iterator& other) const {
+      return _row == other._row;
+    }
+
+    inline bool operator!=(const row_iterator& other) const {
+      return _row != other._row;
+    }
+
+  private:
+    // Read ahead the window after the current one, and free the last one
+    void _advance() {
+      const size_t rows = _matrix->rows();
+      _next = _row + _window;
+      if (_row < rows) {
+        _matrix->advise(DontNeed,_row - _window,_row);
+        _matrix->advise(WillNeed,std::min(_next,rows),
+                        std::min(_next + _window,rows));
+      }
+    }
+  };
+
+#endif
+
+} // namespace anpi
+
+#include "MappedMatrix.tpp"
+
+#endif
@@ -0,0 +1,379 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace anpi
+{
+  namespace detail {
+
+    /// Version of the binary matrix files written
+    static const uint32_t matrixFileVersion = 1;
+
+    /// Byte order mark of the binary matrix files
+    static const uint32_t matrixFileByteOrder = 0x01020304;
+
+    /// Header of a file with the given layout
+    template<typename T>
+    matrix_file_header fileHeader(const size_t rows,
+                                  const size_t cols,
+                                  const size_t dcols,
+                                  const size_t alignment) {
+      matrix_file_header h;
+      std::memset(&h,0,sizeof(h));
+      std::memcpy(h.magic,"ANPIMAT",8);
+      h.version     = matrixFileVersion;
+      h.byteOrder   = matrixFileByteOrder;
+      h.dtype       = matrix_dtype<T>::value;
+      h.elementSize = sizeof(T);
+      h.rows        = rows;
+      h.cols        = cols;
+      h.dcols       = dcols;
+      h.alignment   = alignment;
+      // the payload keeps the alignment of the rows
+      h.offset      = (sizeof(h) + alignment - 1)/alignment*alignment;
+      return h;
+    }
+
+    /**
+     * Check that the header h holds entries of type T in a file of the
+     * given size.  Returns an empty string if so, or the reason why not.
+     */
+    template<typename T>
+    std::string checkHeader(const matrix_file_header& h,const size_t size) {
+      if (std::memcmp(h.magic,"ANPIMAT",8) != 0) {
+        return "not a matrix file";
+      }
+      if (h.version > matrixFileVersion) {
+        return "unsupported version of the matrix file";
+      }
+      if (h.byteOrder != matrixFileByteOrder) {
+        return "matrix file with wrong byte order";
+      }
+      if ( (h.elementSize != sizeof(T)) ||
+           ( (h.dtype != 0) && (h.dtype != matrix_dtype<T>::value) ) ) {
+        return "matrix file holds entries of another type";
+      }
+      // the payload starts after the header, where a T may be placed
+      if ( (h.offset < sizeof(h)) || (h.offset > size) ||
+           (h.alignment == 0) || (h.offset % h.alignment != 0) ||
+           (h.offset % alignof(T) != 0) ) {
+        return "corrupted matrix file";
+      }
+      // the payload fits in the file, compared without overflows
+      const uint64_t room = (size - h.offset)/sizeof(T);
+      if ( (h.cols > h.dcols) ||
+           ( (h.dcols != 0) && (h.rows > room/h.dcols) ) ) {
+        return "corrupted matrix file";
+      }
+      return std::string();
+    }
+
+    /// Exception with the description of the last system error
+    inline Exception systemError(const std::string& what,
+                                 const std::string& file) {
+      return Exception(what + " '" + file + "': " + std::strerror(errno));
+    }
+
+  } // namespace detail
+
+  template<typename T,class Alloc>
+  void save(const std::string& file,const Matrix<T,Alloc>& m) {
+    const matrix_file_header h =
+      detail::fileHeader<T>(m.rows(),m.cols(),m.dcols(),
+                            extract_alignment<Alloc>::value);
+
+    std::ofstream os(file.c_str(),std::ios::binary | std::ios::trunc);
+    if (!os) {
+      throw detail::systemError("Cannot create",file);
+    }
+
+    // header, zeros up to the payload, and the payload as in memory
+    const std::string gap(h.offset - sizeof(h),'\0');
+    os.write(reinterpret_cast<const char*>(&h),sizeof(h));
+    os.write(gap.data(),gap.size());
+    os.write(reinterpret_cast<const char*>(m.data()),
+             m.rows()*m.dcols()*sizeof(T));
+    if (!os) {
+      throw detail::systemError("Cannot write",file);
+    }
+  }
+
+  template<typename T,class Alloc>
+  void load(const std::string& file,Matrix<T,Alloc>& m) {
+    std::ifstream is(file.c_str(),std::ios::binary);
+    if (!is) {
+      throw detail::systemError("Cannot open",file);
+    }
+    is.seekg(0,std::ios::end);
+    const size_t size = is.tellg();
+    is.seekg(0,std::ios::beg);
+
+    matrix_file_header h;
+    if (!is.read(reinterpret_cast<char*>(&h),sizeof(h))) {
+      throw Exception("Cannot read '" + file + "': not a matrix file");
+    }
+    const std::string error = detail::checkHeader<T>(h,size);
+    if (!error.empty()) {
+      throw Exception("Cannot read '" + file + "': " + error);
+    }
+
+    m.allocate(h.rows,h.cols);
+    is.seekg(h.offset,std::ios::beg);
+    if (m.dcols() == h.dcols) {
+      // same layout: the whole payload at once
+      is.read(reinterpret_cast<char*>(m.data()),h.rows*h.dcols*sizeof(T));
+    } else {
+      for (size_t r=0;(r<h.rows) && is;++r) {
+        is.seekg(h.offset + r*h.dcols*sizeof(T),std::ios::beg);
+        is.read(reinterpret_cast<char*>(m[r]),h.cols*sizeof(T));
+      }
+    }
+    if (!is) {
+      throw detail::systemError("Cannot read",file);
+    }
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+
+  template<typename T>
+  constexpr size_t MappedMatrix<T>::streamWindow;
+
+  template<typename T>
+  MappedMatrix<T>::MappedMatrix()
+    : _map(nullptr),_length(0),_data(nullptr),
+      _rows(0),_cols(0),_dcols(0),_alignment(0),_mode(MapReadOnly) {}
+
+  template<typename T>
+  MappedMatrix<T>::MappedMatrix(const std::string& file,
+                                const MappingMode mode)
+    : MappedMatrix() {
+    open(file,mode);
+  }
+
+  template<typename T>
+  MappedMatrix<T>::MappedMatrix(const std::string& file,
+                                const size_t rows,
+                                const size_t cols,
+                                const size_t alignment)
+    : MappedMatrix() {
+    create(file,rows,cols,alignment);
+  }
+
+  template<typename T>
+  MappedMatrix<T>::MappedMatrix(MappedMatrix<T>&& other) noexcept
+    : MappedMatrix() {
+    _swap(other);
+  }
+
+  template<typename T>
+  MappedMatrix<T>::~MappedMatrix() noexcept {
+    close();
+  }
+
+  template<typename T>
+  MappedMatrix<T>&
+  MappedMatrix<T>::operator=(MappedMatrix<T>&& other) noexcept {
+    if (this != &other) {
+      close();
+      _swap(other);
+    }
+    return *this;
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::open(const std::string& file,
+                             const MappingMode mode) {
+    close();
+
+    const int fd = ::open(file.c_str(),
+                          (mode==MapReadWrite) ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+      throw detail::systemError("Cannot open",file);
+    }
+
+    struct stat st;
+    if ( (::fstat(fd,&st) != 0) ) {
+      const Exception e = detail::systemError("Cannot open",file);
+      ::close(fd);
+      throw e;
+    }
+    if (size_t(st.st_size) < sizeof(matrix_file_header)) {
+      ::close(fd);
+      throw Exception("Cannot open '" + file + "': not a matrix file");
+    }
+
+    _map_file(fd,st.st_size,mode);
+    ::close(fd); // the mapping keeps the file open
+
+    if (_map == nullptr) {
+      throw detail::systemError("Cannot map",file);
+    }
+    _read_header(file);
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::create(const std::string& file,
+                               const size_t rows,
+                               const size_t cols,
+                               const size_t alignment) {
+    assert( (alignment >= sizeof(T)) ?
+            (alignment % sizeof(T) == 0) : (sizeof(T) % alignment == 0) );
+    close();
+
+    // pad the rows as the aligned_row_allocator does
+    const size_t blocks = (cols*sizeof(T) + alignment - 1)/alignment;
+    const size_t dcols = std::max(cols,blocks*alignment/sizeof(T));
+    const matrix_file_header h =
+      detail::fileHeader<T>(rows,cols,dcols,alignment);
+    const size_t length = h.offset + rows*dcols*sizeof(T);
+
+    const int fd = ::open(file.c_str(),O_RDWR | O_CREAT | O_TRUNC,0666);
+    if (fd < 0) {
+      throw detail::systemError("Cannot create",file);
+    }
+    // a sparse file: no page is written until used
+    if (::ftruncate(fd,length) != 0) {
+      const Exception e = detail::systemError("Cannot resize",file);
+      ::close(fd);
+      throw e;
+    }
+
+    _map_file(fd,length,MapReadWrite);
+    ::close(fd);
+
+    if (_map == nullptr) {
+      throw detail::systemError("Cannot map",file);
+    }
+    std::memcpy(_map,&h,sizeof(h));
+    _read_header(file);
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::flush() {
+    if (isOpen() && writable() && (::msync(_map,_length,MS_SYNC) != 0)) {
+      throw detail::systemError("Cannot write","mapped matrix");
+    }
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::close() noexcept {
+    if (_map != nullptr) {
+      ::munmap(_map,_length);
+    }
+    _map = nullptr;
+    _length = 0;
+    _data = nullptr;
+    _rows = _cols = _dcols = _alignment = 0;
+    _mode = MapReadOnly;
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::advise(const AccessAdvice advice) const {
+    advise(advice,0,_rows);
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::advise(const AccessAdvice advice,
+                               const size_t firstRow,
+                               const size_t lastRow) const {
+    if ( (_map == nullptr) || (firstRow >= lastRow) ) {
+      return;
+    }
+    assert(lastRow <= _rows);
+
+    static const int flags[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM,
+                                 MADV_WILLNEED, MADV_DONTNEED };
+    static const size_t page = ::sysconf(_SC_PAGESIZE);
+
+    // madvise works on whole pages
+    const size_t begin = reinterpret_cast<const char*>((*this)[firstRow])-_map;
+    const size_t end   = reinterpret_cast<const char*>((*this)[lastRow])-_map;
+    size_t first = begin/page*page;
+    size_t last  = std::min(_length,(end + page - 1)/page*page);
+    if (advice == DontNeed) {
+      // do not free the pages shared with rows still in use
+      first = (begin + page - 1)/page*page;
+      last  = end/page*page;
+      if (first >= last) {
+        return;
+      }
+    }
+
+    // the hints are optional: errors are ignored
+    ::madvise(_map + first,last - first,flags[advice]);
+  }
+
+  template<typename T>
+  typename MappedMatrix<T>::row_iterator MappedMatrix<T>::begin() const {
+    return row_iterator(*this,0);
+  }
+
+  template<typename T>
+  typename MappedMatrix<T>::row_iterator MappedMatrix<T>::end() const {
+    return row_iterator(*this,_rows);
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::_map_file(const int fd,
+                                  const size_t length,
+                                  const MappingMode mode) {
+    const int prot = (mode==MapReadWrite) ? (PROT_READ | PROT_WRITE)
+                                          : PROT_READ;
+    void* map = ::mmap(nullptr,length,prot,MAP_SHARED,fd,0);
+    if (map != MAP_FAILED) {
+      _map = static_cast<char*>(map);
+      _length = length;
+      _mode = mode;
+    }
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::_read_header(const std::string& file) {
+    matrix_file_header h;
+    std::memcpy(&h,_map,sizeof(h));
+
+    const std::string error = detail::checkHeader<T>(h,_length);
+    if (!error.empty()) {
+      close();
+      throw Exception("Cannot open '" + file + "': " + error);
+    }
+
+    _data = reinterpret_cast<T*>(_map + h.offset);
+    _rows = h.rows;
+    _cols = h.cols;
+    _dcols = h.dcols;
+    _alignment = h.alignment;
+  }
+
+  template<typename T>
+  void MappedMatrix<T>::_swap(MappedMatrix<T>& other) noexcept {
+    std::swap(_map,other._map);
+    std::swap(_length,other._length);
+    std::swap(_data,other._data);
+    std::swap(_rows,other._rows);
+    std::swap(_cols,other._cols);
+    std::swap(_dcols,other._dcols);
+    std::swap(_alignment,other._alignment);
+    std::swap(_mode,other._mode);
+  }
+
+#endif
+
+} // namespace anpi
@@ -11,6 +11,7 @@
 #ifndef ANPI_MATRIX_HPP
 #define ANPI_MATRIX_HPP
 
+#include <atomic>
 #include <cstddef>
 #include <cstring>
 #include <cassert>
@@ -20,6 +21,10 @@
 
 #include <AnpiConfig.hpp>
 #include <Allocator.hpp>
+#include <Parallel.hpp>
+#include <Numa.hpp>
+#include "bits/MatrixExpression.hpp"
+#include "MatrixView.hpp"
 
 #include <typeinfo>
 
@@ -46,9 +51,25 @@ namespace anpi
    * use anpi::aligned_allocator and for forcing the alignment of each
    * row you can use anpi::aligned_row_allocator, both defined in
    * <Allocator.hpp>.
+   *
+   * Other storage orders are selected with the third template
+   * parameter (see <MatrixLayout.hpp>).
+   *
+   * Allocators with the type copy_on_write, as anpi::shared_allocator
+   * and anpi::shared_row_allocator, make the copies of a matrix share
+   * its memory block, with a thread-safe reference counter.  The
+   * block is duplicated only when one of its owners is written
+   * through a non-const accessor (operator[], operator(), data(),
+   * view(), block(), fill() or the arithmetic assignments), so that
+   * passing matrices by value to functions that only read them costs
+   * no copy.  As with the implicitly shared containers of other
+   * libraries, pointers and references obtained from the non-const
+   * accessors must not be kept across a copy of the matrix, and a
+   * shared matrix must be written once in one thread (for instance
+   * calling data()) before several threads write on it.
    */
-  template<typename T,class Alloc=anpi::aligned_row_allocator<T> >
-  class Matrix {
+  template<typename T,class Alloc>
+  class Matrix<T,Alloc,row_major> {
   public:   
     /**
      * @name Standard types
@@ -97,6 +118,13 @@ namespace anpi
       /// Allocator indicates we must align each row
       static constexpr bool rowAlign =
         extract_alignment<allocator_type>::row_aligned;
+
+      /// Allocator indicates the copies share the memory block
+      static constexpr bool shared =
+        has_type_copy_on_write<allocator_type>::value;
+
+      /// Number of matrices owning _data, if shared
+      std::atomic<size_t>* _refs;
       
       /**
        * @name Default constructor
@@ -108,6 +136,12 @@ namespace anpi
       //@}
       
       void _swap_data(_Matrix_impl& _x) noexcept;
+
+      /// Other matrices own _data too
+      inline bool _isShared() const {
+        return shared && (_refs != nullptr) &&
+          (_refs->load(std::memory_order_acquire) > 1u);
+      }
     };
 
     /// The instance doing all the allocation work
@@ -149,6 +183,13 @@ namespace anpi
     Matrix(Matrix<T,Alloc>&& _other);
     Matrix(Matrix<T,Alloc>&& _other,const allocator_type& _a);
     ~Matrix() noexcept;
+
+    /**
+     * Copy a matrix stored with another allocator or in another
+     * layout (see <MatrixLayout.hpp>)
+     */
+    template<class OAlloc,class OLayout>
+    explicit Matrix(const Matrix<T,OAlloc,OLayout>& _other);
     
     /**
      * Constructs a matrix from a std::initializer_list
@@ -162,12 +203,26 @@ namespace anpi
     Matrix(std::initializer_list< std::initializer_list<value_type> > _lst);
     Matrix(std::initializer_list< std::initializer_list<value_type> > _lst,
            const allocator_type& _a);
+
+    /**
+     * Construct a matrix evaluating an element-wise expression
+     *
+     * All operations of the expression are computed in one single
+     * pass, without creating temporary matrices:
+     *
+     * \code
+     * anpi::Matrix<float> d = a + b - c;
+     * \endcode
+     */
+    template<class E>
+    Matrix(const MatrixExpression<E>& _expr);
     
     //@}
 
     
     /**
-     * Deep copy another matrix
+     * Deep copy another matrix, or share its memory block with
+     * copy-on-write allocators
      */
     Matrix<T,Alloc>& operator=(const Matrix<T,Alloc>& other);
 
@@ -176,6 +231,12 @@ namespace anpi
      */
     Matrix<T,Alloc>& operator=(Matrix<T,Alloc>&& other);
 
+    /**
+     * Evaluate the given element-wise expression into this matrix
+     */
+    template<class E>
+    Matrix<T,Alloc>& operator=(const MatrixExpression<E>& expr);
+
     /**
      * Compare two matrices for equality
      *
@@ -192,6 +253,7 @@ namespace anpi
     
     /// Return pointer to a given row
     inline T* operator[](const size_t row) {
+      _own(true);
       return this->_impl._data + row * this->_impl._dcols;
     }
 
@@ -202,6 +264,7 @@ namespace anpi
 
     /// Return reference to the element at the r row and c column
     T& operator()(const size_t row,const size_t col) {
+      _own(true);
       return *(this->_impl._data +
                (row*this->_impl._dcols + col));
     }
@@ -219,6 +282,10 @@ namespace anpi
     
     /**
      * Allocate memory for the given number of rows and cols
+     *
+     * Afterwards the matrix owns its memory block exclusively.  The
+     * entries are kept only if the size does not change and the block
+     * was not shared.
      */
     void allocate(const size_t row,const size_t col);
 
@@ -243,11 +310,11 @@ namespace anpi
 
     /**
      * Fill this matrix with the content of the other matrix.  Even if
-     * the padding of both matrices differ, the content will be
-     * appropriately copied.
+     * the padding or the layout of both matrices differ, the content
+     * will be appropriately copied.
      */
-    template<class OAlloc>
-    void fill(const Matrix<T,OAlloc>& _other);
+    template<class OAlloc,class OLayout>
+    void fill(const Matrix<T,OAlloc,OLayout>& _other);
     
     /**
      * Check if the matrix is empty (zero rows or columns)
@@ -289,13 +356,51 @@ namespace anpi
     /**
      * Pointer to data block
      */
-    inline T* data() { return this->_impl._data; }
+    inline T* data() { _own(true); return this->_impl._data; }
 
     /**
      * Pointer to data block
      */
     inline const T* data() const { return this->_impl._data; }
 
+    /**
+     * @name Views
+     *
+     * Views refer to the entries of this matrix without copying them.
+     * They become invalid if this matrix is reallocated or destroyed.
+     */
+    //@{
+
+    /// View of the whole matrix
+    inline MatrixView<T> view() {
+      return MatrixView<T>(data(),rows(),cols(),dcols());
+    }
+
+    /// Read-only view of the whole matrix
+    inline ConstMatrixView<T> view() const {
+      return ConstMatrixView<T>(data(),rows(),cols(),dcols());
+    }
+
+    /**
+     * View of the block with nrows x ncols entries whose first entry
+     * is at the given row and column
+     */
+    inline MatrixView<T> block(const size_t row,
+                               const size_t col,
+                               const size_t nrows,
+                               const size_t ncols) {
+      return view().block(row,col,nrows,ncols);
+    }
+
+    /// Read-only view of a block of the matrix
+    inline ConstMatrixView<T> block(const size_t row,
+                                    const size_t col,
+                                    const size_t nrows,
+                                    const size_t ncols) const {
+      return view().block(row,col,nrows,ncols);
+    }
+    //@}
+
     /**
      * Extract one particular column
      *
@@ -313,6 +418,14 @@ namespace anpi
 
     /// Subtract another matrix to this one, and leave the result in here
     Matrix& operator-=(const Matrix& other);
+
+    /// Sum an expression to this matrix, evaluated in one single pass
+    template<class E>
+    Matrix& operator+=(const MatrixExpression<E>& expr);
+
+    /// Subtract an expression from this matrix, in one single pass
+    template<class E>
+    Matrix& operator-=(const MatrixExpression<E>& expr);
     
     //@}
 
@@ -321,6 +434,22 @@ namespace anpi
     // Call the memory deallocation 
     void _deallocate();
 
+    /// Share the memory block of the other matrix
+    void _share(const Matrix<T,Alloc>& other);
+
+    /**
+     * Give this matrix its own memory block before writing on it,
+     * copying the entries only if keep is true
+     */
+    inline void _own(const bool keep) {
+      if (this->_impl._isShared()) {
+        _unshare(keep);
+      }
+    }
+
+    /// Replace the shared memory block with an exclusive one
+    void _unshare(const bool keep);
+
     
     /// Use the allocator to create the necessary storage
     void _create_storage(size_t _rows,size_t _cols);
@@ -338,18 +467,15 @@ namespace anpi
   }; // class Matrix
 
 
-  // External arithmetic operators
-  template<typename T,class Alloc>
-  Matrix<T,Alloc> operator+(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b);
-
-  template<typename T,class Alloc>
-  Matrix<T,Alloc> operator-(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b);
+  // External arithmetic operators a+b and a-b are lazy expressions
+  // defined in bits/MatrixExpression.hpp
+  // The matrix product a*b and gemm() are defined in
+  // bits/MatrixProduct.hpp
   
 } // namespace ANPI
 
 // include the template implementations
 #include "Matrix.tpp"
+#include "MatrixView.tpp"
 
 #endif
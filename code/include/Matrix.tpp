@@ -9,6 +9,10 @@
  */
 
 #include "bits/MatrixArithmetic.hpp"
+#include "bits/MatrixProduct.hpp"
+#include "bits/MatrixTranspose.hpp"
+#include "bits/MatrixReduction.hpp"
+#include "bits/LayoutMatrix.hpp"
 
 namespace anpi
 {
@@ -19,18 +23,20 @@ namespace anpi
 
   template<typename T,class Alloc>
   Matrix<T,Alloc>::_Matrix_impl::_Matrix_impl()
-    : allocator_type(), _data(), _rows(), _cols(), _dcols() { }
+    : allocator_type(), _data(), _rows(), _cols(), _dcols(),
+      _refs(nullptr) { }
 
   template<typename T,class Alloc>
   Matrix<T,Alloc>::_Matrix_impl::
   _Matrix_impl(allocator_type const& _a) noexcept
-    : allocator_type(_a), _data(), _rows(), _cols(), _dcols() { }
+    : allocator_type(_a), _data(), _rows(), _cols(), _dcols(),
+      _refs(nullptr) { }
       
   template<typename T,class Alloc>
   Matrix<T,Alloc>::_Matrix_impl::
   _Matrix_impl(allocator_type&& _a) noexcept
     : allocator_type(std::move(_a)),
-      _data(), _rows(), _cols(), _dcols() { }
+      _data(), _rows(), _cols(), _dcols(), _refs(nullptr) { }
   
   template<typename T,class Alloc>
   void Matrix<T,Alloc>::_Matrix_impl::
@@ -39,6 +45,7 @@ namespace anpi
     std::swap(_rows,  _x._rows);
     std::swap(_cols,  _x._cols);
     std::swap(_dcols, _x._dcols);
+    std::swap(_refs,  _x._refs);
   }
      
   // ------------------------
@@ -128,21 +135,46 @@ namespace anpi
   }
   
 
+  template<typename T,class Alloc>
+  template<class E>
+  Matrix<T,Alloc>::Matrix(const MatrixExpression<E>& _expr)
+    : _impl() {
+    ::anpi::aimpl::evaluate(_expr,*this);
+  }
+
   template<typename T,class Alloc>
   Matrix<T,Alloc>::Matrix(const Matrix<T,Alloc>& _other)
-    : Matrix(_other.rows(),_other.cols(),DoNotInitialize) {
-    
-    fill(_other.data());
+    : _impl() {
+
+    if (_Matrix_impl::shared) {
+      _share(_other);
+    } else {
+      _create_storage(_other.rows(),_other.cols());
+      fill(_other.data());
+    }
   }
 
   template<typename T,class Alloc>
   Matrix<T,Alloc>::Matrix(const Matrix<T,Alloc>& _other,
                           const allocator_type& _a)
-    : Matrix(_other.rows(),_other.cols(),DoNotInitialize,_a) {
-    
-    fill(_other.data());
+    : _impl(_a) {
+
+    if (_Matrix_impl::shared && (_other._get_allocator() == _a)) {
+      _share(_other);
+    } else {
+      _create_storage(_other.rows(),_other.cols());
+      fill(_other.data());
+    }
   }
   
+  template<typename T,class Alloc>
+  template<class OAlloc,class OLayout>
+  Matrix<T,Alloc>::Matrix(const Matrix<T,OAlloc,OLayout>& _other)
+    : Matrix(_other.rows(),_other.cols(),DoNotInitialize) {
+
+    fill(_other);
+  }
+
   template<typename T,class Alloc>
   Matrix<T,Alloc>::Matrix(Matrix<T,Alloc>&& _other)
     : _impl(std::move(_other._get_allocator())) {
@@ -173,6 +205,13 @@ namespace anpi
   
   template<typename T,class Alloc>
   Matrix<T,Alloc>& Matrix<T,Alloc>::operator=(const Matrix<T,Alloc>& other) {
+    if (_Matrix_impl::shared) {
+      if (this->_impl._data != other._impl._data) { // alias detection
+        _deallocate();
+        _share(other);
+      }
+      return *this;
+    }
     allocate(other._impl._rows,other._impl._cols);
     fill(other.data());
     return *this;
@@ -180,13 +219,22 @@ namespace anpi
 
   template<typename T,class Alloc>
   Matrix<T,Alloc>& Matrix<T,Alloc>::operator=(Matrix<T,Alloc>&& other) {
-    if (this->data() != other.data() ) { // alias detection first
+    // alias detection first, without unsharing the memory blocks
+    if (this->_impl._data != other._impl._data) {
       this->_impl._swap_data(other._impl);
     }
     other.clear();
     return *this;
   }
   
+  template<typename T,class Alloc>
+  template<class E>
+  Matrix<T,Alloc>&
+  Matrix<T,Alloc>::operator=(const MatrixExpression<E>& expr) {
+    ::anpi::aimpl::evaluate(expr,*this);
+    return *this;
+  }
+  
   template<typename T,class Alloc>
   bool Matrix<T,Alloc>::operator==(const Matrix<T,Alloc>& other) const {
     if (&other==this) return true; // alias detection
@@ -195,6 +243,9 @@ namespace anpi
     if ((other.rows() != this->rows()) ||
         (other.cols() != this->cols())) return false;
 
+    // shared memory block
+    if (this->_impl._data == other._impl._data) return true;
+
     // check the content with pointers
     if (this->_impl._dcols == this->_impl._cols)
       return (memcmp(this->_impl._data,
@@ -231,6 +282,9 @@ namespace anpi
     if ( (r!=rows()) || (c!=cols()) ) {
       _deallocate();
       _create_storage(r,c);
+    } else {
+      // the caller writes on the block: it cannot stay shared
+      _own(false);
     }
   }
 
@@ -276,11 +330,21 @@ namespace anpi
       n     = blocks*_Matrix_impl::alignment/sizeof(T);
     } 
           
+    // the counter of owners of shared blocks, released on failures
+    std::unique_ptr< std::atomic<size_t> >
+      refs((_Matrix_impl::shared && (n != 0))
+           ? new std::atomic<size_t>(1u)
+           : nullptr);
+
     // Call the allocator to reserve the required memory
     this->_impl._data
       = (n != 0)
       ? std::allocator_traits<allocator_type>::allocate(_impl, n) 
       : pointer();
+    this->_impl._refs = refs.release();
+
+    // distribute the pages on the NUMA nodes, if requested
+    ::anpi::detail::placeRows(this->_impl._data,__rows,dcols);
     
     // Initialize the rest of the attributes
     this->_impl._rows = __rows;
@@ -290,7 +354,17 @@ namespace anpi
 
   template<typename T,class Alloc>
   void Matrix<T,Alloc>::_deallocate() {
-    if (this->_impl._data) {
+    // only the last owner of a shared block releases it
+    bool last = true;
+    if (this->_impl._refs != nullptr) {
+      last = (this->_impl._refs->fetch_sub(1u,std::memory_order_acq_rel) == 1u);
+      if (last) {
+        delete this->_impl._refs;
+      }
+      this->_impl._refs = nullptr;
+    }
+
+    if (this->_impl._data && last) {
       std::allocator_traits<allocator_type>::deallocate(this->_impl,
                                                         this->_impl._data,
                                                         this->_impl.tentries());
@@ -302,6 +376,30 @@ namespace anpi
     this->_impl._dcols = 0;
   }
 
+  template<typename T,class Alloc>
+  void Matrix<T,Alloc>::_share(const Matrix<T,Alloc>& other) {
+    assert(this->_impl._data == nullptr);
+
+    if (other._impl._refs != nullptr) {
+      other._impl._refs->fetch_add(1u,std::memory_order_relaxed);
+    }
+    this->_impl._data  = other._impl._data;
+    this->_impl._rows  = other._impl._rows;
+    this->_impl._cols  = other._impl._cols;
+    this->_impl._dcols = other._impl._dcols;
+    this->_impl._refs  = other._impl._refs;
+  }
+
+  template<typename T,class Alloc>
+  void Matrix<T,Alloc>::_unshare(const bool keep) {
+    Matrix<T,Alloc> own(rows(),cols(),DoNotInitialize,_get_allocator());
+    if (keep) {
+      own.fill(static_cast<const T*>(this->_impl._data));
+    }
+    // the old block stays with its other owners
+    swap(own);
+  }
+
   template<typename T,class Alloc>
   typename Matrix<T,Alloc>::allocator_type&
   Matrix<T,Alloc>::_get_allocator() noexcept {
@@ -316,22 +414,19 @@ namespace anpi
   
   template<typename T,class Alloc>
   void Matrix<T,Alloc>::fill(const T val) {
-    T* end = this->_impl._data + ( this->_impl._rows * this->_impl._dcols );
-    for (T* ptr = this->_impl._data;ptr!=end;++ptr) {
-      *ptr = val;
-    }
-
-    // ACCELERATE ME!
+    _own(false);
+    ::anpi::aimpl::fill(*this,val);
   }
 
   template<typename T,class Alloc>
   void Matrix<T,Alloc>::fill(const T* mem) {
-    std::memcpy(this->_impl._data,mem,sizeof(T)*this->_impl.tentries());
+    _own(false);
+    ::anpi::aimpl::fill(*this,mem);
   }
 
   template<typename T,class Alloc>
-  template<class OAlloc>
-  void Matrix<T,Alloc>::fill(const Matrix<T,OAlloc>& _other) {
+  template<class OAlloc,class OLayout>
+  void Matrix<T,Alloc>::fill(const Matrix<T,OAlloc,OLayout>& _other) {
 
     // we can only copy this number of rows
     const size_t r=std::min(_other.rows(),this->rows());
@@ -339,10 +434,10 @@ namespace anpi
     // we can only copy this number of columns
     const size_t c=std::min(_other.cols(),this->cols());
 
-    // copy each row separately, ignoring the differences of sizes
-    for (size_t i=0u;i<r;++i) {
-      std::memcpy(this->operator[](i),_other[i],sizeof(value_type)*c);
-    }
+    // copy the common block, ignoring the differences of sizes
+    ::anpi::detail::copyLayout<OLayout,row_major>(
+       ::anpi::detail::storageView(_other),_other.cols(),
+       this->view(),this->cols(),r,c);
   }
 
   
@@ -399,25 +494,23 @@ namespace anpi
   }
 
   template<typename T,class Alloc>
-  Matrix<T,Alloc> operator+(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b) {
+  template<class E>
+  Matrix<T,Alloc>&
+  Matrix<T,Alloc>::operator+=(const MatrixExpression<E>& expr) {
 
-    assert( (a.rows()==b.rows()) && (a.cols()==b.cols()) );    
-
-    Matrix<T,Alloc> c(a.rows(),a.cols(),anpi::DoNotInitialize);
-    ::anpi::aimpl::add(a,b,c);
-    return c;
+    ::anpi::aimpl::evaluate(*this + expr.derived(),*this);
+    
+    return *this;
   }
 
   template<typename T,class Alloc>
-  Matrix<T,Alloc> operator-(const Matrix<T,Alloc>& a,
-                            const Matrix<T,Alloc>& b) {
-    
-    assert( (a.rows()==b.rows()) && (a.cols()==b.cols()) );
+  template<class E>
+  Matrix<T,Alloc>&
+  Matrix<T,Alloc>::operator-=(const MatrixExpression<E>& expr) {
+
+    ::anpi::aimpl::evaluate(*this - expr.derived(),*this);
     
-    Matrix<T,Alloc> c(a.rows(),a.cols(),anpi::DoNotInitialize);
-    ::anpi::aimpl::subtract(a,b,c);
-    return c;
+    return *this;
   }
   
 } // namespace ANPI
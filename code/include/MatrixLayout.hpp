@@ -0,0 +1,152 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_LAYOUT_HPP
+#define ANPI_MATRIX_LAYOUT_HPP
+
+#include <cstddef>
+
+#include <Allocator.hpp>
+
+namespace anpi
+{
+  /**
+   * @name Storage orders of anpi::Matrix
+   *
+   * The third template parameter of anpi::Matrix selects how the
+   * entries are placed in memory.  Each layout keeps its entries in a
+   * row-major "storage" matrix, whose rows are padded as usual:
+   *
+   * - row_major: the storage is the matrix itself.  This is the
+   *   default, and the only layout all algorithms (products,
+   *   factorizations, views) work with.
+   * - column_major: the storage is the transposed matrix, so that
+   *   each column is contiguous, as in Fortran.
+   * - tiled<B>: the matrix is cut in B x B tiles, and each tile is
+   *   stored contiguously (row-major inside the tile), one tile row
+   *   after the other.  The tiles on the right and bottom borders are
+   *   padded to full size.
+   *
+   * \code
+   * anpi::Matrix<float,anpi::aligned_row_allocator<float>,
+   *              anpi::column_major> f(rows,cols);   // Fortran order
+   * anpi::Matrix<float> a(f);                        // row-major copy
+   * \endcode
+   *
+   * Every rectangle of the matrix lying in one "piece" of the layout
+   * is a (possibly transposed) row-major block of the storage.  The
+   * row- and column-major layouts have one single piece, and the
+   * tiled layout one per tile.  The layout policies provide:
+   *
+   * - storageRows() and storageCols(): size of the storage
+   * - offset(): position of an entry in the storage
+   * - granularity: size of the square pieces (zero: one piece)
+   * - transposed: the pieces are transposed in the storage
+   * - piece(): storage view of a rectangle inside one piece
+   */
+  //@{
+
+  /// Rows stored one after the other
+  struct row_major {
+    static constexpr size_t granularity = 0;
+    static constexpr bool transposed = false;
+
+    static inline size_t storageRows(const size_t rows,const size_t) {
+      return rows;
+    }
+
+    static inline size_t storageCols(const size_t,const size_t cols) {
+      return cols;
+    }
+
+    static inline size_t offset(const size_t row,const size_t col,
+                                const size_t,const size_t dcols) {
+      return row*dcols + col;
+    }
+
+    template<class View>
+    static inline View piece(const View& s,const size_t,
+                             const size_t row,const size_t col,
+                             const size_t nrows,const size_t ncols) {
+      return s.block(row,col,nrows,ncols);
+    }
+  };
+
+  /// Columns stored one after the other
+  struct column_major {
+    static constexpr size_t granularity = 0;
+    static constexpr bool transposed = true;
+
+    static inline size_t storageRows(const size_t,const size_t cols) {
+      return cols;
+    }
+
+    static inline size_t storageCols(const size_t rows,const size_t) {
+      return rows;
+    }
+
+    static inline size_t offset(const size_t row,const size_t col,
+                                const size_t,const size_t dcols) {
+      return col*dcols + row;
+    }
+
+    template<class View>
+    static inline View piece(const View& s,const size_t,
+                             const size_t row,const size_t col,
+                             const size_t nrows,const size_t ncols) {
+      return s.block(col,row,ncols,nrows);
+    }
+  };
+
+  /// Square tiles of B x B entries stored one after the other
+  template<size_t B=32>
+  struct tiled {
+    static_assert(B>0,"Tiles must not be empty");
+
+    static constexpr size_t granularity = B;
+    static constexpr bool transposed = false;
+
+    /// Number of tiles covering n rows or columns
+    static inline size_t tiles(const size_t n) {
+      return (n + (B-1))/B;
+    }
+
+    static inline size_t storageRows(const size_t rows,const size_t cols) {
+      return tiles(rows)*tiles(cols)*B;
+    }
+
+    static inline size_t storageCols(const size_t,const size_t) {
+      return B;
+    }
+
+    static inline size_t offset(const size_t row,const size_t col,
+                                const size_t cols,const size_t dcols) {
+      const size_t tile = (row/B)*tiles(cols) + col/B;
+      return (tile*B + row%B)*dcols + col%B;
+    }
+
+    template<class View>
+    static inline View piece(const View& s,const size_t cols,
+                             const size_t row,const size_t col,
+                             const size_t nrows,const size_t ncols) {
+      const size_t tile = (row/B)*tiles(cols) + col/B;
+      return s.block(tile*B + row%B,col%B,nrows,ncols);
+    }
+  };
+  //@}
+
+  template<typename T,
+           class Alloc=anpi::aligned_row_allocator<T>,
+           class Layout=row_major>
+  class Matrix;
+
+} // namespace anpi
+
+#endif
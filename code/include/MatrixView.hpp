@@ -0,0 +1,319 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_VIEW_HPP
+#define ANPI_MATRIX_VIEW_HPP
+
+#include <cstddef>
+#include <cassert>
+
+#include "bits/MatrixExpression.hpp"
+
+namespace anpi
+{
+  /**
+   * Read-only view of a rectangular block of a row-major matrix.
+   *
+   * A view does not own any memory: it just refers to rows() x cols()
+   * entries of another matrix, whose rows start dcols() entries apart.
+   * Views are cheap to copy, and allow to run the arithmetic kernels
+   * on sub-blocks (tiles) of a matrix without copying them:
+   *
+   * \code
+   * anpi::Matrix<float> a(512,512);
+   * auto tile = a.block(128,64,32,32); // rows [128,160), cols [64,96)
+   * \endcode
+   *
+   * A view becomes invalid when the matrix it refers to is destroyed
+   * or reallocated.
+   */
+  template<typename T>
+  class ConstMatrixView {
+  public:
+    typedef T value_type;
+
+  protected:
+    /// First entry of the view
+    const T* _data;
+    /// Number of rows
+    size_t _rows;
+    /// Number of columns
+    size_t _cols;
+    /// Distance in entries between the beginnings of two rows
+    size_t _dcols;
+
+  public:
+    /// Empty view
+    inline ConstMatrixView()
+      : _data(nullptr),_rows(0),_cols(0),_dcols(0) {}
+
+    /// View of rows x cols entries with rows starting dcols entries apart
+    inline ConstMatrixView(const T* data,
+                           const size_t rows,
+                           const size_t cols,
+                           const size_t dcols)
+      : _data(data),_rows(rows),_cols(cols),_dcols(dcols) {
+      assert( (cols <= dcols) || (rows <= 1) );
+    }
+
+    /// View of the whole matrix m
+    template<class Alloc>
+    inline ConstMatrixView(const Matrix<T,Alloc>& m)
+      : _data(m.data()),_rows(m.rows()),_cols(m.cols()),_dcols(m.dcols()) {}
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /// Distance in entries between the beginnings of two rows
+    inline size_t dcols() const { return _dcols; }
+
+    /// Total number of entries (rows x cols)
+    inline size_t entries() const { return _rows*_cols; }
+
+    /// Check if the view is empty (zero rows or columns)
+    inline bool empty() const { return (_rows==0) || (_cols==0); }
+
+    /**
+     * Check if all rows lie one after the other in memory, so that
+     * the view can be processed as one single block of entries()
+     */
+    inline bool contiguous() const { return (_cols==_dcols) || (_rows<=1); }
+
+    /// Pointer to the first entry
+    inline const T* data() const { return _data; }
+
+    /// Return read-only pointer to a given row
+    inline const T* operator[](const size_t row) const {
+      return _data + row*_dcols;
+    }
+
+    /// Return const reference to the element at the r row and c column
+    inline const T& operator()(const size_t row,const size_t col) const {
+      return *(_data + (row*_dcols + col));
+    }
+
+    /**
+     * View of the block with nrows x ncols entries whose first entry
+     * is at the given row and column of this view
+     */
+    inline ConstMatrixView<T> block(const size_t row,
+                                    const size_t col,
+                                    const size_t nrows,
+                                    const size_t ncols) const {
+      assert( (row+nrows <= _rows) && (col+ncols <= _cols) );
+      return ConstMatrixView<T>(_data + (row*_dcols + col),nrows,ncols,_dcols);
+    }
+  };
+
+  /**
+   * Writable view of a rectangular block of a row-major matrix.
+   *
+   * The constness of a view is shallow: a const MatrixView still
+   * allows to modify the entries it refers to, so that temporary views
+   * can be used as destination of the arithmetic operations:
+   *
+   * \code
+   * c.block(0,0,16,16) = a.block(0,0,16,16) + b.block(16,16,16,16);
+   * \endcode
+   *
+   * Assigning a matrix or a view to a view copies its entries, as for
+   * matrices.  The sizes must match.
+   *
+   * The arithmetic on views does not check for aliasing: the
+   * destination may be exactly one of the operands, but it must not
+   * partially overlap any of them.
+   */
+  template<typename T>
+  class MatrixView : public ConstMatrixView<T> {
+  public:
+    /// Empty view
+    inline MatrixView() : ConstMatrixView<T>() {}
+
+    /// View of rows x cols entries with rows starting dcols entries apart
+    inline MatrixView(T* data,
+                      const size_t rows,
+                      const size_t cols,
+                      const size_t dcols)
+      : ConstMatrixView<T>(data,rows,cols,dcols) {}
+
+    /// View of the whole matrix m
+    template<class Alloc>
+    inline MatrixView(Matrix<T,Alloc>& m)
+      : ConstMatrixView<T>(m.data(),m.rows(),m.cols(),m.dcols()) {}
+
+    /// Pointer to the first entry
+    inline T* data() const {
+      // views are only writable if constructed from writable memory
+      return const_cast<T*>(this->_data);
+    }
+
+    /// Return pointer to a given row
+    inline T* operator[](const size_t row) const {
+      return data() + row*this->_dcols;
+    }
+
+    /// Return reference to the element at the r row and c column
+    inline T& operator()(const size_t row,const size_t col) const {
+      return *(data() + (row*this->_dcols + col));
+    }
+
+    /**
+     * View of the block with nrows x ncols entries whose first entry
+     * is at the given row and column of this view
+     */
+    inline MatrixView<T> block(const size_t row,
+                               const size_t col,
+                               const size_t nrows,
+                               const size_t ncols) const {
+      assert( (row+nrows <= this->_rows) && (col+ncols <= this->_cols) );
+      return MatrixView<T>(data() + (row*this->_dcols + col),
+                           nrows,ncols,this->_dcols);
+    }
+
+    /// Copy the entries of the other view, which must have the same size
+    const MatrixView<T>& operator=(const MatrixView<T>& other) const;
+
+    /// Copy the entries of a view, which must have the same size
+    const MatrixView<T>& operator=(const ConstMatrixView<T>& other) const;
+
+    /// Copy the entries of a matrix, which must have the same size
+    template<class Alloc>
+    const MatrixView<T>& operator=(const Matrix<T,Alloc>& other) const;
+
+    /**
+     * Evaluate the given element-wise expression into the entries of
+     * this view, which must have the size of the expression
+     */
+    template<class E>
+    const MatrixView<T>& operator=(const MatrixExpression<E>& expr) const;
+
+    /// Set all entries of the view to val
+    void fill(const T val) const;
+
+    /// Copy the entries of the other view, which must have the same size
+    void fill(const ConstMatrixView<T>& other) const;
+
+    /**
+     * @name Arithmetic operators
+     */
+    //@{
+
+    /// Sum another matrix or view to this one
+    const MatrixView<T>& operator+=(const ConstMatrixView<T>& other) const;
+
+    /// Subtract another matrix or view from this one
+    const MatrixView<T>& operator-=(const ConstMatrixView<T>& other) const;
+
+    /// Sum an expression to this view, evaluated in one single pass
+    template<class E>
+    const MatrixView<T>& operator+=(const MatrixExpression<E>& expr) const;
+
+    /// Subtract an expression from this view, in one single pass
+    template<class E>
+    const MatrixView<T>& operator-=(const MatrixExpression<E>& expr) const;
+    //@}
+  };
+
+  /**
+   * Lazy transpose of a matrix or view.
+   *
+   * The transposed view just exchanges the role of rows and columns
+   * of the original entries, without moving any data.  Kernels that
+   * accept arbitrary strides, like the matrix product, consume it
+   * directly:
+   *
+   * \code
+   * anpi::gemm(1.0,anpi::transposed(a),b,0.0,c); // c = a^T * b
+   * \endcode
+   *
+   * Use anpi::transpose() to compute a transposed copy instead.
+   */
+  template<typename T>
+  class TransposedView {
+  public:
+    typedef T value_type;
+
+  protected:
+    /// The view being transposed
+    ConstMatrixView<T> _original;
+
+  public:
+    /// Transpose the given view
+    inline explicit TransposedView(const ConstMatrixView<T>& original)
+      : _original(original) {}
+
+    /// The view being transposed
+    inline const ConstMatrixView<T>& original() const { return _original; }
+
+    /// Number of rows (columns of the original)
+    inline size_t rows() const { return _original.cols(); }
+
+    /// Number of columns (rows of the original)
+    inline size_t cols() const { return _original.rows(); }
+
+    /// Total number of entries (rows x cols)
+    inline size_t entries() const { return _original.entries(); }
+
+    /// Check if the view is empty (zero rows or columns)
+    inline bool empty() const { return _original.empty(); }
+
+    /// Return const reference to the element at the r row and c column
+    inline const T& operator()(const size_t row,const size_t col) const {
+      return _original(col,row);
+    }
+  };
+
+  /**
+   * @name Lazy transpose
+   */
+  //@{
+
+  /// Transposed view of the matrix m
+  template<typename T,class Alloc>
+  inline TransposedView<T> transposed(const Matrix<T,Alloc>& m) {
+    return TransposedView<T>(ConstMatrixView<T>(m));
+  }
+
+  /// Transposed view of the view v
+  template<typename T>
+  inline TransposedView<T> transposed(const ConstMatrixView<T>& v) {
+    return TransposedView<T>(v);
+  }
+
+  /// The transpose of a transposed view is the original view
+  template<typename T>
+  inline ConstMatrixView<T> transposed(const TransposedView<T>& v) {
+    return v.original();
+  }
+  //@}
+
+  // Views are refered in expressions as the matrices they come from
+  template<typename T>
+  struct expression_operand< ConstMatrixView<T> > {
+    static constexpr bool value = true;
+    typedef MatrixReference<T> type;
+  };
+
+  // Views are refered in expressions as the matrices they come from
+  template<typename T>
+  struct expression_operand< MatrixView<T> > {
+    static constexpr bool value = true;
+    typedef MatrixReference<T> type;
+  };
+
+} // namespace anpi
+
+// the views are implemented together with the matrix
+#include "Matrix.hpp"
+
+#endif
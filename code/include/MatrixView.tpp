@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+namespace anpi
+{
+
+  // -------------------------------------------
+  // Implementation of MatrixView
+  // -------------------------------------------
+
+  template<typename T>
+  const MatrixView<T>&
+  MatrixView<T>::operator=(const MatrixView<T>& other) const {
+    ::anpi::aimpl::copy(other,*this);
+    return *this;
+  }
+
+  template<typename T>
+  const MatrixView<T>&
+  MatrixView<T>::operator=(const ConstMatrixView<T>& other) const {
+    ::anpi::aimpl::copy(other,*this);
+    return *this;
+  }
+
+  template<typename T>
+  template<class Alloc>
+  const MatrixView<T>&
+  MatrixView<T>::operator=(const Matrix<T,Alloc>& other) const {
+    ::anpi::aimpl::copy(other.view(),*this);
+    return *this;
+  }
+
+  template<typename T>
+  template<class E>
+  const MatrixView<T>&
+  MatrixView<T>::operator=(const MatrixExpression<E>& expr) const {
+    ::anpi::aimpl::evaluate(expr,*this);
+    return *this;
+  }
+
+  template<typename T>
+  void MatrixView<T>::fill(const T val) const {
+    ::anpi::aimpl::fill(*this,val);
+  }
+
+  template<typename T>
+  void MatrixView<T>::fill(const ConstMatrixView<T>& other) const {
+    ::anpi::aimpl::copy(other,*this);
+  }
+
+  template<typename T>
+  const MatrixView<T>&
+  MatrixView<T>::operator+=(const ConstMatrixView<T>& other) const {
+    ::anpi::aimpl::add(*this,other);
+    return *this;
+  }
+
+  template<typename T>
+  const MatrixView<T>&
+  MatrixView<T>::operator-=(const ConstMatrixView<T>& other) const {
+    ::anpi::aimpl::subtract(*this,other);
+    return *this;
+  }
+
+  template<typename T>
+  template<class E>
+  const MatrixView<T>&
+  MatrixView<T>::operator+=(const MatrixExpression<E>& expr) const {
+    ::anpi::aimpl::evaluate(*this + expr.derived(),*this);
+    return *this;
+  }
+
+  template<typename T>
+  template<class E>
+  const MatrixView<T>&
+  MatrixView<T>::operator-=(const MatrixExpression<E>& expr) const {
+    ::anpi::aimpl::evaluate(*this - expr.derived(),*this);
+    return *this;
+  }
+
+} // namespace anpi
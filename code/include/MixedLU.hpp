@@ -0,0 +1,175 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_MIXED_LU_HPP
+#define ANPI_MIXED_LU_HPP
+
+#include <cstddef>
+
+#include "Exception.hpp"
+#include "LU.hpp"
+#include "Matrix.hpp"
+#include "Vector.hpp"
+
+namespace anpi
+{
+  /**
+   * Limits of the iterative refinement of anpi::MixedLU.
+   */
+  struct refinement_limits {
+    /// Refinement steps before falling back to the double factorization
+    static constexpr size_t iterations = 30;
+    /**
+     * Each step must reduce the scaled residual at least by this
+     * factor, or the refinement is considered stalled.
+     */
+    static constexpr double stall = 0.5;
+    /**
+     * Right hand sides up to which the residuals are computed column
+     * by column with matrix-vector products, which read A once per
+     * column instead of packing it for the matrix product.
+     */
+    static constexpr size_t columns = 4;
+  };
+
+  /**
+   * Solver of double precision linear systems A*X = B, which
+   * factorizes A in single precision and refines the solutions in
+   * double precision.
+   *
+   * The float factorization moves half the bytes of a double one, and
+   * fills twice the lanes of each register, so that it takes about
+   * half the time.  Each solution is first computed with the float
+   * factors, and then corrected with the residual R = B - A*X,
+   * computed in double precision:
+   *
+   *   X = X + (LU)^-1 * R
+   *
+   * until the residual of each column is as small as the one of a
+   * backward stable double precision solver:
+   *
+   *   max|r| <= sqrt(n) * eps * ||A||_inf * max|x|
+   *
+   * Each step costs O(n^2) operations per column, against the O(n^3)
+   * of the factorization.  For matrices with condition numbers near or
+   * beyond 1/eps of float the refinement converges slowly or not at
+   * all; if a step does not halve the residual (see refinement_limits),
+   * or if A cannot be represented in float, the matrix is factorized
+   * in double precision and the systems are solved directly.
+   *
+   * \code
+   * anpi::MixedLU<> lu(a);                  // a: anpi::Matrix<double>
+   * anpi::Matrix<double> x = lu.solve(b);   // a*x = b, to double precision
+   * size_t steps = lu.iterations();         // refinement steps of b
+   * \endcode
+   *
+   * The solver keeps a copy of A for the residuals.
+   */
+  template<class Alloc=aligned_row_allocator<double> >
+  class MixedLU {
+  public:
+    typedef double value_type;
+    typedef Alloc allocator_type;
+
+  private:
+    /// The factorized matrix, for the residuals
+    Matrix<double,Alloc> _a;
+    /// Infinity norm of _a
+    double _norm;
+    /// Factors in single precision
+    LU<float,Alloc> _lu;
+    /// Factors in double precision, computed on the first fallback
+    LU<double,Alloc> _dlu;
+    /// A cannot be factorized in single precision
+    bool _useDouble;
+    /// Refinement steps of the last solution
+    size_t _iterations;
+    /// The last solution used the double precision factors
+    bool _fallback;
+
+    /// Solve with the double factors, computing them if necessary
+    void solveDouble(const MatrixView<double>& b);
+
+  public:
+    /// Empty factorization
+    MixedLU();
+
+    /**
+     * Factorize the square matrix a.
+     *
+     * @throws anpi::Exception if a is not square
+     */
+    explicit MixedLU(const ConstMatrixView<double>& a);
+
+    /**
+     * Factorize the square matrix a.
+     *
+     * @throws anpi::Exception if a is not square
+     */
+    template<class A>
+    explicit MixedLU(const Matrix<double,A>& a)
+      : MixedLU(ConstMatrixView<double>(a)) {}
+
+    /**
+     * Replace the factorization with the one of the square matrix a.
+     *
+     * @throws anpi::Exception if a is not square
+     */
+    void factorize(const ConstMatrixView<double>& a);
+
+    /// Number of rows (and columns) of the factorized matrix
+    inline size_t size() const { return _a.rows(); }
+
+    /// Factors in single precision
+    inline const LU<float,Alloc>& factors() const { return _lu; }
+
+    /**
+     * Solve A*X = B for all columns of B, overwriting B with X.
+     *
+     * @throws anpi::Exception if the matrix is singular
+     */
+    void solveInPlace(const MatrixView<double>& b);
+
+    /**
+     * Solution X of A*X = B, for all columns of B.
+     *
+     * @throws anpi::Exception if the matrix is singular
+     */
+    template<class A>
+    Matrix<double,A> solve(const Matrix<double,A>& b);
+
+    /**
+     * Refinement steps of the last solution.  If it fell back to the
+     * double precision factors, these are the steps tried before.
+     */
+    inline size_t iterations() const { return _iterations; }
+
+    /// Check if the last solution used the double precision factors
+    inline bool usedFallback() const { return _fallback; }
+  };
+
+  /**
+   * Solution X of A*X = B, with A factorized in single precision and X
+   * refined to double precision (see anpi::MixedLU).
+   *
+   * If iterations is not null, it receives the refinement steps.
+   *
+   * @throws anpi::Exception if a is not square or is singular
+   */
+  template<class Alloc>
+  Matrix<double,Alloc> solveMixed(const Matrix<double,Alloc>& a,
+                                  const Matrix<double,Alloc>& b,
+                                  size_t* iterations=nullptr);
+
+} // namespace anpi
+
+#include "MixedLU.tpp"
+
+#endif
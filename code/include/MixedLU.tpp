@@ -0,0 +1,235 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace anpi
+{
+  namespace detail {
+
+    /// dst = src, converting each entry to the type of dst
+    template<typename S,typename D>
+    void convertEntries(const ConstMatrixView<S>& src,
+                        const MatrixView<D>& dst) {
+      assert( (src.rows() == dst.rows()) && (src.cols() == dst.cols()) );
+      const size_t cols = src.cols();
+      parallelRows(src.rows(),cols,[&](const size_t first,const size_t last) {
+        for (size_t i=first;i<last;++i) {
+          const S* s = src[i];
+          D* d = dst[i];
+          for (size_t j=0;j<cols;++j) {
+            d[j] = static_cast<D>(s[j]);
+          }
+        }
+      });
+    }
+
+    /// x += d, with the correction d in single precision
+    inline void addCorrection(const MatrixView<double>& x,
+                              const ConstMatrixView<float>& d) {
+      assert( (x.rows() == d.rows()) && (x.cols() == d.cols()) );
+      const size_t cols = x.cols();
+      parallelRows(x.rows(),cols,[&](const size_t first,const size_t last) {
+        for (size_t i=first;i<last;++i) {
+          const float* di = d[i];
+          double* xi = x[i];
+          for (size_t j=0;j<cols;++j) {
+            xi[j] += double(di[j]);
+          }
+        }
+      });
+    }
+
+    /// r = b - a*x, in double precision
+    inline void residual(const ConstMatrixView<double>& a,
+                         const ConstMatrixView<double>& x,
+                         const ConstMatrixView<double>& b,
+                         const MatrixView<double>& r) {
+      const size_t n = a.rows();
+      r = b;
+      if (x.cols() > refinement_limits::columns) {
+        gemm(-1.,a,x,1.,r);
+        return;
+      }
+
+      Vector<double> xj(n,DoNotInitialize),rj(n,DoNotInitialize);
+      for (size_t j=0;j<x.cols();++j) {
+        for (size_t i=0;i<n;++i) {
+          xj[i] = x(i,j);
+          rj[i] = r(i,j);
+        }
+        gemv(-1.,a,xj,1.,rj);
+        for (size_t i=0;i<n;++i) {
+          r(i,j) = rj[i];
+        }
+      }
+    }
+
+    /**
+     * Largest ratio, among all columns, of max|r| to scale*max|x|.
+     * The solutions have converged if it is not above one.
+     */
+    inline double refinementError(const ConstMatrixView<double>& r,
+                                  const ConstMatrixView<double>& x,
+                                  const double scale) {
+      const size_t cols = r.cols();
+      std::vector<double> rn(cols,0.),xn(cols,0.);
+      for (size_t i=0;i<r.rows();++i) {
+        const double* ri = r[i];
+        const double* xi = x[i];
+        for (size_t j=0;j<cols;++j) {
+          rn[j] = std::max(rn[j],std::abs(ri[j]));
+          xn[j] = std::max(xn[j],std::abs(xi[j]));
+        }
+      }
+
+      double error = 0.;
+      for (size_t j=0;j<cols;++j) {
+        if (std::isnan(rn[j])) {
+          return rn[j];
+        }
+        if (rn[j] != 0.) {
+          error = std::max(error,rn[j]/(scale*xn[j]));
+        }
+      }
+      return error;
+    }
+
+  } // namespace detail
+
+  template<class Alloc>
+  MixedLU<Alloc>::MixedLU()
+    : _a(),_norm(0.),_lu(),_dlu(),_useDouble(false),
+      _iterations(0),_fallback(false) {}
+
+  template<class Alloc>
+  MixedLU<Alloc>::MixedLU(const ConstMatrixView<double>& a) : MixedLU() {
+    factorize(a);
+  }
+
+  template<class Alloc>
+  void MixedLU<Alloc>::factorize(const ConstMatrixView<double>& a) {
+    if (a.rows() != a.cols()) {
+      throw anpi::Exception("LU factorization of a non-square matrix");
+    }
+
+    const size_t n = a.rows();
+    _a.allocate(n,n);
+    _a.view() = a;
+    _norm = normInf(_a);
+    _dlu = LU<double,Alloc>();
+    _iterations = 0;
+    _fallback = false;
+
+    Matrix<float,Alloc> af(n,n,DoNotInitialize);
+    detail::convertEntries(ConstMatrixView<double>(_a),af.view());
+
+    // entries beyond the range of float cannot be factorized in float
+    _useDouble = (n > 0) &&
+                 !(std::isfinite(::anpi::max(af)) &&
+                   std::isfinite(::anpi::min(af)));
+    if (_useDouble) {
+      _lu = LU<float,Alloc>();
+      return;
+    }
+
+    _lu.factorize(af.view());
+
+    // a zero pivot in float may still be a regular matrix in double
+    _useDouble = _lu.singular();
+  }
+
+  template<class Alloc>
+  void MixedLU<Alloc>::solveDouble(const MatrixView<double>& b) {
+    if (_dlu.size() != size()) {
+      _dlu.factorize(_a.view());
+    }
+    _fallback = true;
+    _dlu.solveInPlace(b);
+  }
+
+  template<class Alloc>
+  void MixedLU<Alloc>::solveInPlace(const MatrixView<double>& b) {
+    assert( b.rows() == size() );
+    _iterations = 0;
+    _fallback = false;
+
+    const size_t n = size();
+    const size_t m = b.cols();
+    if ((n == 0) || (m == 0)) {
+      return;
+    }
+    if (_useDouble) {
+      solveDouble(b);
+      return;
+    }
+
+    // first solution, with the float factors
+    Matrix<float,Alloc> d(n,m,DoNotInitialize);
+    Matrix<double,Alloc> x(n,m,DoNotInitialize);
+    detail::convertEntries(ConstMatrixView<double>(b),d.view());
+    _lu.solveInPlace(d.view());
+    detail::convertEntries(ConstMatrixView<float>(d),x.view());
+
+    const double scale =
+      std::sqrt(double(n))*std::numeric_limits<double>::epsilon()*_norm;
+    const size_t maxIterations = refinement_limits::iterations;
+    const double stall = refinement_limits::stall;
+
+    Matrix<double,Alloc> r(n,m,DoNotInitialize);
+    double last = std::numeric_limits<double>::infinity();
+    for (;;) {
+      detail::residual(_a.view(),x.view(),b,r.view());
+
+      const double error = detail::refinementError(r.view(),x.view(),scale);
+      if (error <= 1.) {
+        b = x.view();
+        return;
+      }
+      if (!(error <= stall*last) || (_iterations == maxIterations)) {
+        // too slow, or diverging: the matrix is too ill-conditioned
+        solveDouble(b);
+        return;
+      }
+      last = error;
+
+      // x = x + (LU)^-1 * r
+      detail::convertEntries(ConstMatrixView<double>(r),d.view());
+      _lu.solveInPlace(d.view());
+      detail::addCorrection(x.view(),d.view());
+      ++_iterations;
+    }
+  }
+
+  template<class Alloc>
+  template<class A>
+  Matrix<double,A> MixedLU<Alloc>::solve(const Matrix<double,A>& b) {
+    Matrix<double,A> x(b);
+    solveInPlace(x.view());
+    return x;
+  }
+
+  template<class Alloc>
+  Matrix<double,Alloc> solveMixed(const Matrix<double,Alloc>& a,
+                                  const Matrix<double,Alloc>& b,
+                                  size_t* iterations) {
+    MixedLU<Alloc> lu(a);
+    Matrix<double,Alloc> x = lu.solve(b);
+    if (iterations != nullptr) {
+      *iterations = lu.iterations();
+    }
+    return x;
+  }
+
+} // namespace anpi
@@ -0,0 +1,257 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @author Pablo Alvarado
+ * @date   15.12.2017
+ */
+
+#ifndef ANPI_NUMA_HPP
+#define ANPI_NUMA_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Parallel.hpp"
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+namespace anpi {
+
+  /**
+   * Placement of the memory of new matrices on the NUMA nodes.
+   *
+   * On machines with several sockets, each one accesses its own memory
+   * faster than the memory of the others.  Linux places each page on
+   * the node of the thread that first writes it, which for matrices
+   * created by one thread is always the same node.
+   */
+  enum NumaPlacement {
+    /// Leave the placement to the operating system
+    NumaDefault,
+    /**
+     * Each page on the node of the thread processing it: the memory is
+     * bound to the local node, and the rows are first touched in
+     * parallel, with the same partition used by parallelRows().
+     */
+    NumaLocal,
+    /// The pages are distributed round-robin on all nodes
+    NumaInterleave
+  };
+
+  namespace detail {
+
+    /**
+     * Parse a list of nodes like "0-3,5" into a bit mask.  Returns the
+     * number of nodes in the list.
+     */
+    inline size_t parseNodeList(const std::string& list,
+                                std::vector<unsigned long>& mask) {
+      const size_t bits = 8*sizeof(unsigned long);
+      mask.clear();
+      size_t count = 0;
+
+      const char* s = list.c_str();
+      while (*s != '\0') {
+        char* end;
+        const unsigned long first = std::strtoul(s,&end,10);
+        if (end == s) {
+          break;
+        }
+        unsigned long last = first;
+        s = end;
+        if (*s == '-') {
+          last = std::strtoul(s+1,&end,10);
+          s = end;
+        }
+        for (unsigned long n=first;n<=last;++n,++count) {
+          if (mask.size() <= n/bits) {
+            mask.resize(n/bits + 1,0ul);
+          }
+          mask[n/bits] |= 1ul << (n % bits);
+        }
+        while ( (*s == ',') || (*s == '\n') || (*s == ' ') ) {
+          ++s;
+        }
+      }
+      return count;
+    }
+
+    /// Mask of the NUMA nodes of this machine
+    inline const std::vector<unsigned long>& numaNodeMask() {
+      static const std::vector<unsigned long> mask = [] {
+        std::vector<unsigned long> m;
+        std::ifstream is("/sys/devices/system/node/online");
+        std::string list;
+        if (!std::getline(is,list) || (parseNodeList(list,m) == 0)) {
+          m.assign(1,1ul); // just node 0
+        }
+        return m;
+      }();
+      return mask;
+    }
+
+    /// Default placement, given by ANPI_NUMA (local or interleave)
+    inline NumaPlacement defaultNumaPlacement() {
+      const char* env = std::getenv("ANPI_NUMA");
+      if (env != nullptr) {
+        if (std::strcmp(env,"local") == 0) {
+          return NumaLocal;
+        }
+        if (std::strcmp(env,"interleave") == 0) {
+          return NumaInterleave;
+        }
+      }
+      return NumaDefault;
+    }
+
+    /// Placement of new matrices
+    inline std::atomic<int>& numaPlacement() {
+      static std::atomic<int> value(defaultNumaPlacement());
+      return value;
+    }
+
+    /// Size of the memory pages
+    inline size_t pageSize() {
+#if defined(__unix__)
+      static const size_t page = ::sysconf(_SC_PAGESIZE);
+      return page;
+#else
+      return 4096u;
+#endif
+    }
+
+    /**
+     * Bind the whole pages in [begin,begin+bytes) with the memory
+     * policy of the given placement.  Pages already used keep their
+     * place, and the pages at both ends, which may be shared with
+     * other memory blocks, are not changed.
+     */
+    inline void bindPages(char* begin,const size_t bytes,
+                          const NumaPlacement placement) {
+#if defined(__linux__) && defined(SYS_mbind)
+      const int mpolInterleave = 3; // MPOL_INTERLEAVE of <numaif.h>
+      const int mpolLocal      = 4; // MPOL_LOCAL
+
+      const size_t page = pageSize();
+      const std::uintptr_t a = reinterpret_cast<std::uintptr_t>(begin);
+      const std::uintptr_t first = (a + page - 1)/page*page;
+      const std::uintptr_t last  = (a + bytes)/page*page;
+      if (first >= last) {
+        return;
+      }
+
+      const std::vector<unsigned long>& mask = numaNodeMask();
+      if (placement == NumaInterleave) {
+        // the kernel expects one more bit than the highest node
+        ::syscall(SYS_mbind,first,last-first,mpolInterleave,
+                  mask.data(),8*sizeof(unsigned long)*mask.size() + 1,0u);
+      } else {
+        ::syscall(SYS_mbind,first,last-first,mpolLocal,
+                  nullptr,0ul,0u);
+      }
+#else
+      (void)begin; (void)bytes; (void)placement;
+#endif
+    }
+
+  } // namespace detail
+
+  /**
+   * @name NUMA settings
+   */
+  //@{
+
+  /// Number of NUMA nodes of this machine
+  inline size_t numaNodes() {
+    static const size_t nodes = [] {
+      size_t n = 0;
+      for (unsigned long word : detail::numaNodeMask()) {
+        for (;word != 0;word &= word-1) {
+          ++n;
+        }
+      }
+      return std::max(n,size_t(1));
+    }();
+    return nodes;
+  }
+
+  /**
+   * Placement of the memory of new matrices.
+   *
+   * By default the placement is left to the operating system, unless
+   * the environment variable ANPI_NUMA is "local" or "interleave".
+   */
+  inline NumaPlacement numaPlacement() {
+    return static_cast<NumaPlacement>(
+      detail::numaPlacement().load(std::memory_order_relaxed));
+  }
+
+  /**
+   * Set the placement of the memory of new matrices.
+   *
+   * NumaLocal suits matrices processed by the element-wise kernels,
+   * where each thread always works on the same rows.  NumaInterleave
+   * suits matrices read by all threads, like the factors of a product.
+   * The setting has no effect on machines with one single node.
+   */
+  inline void setNumaPlacement(const NumaPlacement placement) {
+    detail::numaPlacement().store(placement,std::memory_order_relaxed);
+  }
+  //@}
+
+  namespace detail {
+
+    /**
+     * Place the memory of a new matrix with rows x dcols entries, as
+     * selected with setNumaPlacement().  On machines with one single
+     * node this does nothing.
+     */
+    template<typename T>
+    void placeRows(T* data,const size_t rows,const size_t dcols) {
+      const NumaPlacement placement =
+        static_cast<NumaPlacement>(numaPlacement().load(
+                                     std::memory_order_relaxed));
+      if ( (placement == NumaDefault) || (data == nullptr) ||
+           (numaNodes() < 2) ) {
+        return;
+      }
+
+      char* begin = reinterpret_cast<char*>(data);
+      const size_t rowBytes = dcols*sizeof(T);
+      bindPages(begin,rows*rowBytes,placement);
+
+      if (placement == NumaLocal) {
+        // write one byte of each page in the thread that will use it
+        const size_t page = pageSize();
+        parallelRows(rows,dcols,[&](const size_t first,const size_t last) {
+          char* const end = begin + last*rowBytes;
+          for (char* p = begin + first*rowBytes;p < end;) {
+            *static_cast<volatile char*>(p) = 0;
+            const std::uintptr_t a = reinterpret_cast<std::uintptr_t>(p);
+            p += page - (a % page);
+          }
+        });
+      }
+    }
+
+  } // namespace detail
+
+} // namespace anpi
+
+#endif
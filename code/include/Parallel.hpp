@@ -0,0 +1,192 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @author Pablo Alvarado
+ * @date   15.12.2017
+ */
+
+#ifndef ANPI_PARALLEL_HPP
+#define ANPI_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace anpi {
+
+  namespace detail {
+    /// Number of processors available to this process
+    inline size_t processors() {
+#ifdef _OPENMP
+      return static_cast<size_t>(std::max(1,omp_get_num_procs()));
+#else
+      return 1u;
+#endif
+    }
+
+    /// Default number of threads, given by ANPI_THREADS or the processors
+    inline size_t defaultThreads() {
+      const char* env = std::getenv("ANPI_THREADS");
+      const long n = (env != nullptr) ? std::atol(env) : 0l;
+      return (n > 0) ? static_cast<size_t>(n) : processors();
+    }
+
+    /// Maximum number of threads used by the library
+    inline std::atomic<size_t>& maxThreads() {
+      static std::atomic<size_t> value(defaultThreads());
+      return value;
+    }
+
+    /// Minimum number of entries processed by each thread
+    inline std::atomic<size_t>& minEntriesPerThread() {
+      static std::atomic<size_t> value(32768u);
+      return value;
+    }
+  } // namespace detail
+
+  /**
+   * @name Parallelization settings
+   *
+   * These settings are independent of the OpenMP environment
+   * variables, and apply to all parallel algorithms of the library.
+   */
+  //@{
+
+  /**
+   * Maximum number of threads used by the library.
+   *
+   * By default all processors are used, unless the environment
+   * variable ANPI_THREADS indicates otherwise.
+   */
+  inline size_t threads() {
+    return detail::maxThreads().load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Set the maximum number of threads used by the library.
+   *
+   * A value of zero restores the default.
+   */
+  inline void setThreads(const size_t n) {
+    detail::maxThreads().store((n > 0) ? n : detail::defaultThreads(),
+                               std::memory_order_relaxed);
+  }
+
+  /**
+   * Minimum number of matrix entries each thread has to process.
+   *
+   * Tasks smaller than this threshold run in the calling thread, as
+   * starting other threads would cost more than the task itself.
+   */
+  inline size_t parallelThreshold() {
+    return detail::minEntriesPerThread().load(std::memory_order_relaxed);
+  }
+
+  /// Set the minimum number of entries each thread has to process
+  inline void setParallelThreshold(const size_t entries) {
+    detail::minEntriesPerThread().store(std::max(entries,size_t(1)),
+                                        std::memory_order_relaxed);
+  }
+  //@}
+
+  /**
+   * Number of threads used to process a matrix with the given number
+   * of rows and entries per row.
+   *
+   * Without OpenMP everything runs in the calling thread, no matter
+   * what threads() says.
+   */
+  inline size_t parallelThreads(const size_t rows,const size_t cols) {
+#ifdef _OPENMP
+    if (omp_in_parallel()) {
+      // avoid nested parallelism: the caller is already a worker
+      return 1u;
+    }
+    const size_t byWork = (rows*cols)/parallelThreshold();
+    return std::max(std::min(std::min(threads(),rows),byWork),size_t(1));
+#else
+    return 1u;
+#endif
+  }
+
+  /**
+   * Process the rows of a matrix in parallel.
+   *
+   * The rows [0,rows) are split into contiguous blocks of similar
+   * size, one for each thread, and the functor f(first,last) is called
+   * for each block [first,last).  For the same arguments and settings,
+   * the blocks are always the same, so that each thread touches
+   * always the same memory.
+   *
+   * Small matrices, with less than parallelThreshold() entries per
+   * thread, are processed in the calling thread.
+   */
+  template<class F>
+  inline void parallelRows(const size_t rows,const size_t cols,F f) {
+    const size_t nthreads = parallelThreads(rows,cols);
+
+    if (nthreads < 2u) {
+      f(size_t(0),rows);
+      return;
+    }
+
+#ifdef _OPENMP
+#   pragma omp parallel num_threads(static_cast<int>(nthreads))
+    {
+      const size_t t = static_cast<size_t>(omp_get_thread_num());
+      const size_t n = static_cast<size_t>(omp_get_num_threads());
+      f((rows*t)/n,(rows*(t+1))/n);
+    }
+#else
+    f(size_t(0),rows);
+#endif
+  }
+
+  /**
+   * Run the independent tasks f(0), ..., f(n-1) in parallel.
+   *
+   * Each task runs in one thread, and the threads take the next
+   * pending task as soon as they finish one, so that tasks of
+   * different lengths keep all threads busy.  The parallel algorithms
+   * called by the tasks run in the thread of their task.
+   */
+  template<class F>
+  inline void parallelTasks(const size_t n,F f) {
+    size_t nthreads = std::min(threads(),n);
+#ifdef _OPENMP
+    if (omp_in_parallel()) {
+      nthreads = 1u;
+    }
+#else
+    // without OpenMP the tasks run one after the other
+    nthreads = 1u;
+#endif
+
+    if (nthreads < 2u) {
+      for (size_t i=0;i<n;++i) {
+        f(i);
+      }
+      return;
+    }
+
+#ifdef _OPENMP
+    const std::ptrdiff_t tasks = static_cast<std::ptrdiff_t>(n);
+#   pragma omp parallel for schedule(dynamic,1) \
+                            num_threads(static_cast<int>(nthreads))
+    for (std::ptrdiff_t i=0;i<tasks;++i) {
+      f(static_cast<size_t>(i));
+    }
+#endif
+  }
+
+} // namespace anpi
+
+#endif
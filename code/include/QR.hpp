@@ -0,0 +1,159 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_QR_HPP
+#define ANPI_QR_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "Exception.hpp"
+#include "Matrix.hpp"
+#include "LU.hpp"
+
+namespace anpi
+{
+  /**
+   * Blocking of the QR factorization.
+   *
+   * The reflectors of each panel of nb columns are accumulated into
+   * one block reflector, which is applied to the trailing matrix with
+   * matrix products of nb inner dimension.
+   */
+  struct qr_blocking {
+    /// Columns of each panel
+    static constexpr size_t nb = 32;
+  };
+
+  /**
+   * Householder QR factorization of a m x n matrix A:
+   *
+   *   A = Q*R
+   *
+   * with Q = H(0)*H(1)*...*H(k-1) orthogonal, k = min(m,n), and R
+   * upper triangular.  Each reflector H(j) = I - tau(j)*v(j)*v(j)^T is
+   * stored compactly below the diagonal of R, with v(j) zero above
+   * row j and one at row j.  Q is therefore never formed, but applied
+   * directly:
+   *
+   * \code
+   * anpi::QR<double> qr(a);             // a is tall: m >= n
+   * anpi::Matrix<double> x = qr.solve(b); // minimizes |a*x - b|
+   * qr.applyQTransposed(c.view());      // c = Q^T * c
+   * \endcode
+   *
+   * The factorization is blocked: the nb reflectors of each panel are
+   * merged in the compact WY form
+   *
+   *   H(k)*...*H(k+nb-1) = I - V*T*V^T
+   *
+   * with V the m x nb matrix of the reflectors and T a nb x nb upper
+   * triangular matrix.  The trailing matrix is then updated with three
+   * matrix products instead of nb rank-one updates, and the same
+   * blocks are used to apply Q later.
+   */
+  template<typename T,class Alloc=aligned_row_allocator<T> >
+  class QR {
+    static_assert( std::is_floating_point<T>::value,
+                   "QR factorization requires a real floating point type" );
+
+  public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+
+  private:
+    /// R on and above the diagonal, reflectors below
+    Matrix<T,Alloc> _qr;
+    /// Scale factor tau of each reflector
+    std::vector<T> _tau;
+    /// Factors T of the blocks: the one of the panel starting at
+    /// column k is the upper triangle of the block at column k
+    Matrix<T,Alloc> _t;
+
+    /**
+     * Apply the block reflector of the panel at column k, or its
+     * transpose, to the rows [k,m) of b.
+     */
+    void applyBlock(const size_t k,
+                    const bool transposed,
+                    const MatrixView<T>& b) const;
+
+  public:
+    /// Empty factorization
+    QR();
+
+    /// Factorize the matrix a
+    explicit QR(const ConstMatrixView<T>& a);
+
+    /// Factorize the matrix a
+    template<class A>
+    explicit QR(const Matrix<T,A>& a) : QR(ConstMatrixView<T>(a)) {}
+
+    /// Replace the factorization with the one of the matrix a
+    void factorize(const ConstMatrixView<T>& a);
+
+    /// Number of rows of the factorized matrix
+    inline size_t rows() const { return _qr.rows(); }
+
+    /// Number of columns of the factorized matrix
+    inline size_t cols() const { return _qr.cols(); }
+
+    /**
+     * R on and above the diagonal and the reflectors below it, with
+     * their unit entry implicit.
+     */
+    inline const Matrix<T,Alloc>& packed() const { return _qr; }
+
+    /// Scale factor tau of each reflector
+    inline const std::vector<T>& tau() const { return _tau; }
+
+    /// Upper triangular factor R, with min(m,n) rows and n columns
+    Matrix<T,Alloc> upper() const;
+
+    /**
+     * First min(m,n) columns of Q, which is computed by applying the
+     * reflectors to the identity.  Prefer applyQ() where possible.
+     */
+    Matrix<T,Alloc> thinQ() const;
+
+    /// Replace b, with m rows, by Q*b
+    void applyQ(const MatrixView<T>& b) const;
+
+    /// Replace b, with m rows, by Q^T*b
+    void applyQTransposed(const MatrixView<T>& b) const;
+
+    /**
+     * Least squares solution X, with n rows, minimizing the norm of
+     * A*X - B for each column of B, with m rows.
+     *
+     * @throws anpi::Exception if A has less rows than columns, or if
+     *         its columns are (numerically) linearly dependent
+     */
+    template<class A>
+    Matrix<T,A> solve(const Matrix<T,A>& b) const;
+  };
+
+  /**
+   * Least squares solution X minimizing the norm of A*X - B, computed
+   * with the QR factorization of A.
+   *
+   * @throws anpi::Exception if A has less rows than columns, or if its
+   *         columns are (numerically) linearly dependent
+   */
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> leastSquares(const Matrix<T,Alloc>& a,
+                               const Matrix<T,Alloc>& b);
+
+} // namespace anpi
+
+#include "QR.tpp"
+
+#endif
@@ -0,0 +1,345 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace anpi
+{
+  namespace detail {
+
+    /**
+     * Unblocked Householder QR of the view a, in place, with the scale
+     * factors of the min(m,n) reflectors stored in tau.
+     *
+     * Each reflector is applied to the columns on its right as soon as
+     * it is computed, with a matrix-vector product and a rank-one
+     * update, so that the whole matrix is traversed once per column.
+     */
+    template<typename T>
+    void householderQR(const MatrixView<T>& a,T* tau) {
+      const size_t m = a.rows();
+      const size_t n = a.cols();
+      const size_t k = std::min(m,n);
+      std::vector<T> w(n);
+
+      for (size_t j=0;j<k;++j) {
+        T sigma(0);
+        for (size_t i=j+1;i<m;++i) {
+          sigma += a(i,j)*a(i,j);
+        }
+
+        const T alpha = a(j,j);
+        if (sigma == T(0)) {
+          // nothing to eliminate: H(j) is the identity
+          tau[j] = T(0);
+          continue;
+        }
+
+        // the sign of beta avoids the cancellation in alpha - beta
+        const T norm = std::sqrt(alpha*alpha + sigma);
+        const T beta = (alpha > T(0)) ? -norm : norm;
+        tau[j] = (beta - alpha)/beta;
+        const T scale = T(1)/(alpha - beta);
+        for (size_t i=j+1;i<m;++i) {
+          a(i,j) *= scale;
+        }
+        a(j,j) = beta;
+
+        // w = tau * v^T * A, for the columns on the right of j
+        const T* aj = a[j];
+        for (size_t c=j+1;c<n;++c) {
+          w[c] = aj[c];
+        }
+        for (size_t i=j+1;i<m;++i) {
+          const T* ai = a[i];
+          const T vi = ai[j];
+          for (size_t c=j+1;c<n;++c) {
+            w[c] += vi*ai[c];
+          }
+        }
+        for (size_t c=j+1;c<n;++c) {
+          w[c] *= tau[j];
+        }
+
+        // A = A - v * w^T
+        T* ajw = a[j];
+        for (size_t c=j+1;c<n;++c) {
+          ajw[c] -= w[c];
+        }
+        for (size_t i=j+1;i<m;++i) {
+          T* ai = a[i];
+          const T vi = ai[j];
+          for (size_t c=j+1;c<n;++c) {
+            ai[c] -= vi*w[c];
+          }
+        }
+      }
+    }
+
+  } // namespace detail
+
+  template<typename T,class Alloc>
+  QR<T,Alloc>::QR() : _qr(),_tau(),_t() {}
+
+  template<typename T,class Alloc>
+  QR<T,Alloc>::QR(const ConstMatrixView<T>& a) : QR() {
+    factorize(a);
+  }
+
+  template<typename T,class Alloc>
+  void QR<T,Alloc>::factorize(const ConstMatrixView<T>& a) {
+    const size_t m = a.rows();
+    const size_t n = a.cols();
+    const size_t kmin = std::min(m,n);
+    const size_t nb = qr_blocking::nb;
+
+    _qr.allocate(m,n);
+    _qr.view() = a;
+    _tau.assign(kmin,T(0));
+    _t.allocate(std::min(nb,kmin),kmin);
+
+    for (size_t k=0;k<kmin;k+=nb) {
+      const size_t kb = std::min(nb,kmin-k);
+      const size_t m2 = m-k-kb;
+
+      // Factorize the panel of columns [k,k+kb) without blocking
+      detail::householderQR(_qr.block(k,k,m-k,kb),&_tau[k]);
+
+      // G = V^T * V, with V = [V1;V2] and V1 unit lower triangular
+      Matrix<T> g(kb,kb,T(0));
+      if (m2 > 0) {
+        const ConstMatrixView<T> v2 = _qr.block(k+kb,k,m2,kb);
+        gemm(T(1),transposed(v2),v2,T(0),g);
+      }
+      for (size_t c=0;c<kb;++c) {
+        const T* vc = _qr[k+c] + k;
+        for (size_t i=0;i<c;++i) {
+          g(i,c) += vc[i];
+        }
+        for (size_t r=c+1;r<kb;++r) {
+          const T* vr = _qr[k+r] + k;
+          for (size_t i=0;i<c;++i) {
+            g(i,c) += vr[i]*vr[c];
+          }
+        }
+      }
+
+      // T(0:c,c) = -tau(c) * T(0:c,0:c) * G(0:c,c)
+      const MatrixView<T> t = _t.block(0,k,kb,kb);
+      for (size_t c=0;c<kb;++c) {
+        const T tau = _tau[k+c];
+        for (size_t i=0;i<c;++i) {
+          T s(0);
+          for (size_t l=i;l<c;++l) {
+            s += t(i,l)*g(l,c);
+          }
+          t(i,c) = -tau*s;
+        }
+        t(c,c) = tau;
+      }
+
+      // Apply the block reflector to the trailing matrix
+      if (k+kb < n) {
+        applyBlock(k,true,_qr.block(0,k+kb,m,n-k-kb));
+      }
+    }
+  }
+
+  template<typename T,class Alloc>
+  void QR<T,Alloc>::applyBlock(const size_t k,
+                               const bool transposed,
+                               const MatrixView<T>& b) const {
+    const size_t m = rows();
+    const size_t nb = qr_blocking::nb;
+    const size_t kb = std::min(nb,std::min(m,cols())-k);
+    const size_t m2 = m-k-kb;
+    const size_t nc = b.cols();
+    if (nc == 0) {
+      return;
+    }
+
+    const ConstMatrixView<T> v1 = _qr.block(k,k,kb,kb);
+    const ConstMatrixView<T> v2 = _qr.block(k+kb,k,m2,kb);
+    const ConstMatrixView<T> t = _t.block(0,k,kb,kb);
+    const MatrixView<T> b1 = b.block(k,0,kb,nc);
+    const MatrixView<T> b2 = b.block(k+kb,0,m2,nc);
+
+    // W = V^T * B = V1^T * B1 + V2^T * B2
+    Matrix<T> w(kb,nc,DoNotInitialize);
+    for (size_t i=0;i<kb;++i) {
+      T* wi = w[i];
+      std::copy(b1[i],b1[i]+nc,wi);
+      for (size_t r=i+1;r<kb;++r) {
+        const T vri = v1(r,i);
+        const T* br = b1[r];
+        for (size_t c=0;c<nc;++c) {
+          wi[c] += vri*br[c];
+        }
+      }
+    }
+    if (m2 > 0) {
+      parallelRows(nc,m2*kb,[&](const size_t first,const size_t last) {
+        if (first < last) {
+          gemm(T(1),::anpi::transposed(v2),b2.block(0,first,m2,last-first),
+               T(1),w.block(0,first,kb,last-first));
+        }
+      });
+    }
+
+    // W = T^T * W for Q^T, or T * W for Q
+    if (transposed) {
+      for (size_t i=kb;i-- > 0;) {
+        T* wi = w[i];
+        const T tii = t(i,i);
+        for (size_t c=0;c<nc;++c) {
+          wi[c] *= tii;
+        }
+        for (size_t l=0;l<i;++l) {
+          const T tli = t(l,i);
+          const T* wl = w[l];
+          for (size_t c=0;c<nc;++c) {
+            wi[c] += tli*wl[c];
+          }
+        }
+      }
+    } else {
+      for (size_t i=0;i<kb;++i) {
+        T* wi = w[i];
+        const T tii = t(i,i);
+        for (size_t c=0;c<nc;++c) {
+          wi[c] *= tii;
+        }
+        for (size_t l=i+1;l<kb;++l) {
+          const T til = t(i,l);
+          const T* wl = w[l];
+          for (size_t c=0;c<nc;++c) {
+            wi[c] += til*wl[c];
+          }
+        }
+      }
+    }
+
+    // B = B - V * W
+    if (m2 > 0) {
+      parallelRows(m2,nc*kb,[&](const size_t first,const size_t last) {
+        if (first < last) {
+          gemm(T(-1),v2.block(first,0,last-first,kb),w,
+               T(1),b2.block(first,0,last-first,nc));
+        }
+      });
+    }
+    for (size_t i=0;i<kb;++i) {
+      T* bi = b1[i];
+      const T* wi = w[i];
+      for (size_t c=0;c<nc;++c) {
+        bi[c] -= wi[c];
+      }
+      for (size_t l=0;l<i;++l) {
+        const T vil = v1(i,l);
+        const T* wl = w[l];
+        for (size_t c=0;c<nc;++c) {
+          bi[c] -= vil*wl[c];
+        }
+      }
+    }
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> QR<T,Alloc>::upper() const {
+    const size_t kmin = std::min(rows(),cols());
+    Matrix<T,Alloc> r(kmin,cols(),T(0));
+    for (size_t i=0;i<kmin;++i) {
+      std::copy(_qr[i]+i,_qr[i]+cols(),r[i]+i);
+    }
+    return r;
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> QR<T,Alloc>::thinQ() const {
+    const size_t kmin = std::min(rows(),cols());
+    Matrix<T,Alloc> q(rows(),kmin,T(0));
+    for (size_t i=0;i<kmin;++i) {
+      q(i,i) = T(1);
+    }
+    applyQ(q.view());
+    return q;
+  }
+
+  template<typename T,class Alloc>
+  void QR<T,Alloc>::applyQ(const MatrixView<T>& b) const {
+    assert( b.rows() == rows() );
+    const size_t kmin = std::min(rows(),cols());
+    const size_t nb = qr_blocking::nb;
+    if (kmin == 0) {
+      return;
+    }
+
+    // Q = (I - V0*T0*V0^T) * (I - V1*T1*V1^T) * ...
+    for (size_t k=((kmin-1)/nb)*nb+nb;k > 0;) {
+      k -= nb;
+      applyBlock(k,false,b);
+    }
+  }
+
+  template<typename T,class Alloc>
+  void QR<T,Alloc>::applyQTransposed(const MatrixView<T>& b) const {
+    assert( b.rows() == rows() );
+    const size_t kmin = std::min(rows(),cols());
+    const size_t nb = qr_blocking::nb;
+
+    for (size_t k=0;k<kmin;k+=nb) {
+      applyBlock(k,true,b);
+    }
+  }
+
+  template<typename T,class Alloc>
+  template<class A>
+  Matrix<T,A> QR<T,Alloc>::solve(const Matrix<T,A>& b) const {
+    assert( b.rows() == rows() );
+    const size_t n = cols();
+    if (rows() < n) {
+      throw anpi::Exception("Least squares with less rows than columns");
+    }
+
+    // the diagonal of R vanishes, up to rounding, for dependent columns
+    T largest(0);
+    for (size_t i=0;i<n;++i) {
+      largest = std::max(largest,std::abs(_qr(i,i)));
+    }
+    const T tol = largest*T(rows())*std::numeric_limits<T>::epsilon();
+    for (size_t i=0;i<n;++i) {
+      if (std::abs(_qr(i,i)) <= tol) {
+        throw anpi::Exception("Least squares with dependent columns");
+      }
+    }
+
+    // X = R^-1 * (first n rows of Q^T * B)
+    Matrix<T,A> y(b);
+    applyQTransposed(y.view());
+    Matrix<T,A> x(n,b.cols(),DoNotInitialize);
+    x.view() = y.block(0,0,n,b.cols());
+
+    const ConstMatrixView<T> r = _qr.block(0,0,n,n);
+    detail::parallelColumns(x.view(),n*n,[&](const MatrixView<T>& xc) {
+      detail::solveUpper(r,xc);
+    });
+    return x;
+  }
+
+  template<typename T,class Alloc>
+  Matrix<T,Alloc> leastSquares(const Matrix<T,Alloc>& a,
+                               const Matrix<T,Alloc>& b) {
+    return QR<T,Alloc>(a).solve(b);
+  }
+
+} // namespace anpi
@@ -0,0 +1,188 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_SPARSE_MATRIX_HPP
+#define ANPI_SPARSE_MATRIX_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Allocator.hpp"
+#include "Matrix.hpp"
+
+namespace anpi
+{
+  /// Entry of a sparse matrix with its position
+  template<typename T>
+  struct sparse_entry {
+    /// Row of the entry
+    size_t row;
+    /// Column of the entry
+    size_t col;
+    /// Value of the entry
+    T value;
+  };
+
+  /**
+   * Sparse matrix in compressed sparse row (CSR) format.
+   *
+   * Only the non-zero entries are stored, row after row, together with
+   * their columns.  A third array holds where each row begins, so that
+   * rows x cols matrices with nnz non-zero entries need
+   * nnz*(sizeof(T) + sizeof(size_t)) + (rows+1)*sizeof(size_t) bytes.
+   * Within each row the entries are sorted by column.
+   *
+   * The arrays are allocated with Alloc (rebound to size_t for the
+   * indices).
+   *
+   * \code
+   * std::vector< anpi::sparse_entry<double> > e = { {0,0,4.},{0,1,-1.},
+   *                                                 {1,0,-1.},{1,1,4.} };
+   * anpi::SparseMatrix<double> a(2,2,e);
+   * anpi::Matrix<double> y = a*x;  // x is a 2x1 matrix
+   * \endcode
+   */
+  template<typename T,class Alloc=aligned_allocator<T> >
+  class SparseMatrix {
+  public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+    typedef typename Alloc::template rebind<size_t>::other index_allocator;
+
+    /// Array of values
+    typedef std::vector<T,Alloc> value_vector;
+    /// Array of indices
+    typedef std::vector<size_t,index_allocator> index_vector;
+
+  private:
+    /// Number of rows
+    size_t _rows;
+    /// Number of columns
+    size_t _cols;
+    /// Non-zero entries, row after row
+    value_vector _values;
+    /// Column of each entry of _values
+    index_vector _columns;
+    /// Index of the first entry of each row, and nonZeros() at the end
+    index_vector _rowStarts;
+
+  public:
+    /// Empty matrix
+    SparseMatrix();
+
+    /// Matrix of rows x cols zeros
+    SparseMatrix(const size_t rows,const size_t cols);
+
+    /**
+     * Matrix of rows x cols with the given entries, in any order.  The
+     * values of repeated positions are added.
+     */
+    SparseMatrix(const size_t rows,
+                 const size_t cols,
+                 std::vector< sparse_entry<T> > entries);
+
+    /// Sparse copy of the non-zero entries of a dense view
+    explicit SparseMatrix(const ConstMatrixView<T>& dense);
+
+    /// Sparse copy of the non-zero entries of a dense matrix
+    template<class A>
+    explicit SparseMatrix(const Matrix<T,A>& dense)
+      : SparseMatrix(ConstMatrixView<T>(dense)) {}
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /// Number of stored entries
+    inline size_t nonZeros() const { return _values.size(); }
+
+    /// Check if the matrix has zero rows or columns
+    inline bool empty() const { return (_rows==0) || (_cols==0); }
+
+    /// Fraction of the entries stored
+    inline double density() const {
+      return empty() ? 0. : double(nonZeros())/(double(_rows)*_cols);
+    }
+
+    /// Stored entries, row after row
+    inline const T* values() const { return _values.data(); }
+
+    /// Stored entries, row after row, which may be modified in place
+    inline T* values() { return _values.data(); }
+
+    /// Column of each stored entry
+    inline const size_t* columns() const { return _columns.data(); }
+
+    /**
+     * Index in values() of the first entry of each row.  The entries
+     * of row r are those in [rowStarts()[r],rowStarts()[r+1]).
+     */
+    inline const size_t* rowStarts() const { return _rowStarts.data(); }
+
+    /// Entry at the given row and column, which may be a zero
+    T operator()(const size_t row,const size_t col) const;
+
+    /// Dense copy of this matrix
+    template<class A=aligned_row_allocator<T> >
+    Matrix<T,A> toMatrix() const;
+
+    /// Exchange the content with the other matrix
+    void swap(SparseMatrix<T,Alloc>& other);
+  };
+
+  /**
+   * @name Sparse arithmetic
+   */
+  //@{
+
+  /**
+   * Sparse matrix times dense matrix: y = alpha*a*x + beta*y.
+   *
+   * x must have a.cols() rows, and y a.rows() rows and the columns of
+   * x.  The usual sparse matrix-vector product is the case of one
+   * column.  If beta is zero, the previous content of y is ignored.
+   *
+   * The rows are distributed among the threads in blocks with about
+   * the same number of non-zero entries.
+   */
+  template<typename T,class Alloc>
+  void spmv(const T alpha,
+            const SparseMatrix<T,Alloc>& a,
+            const ConstMatrixView<T>& x,
+            const T beta,
+            const MatrixView<T>& y);
+
+  /// Product of a sparse and a dense matrix
+  template<typename T,class SAlloc,class Alloc>
+  Matrix<T,Alloc> operator*(const SparseMatrix<T,SAlloc>& a,
+                            const Matrix<T,Alloc>& x);
+
+  /// Add the sparse matrix a to the dense view b, of the same size
+  template<typename T,class Alloc>
+  void add(const MatrixView<T>& b,const SparseMatrix<T,Alloc>& a);
+
+  /// Sum of a sparse and a dense matrix
+  template<typename T,class SAlloc,class Alloc>
+  Matrix<T,Alloc> operator+(const SparseMatrix<T,SAlloc>& a,
+                            const Matrix<T,Alloc>& b);
+
+  /// Sum of a dense and a sparse matrix
+  template<typename T,class SAlloc,class Alloc>
+  Matrix<T,Alloc> operator+(const Matrix<T,Alloc>& a,
+                            const SparseMatrix<T,SAlloc>& b);
+  //@}
+
+} // namespace anpi
+
+#include "SparseMatrix.tpp"
+
+#endif
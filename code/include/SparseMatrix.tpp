@@ -0,0 +1,255 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace anpi
+{
+  template<typename T,class Alloc>
+  SparseMatrix<T,Alloc>::SparseMatrix()
+    : _rows(0),_cols(0),_values(),_columns(),_rowStarts(1,0) {}
+
+  template<typename T,class Alloc>
+  SparseMatrix<T,Alloc>::SparseMatrix(const size_t rows,const size_t cols)
+    : _rows(rows),_cols(cols),_values(),_columns(),_rowStarts(rows+1,0) {}
+
+  template<typename T,class Alloc>
+  SparseMatrix<T,Alloc>::SparseMatrix(const size_t rows,
+                                      const size_t cols,
+                                      std::vector< sparse_entry<T> > entries)
+    : SparseMatrix(rows,cols) {
+
+    std::sort(entries.begin(),entries.end(),
+              [](const sparse_entry<T>& a,const sparse_entry<T>& b) {
+                return (a.row < b.row) ||
+                       ((a.row == b.row) && (a.col < b.col));
+              });
+
+    _values.reserve(entries.size());
+    _columns.reserve(entries.size());
+    for (size_t i=0;i<entries.size();++i) {
+      const sparse_entry<T>& e = entries[i];
+      assert( (e.row < rows) && (e.col < cols) );
+      if ( (i > 0) && (e.row == entries[i-1].row) &&
+           (e.col == entries[i-1].col) ) {
+        _values.back() += e.value;
+      } else {
+        _values.push_back(e.value);
+        _columns.push_back(e.col);
+        ++_rowStarts[e.row+1];
+      }
+    }
+
+    // counts per row to starts of each row
+    std::partial_sum(_rowStarts.begin(),_rowStarts.end(),_rowStarts.begin());
+  }
+
+  template<typename T,class Alloc>
+  SparseMatrix<T,Alloc>::SparseMatrix(const ConstMatrixView<T>& dense)
+    : SparseMatrix(dense.rows(),dense.cols()) {
+
+    // count first, to allocate the arrays just once
+    size_t nnz = 0;
+    for (size_t r=0;r<_rows;++r) {
+      const T* row = dense[r];
+      nnz += _cols - std::count(row,row+_cols,T(0));
+    }
+    _values.reserve(nnz);
+    _columns.reserve(nnz);
+
+    for (size_t r=0;r<_rows;++r) {
+      const T* row = dense[r];
+      for (size_t c=0;c<_cols;++c) {
+        if (row[c] != T(0)) {
+          _values.push_back(row[c]);
+          _columns.push_back(c);
+        }
+      }
+      _rowStarts[r+1] = _values.size();
+    }
+  }
+
+  template<typename T,class Alloc>
+  T SparseMatrix<T,Alloc>::operator()(const size_t row,
+                                      const size_t col) const {
+    assert( (row < _rows) && (col < _cols) );
+    const size_t* first = _columns.data() + _rowStarts[row];
+    const size_t* last  = _columns.data() + _rowStarts[row+1];
+    const size_t* p = std::lower_bound(first,last,col);
+    return ((p != last) && (*p == col)) ? _values[p - _columns.data()]
+                                        : T(0);
+  }
+
+  template<typename T,class Alloc>
+  template<class A>
+  Matrix<T,A> SparseMatrix<T,Alloc>::toMatrix() const {
+    Matrix<T,A> m(_rows,_cols,T(0));
+    add(m.view(),*this);
+    return m;
+  }
+
+  template<typename T,class Alloc>
+  void SparseMatrix<T,Alloc>::swap(SparseMatrix<T,Alloc>& other) {
+    std::swap(_rows,other._rows);
+    std::swap(_cols,other._cols);
+    _values.swap(other._values);
+    _columns.swap(other._columns);
+    _rowStarts.swap(other._rowStarts);
+  }
+
+  namespace detail {
+
+    /**
+     * Call f(first,last) for blocks of rows of a, distributed among the
+     * threads, with about the same number of stored entries in each
+     * block.  Each stored entry represents work units of the given size.
+     */
+    template<typename T,class Alloc,class F>
+    void parallelSparseRows(const SparseMatrix<T,Alloc>& a,
+                            const size_t work,
+                            F f) {
+      const size_t rows = a.rows();
+      const size_t nnz = a.nonZeros();
+      const size_t* starts = a.rowStarts();
+      if (rows == 0) {
+        return;
+      }
+
+      // the rows themselves count as work too
+      const size_t total = (nnz + rows)*std::max(work,size_t(1));
+      const size_t chunks = parallelThreads(rows,total/rows);
+
+      // first row of the block c
+      auto boundary = [&](const size_t c) -> size_t {
+        if (c == 0) {
+          return 0;
+        }
+        if (c >= chunks) {
+          return rows;
+        }
+        return std::lower_bound(starts,starts+rows,(nnz*c)/chunks) - starts;
+      };
+
+      parallelRows(chunks,total/chunks,[&](const size_t fc,const size_t lc) {
+        for (size_t c=fc;c<lc;++c) {
+          const size_t first = boundary(c);
+          const size_t last = boundary(c+1);
+          if (first < last) {
+            f(first,last);
+          }
+        }
+      });
+    }
+
+  } // namespace detail
+
+  template<typename T,class Alloc>
+  void spmv(const T alpha,
+            const SparseMatrix<T,Alloc>& a,
+            const ConstMatrixView<T>& x,
+            const T beta,
+            const MatrixView<T>& y) {
+    assert( (x.rows() == a.cols()) &&
+            (y.rows() == a.rows()) && (y.cols() == x.cols()) );
+
+    const size_t k = x.cols();
+    const T* values = a.values();
+    const size_t* columns = a.columns();
+    const size_t* starts = a.rowStarts();
+
+    detail::parallelSparseRows(a,k,[&](const size_t first,
+                                       const size_t last) {
+      if (k == 1) {
+        // one dot product per row, with four independent sums
+        const T* xs = x.data();
+        const size_t dx = x.dcols();
+        for (size_t r=first;r<last;++r) {
+          T s0(0),s1(0),s2(0),s3(0);
+          size_t e = starts[r];
+          const size_t end = starts[r+1];
+          for (;e+4<=end;e+=4) {
+            s0 += values[e  ]*xs[columns[e  ]*dx];
+            s1 += values[e+1]*xs[columns[e+1]*dx];
+            s2 += values[e+2]*xs[columns[e+2]*dx];
+            s3 += values[e+3]*xs[columns[e+3]*dx];
+          }
+          for (;e<end;++e) {
+            s0 += values[e]*xs[columns[e]*dx];
+          }
+          const T s = alpha*((s0 + s1) + (s2 + s3));
+          y(r,0) = (beta == T(0)) ? s : beta*y(r,0) + s;
+        }
+      } else {
+        // each entry adds a scaled row of x to a row of y
+        for (size_t r=first;r<last;++r) {
+          T* yr = y[r];
+          if (beta == T(0)) {
+            std::fill(yr,yr+k,T(0));
+          } else if (beta != T(1)) {
+            for (size_t j=0;j<k;++j) {
+              yr[j] *= beta;
+            }
+          }
+          for (size_t e=starts[r];e<starts[r+1];++e) {
+            const T av = alpha*values[e];
+            const T* xr = x[columns[e]];
+            for (size_t j=0;j<k;++j) {
+              yr[j] += av*xr[j];
+            }
+          }
+        }
+      }
+    });
+  }
+
+  template<typename T,class SAlloc,class Alloc>
+  Matrix<T,Alloc> operator*(const SparseMatrix<T,SAlloc>& a,
+                            const Matrix<T,Alloc>& x) {
+    Matrix<T,Alloc> y(a.rows(),x.cols(),DoNotInitialize);
+    spmv(T(1),a,x.view(),T(0),y.view());
+    return y;
+  }
+
+  template<typename T,class Alloc>
+  void add(const MatrixView<T>& b,const SparseMatrix<T,Alloc>& a) {
+    assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) );
+
+    const T* values = a.values();
+    const size_t* columns = a.columns();
+    const size_t* starts = a.rowStarts();
+
+    detail::parallelSparseRows(a,1,[&](const size_t first,
+                                       const size_t last) {
+      for (size_t r=first;r<last;++r) {
+        T* br = b[r];
+        for (size_t e=starts[r];e<starts[r+1];++e) {
+          br[columns[e]] += values[e];
+        }
+      }
+    });
+  }
+
+  template<typename T,class SAlloc,class Alloc>
+  Matrix<T,Alloc> operator+(const SparseMatrix<T,SAlloc>& a,
+                            const Matrix<T,Alloc>& b) {
+    Matrix<T,Alloc> c(b);
+    add(c.view(),a);
+    return c;
+  }
+
+  template<typename T,class SAlloc,class Alloc>
+  Matrix<T,Alloc> operator+(const Matrix<T,Alloc>& a,
+                            const SparseMatrix<T,SAlloc>& b) {
+    return b + a;
+  }
+
+} // namespace anpi
@@ -0,0 +1,217 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date  : 28.12.2017
+ */
+
+#ifndef ANPI_VECTOR_HPP
+#define ANPI_VECTOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+
+#include "Allocator.hpp"
+#include "Matrix.hpp"
+
+namespace anpi
+{
+  /**
+   * Vector of n entries of type T.
+   *
+   * The entries are stored contiguously, as the only row of an
+   * anpi::Matrix, so that vectors use the same allocators as the
+   * matrices: with the default allocator the first entry is aligned
+   * for the widest registers, and the storage is padded to a whole
+   * number of registers.
+   *
+   * In matrix products a vector is a column, with n rows:
+   *
+   * \code
+   * anpi::Matrix<float> a(100,50,1.f);
+   * anpi::Vector<float> x(50,2.f);
+   * anpi::Vector<float> y = a*x;                // gemv
+   * anpi::gemv(1.f,anpi::transposed(a),y,0.f,x); // x = a^T * y
+   * \endcode
+   */
+  template<typename T,class Alloc=aligned_row_allocator<T> >
+  class Vector {
+  public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef size_t size_type;
+
+  private:
+    /// Entries, in the only row of the matrix
+    Matrix<T,Alloc> _data;
+
+  public:
+    /// Empty vector
+    Vector() : _data() {}
+
+    /// Vector of n entries initialized with the given value
+    explicit Vector(const size_t n,const T initVal=T())
+      : _data(1,n,initVal) {}
+
+    /// Vector of n entries not initialized
+    explicit Vector(const size_t n,const InitializationType it)
+      : _data(1,n,it) {}
+
+    /**
+     * Vector with the given entries
+     *
+     * \code
+     * anpi::Vector<int> v = { 1,2,3 };
+     * \endcode
+     */
+    Vector(std::initializer_list<T> lst)
+      : _data(1,lst.size(),DoNotInitialize) {
+      std::copy(lst.begin(),lst.end(),begin());
+    }
+
+    /// Copy of the entries of a view with one row or one column
+    explicit Vector(const ConstMatrixView<T>& v)
+      : _data(1,v.entries(),DoNotInitialize) {
+      assert( (v.rows() == 1) || (v.cols() == 1) );
+      if (v.rows() == 1) {
+        std::copy(v[0],v[0]+v.cols(),begin());
+      } else {
+        for (size_t i=0;i<v.rows();++i) {
+          _data(0,i) = v(i,0);
+        }
+      }
+    }
+
+    /// Number of entries
+    inline size_t size() const { return _data.cols(); }
+
+    /// Check if the vector has no entries
+    inline bool empty() const { return _data.empty(); }
+
+    /// Pointer to the first entry
+    inline T* data() { return _data.data(); }
+
+    /// Pointer to the first entry
+    inline const T* data() const { return _data.data(); }
+
+    /// Return reference to the i-th entry
+    inline T& operator[](const size_t i) {
+      assert( i < size() );
+      return data()[i];
+    }
+
+    /// Return const reference to the i-th entry
+    inline const T& operator[](const size_t i) const {
+      assert( i < size() );
+      return data()[i];
+    }
+
+    /// Iterator to the first entry
+    inline iterator begin() { return data(); }
+
+    /// Iterator to the first entry
+    inline const_iterator begin() const { return data(); }
+
+    /// Iterator after the last entry
+    inline iterator end() { return data() + size(); }
+
+    /// Iterator after the last entry
+    inline const_iterator end() const { return data() + size(); }
+
+    /// View of the entries as a matrix with one row
+    inline MatrixView<T> view() { return _data.view(); }
+
+    /// Read-only view of the entries as a matrix with one row
+    inline ConstMatrixView<T> view() const { return _data.view(); }
+
+    /// View of the entries as a matrix with one column
+    inline MatrixView<T> column() {
+      return MatrixView<T>(data(),size(),1,1);
+    }
+
+    /// Read-only view of the entries as a matrix with one column
+    inline ConstMatrixView<T> column() const {
+      return ConstMatrixView<T>(data(),size(),1,1);
+    }
+
+    /**
+     * Reserve memory for n entries, if the size changes.  The content
+     * is undefined afterwards.
+     */
+    inline void allocate(const size_t n) { _data.allocate(1,n); }
+
+    /// Set all entries to val
+    inline void fill(const T val) { _data.fill(val); }
+
+    /// Exchange the content with the other vector
+    inline void swap(Vector<T,Alloc>& other) { _data.swap(other._data); }
+
+    /**
+     * @name Comparison operators
+     */
+    //@{
+    inline bool operator==(const Vector<T,Alloc>& other) const {
+      return (size() == other.size()) &&
+             std::equal(begin(),end(),other.begin());
+    }
+
+    inline bool operator!=(const Vector<T,Alloc>& other) const {
+      return !operator==(other);
+    }
+    //@}
+
+    /**
+     * @name Arithmetic operators
+     */
+    //@{
+
+    /// Sum another vector to this one
+    inline Vector<T,Alloc>& operator+=(const Vector<T,Alloc>& other) {
+      assert( size() == other.size() );
+      view() += other.view();
+      return *this;
+    }
+
+    /// Subtract another vector from this one
+    inline Vector<T,Alloc>& operator-=(const Vector<T,Alloc>& other) {
+      assert( size() == other.size() );
+      view() -= other.view();
+      return *this;
+    }
+
+    /// Multiply all entries by a scalar
+    inline Vector<T,Alloc>& operator*=(const T s) {
+      for (T& x : *this) {
+        x *= s;
+      }
+      return *this;
+    }
+    //@}
+  };
+
+  // Vectors are columns in matrix products
+  template<typename T,class Alloc>
+  struct product_operand< Vector<T,Alloc> > {
+    static constexpr bool value = true;
+    typedef T value_type;
+    static inline gemm_operand<T> get(const Vector<T,Alloc>& v) {
+      return gemm_operand<T>{v.data(),v.size(),1,1,1};
+    }
+  };
+
+} // namespace anpi
+
+#include "bits/MatrixVector.hpp"
+
+#endif
@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_LAYOUT_MATRIX_HPP
+#define ANPI_LAYOUT_MATRIX_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "MatrixLayout.hpp"
+#include "Parallel.hpp"
+
+namespace anpi
+{
+  namespace detail {
+
+    /**
+     * Size of the square pieces shared by two layouts: the greatest
+     * common divisor of both granularities, where zero means that the
+     * layout has one single piece
+     */
+    inline size_t commonGranularity(size_t a,size_t b) {
+      if (a == 0) return b;
+      while (b != 0) {
+        const size_t t = a % b;
+        a = b;
+        b = t;
+      }
+      return a;
+    }
+
+    /// Storage of a row-major matrix: the matrix itself
+    template<typename T,class Alloc>
+    inline ConstMatrixView<T> storageView(const Matrix<T,Alloc,row_major>& m) {
+      return m.view();
+    }
+
+    /// Storage of a row-major matrix: the matrix itself
+    template<typename T,class Alloc>
+    inline MatrixView<T> storageView(Matrix<T,Alloc,row_major>& m) {
+      return m.view();
+    }
+
+    /// Storage of a matrix in any other layout
+    template<typename T,class Alloc,class Layout>
+    inline ConstMatrixView<T> storageView(const Matrix<T,Alloc,Layout>& m) {
+      return m.storage().view();
+    }
+
+    /// Storage of a matrix in any other layout
+    template<typename T,class Alloc,class Layout>
+    inline MatrixView<T> storageView(Matrix<T,Alloc,Layout>& m) {
+      return m.storage().view();
+    }
+
+    // Copy of a piece stored in the same orientation
+    template<typename T>
+    inline void copyPiece(const ConstMatrixView<T>& src,
+                          const MatrixView<T>& dst,
+                          std::true_type) {
+      ::anpi::aimpl::copy(src,dst);
+    }
+
+    // Copy of a piece stored transposed in one of the layouts
+    template<typename T>
+    inline void copyPiece(const ConstMatrixView<T>& src,
+                          const MatrixView<T>& dst,
+                          std::false_type) {
+      ::anpi::aimpl::transpose(src,dst);
+    }
+
+    /**
+     * Copy the first rows x cols entries of a matrix stored in the
+     * layout SL into a matrix stored in the layout DL.
+     *
+     * src and dst are the storages, and scols and dcols the number of
+     * columns of each matrix.  Both are traversed in pieces that lie
+     * in one piece of each layout, which are copied, or transposed if
+     * only one of the layouts is transposed.  Each thread copies a
+     * band of pieces.
+     */
+    template<class SL,class DL,typename T>
+    void copyLayout(const ConstMatrixView<T>& src,const size_t scols,
+                    const MatrixView<T>& dst,const size_t dcols,
+                    const size_t rows,const size_t cols) {
+      if ((rows == 0) || (cols == 0)) {
+        return;
+      }
+
+      typedef std::integral_constant<bool,SL::transposed==DL::transposed>
+        same_orientation;
+
+      const size_t g = commonGranularity(SL::granularity,DL::granularity);
+      if (g == 0) {
+        copyPiece(SL::piece(src,scols,0,0,rows,cols),
+                  DL::piece(dst,dcols,0,0,rows,cols),
+                  same_orientation());
+        return;
+      }
+
+      const size_t bands = (rows + (g-1))/g;
+      parallelRows(bands,g*cols,[&](const size_t first,const size_t last) {
+        for (size_t b=first;b<last;++b) {
+          const size_t r  = b*g;
+          const size_t nr = std::min(g,rows-r);
+          for (size_t c=0;c<cols;c+=g) {
+            const size_t nc = std::min(g,cols-c);
+            copyPiece(SL::piece(src,scols,r,c,nr,nc),
+                      DL::piece(dst,dcols,r,c,nr,nc),
+                      same_orientation());
+          }
+        }
+      });
+    }
+
+    /**
+     * Compare the first rows x cols entries of two matrices stored in
+     * the same layout L, whose storages are a and b
+     */
+    template<class L,typename T>
+    bool equalLayout(const ConstMatrixView<T>& a,
+                     const ConstMatrixView<T>& b,
+                     const size_t rows,const size_t cols) {
+      const size_t g = (L::granularity == 0) ? std::max(rows,cols)
+                                             : L::granularity;
+      for (size_t r=0;r<rows;r+=g) {
+        const size_t nr = std::min(g,rows-r);
+        for (size_t c=0;c<cols;c+=g) {
+          const size_t nc = std::min(g,cols-c);
+          const ConstMatrixView<T> pa = L::piece(a,cols,r,c,nr,nc);
+          const ConstMatrixView<T> pb = L::piece(b,cols,r,c,nr,nc);
+          for (size_t i=0;i<pa.rows();++i) {
+            if (std::memcmp(pa[i],pb[i],pa.cols()*sizeof(T)) != 0) {
+              return false;
+            }
+          }
+        }
+      }
+      return true;
+    }
+
+    /**
+     * One row of a matrix in any layout, so that m[row][col] works as
+     * for the row-major matrices
+     */
+    template<class M,typename R>
+    class layout_row {
+      /// The matrix
+      M* _m;
+      /// The row
+      size_t _row;
+
+    public:
+      inline layout_row(M* m,const size_t row) : _m(m),_row(row) {}
+
+      /// Entry at the given column
+      inline R& operator[](const size_t col) const {
+        return (*_m)(_row,col);
+      }
+    };
+
+  } // namespace detail
+
+  /**
+   * Matrix whose entries are stored in the given Layout (see
+   * <MatrixLayout.hpp>).  The default row-major matrix is the
+   * specialization defined in <Matrix.hpp>.
+   *
+   * The entries are kept in a row-major storage matrix, so that the
+   * allocation, padding and element-wise kernels are those of the
+   * row-major matrices.  Entries are accessed with m(row,col) or
+   * m[row][col].
+   *
+   * The element-wise operators between matrices of the same layout
+   * run in one pass over the storages, with the SIMD and parallel
+   * kernels.  A matrix in another layout (including the row-major
+   * one) is converted constructing or filling one from the other,
+   * which copies or transposes the common pieces of both layouts:
+   *
+   * \code
+   * typedef anpi::aligned_row_allocator<double> alloc;
+   * anpi::Matrix<double,alloc,anpi::tiled<> > t(a);   // a is row-major
+   * t = t + t*2.;
+   * anpi::Matrix<double> b(t);
+   * \endcode
+   */
+  template<typename T,class Alloc,class Layout>
+  class Matrix {
+  public:
+    /**
+     * @name Standard types
+     */
+    //@{
+    typedef Matrix<T,Alloc> storage_type;
+    typedef typename storage_type::allocator_type allocator_type;
+    typedef typename storage_type::value_type value_type;
+    typedef Layout layout_type;
+    //@}
+
+  protected:
+    /// The entries, in the order given by the layout
+    storage_type _storage;
+    /// Number of rows
+    size_t _rows;
+    /// Number of columns
+    size_t _cols;
+
+  public:
+    /**
+     * @name Constructors
+     */
+    //@{
+    Matrix() : _storage(),_rows(0),_cols(0) {}
+
+    explicit Matrix(const size_t rows,
+                    const size_t cols,
+                    const InitializationType)
+      : _storage(Layout::storageRows(rows,cols),
+                 Layout::storageCols(rows,cols),DoNotInitialize),
+        _rows(rows),_cols(cols) {}
+
+    explicit Matrix(const size_t rows,
+                    const size_t cols,
+                    const value_type initVal=value_type())
+      : Matrix(rows,cols,DoNotInitialize) {
+      fill(initVal);
+    }
+
+    /// Matrix with the rows given in the list
+    Matrix(std::initializer_list< std::initializer_list<value_type> > lst);
+
+    /// Copy of a matrix in any other layout
+    template<class OAlloc,class OLayout>
+    explicit Matrix(const Matrix<T,OAlloc,OLayout>& other)
+      : Matrix(other.rows(),other.cols(),DoNotInitialize) {
+      fill(other);
+    }
+
+    Matrix(const Matrix& other) = default;
+
+    Matrix(Matrix&& other)
+      : _storage(std::move(other._storage)),
+        _rows(other._rows),_cols(other._cols) {
+      other._rows = 0;
+      other._cols = 0;
+    }
+    //@}
+
+    /// Deep copy another matrix
+    Matrix& operator=(const Matrix& other) = default;
+
+    /// Move assignment operator
+    Matrix& operator=(Matrix&& other) {
+      if (this != &other) {
+        swap(other);
+        other.clear();
+      }
+      return *this;
+    }
+
+    /// Compare two matrices for equality, entry by entry
+    bool operator==(const Matrix& other) const {
+      return (_rows == other._rows) && (_cols == other._cols) &&
+        ::anpi::detail::equalLayout<Layout>(_storage.view(),
+                                            other._storage.view(),
+                                            _rows,_cols);
+    }
+
+    /// Compare two matrices for inequality
+    bool operator!=(const Matrix& other) const {
+      return !operator==(other);
+    }
+
+    /// Entries of the given row, to be indexed by column
+    inline detail::layout_row<Matrix,T> operator[](const size_t row) {
+      return detail::layout_row<Matrix,T>(this,row);
+    }
+
+    /// Read-only entries of the given row, to be indexed by column
+    inline detail::layout_row<const Matrix,const T>
+    operator[](const size_t row) const {
+      return detail::layout_row<const Matrix,const T>(this,row);
+    }
+
+    /// Return reference to the element at the r row and c column
+    inline T& operator()(const size_t row,const size_t col) {
+      return *(_storage.data() +
+               Layout::offset(row,col,_cols,_storage.dcols()));
+    }
+
+    /// Return const reference to the element at the r row and c column
+    inline const T& operator()(const size_t row,const size_t col) const {
+      return *(_storage.data() +
+               Layout::offset(row,col,_cols,_storage.dcols()));
+    }
+
+    /// Swap the contents of the other matrix with this one
+    void swap(Matrix& other) {
+      _storage.swap(other._storage);
+      std::swap(_rows,other._rows);
+      std::swap(_cols,other._cols);
+    }
+
+    /// Allocate memory for the given number of rows and cols
+    void allocate(const size_t rows,const size_t cols) {
+      _storage.allocate(Layout::storageRows(rows,cols),
+                        Layout::storageCols(rows,cols));
+      _rows = rows;
+      _cols = cols;
+    }
+
+    /// Reset this matrix to a default constructed empty state
+    void clear() {
+      _storage.clear();
+      _rows = 0;
+      _cols = 0;
+    }
+
+    /// Fill all elements of the matrix with the given value
+    void fill(const T val) {
+      _storage.fill(val);
+    }
+
+    /**
+     * Fill this matrix with the content of the other matrix, in any
+     * layout.  Only the block common to both sizes is copied.
+     */
+    template<class OAlloc,class OLayout>
+    void fill(const Matrix<T,OAlloc,OLayout>& other) {
+      ::anpi::detail::copyLayout<OLayout,Layout>(
+         ::anpi::detail::storageView(other),other.cols(),
+         _storage.view(),_cols,
+         std::min(other.rows(),_rows),std::min(other.cols(),_cols));
+    }
+
+    /// Check if the matrix is empty (zero rows or columns)
+    inline bool empty() const { return (_rows==0) || (_cols==0); }
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /// Total number of entries (rows x cols)
+    inline size_t entries() const { return _rows*_cols; }
+
+    /// Row-major matrix holding the entries in the order of the layout
+    inline storage_type& storage() { return _storage; }
+
+    /// Row-major matrix holding the entries in the order of the layout
+    inline const storage_type& storage() const { return _storage; }
+
+    /**
+     * @name Arithmetic operators
+     *
+     * Both operands must have the same size.
+     */
+    //@{
+
+    /// Sum this and another matrix, and leave the result in here
+    Matrix& operator+=(const Matrix& other) {
+      assert( (_rows == other._rows) && (_cols == other._cols) );
+      _storage += other._storage;
+      return *this;
+    }
+
+    /// Subtract another matrix to this one, and leave the result in here
+    Matrix& operator-=(const Matrix& other) {
+      assert( (_rows == other._rows) && (_cols == other._cols) );
+      _storage -= other._storage;
+      return *this;
+    }
+
+    /// Sum of two matrices
+    friend inline Matrix operator+(const Matrix& a,const Matrix& b) {
+      assert( (a._rows == b._rows) && (a._cols == b._cols) );
+      Matrix c(a._rows,a._cols,DoNotInitialize);
+      c._storage = a._storage + b._storage;
+      return c;
+    }
+
+    /// Difference of two matrices
+    friend inline Matrix operator-(const Matrix& a,const Matrix& b) {
+      assert( (a._rows == b._rows) && (a._cols == b._cols) );
+      Matrix c(a._rows,a._cols,DoNotInitialize);
+      c._storage = a._storage - b._storage;
+      return c;
+    }
+
+    /// Product of a matrix and a scalar
+    friend inline Matrix operator*(const Matrix& a,const value_type s) {
+      Matrix c(a._rows,a._cols,DoNotInitialize);
+      c._storage = a._storage * s;
+      return c;
+    }
+
+    /// Product of a scalar and a matrix
+    friend inline Matrix operator*(const value_type s,const Matrix& a) {
+      return a*s;
+    }
+
+    /// Quotient of a matrix and a scalar
+    friend inline Matrix operator/(const Matrix& a,const value_type s) {
+      Matrix c(a._rows,a._cols,DoNotInitialize);
+      c._storage = a._storage / s;
+      return c;
+    }
+    //@}
+  };
+
+  template<typename T,class Alloc,class Layout>
+  Matrix<T,Alloc,Layout>::
+  Matrix(std::initializer_list< std::initializer_list<value_type> > lst)
+    : Matrix(lst.size(),
+             (lst.size()>0) ? lst.begin()->size() : 0,
+             DoNotInitialize) {
+    fill(value_type());
+    size_t r=0;
+    for (const auto& row : lst) {
+      assert(row.size()==_cols && "Check number of cols");
+      size_t c=0;
+      for (const auto& v : row) {
+        operator()(r,c++) = v;
+      }
+      ++r;
+    }
+  }
+
+} // namespace anpi
+
+#endif
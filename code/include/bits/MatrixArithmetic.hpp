@@ -12,391 +12,1127 @@
 #define ANPI_MATRIX_ARITHMETIC_HPP
 
 #include "Intrinsics.hpp"
+#include "Parallel.hpp"
+#include "MatrixExpression.hpp"
+#include "SimdOperations.hpp"
+#include "SimdDispatch.hpp"
+#include <cstring>
 #include <type_traits>
 
 namespace anpi
 {
+  namespace detail {
+    /// View of the whole memory block of m, including the row padding
+    template<typename T,class Alloc>
+    inline MatrixView<T> paddedView(Matrix<T,Alloc>& m) {
+      return MatrixView<T>(m.data(),m.rows(),m.dcols(),m.dcols());
+    }
+
+    /// Read-only view of the whole memory block of m
+    template<typename T,class Alloc>
+    inline ConstMatrixView<T> paddedView(const Matrix<T,Alloc>& m) {
+      return ConstMatrixView<T>(m.data(),m.rows(),m.dcols(),m.dcols());
+    }
+  } // namespace detail
+
   namespace fallback {
+
+    /*
+     * Generic element-wise operations
+     *
+     * The padding of the rows is never touched, to avoid computing
+     * on uninitialized data (e.g. integer divisions by zero).  The
+     * kernels work on views, so that they can also be applied on
+     * blocks of larger matrices.
+     */
+
+    // Implementation on views c = a op b
+    template<class Op,typename T>
+    inline void elementwise(const ConstMatrixView<T>& a,
+                            const ConstMatrixView<T>& b,
+                            const MatrixView<T>& c) {
+
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+              (a.rows() == c.rows()) && (a.cols() == c.cols()) );
+
+      // without gaps all rows of a block can be processed as one
+      const bool flat = a.contiguous() && b.contiguous() && c.contiguous();
+
+      parallelRows(c.rows(),c.cols(),[&](const size_t first,
+                                         const size_t last) {
+        const size_t rows = flat ? first+1 : last;
+        const size_t cols = flat ? (last-first)*c.cols() : c.cols();
+
+        for (size_t r=first;r<rows;++r) {
+          T* here        = c[r];
+          T *const end   = here + cols;
+          const T* aptr  = a[r];
+          const T* bptr  = b[r];
+
+          for (;here!=end;) {
+            *here++ = Op::apply(*aptr++,*bptr++);
+          }
+        }
+      });
+    }
+
+    // In-place implementation on views a = a op b
+    template<class Op,typename T>
+    inline void elementwise(const MatrixView<T>& a,
+                            const ConstMatrixView<T>& b) {
+      elementwise<Op>(a,b,a);
+    }
+
+    // Implementation on views d = op(a,b,c)
+    template<class Op,typename T>
+    inline void elementwise(const ConstMatrixView<T>& a,
+                            const ConstMatrixView<T>& b,
+                            const ConstMatrixView<T>& c,
+                            const MatrixView<T>& d) {
+
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+              (a.rows() == c.rows()) && (a.cols() == c.cols()) &&
+              (a.rows() == d.rows()) && (a.cols() == d.cols()) );
+
+      const bool flat = a.contiguous() && b.contiguous() &&
+                        c.contiguous() && d.contiguous();
+
+      parallelRows(d.rows(),d.cols(),[&](const size_t first,
+                                         const size_t last) {
+        const size_t rows = flat ? first+1 : last;
+        const size_t cols = flat ? (last-first)*d.cols() : d.cols();
+
+        for (size_t r=first;r<rows;++r) {
+          T* here        = d[r];
+          T *const end   = here + cols;
+          const T* aptr  = a[r];
+          const T* bptr  = b[r];
+          const T* cptr  = c[r];
+
+          for (;here!=end;) {
+            *here++ = Op::apply(*aptr++,*bptr++,*cptr++);
+          }
+        }
+      });
+    }
+
+    // In-copy implementation c = a op b
+    template<class Op,typename T,class Alloc>
+    inline void elementwise(const Matrix<T,Alloc>& a,
+                            const Matrix<T,Alloc>& b,
+                            Matrix<T,Alloc>& c) {
+
+      assert( (a.rows() == b.rows()) &&
+              (a.cols() == b.cols()) );
+
+      // c may be one of the operands, which has to be read before it
+      // gets its own memory block
+      const ConstMatrixView<T> av = a.view();
+      const ConstMatrixView<T> bv = b.view();
+      c.allocate(a.rows(),a.cols());
+      elementwise<Op>(av,bv,c.view());
+    }
+
+    // In-place implementation a = a op b
+    template<class Op,typename T,class Alloc>
+    inline void elementwise(Matrix<T,Alloc>& a,
+                            const Matrix<T,Alloc>& b) {
+      elementwise<Op>(a,b,a);
+    }
+
+    // In-copy implementation d = op(a,b,c)
+    template<class Op,typename T,class Alloc>
+    inline void elementwise(const Matrix<T,Alloc>& a,
+                            const Matrix<T,Alloc>& b,
+                            const Matrix<T,Alloc>& c,
+                            Matrix<T,Alloc>& d) {
+
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+              (a.rows() == c.rows()) && (a.cols() == c.cols()) );
+
+      // d may be one of the operands (see above)
+      const ConstMatrixView<T> av = a.view();
+      const ConstMatrixView<T> bv = b.view();
+      const ConstMatrixView<T> cv = c.view();
+      d.allocate(a.rows(),a.cols());
+      elementwise<Op>(av,bv,cv,d.view());
+    }
+
     /*
      * Sum
      */
 
-    // Fallback implementation
-    
     // In-copy implementation c=a+b
     template<typename T,class Alloc>
     inline void add(const Matrix<T,Alloc>& a,
                     const Matrix<T,Alloc>& b,
                     Matrix<T,Alloc>& c) {
-
-      assert( (a.rows() == b.rows()) &&
-              (a.cols() == b.cols()) );
-
-      const size_t tentries = a.rows()*a.dcols();
-      c.allocate(a.rows(),a.cols());
-      
-      T* here        = c.data();
-      T *const end   = here + tentries;
-      const T* aptr = a.data();
-      const T* bptr = b.data();
-
-      for (;here!=end;) {
-        *here++ = *aptr++ + *bptr++;
-      }
+      elementwise<ops::add>(a,b,c);
     }
 
     // In-place implementation a = a+b
     template<typename T,class Alloc>
     inline void add(Matrix<T,Alloc>& a,
                     const Matrix<T,Alloc>& b) {
+      elementwise<ops::add>(a,b);
+    }
 
-      assert( (a.rows() == b.rows()) &&
-              (a.cols() == b.cols()) );
-
-      const size_t tentries = a.rows()*a.dcols();
-      
-      T* here        = a.data();
-      T *const end   = here + tentries;
-      
-      const T* bptr = b.data();
-
-      for (;here!=end;) {
-        *here++ += *bptr++;
-      }
+    // Implementation on views c = a+b
+    template<typename T>
+    inline void add(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::add>(a,b,c);
     }
 
+    // In-place implementation on views a = a+b
+    template<typename T>
+    inline void add(const MatrixView<T>& a,
+                    const ConstMatrixView<T>& b) {
+      elementwise<ops::add>(a,b);
+    }
 
     /*
      * Subtraction
      */
 
-    // Fall back implementations
-
     // In-copy implementation c=a-b
     template<typename T,class Alloc>
     inline void subtract(const Matrix<T,Alloc>& a,
                          const Matrix<T,Alloc>& b,
                          Matrix<T,Alloc>& c) {
-
-      assert( (a.rows() == b.rows()) &&
-              (a.cols() == b.cols()) );
-
-      const size_t tentries = a.rows()*a.dcols();
-      c.allocate(a.rows(),a.cols());
-      
-      T* here        = c.data();
-      T *const end   = here + tentries;
-      const T* aptr = a.data();
-      const T* bptr = b.data();
-
-      for (;here!=end;) {
-        *here++ = *aptr++ - *bptr++;
-      }
+      elementwise<ops::subtract>(a,b,c);
     }
 
     // In-place implementation a = a-b
     template<typename T,class Alloc>
     inline void subtract(Matrix<T,Alloc>& a,
                          const Matrix<T,Alloc>& b) {
+      elementwise<ops::subtract>(a,b);
+    }
 
-      assert( (a.rows() == b.rows()) &&
-              (a.cols() == b.cols()) );
-      
-      const size_t tentries = a.rows()*a.dcols();
-      
-      T* here        = a.data();
-      T *const end   = here + tentries;
-      
-      const T* bptr = b.data();
-
-      for (;here!=end;) {
-        *here++ -= *bptr++;
-      }
+    // Implementation on views c = a-b
+    template<typename T>
+    inline void subtract(const ConstMatrixView<T>& a,
+                         const ConstMatrixView<T>& b,
+                         const MatrixView<T>& c) {
+      elementwise<ops::subtract>(a,b,c);
     }
 
-  } // namespace fallback
+    // In-place implementation on views a = a-b
+    template<typename T>
+    inline void subtract(const MatrixView<T>& a,
+                         const ConstMatrixView<T>& b) {
+      elementwise<ops::subtract>(a,b);
+    }
 
+    /*
+     * Element-wise product
+     */
+
+    // In-copy implementation c=a.*b
+    template<typename T,class Alloc>
+    inline void multiply(const Matrix<T,Alloc>& a,
+                         const Matrix<T,Alloc>& b,
+                         Matrix<T,Alloc>& c) {
+      elementwise<ops::multiply>(a,b,c);
+    }
+
+    // In-place implementation a = a.*b
+    template<typename T,class Alloc>
+    inline void multiply(Matrix<T,Alloc>& a,
+                         const Matrix<T,Alloc>& b) {
+      elementwise<ops::multiply>(a,b);
+    }
+
+    // Implementation on views c = a.*b
+    template<typename T>
+    inline void multiply(const ConstMatrixView<T>& a,
+                         const ConstMatrixView<T>& b,
+                         const MatrixView<T>& c) {
+      elementwise<ops::multiply>(a,b,c);
+    }
+
+    // In-place implementation on views a = a.*b
+    template<typename T>
+    inline void multiply(const MatrixView<T>& a,
+                         const ConstMatrixView<T>& b) {
+      elementwise<ops::multiply>(a,b);
+    }
 
-  namespace simd
-  {
     /*
-     * Sum
+     * Element-wise division
      */
 
+    // In-copy implementation c=a./b
+    template<typename T,class Alloc>
+    inline void divide(const Matrix<T,Alloc>& a,
+                       const Matrix<T,Alloc>& b,
+                       Matrix<T,Alloc>& c) {
+      elementwise<ops::divide>(a,b,c);
+    }
+
+    // In-place implementation a = a./b
+    template<typename T,class Alloc>
+    inline void divide(Matrix<T,Alloc>& a,
+                       const Matrix<T,Alloc>& b) {
+      elementwise<ops::divide>(a,b);
+    }
+
+    // Implementation on views c = a./b
+    template<typename T>
+    inline void divide(const ConstMatrixView<T>& a,
+                       const ConstMatrixView<T>& b,
+                       const MatrixView<T>& c) {
+      elementwise<ops::divide>(a,b,c);
+    }
+
+    // In-place implementation on views a = a./b
+    template<typename T>
+    inline void divide(const MatrixView<T>& a,
+                       const ConstMatrixView<T>& b) {
+      elementwise<ops::divide>(a,b);
+    }
+
+    /*
+     * Element-wise minimum
+     */
+
+    // In-copy implementation c=min(a,b)
+    template<typename T,class Alloc>
+    inline void min(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    Matrix<T,Alloc>& c) {
+      elementwise<ops::min>(a,b,c);
+    }
+
+    // In-place implementation a = min(a,b)
+    template<typename T,class Alloc>
+    inline void min(Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b) {
+      elementwise<ops::min>(a,b);
+    }
+
+    // Implementation on views c = min(a,b)
+    template<typename T>
+    inline void min(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::min>(a,b,c);
+    }
+
+    // In-place implementation on views a = min(a,b)
+    template<typename T>
+    inline void min(const MatrixView<T>& a,
+                    const ConstMatrixView<T>& b) {
+      elementwise<ops::min>(a,b);
+    }
+
+    /*
+     * Element-wise maximum
+     */
+
+    // In-copy implementation c=max(a,b)
+    template<typename T,class Alloc>
+    inline void max(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    Matrix<T,Alloc>& c) {
+      elementwise<ops::max>(a,b,c);
+    }
+
+    // In-place implementation a = max(a,b)
+    template<typename T,class Alloc>
+    inline void max(Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b) {
+      elementwise<ops::max>(a,b);
+    }
+
+    // Implementation on views c = max(a,b)
+    template<typename T>
+    inline void max(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::max>(a,b,c);
+    }
+
+    // In-place implementation on views a = max(a,b)
+    template<typename T>
+    inline void max(const MatrixView<T>& a,
+                    const ConstMatrixView<T>& b) {
+      elementwise<ops::max>(a,b);
+    }
+
+    /*
+     * Element-wise multiply-add
+     */
+
+    // In-copy implementation d=a.*b+c
+    template<typename T,class Alloc>
+    inline void fma(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    const Matrix<T,Alloc>& c,
+                    Matrix<T,Alloc>& d) {
+      elementwise<ops::fma>(a,b,c,d);
+    }
+
+    // Accumulating implementation c = a.*b+c
+    template<typename T,class Alloc>
+    inline void fma(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    Matrix<T,Alloc>& c) {
+      elementwise<ops::fma>(a,b,c,c);
+    }
+
+    // Implementation on views d = a.*b+c
+    template<typename T>
+    inline void fma(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const ConstMatrixView<T>& c,
+                    const MatrixView<T>& d) {
+      elementwise<ops::fma>(a,b,c,d);
+    }
+
+    // Accumulating implementation on views c = a.*b+c
+    template<typename T>
+    inline void fma(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::fma>(a,b,c,c);
+    }
+
+    /*
+     * Expressions
+     */
+
+    // Evaluate the expression tree e into the view c, element by element
+    template<typename T,class E>
+    inline void evaluate(const MatrixExpression<E>& expr,
+                         const MatrixView<T>& c) {
+
+      static_assert(std::is_same<T,typename E::value_type>::value,
+                    "Expression and matrix must have the same type");
+
+      const E& e = expr.derived();
+      assert( (c.rows() == e.rows()) && (c.cols() == e.cols()) );
+
+      const bool flat = c.contiguous() && e.flat(c.dcols());
+
+      parallelRows(c.rows(),c.cols(),[&](const size_t first,
+                                         const size_t last) {
+        if (flat) {
+          // all operands share the layout of c: one single pass
+          const size_t entries = (last-first)*c.cols();
+          T* here = c[first];
+          for (size_t i=0;i<entries;++i) {
+            *here++ = e.coeff(first,i);
+          }
+        } else {
+          for (size_t r=first;r<last;++r) {
+            T* here = c[r];
+            for (size_t col=0;col<c.cols();++col) {
+              *here++ = e.coeff(r,col);
+            }
+          }
+        }
+      });
+    }
+
+    // Evaluate the expression tree e into c, element by element
+    template<typename T,class Alloc,class E>
+    inline void evaluate(const MatrixExpression<E>& expr,
+                         Matrix<T,Alloc>& c) {
+      const E& e = expr.derived();
+      c.allocate(e.rows(),e.cols());
+      ::anpi::fallback::evaluate(e,c.view());
+    }
+
+    /*
+     * Memory transfers
+     *
+     * On matrices, both fill the whole memory block, including the
+     * padding.  On views, the gaps between the rows are not touched.
+     */
+
+    // Set all entries of the view m to val
+    template<typename T>
+    inline void fill(const MatrixView<T>& m,const T val) {
+      const bool flat = m.contiguous();
+
+      parallelRows(m.rows(),m.cols(),[&](const size_t first,
+                                         const size_t last) {
+        const size_t rows = flat ? first+1 : last;
+        const size_t cols = flat ? (last-first)*m.cols() : m.cols();
+
+        for (size_t r=first;r<rows;++r) {
+          T *const end = m[r] + cols;
+          for (T* ptr = m[r];ptr!=end;++ptr) {
+            *ptr = val;
+          }
+        }
+      });
+    }
+
+    // Copy the entries of the view src into the view dst
+    template<typename T>
+    inline void copy(const ConstMatrixView<T>& src,const MatrixView<T>& dst) {
+      assert( (src.rows() == dst.rows()) && (src.cols() == dst.cols()) );
+
+      const bool flat = src.contiguous() && dst.contiguous();
+
+      parallelRows(dst.rows(),dst.cols(),[&](const size_t first,
+                                             const size_t last) {
+        if (flat) {
+          std::memcpy(dst[first],src[first],
+                      sizeof(T)*(last-first)*dst.cols());
+        } else {
+          for (size_t r=first;r<last;++r) {
+            std::memcpy(dst[r],src[r],sizeof(T)*dst.cols());
+          }
+        }
+      });
+    }
+
+    // Set all entries of m to val
+    template<typename T,class Alloc>
+    inline void fill(Matrix<T,Alloc>& m,const T val) {
+      ::anpi::fallback::fill(::anpi::detail::paddedView(m),val);
+    }
+
+    // Copy the memory block mem, with the layout of m, into m
+    template<typename T,class Alloc>
+    inline void fill(Matrix<T,Alloc>& m,const T* mem) {
+      ::anpi::fallback::copy(ConstMatrixView<T>(mem,m.rows(),
+                                                m.dcols(),m.dcols()),
+                             ::anpi::detail::paddedView(m));
+    }
+
+  } // namespace fallback
+
+
+  namespace simd
+  {
     /*
      * The following code exemplifies how to manually accelerate code using
      * SIMD instructions.  However, for the simple element-wise algorithms
      * like sum or subtraction, modern compilers can automatically vectorize
      * the code, as the benchmarks show.
+     *
+     * All kernels are generic: the operation table mm_op in
+     * SimdOperations.hpp provides the intrinsic for each combination of
+     * operation, instruction set and element type.  Combinations
+     * missing in the table use the fallback implementation.
+     */
+
+    /*
+     * Kernels dispatched at runtime
+     *
+     * The kernels for each instruction set are compiled in
+     * SimdDispatch.hpp.  The following functors tell the dispatcher
+     * which instruction sets can run each kernel, and how to call it.
      */
 
+    // c[i] = a[i] op b[i] for i in [0,n)
+    template<class Op,typename T>
+    struct binary_kernel {
+      template<class Isa>
+      struct supported : is_simd_op<Op,Isa,T> {};
+
+      template<class Isa>
+      static void run(const T* a,const T* b,T* c,const size_t n) {
+        kernels<Isa>::template binary<Op>(a,b,c,n);
+      }
+    };
 
-    /// We wrap the intrinsics methods to be polymorphic versions
-    template<typename T,class regType>
-    regType mm_add(regType,regType); // We don't implement this to cause, at
-                                     // least, a linker error if this version is
-                                     // used.
-    //{
-    // Generic function should never be called.
-    // If it is called, then some SIMD chaos is going on...
-    
-    // A way to cause a compile time error would be better
-    // throw std::bad_function_call();
-    // return regType();
-    //}
-    
-#ifdef __AVX512F__
-    template<>
-    inline __m512d __attribute__((__always_inline__))
-    mm_add<double>(__m512d a,__m512d b) {
-      return _mm512_add_pd(a,b);
-    }
-    template<>
-    inline __m512 __attribute__((__always_inline__))
-    mm_add<float>(__m512 a,__m512 b) {
-      return _mm512_add_ps(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<uint64_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi64(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<int64_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi64(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<uint32_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi32(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<int32_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi32(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<uint16_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi16(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<int16_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi16(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<uint8_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi8(a,b);
-    }
-    template<>
-    inline __m512i __attribute__((__always_inline__))
-    mm_add<int8_t>(__m512i a,__m512i b) {
-      return _mm512_add_epi8(a,b);
-    }
-#elif defined __AVX__
-    template<>
-    inline __m256d __attribute__((__always_inline__))
-    mm_add<double>(__m256d a,__m256d b) {
-      return _mm256_add_pd(a,b);
-    }
-    template<>
-    inline __m256 __attribute__((__always_inline__))
-    mm_add<float>(__m256 a,__m256 b) {
-      return _mm256_add_ps(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<uint64_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi64(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<int64_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi64(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<uint32_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi32(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<int32_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi32(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<uint16_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi16(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<int16_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi16(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<uint8_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi8(a,b);
-    }
-    template<>
-    inline __m256i __attribute__((__always_inline__))
-    mm_add<int8_t>(__m256i a,__m256i b) {
-      return _mm256_add_epi8(a,b);
-    }
-#elif  defined __SSE2__
-    template<>
-    inline __m128d __attribute__((__always_inline__))
-    mm_add<double>(__m128d a,__m128d b) {
-      return _mm_add_pd(a,b);
-    }
-    template<>
-    inline __m128 __attribute__((__always_inline__))
-    mm_add<float>(__m128 a,__m128 b) {
-      return _mm_add_ps(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::uint64_t>(__m128i a,__m128i b) {
-      return _mm_add_epi64(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::int64_t>(__m128i a,__m128i b) {
-      return _mm_add_epi64(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::uint32_t>(__m128i a,__m128i b) {
-      return _mm_add_epi32(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::int32_t>(__m128i a,__m128i b) {
-      return _mm_add_epi16(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::uint16_t>(__m128i a,__m128i b) {
-      return _mm_add_epi16(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::int16_t>(__m128i a,__m128i b) {
-      return _mm_add_epi32(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::uint8_t>(__m128i a,__m128i b) {
-      return _mm_add_epi16(a,b);
-    }
-    template<>
-    inline __m128i __attribute__((__always_inline__))
-    mm_add<std::int8_t>(__m128i a,__m128i b) {
-      return _mm_add_epi32(a,b);
+    // d[i] = op(a[i],b[i],c[i]) for i in [0,n)
+    template<class Op,typename T>
+    struct ternary_kernel {
+      template<class Isa>
+      struct supported : is_simd_op<Op,Isa,T> {};
+
+      template<class Isa>
+      static void run(const T* a,const T* b,const T* c,T* d,const size_t n) {
+        kernels<Isa>::template ternary<Op>(a,b,c,d,n);
+      }
+    };
+
+    // n entries of the given row of the expression e
+    template<class E,typename T>
+    struct expression_kernel {
+      template<class Isa>
+      struct supported : is_simd_expression<Isa,E> {};
+
+      template<class Isa>
+      static void run(const E& e,const size_t row,T* out,const size_t n) {
+        kernels<Isa>::evaluate(e,row,out,n);
+      }
+    };
+
+    /*
+     * View kernels
+     *
+     * Views without gaps between their rows are processed as one
+     * contiguous block; otherwise the kernel runs on each row.
+     */
+
+    // Implementation on views c = a op b
+    template<class Op,typename T>
+    inline void elementwise(const ConstMatrixView<T>& a,
+                            const ConstMatrixView<T>& b,
+                            const MatrixView<T>& c) {
+
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+              (a.rows() == c.rows()) && (a.cols() == c.cols()) );
+
+      typedef binary_kernel<Op,T> kernel;
+
+      if (!dispatchable<kernel>()) {
+        // not in the operation table, or no SIMD support in this CPU
+        ::anpi::fallback::elementwise<Op>(a,b,c);
+        return;
+      }
+
+      const bool flat = a.contiguous() && b.contiguous() && c.contiguous();
+
+      parallelRows(c.rows(),c.cols(),[&](const size_t first,
+                                         const size_t last) {
+        if (flat) {
+          dispatch<kernel>(a[first],b[first],c[first],(last-first)*c.cols());
+        } else {
+          for (size_t r=first;r<last;++r) {
+            dispatch<kernel>(a[r],b[r],c[r],c.cols());
+          }
+        }
+      });
     }
-#endif
-    
-    // On-copy implementation c=a+b
-    template<typename T,class Alloc,typename regType>
-    inline void addSIMD(const Matrix<T,Alloc>& a, 
-                        const Matrix<T,Alloc>& b,
-                        Matrix<T,Alloc>& c) {
-
-      // This method is instantiated with unaligned allocators.  We
-      // allow the instantiation although externally this is never
-      // called unaligned
-      static_assert(!extract_alignment<Alloc>::aligned ||
-		    (extract_alignment<Alloc>::value >= sizeof(regType)),
-		    "Insufficient alignment for the registers used");
-      
-      const size_t tentries = a.rows()*a.dcols();
-      c.allocate(a.rows(),a.cols());
 
-      regType* here        = reinterpret_cast<regType*>(c.data());
-      const size_t  blocks = ( tentries*sizeof(T) + (sizeof(regType)-1) )/
-        sizeof(regType);
-      regType *const end   = here + blocks;
-      const regType* aptr  = reinterpret_cast<const regType*>(a.data());
-      const regType* bptr  = reinterpret_cast<const regType*>(b.data());
-      
-      for (;here!=end;) {
-        *here++ = mm_add<T>(*aptr++,*bptr++);
+    // In-place implementation on views a = a op b
+    template<class Op,typename T>
+    inline void elementwise(const MatrixView<T>& a,
+                            const ConstMatrixView<T>& b) {
+      elementwise<Op>(a,b,a);
+    }
+
+    // Implementation on views d = op(a,b,c)
+    template<class Op,typename T>
+    inline void elementwise(const ConstMatrixView<T>& a,
+                            const ConstMatrixView<T>& b,
+                            const ConstMatrixView<T>& c,
+                            const MatrixView<T>& d) {
+
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+              (a.rows() == c.rows()) && (a.cols() == c.cols()) &&
+              (a.rows() == d.rows()) && (a.cols() == d.cols()) );
+
+      typedef ternary_kernel<Op,T> kernel;
+
+      if (!dispatchable<kernel>()) {
+        ::anpi::fallback::elementwise<Op>(a,b,c,d);
+        return;
       }
-      
+
+      const bool flat = a.contiguous() && b.contiguous() &&
+                        c.contiguous() && d.contiguous();
+
+      parallelRows(d.rows(),d.cols(),[&](const size_t first,
+                                         const size_t last) {
+        if (flat) {
+          dispatch<kernel>(a[first],b[first],c[first],d[first],
+                           (last-first)*d.cols());
+        } else {
+          for (size_t r=first;r<last;++r) {
+            dispatch<kernel>(a[r],b[r],c[r],d[r],d.cols());
+          }
+        }
+      });
     }
-       
-    // On-copy implementation c=a+b for SIMD-capable types
-    template<typename T,
-	     class Alloc,
-	     typename std::enable_if<is_simd_type<T>::value,int>::type=0>
-    inline void add(const Matrix<T,Alloc>& a,
-                    const Matrix<T,Alloc>& b,
-                    Matrix<T,Alloc>& c) {
+
+    /*
+     * Matrix kernels
+     *
+     * All matrices have the same type, and therefore the same padding.
+     * The SIMD operations in the table are safe to be computed on the
+     * padding, so that the whole memory block is processed at once.
+     */
+
+    // In-copy implementation c = a op b
+    template<class Op,typename T,class Alloc>
+    inline void elementwise(const Matrix<T,Alloc>& a,
+                            const Matrix<T,Alloc>& b,
+                            Matrix<T,Alloc>& c) {
 
       assert( (a.rows() == b.rows()) &&
               (a.cols() == b.cols()) );
 
+      if (!dispatchable< binary_kernel<Op,T> >()) {
+        // the fallback must not compute on the padding
+        ::anpi::fallback::elementwise<Op>(a,b,c);
+        return;
+      }
 
-      if (is_aligned_alloc<Alloc>::value) {        
-#ifdef __AVX512F__
-        addSIMD<T,Alloc,typename avx512_traits<T>::reg_type>(a,b,c);
-#elif  __AVX__
-        addSIMD<T,Alloc,typename avx_traits<T>::reg_type>(a,b,c);
-#elif  __SSE2__
-        addSIMD<T,Alloc,typename sse2_traits<T>::reg_type>(a,b,c);
-#else
-        ::anpi::fallback::add(a,b,c);
-#endif
-      } else { // allocator seems to be unaligned
-        ::anpi::fallback::add(a,b,c);
+      // c may be one of the operands, which has to be read before it
+      // gets its own memory block
+      const ConstMatrixView<T> av = ::anpi::detail::paddedView(a);
+      const ConstMatrixView<T> bv = ::anpi::detail::paddedView(b);
+      c.allocate(a.rows(),a.cols());
+      elementwise<Op>(av,bv,::anpi::detail::paddedView(c));
+    }
+
+    // In-place implementation a = a op b
+    template<class Op,typename T,class Alloc>
+    inline void elementwise(Matrix<T,Alloc>& a,
+                            const Matrix<T,Alloc>& b) {
+      elementwise<Op>(a,b,a);
+    }
+
+    // In-copy implementation d = op(a,b,c)
+    template<class Op,typename T,class Alloc>
+    inline void elementwise(const Matrix<T,Alloc>& a,
+                            const Matrix<T,Alloc>& b,
+                            const Matrix<T,Alloc>& c,
+                            Matrix<T,Alloc>& d) {
+
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+              (a.rows() == c.rows()) && (a.cols() == c.cols()) );
+
+      if (!dispatchable< ternary_kernel<Op,T> >()) {
+        ::anpi::fallback::elementwise<Op>(a,b,c,d);
+        return;
       }
+
+      // d may be one of the operands (see above)
+      const ConstMatrixView<T> av = ::anpi::detail::paddedView(a);
+      const ConstMatrixView<T> bv = ::anpi::detail::paddedView(b);
+      const ConstMatrixView<T> cv = ::anpi::detail::paddedView(c);
+      d.allocate(a.rows(),a.cols());
+      elementwise<Op>(av,bv,cv,::anpi::detail::paddedView(d));
     }
 
-    // Non-SIMD types such as complex
-    template<typename T,
-             class Alloc,
-             typename std::enable_if<!is_simd_type<T>::value,int>::type = 0>
+    /*
+     * Sum
+     */
+
+    // On-copy implementation c=a+b
+    template<typename T,class Alloc>
     inline void add(const Matrix<T,Alloc>& a,
                     const Matrix<T,Alloc>& b,
                     Matrix<T,Alloc>& c) {
-      
-      ::anpi::fallback::add(a,b,c);
+      elementwise<ops::add>(a,b,c);
     }
 
     // In-place implementation a = a+b
     template<typename T,class Alloc>
     inline void add(Matrix<T,Alloc>& a,
                     const Matrix<T,Alloc>& b) {
+      elementwise<ops::add>(a,b);
+    }
 
-      add(a,b,a);
+    // Implementation on views c = a+b
+    template<typename T>
+    inline void add(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::add>(a,b,c);
     }
 
+    // In-place implementation on views a = a+b
+    template<typename T>
+    inline void add(const MatrixView<T>& a,
+                    const ConstMatrixView<T>& b) {
+      elementwise<ops::add>(a,b);
+    }
 
     /*
      * Subtraction
      */
 
-    // Fall back implementations
-
     // In-copy implementation c=a-b
     template<typename T,class Alloc>
     inline void subtract(const Matrix<T,Alloc>& a,
                          const Matrix<T,Alloc>& b,
                          Matrix<T,Alloc>& c) {
-      ::anpi::fallback::subtract(a,b,c);
+      elementwise<ops::subtract>(a,b,c);
     }
 
     // In-place implementation a = a-b
     template<typename T,class Alloc>
     inline void subtract(Matrix<T,Alloc>& a,
                          const Matrix<T,Alloc>& b) {
+      elementwise<ops::subtract>(a,b);
+    }
+
+    // Implementation on views c = a-b
+    template<typename T>
+    inline void subtract(const ConstMatrixView<T>& a,
+                         const ConstMatrixView<T>& b,
+                         const MatrixView<T>& c) {
+      elementwise<ops::subtract>(a,b,c);
+    }
+
+    // In-place implementation on views a = a-b
+    template<typename T>
+    inline void subtract(const MatrixView<T>& a,
+                         const ConstMatrixView<T>& b) {
+      elementwise<ops::subtract>(a,b);
+    }
+
+    /*
+     * Element-wise product
+     */
+
+    // In-copy implementation c=a.*b
+    template<typename T,class Alloc>
+    inline void multiply(const Matrix<T,Alloc>& a,
+                         const Matrix<T,Alloc>& b,
+                         Matrix<T,Alloc>& c) {
+      elementwise<ops::multiply>(a,b,c);
+    }
+
+    // In-place implementation a = a.*b
+    template<typename T,class Alloc>
+    inline void multiply(Matrix<T,Alloc>& a,
+                         const Matrix<T,Alloc>& b) {
+      elementwise<ops::multiply>(a,b);
+    }
+
+    // Implementation on views c = a.*b
+    template<typename T>
+    inline void multiply(const ConstMatrixView<T>& a,
+                         const ConstMatrixView<T>& b,
+                         const MatrixView<T>& c) {
+      elementwise<ops::multiply>(a,b,c);
+    }
+
+    // In-place implementation on views a = a.*b
+    template<typename T>
+    inline void multiply(const MatrixView<T>& a,
+                         const ConstMatrixView<T>& b) {
+      elementwise<ops::multiply>(a,b);
+    }
+
+    /*
+     * Element-wise division
+     */
+
+    // In-copy implementation c=a./b
+    template<typename T,class Alloc>
+    inline void divide(const Matrix<T,Alloc>& a,
+                       const Matrix<T,Alloc>& b,
+                       Matrix<T,Alloc>& c) {
+      elementwise<ops::divide>(a,b,c);
+    }
+
+    // In-place implementation a = a./b
+    template<typename T,class Alloc>
+    inline void divide(Matrix<T,Alloc>& a,
+                       const Matrix<T,Alloc>& b) {
+      elementwise<ops::divide>(a,b);
+    }
+
+    // Implementation on views c = a./b
+    template<typename T>
+    inline void divide(const ConstMatrixView<T>& a,
+                       const ConstMatrixView<T>& b,
+                       const MatrixView<T>& c) {
+      elementwise<ops::divide>(a,b,c);
+    }
+
+    // In-place implementation on views a = a./b
+    template<typename T>
+    inline void divide(const MatrixView<T>& a,
+                       const ConstMatrixView<T>& b) {
+      elementwise<ops::divide>(a,b);
+    }
+
+    /*
+     * Element-wise minimum
+     */
+
+    // In-copy implementation c=min(a,b)
+    template<typename T,class Alloc>
+    inline void min(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    Matrix<T,Alloc>& c) {
+      elementwise<ops::min>(a,b,c);
+    }
+
+    // In-place implementation a = min(a,b)
+    template<typename T,class Alloc>
+    inline void min(Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b) {
+      elementwise<ops::min>(a,b);
+    }
+
+    // Implementation on views c = min(a,b)
+    template<typename T>
+    inline void min(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::min>(a,b,c);
+    }
+
+    // In-place implementation on views a = min(a,b)
+    template<typename T>
+    inline void min(const MatrixView<T>& a,
+                    const ConstMatrixView<T>& b) {
+      elementwise<ops::min>(a,b);
+    }
+
+    /*
+     * Element-wise maximum
+     */
+
+    // In-copy implementation c=max(a,b)
+    template<typename T,class Alloc>
+    inline void max(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    Matrix<T,Alloc>& c) {
+      elementwise<ops::max>(a,b,c);
+    }
+
+    // In-place implementation a = max(a,b)
+    template<typename T,class Alloc>
+    inline void max(Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b) {
+      elementwise<ops::max>(a,b);
+    }
+
+    // Implementation on views c = max(a,b)
+    template<typename T>
+    inline void max(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::max>(a,b,c);
+    }
+
+    // In-place implementation on views a = max(a,b)
+    template<typename T>
+    inline void max(const MatrixView<T>& a,
+                    const ConstMatrixView<T>& b) {
+      elementwise<ops::max>(a,b);
+    }
+
+    /*
+     * Element-wise multiply-add
+     */
+
+    // In-copy implementation d=a.*b+c
+    template<typename T,class Alloc>
+    inline void fma(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    const Matrix<T,Alloc>& c,
+                    Matrix<T,Alloc>& d) {
+      elementwise<ops::fma>(a,b,c,d);
+    }
+
+    // Accumulating implementation c = a.*b+c
+    template<typename T,class Alloc>
+    inline void fma(const Matrix<T,Alloc>& a,
+                    const Matrix<T,Alloc>& b,
+                    Matrix<T,Alloc>& c) {
+      elementwise<ops::fma>(a,b,c,c);
+    }
+
+    // Implementation on views d = a.*b+c
+    template<typename T>
+    inline void fma(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const ConstMatrixView<T>& c,
+                    const MatrixView<T>& d) {
+      elementwise<ops::fma>(a,b,c,d);
+    }
+
+    // Accumulating implementation on views c = a.*b+c
+    template<typename T>
+    inline void fma(const ConstMatrixView<T>& a,
+                    const ConstMatrixView<T>& b,
+                    const MatrixView<T>& c) {
+      elementwise<ops::fma>(a,b,c,c);
+    }
+
+
+    /*
+     * Expressions
+     */
+
+    /*
+     * Evaluate the expression tree e into c.  If flat, each block of
+     * rows is computed in one single pass, including the dcols()-cols()
+     * entries after each row.
+     */
+    template<typename T,class E>
+    inline void evaluateRows(const E& e,const MatrixView<T>& c,
+                             const bool flat) {
+      typedef expression_kernel<E,T> kernel;
+
+      parallelRows(c.rows(),c.cols(),[&](const size_t first,
+                                         const size_t last) {
+        if (flat) {
+          // all operands share the layout of c: one single pass
+          dispatch<kernel>(e,first,c[first],(last-first)*c.dcols());
+        } else {
+          for (size_t r=first;r<last;++r) {
+            dispatch<kernel>(e,r,c[r],c.cols());
+          }
+        }
+      });
+    }
 
-      ::anpi::fallback::subtract(a,b);
+    // Evaluate the expression tree e into the view c
+    template<typename T,class E>
+    inline void evaluate(const MatrixExpression<E>& expr,
+                         const MatrixView<T>& c) {
+
+      static_assert(std::is_same<T,typename E::value_type>::value,
+                    "Expression and matrix must have the same type");
+
+      const E& e = expr.derived();
+      assert( (c.rows() == e.rows()) && (c.cols() == e.cols()) );
+
+      if (!dispatchable< expression_kernel<E,T> >()) {
+        // some operation is not in the table, or no SIMD support
+        ::anpi::fallback::evaluate(e,c);
+        return;
+      }
+
+      // the gaps between the rows of a view must not be written
+      evaluateRows(e,c,(c.cols() == c.dcols()) && e.flat(c.dcols()));
+    }
+
+    // Evaluate the expression tree e into c
+    template<typename T,class Alloc,class E>
+    inline void evaluate(const MatrixExpression<E>& expr,
+                         Matrix<T,Alloc>& c) {
+
+      static_assert(std::is_same<T,typename E::value_type>::value,
+                    "Expression and matrix must have the same type");
+
+      const E& e = expr.derived();
+
+      if (!dispatchable< expression_kernel<E,T> >()) {
+        ::anpi::fallback::evaluate(e,c);
+        return;
+      }
+
+      c.allocate(e.rows(),e.cols());
+
+      // the padding of c can be computed as well
+      evaluateRows(e,c.view(),e.flat(c.dcols()));
+    }
+
+    /*
+     * Memory transfers
+     */
+
+    // Copy n bytes with non-temporal stores
+    struct copy_kernel {
+      template<class Isa>
+      struct supported {
+        static constexpr bool value = memory_traits<Isa>::supported;
+      };
+
+      template<class Isa>
+      static void run(const char* src,char* dst,const size_t n) {
+        kernels<Isa>::copy(src,dst,n);
+      }
+    };
+
+    // True if a register of the Isa holds a whole number of Size bytes
+    template<class Isa,size_t Size,
+             bool Supported = memory_traits<Isa>::supported>
+    struct fills_register {
+      static constexpr bool value = false;
+    };
+
+    template<class Isa,size_t Size>
+    struct fills_register<Isa,Size,true> {
+      static constexpr bool value = (memory_traits<Isa>::bytes % Size) == 0;
+    };
+
+    // Fill n bytes repeating a pattern of Size bytes
+    template<size_t Size>
+    struct fill_kernel {
+      template<class Isa>
+      struct supported : fills_register<Isa,Size> {};
+
+      template<class Isa>
+      static void run(char* dst,const char* pattern,const size_t n,
+                      const bool stream) {
+        kernels<Isa>::fill(dst,pattern,n,stream);
+      }
+    };
+
+    // Set all entries of the view m to val
+    template<typename T>
+    inline void fill(const MatrixView<T>& m,const T val) {
+      // the value is replicated in the registers as a byte pattern
+      if (!std::is_trivially_copyable<T>::value ||
+          ((64 % sizeof(T)) != 0) ||
+          !dispatchable< fill_kernel<sizeof(T)> >()) {
+        ::anpi::fallback::fill(m,val);
+        return;
+      }
+
+      char pattern[128];
+      for (size_t i=0;i<sizeof(pattern);i+=sizeof(T)) {
+        std::memcpy(pattern+i,&val,sizeof(T));
+      }
+
+      const bool flat = m.contiguous();
+      const bool stream = (sizeof(T)*m.entries() >= streamingThreshold());
+
+      parallelRows(m.rows(),m.cols(),[&](const size_t first,
+                                         const size_t last) {
+        const size_t rows = flat ? first+1 : last;
+        const size_t bytes = sizeof(T)*(flat ? (last-first)*m.cols()
+                                             : m.cols());
+        for (size_t r=first;r<rows;++r) {
+          dispatch< fill_kernel<sizeof(T)> >(reinterpret_cast<char*>(m[r]),
+                                             static_cast<const char*>(pattern),
+                                             bytes,stream);
+        }
+      });
     }
+
+    // Copy the entries of the view src into the view dst
+    template<typename T>
+    inline void copy(const ConstMatrixView<T>& src,const MatrixView<T>& dst) {
+      assert( (src.rows() == dst.rows()) && (src.cols() == dst.cols()) );
+
+      // memcpy is already optimal for blocks that fit in the cache
+      if ((sizeof(T)*dst.entries() < streamingThreshold()) ||
+          !dispatchable<copy_kernel>()) {
+        ::anpi::fallback::copy(src,dst);
+        return;
+      }
+
+      const bool flat = src.contiguous() && dst.contiguous();
+
+      parallelRows(dst.rows(),dst.cols(),[&](const size_t first,
+                                             const size_t last) {
+        const size_t rows = flat ? first+1 : last;
+        const size_t bytes = sizeof(T)*(flat ? (last-first)*dst.cols()
+                                             : dst.cols());
+        for (size_t r=first;r<rows;++r) {
+          dispatch<copy_kernel>(reinterpret_cast<const char*>(src[r]),
+                                reinterpret_cast<char*>(dst[r]),
+                                bytes);
+        }
+      });
+    }
+
+    // Set all entries of m to val, including the padding
+    template<typename T,class Alloc>
+    inline void fill(Matrix<T,Alloc>& m,const T val) {
+      ::anpi::simd::fill(::anpi::detail::paddedView(m),val);
+    }
+
+    // Copy the memory block mem, with the layout of m, into m
+    template<typename T,class Alloc>
+    inline void fill(Matrix<T,Alloc>& m,const T* mem) {
+      ::anpi::simd::copy(ConstMatrixView<T>(mem,m.rows(),m.dcols(),m.dcols()),
+                         ::anpi::detail::paddedView(m));
+    }
+
   } // namespace simd
 
 
@@ -407,7 +1143,7 @@ namespace anpi
 #else
   namespace aimpl=fallback;
 #endif
-  
+
 } // namespace anpi
 
 #endif
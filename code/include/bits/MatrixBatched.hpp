@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_BATCHED_HPP
+#define ANPI_MATRIX_BATCHED_HPP
+
+#include "Intrinsics.hpp"
+#include "Parallel.hpp"
+#include "SimdDispatch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace anpi
+{
+  /**
+   * Blocking of the batched operations.
+   *
+   * The lanes of a batch are processed in chunks, so that the entries
+   * of all matrices of a chunk stay in the cache during the whole
+   * operation.  The chunks are distributed among the threads.
+   */
+  struct batched_blocking {
+    /// Matrices of each chunk
+    static constexpr size_t nc = 64;
+  };
+
+  namespace detail {
+
+    /**
+     * Call f(first,count) for chunks of the count lanes of a batch,
+     * distributed among the threads, with the given work per lane.
+     */
+    template<class F>
+    void parallelLanes(const size_t count,const size_t work,F f) {
+      const size_t nc = batched_blocking::nc;
+      const size_t chunks = (count + nc - 1)/nc;
+      parallelRows(chunks,nc*work,[&](const size_t fc,const size_t lc) {
+        for (size_t c=fc;c<lc;++c) {
+          const size_t first = c*nc;
+          f(first,std::min(nc,count-first));
+        }
+      });
+    }
+
+  } // namespace detail
+
+  namespace fallback {
+
+    /**
+     * Scalar kernels of the batched operations, on the lanes [0,count)
+     * of the interleaved matrices (see anpi::BatchedMatrix).  The lanes
+     * are the innermost loop, so that the compiler can vectorize them.
+     */
+    template<typename T>
+    struct batched_kernels {
+      // c = a*b for m x k matrices a and k x n matrices b
+      void product(const size_t m,const size_t k,const size_t n,
+                   const T* a,const size_t lda,
+                   const T* b,const size_t ldb,
+                   T* c,const size_t ldc,
+                   const size_t count) const {
+        for (size_t i=0;i<m;++i) {
+          for (size_t j=0;j<n;++j) {
+            T* cij = c + (i*n + j)*ldc;
+            std::fill(cij,cij+count,T(0));
+            for (size_t p=0;p<k;++p) {
+              const T* aip = a + (i*k + p)*lda;
+              const T* bpj = b + (p*n + j)*ldb;
+              for (size_t l=0;l<count;++l) {
+                cij[l] += aip[l]*bpj[l];
+              }
+            }
+          }
+        }
+      }
+
+      // step k of the LU factorization, with the pivots in row k
+      void eliminate(const size_t n,const size_t k,T* a,const size_t lda,
+                     const size_t count) const {
+        const T* akk = a + (k*n + k)*lda;
+        for (size_t i=k+1;i<n;++i) {
+          T* aik = a + (i*n + k)*lda;
+          for (size_t l=0;l<count;++l) {
+            aik[l] /= akk[l];
+          }
+          for (size_t j=k+1;j<n;++j) {
+            const T* akj = a + (k*n + j)*lda;
+            T* aij = a + (i*n + j)*lda;
+            for (size_t l=0;l<count;++l) {
+              aij[l] -= aik[l]*akj[l];
+            }
+          }
+        }
+      }
+
+      // X = U^-1 * L^-1 * B, with the rows of B already permuted
+      void substitute(const size_t n,const size_t m,
+                      const T* lu,const size_t lda,
+                      T* b,const size_t ldb,
+                      const size_t count) const {
+        for (size_t i=1;i<n;++i) {
+          for (size_t p=0;p<i;++p) {
+            const T* lip = lu + (i*n + p)*lda;
+            for (size_t j=0;j<m;++j) {
+              const T* bpj = b + (p*m + j)*ldb;
+              T* bij = b + (i*m + j)*ldb;
+              for (size_t l=0;l<count;++l) {
+                bij[l] -= lip[l]*bpj[l];
+              }
+            }
+          }
+        }
+        for (size_t i=n;i-- > 0;) {
+          for (size_t p=i+1;p<n;++p) {
+            const T* uip = lu + (i*n + p)*lda;
+            for (size_t j=0;j<m;++j) {
+              const T* bpj = b + (p*m + j)*ldb;
+              T* bij = b + (i*m + j)*ldb;
+              for (size_t l=0;l<count;++l) {
+                bij[l] -= uip[l]*bpj[l];
+              }
+            }
+          }
+          const T* uii = lu + (i*n + i)*lda;
+          for (size_t j=0;j<m;++j) {
+            T* bij = b + (i*m + j)*ldb;
+            for (size_t l=0;l<count;++l) {
+              bij[l] /= uii[l];
+            }
+          }
+        }
+      }
+    };
+
+    /**
+     * Products c = a*b of count pairs of m x k and k x n matrices,
+     * interleaved with the given lane strides.  c must not overlap a
+     * or b.
+     */
+    template<typename T,class Kernels>
+    void batchedProduct(const size_t m,const size_t k,const size_t n,
+                        const T* a,const size_t lda,
+                        const T* b,const size_t ldb,
+                        T* c,const size_t ldc,
+                        const size_t count,
+                        const Kernels& kernels) {
+      detail::parallelLanes(count,m*n*k,[&](const size_t first,
+                                            const size_t lanes) {
+        kernels.product(m,k,n,a+first,lda,b+first,ldb,c+first,ldc,lanes);
+      });
+    }
+
+    /**
+     * LU factorization with partial pivoting of count n x n matrices,
+     * in place.  The pivot of step k of the matrix in lane l is stored
+     * in piv[k*ldp + l], and singular[l] tells if some pivot of the
+     * matrix was zero, in which case its factors are undefined.
+     *
+     * The pivots are searched and exchanged lane by lane, since each
+     * matrix has its own, but the elimination processes all lanes at
+     * once.
+     */
+    template<typename T,class Kernels>
+    void batchedLU(const size_t n,
+                   T* a,const size_t lda,
+                   size_t* piv,const size_t ldp,
+                   char* singular,
+                   const size_t count,
+                   const Kernels& kernels) {
+      detail::parallelLanes(count,n*n*n,[&](const size_t first,
+                                            const size_t lanes) {
+        T* ac = a + first;
+        std::fill(singular+first,singular+first+lanes,char(0));
+        for (size_t k=0;k<n;++k) {
+          for (size_t l=0;l<lanes;++l) {
+            size_t p = k;
+            T largest = std::abs(ac[(k*n + k)*lda + l]);
+            for (size_t i=k+1;i<n;++i) {
+              const T v = std::abs(ac[(i*n + k)*lda + l]);
+              if (v > largest) {
+                largest = v;
+                p = i;
+              }
+            }
+            piv[k*ldp + first + l] = p;
+            if (largest == T(0)) {
+              singular[first + l] = 1;
+            } else if (p != k) {
+              for (size_t j=0;j<n;++j) {
+                std::swap(ac[(k*n + j)*lda + l],ac[(p*n + j)*lda + l]);
+              }
+            }
+          }
+          kernels.eliminate(n,k,ac,lda,lanes);
+        }
+      });
+    }
+
+    /**
+     * Solution of A*X = B for count n x n matrices factorized by
+     * batchedLU() and n x m matrices b, overwritten with X.
+     */
+    template<typename T,class Kernels>
+    void batchedSolve(const size_t n,const size_t m,
+                      const T* lu,const size_t lda,
+                      const size_t* piv,const size_t ldp,
+                      T* b,const size_t ldb,
+                      const size_t count,
+                      const Kernels& kernels) {
+      detail::parallelLanes(count,n*n*m,[&](const size_t first,
+                                            const size_t lanes) {
+        T* bc = b + first;
+        for (size_t k=0;k<n;++k) {
+          const size_t* pk = piv + k*ldp + first;
+          for (size_t l=0;l<lanes;++l) {
+            const size_t p = pk[l];
+            if (p != k) {
+              for (size_t j=0;j<m;++j) {
+                std::swap(bc[(k*m + j)*ldb + l],bc[(p*m + j)*ldb + l]);
+              }
+            }
+          }
+        }
+        kernels.substitute(n,m,lu+first,lda,bc,ldb,lanes);
+      });
+    }
+
+    /// Batched product with the scalar kernels
+    template<typename T>
+    inline void batchedProduct(const size_t m,const size_t k,const size_t n,
+                               const T* a,const size_t lda,
+                               const T* b,const size_t ldb,
+                               T* c,const size_t ldc,
+                               const size_t count) {
+      ::anpi::fallback::batchedProduct(m,k,n,a,lda,b,ldb,c,ldc,count,
+                                       batched_kernels<T>());
+    }
+
+    /// Batched LU factorization with the scalar kernels
+    template<typename T>
+    inline void batchedLU(const size_t n,T* a,const size_t lda,
+                          size_t* piv,const size_t ldp,char* singular,
+                          const size_t count) {
+      ::anpi::fallback::batchedLU(n,a,lda,piv,ldp,singular,count,
+                                  batched_kernels<T>());
+    }
+
+    /// Batched solution with the scalar kernels
+    template<typename T>
+    inline void batchedSolve(const size_t n,const size_t m,
+                             const T* lu,const size_t lda,
+                             const size_t* piv,const size_t ldp,
+                             T* b,const size_t ldb,
+                             const size_t count) {
+      ::anpi::fallback::batchedSolve(n,m,lu,lda,piv,ldp,b,ldb,count,
+                                     batched_kernels<T>());
+    }
+
+  } // namespace fallback
+
+  namespace simd {
+
+    // c = a*b for the interleaved matrices
+    template<typename T>
+    struct batched_product_kernel {
+      template<class Isa>
+      struct supported : is_simd_op<ops::fma,Isa,T> {};
+
+      template<class Isa>
+      static void run(const size_t m,const size_t k,const size_t n,
+                      const T* a,const size_t lda,
+                      const T* b,const size_t ldb,
+                      T* c,const size_t ldc,
+                      const size_t count,size_t* done) {
+        *done = kernels<Isa>::batchedProduct(m,k,n,a,lda,b,ldb,c,ldc,count);
+      }
+    };
+
+    // LU factorization and substitution need all four operations
+    template<class Isa,typename T>
+    struct batched_solve_supported
+      : std::integral_constant<bool,
+                               is_simd_op<ops::fma,Isa,T>::value &&
+                               is_simd_op<ops::multiply,Isa,T>::value &&
+                               is_simd_op<ops::subtract,Isa,T>::value &&
+                               is_simd_op<ops::divide,Isa,T>::value> {};
+
+    // step k of the LU factorization of the interleaved matrices
+    template<typename T>
+    struct batched_eliminate_kernel {
+      template<class Isa>
+      struct supported : batched_solve_supported<Isa,T> {};
+
+      template<class Isa>
+      static void run(const size_t n,const size_t k,T* a,const size_t lda,
+                      const size_t count,size_t* done) {
+        *done = kernels<Isa>::batchedEliminate(n,k,a,lda,count);
+      }
+    };
+
+    // substitution with the LU factors of the interleaved matrices
+    template<typename T>
+    struct batched_substitute_kernel {
+      template<class Isa>
+      struct supported : batched_solve_supported<Isa,T> {};
+
+      template<class Isa>
+      static void run(const size_t n,const size_t m,
+                      const T* lu,const size_t lda,
+                      T* b,const size_t ldb,
+                      const size_t count,size_t* done) {
+        *done = kernels<Isa>::batchedSubstitute(n,m,lu,lda,b,ldb,count);
+      }
+    };
+
+    /**
+     * SIMD kernels of the batched operations.  The lanes left over by
+     * the registers are computed with the scalar kernels.
+     */
+    template<typename T>
+    struct batched_kernels {
+      void product(const size_t m,const size_t k,const size_t n,
+                   const T* a,const size_t lda,
+                   const T* b,const size_t ldb,
+                   T* c,const size_t ldc,
+                   const size_t count) const {
+        size_t done = 0;
+        dispatch< batched_product_kernel<T> >(m,k,n,a,lda,b,ldb,c,ldc,
+                                              count,&done);
+        ::anpi::fallback::batched_kernels<T>().product(m,k,n,
+                                                       a+done,lda,
+                                                       b+done,ldb,
+                                                       c+done,ldc,
+                                                       count-done);
+      }
+
+      void eliminate(const size_t n,const size_t k,T* a,const size_t lda,
+                     const size_t count) const {
+        size_t done = 0;
+        dispatch< batched_eliminate_kernel<T> >(n,k,a,lda,count,&done);
+        ::anpi::fallback::batched_kernels<T>().eliminate(n,k,a+done,lda,
+                                                         count-done);
+      }
+
+      void substitute(const size_t n,const size_t m,
+                      const T* lu,const size_t lda,
+                      T* b,const size_t ldb,
+                      const size_t count) const {
+        size_t done = 0;
+        dispatch< batched_substitute_kernel<T> >(n,m,lu,lda,b,ldb,
+                                                 count,&done);
+        ::anpi::fallback::batched_kernels<T>().substitute(n,m,
+                                                          lu+done,lda,
+                                                          b+done,ldb,
+                                                          count-done);
+      }
+    };
+
+    /// Batched product with the SIMD kernels, if available
+    template<typename T>
+    inline void batchedProduct(const size_t m,const size_t k,const size_t n,
+                               const T* a,const size_t lda,
+                               const T* b,const size_t ldb,
+                               T* c,const size_t ldc,
+                               const size_t count) {
+      if (!dispatchable< batched_product_kernel<T> >()) {
+        ::anpi::fallback::batchedProduct(m,k,n,a,lda,b,ldb,c,ldc,count);
+        return;
+      }
+      ::anpi::fallback::batchedProduct(m,k,n,a,lda,b,ldb,c,ldc,count,
+                                       batched_kernels<T>());
+    }
+
+    /// Batched LU factorization with the SIMD kernels, if available
+    template<typename T>
+    inline void batchedLU(const size_t n,T* a,const size_t lda,
+                          size_t* piv,const size_t ldp,char* singular,
+                          const size_t count) {
+      if (!dispatchable< batched_eliminate_kernel<T> >()) {
+        ::anpi::fallback::batchedLU(n,a,lda,piv,ldp,singular,count);
+        return;
+      }
+      ::anpi::fallback::batchedLU(n,a,lda,piv,ldp,singular,count,
+                                  batched_kernels<T>());
+    }
+
+    /// Batched solution with the SIMD kernels, if available
+    template<typename T>
+    inline void batchedSolve(const size_t n,const size_t m,
+                             const T* lu,const size_t lda,
+                             const size_t* piv,const size_t ldp,
+                             T* b,const size_t ldb,
+                             const size_t count) {
+      if (!dispatchable< batched_substitute_kernel<T> >()) {
+        ::anpi::fallback::batchedSolve(n,m,lu,lda,piv,ldp,b,ldb,count);
+        return;
+      }
+      ::anpi::fallback::batchedSolve(n,m,lu,lda,piv,ldp,b,ldb,count,
+                                     batched_kernels<T>());
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
@@ -0,0 +1,861 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_EXPRESSION_HPP
+#define ANPI_MATRIX_EXPRESSION_HPP
+
+#include <cstddef>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+
+#include "HalfFloat.hpp"
+#include "MatrixLayout.hpp"
+
+namespace anpi
+{
+  template<typename T> class ConstMatrixView;
+
+  /**
+   * Base class of all lazy matrix expressions.
+   *
+   * Element-wise operators on matrices do not compute anything: they
+   * just build a tree of expression nodes, which is evaluated in one
+   * single pass over the memory when it is assigned to a Matrix.  In
+   * this way, a chain like
+   *
+   * \code
+   * d = a + b - c + e;
+   * \endcode
+   *
+   * does not create any temporary matrices.
+   *
+   * The expressions hold references to the data of the matrices
+   * involved, so they must not outlive them.  In particular, do not
+   * store expressions with \c auto.
+   *
+   * This uses the CRTP, i.e. E is the derived expression class.
+   */
+  template<class E>
+  class MatrixExpression {
+  public:
+    /// Downcast to the real expression
+    inline const E& derived() const { return static_cast<const E&>(*this); }
+  };
+
+  /**
+   * Leaf of an expression tree, refering to the data of a matrix
+   */
+  template<typename T>
+  class MatrixReference : public MatrixExpression< MatrixReference<T> > {
+  public:
+    typedef T value_type;
+
+  protected:
+    /// Data of the refered matrix
+    const T* _data;
+    /// Number of rows
+    size_t _rows;
+    /// Effective number of columns
+    size_t _cols;
+    /// Dominant number of columns (including padding)
+    size_t _dcols;
+    /// The padding of the rows can be read (it belongs to a matrix)
+    bool _padded;
+
+  public:
+    /// Refer to the given matrix
+    template<class Alloc>
+    inline MatrixReference(const Matrix<T,Alloc>& m)
+      : _data(m.data()),_rows(m.rows()),_cols(m.cols()),_dcols(m.dcols()),
+        _padded(true) {}
+
+    /**
+     * Refer to the given view.  The gaps between its rows may belong
+     * to other blocks, or even lie outside the matrix.
+     */
+    inline MatrixReference(const ConstMatrixView<T>& v)
+      : _data(v.data()),_rows(v.rows()),_cols(v.cols()),_dcols(v.dcols()),
+        _padded(v.cols()==v.dcols()) {}
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /**
+     * Check if this expression can be evaluated as one contiguous
+     * block of memory with the given number of dominant columns
+     */
+    inline bool flat(const size_t dcols) const {
+      return _padded && (_dcols==dcols);
+    }
+
+    /// Pointer to the entry at the given row and column
+    inline const T* ptr(const size_t row,const size_t col) const {
+      return _data + (row*_dcols + col);
+    }
+
+    /// Value at the given row and column
+    inline T coeff(const size_t row,const size_t col) const {
+      return *ptr(row,col);
+    }
+  };
+
+  /**
+   * Leaf of an expression tree holding one scalar, which is used for
+   * all entries of the matrix
+   */
+  template<typename T>
+  class ScalarExpression : public MatrixExpression< ScalarExpression<T> > {
+  public:
+    typedef T value_type;
+
+  protected:
+    /// The scalar value
+    T _value;
+    /// Number of rows
+    size_t _rows;
+    /// Number of columns
+    size_t _cols;
+
+  public:
+    /// Construct a rows x cols matrix with all elements equal to value
+    inline ScalarExpression(const T value,const size_t rows,const size_t cols)
+      : _value(value),_rows(rows),_cols(cols) {}
+
+    /// Number of rows
+    inline size_t rows() const { return _rows; }
+    /// Number of columns
+    inline size_t cols() const { return _cols; }
+
+    /// Scalars adapt to any memory layout
+    inline bool flat(const size_t) const { return true; }
+
+    /// The scalar value
+    inline T value() const { return _value; }
+
+    /// Value at the given row and column
+    inline T coeff(const size_t,const size_t) const { return _value; }
+  };
+
+  /**
+   * Expression node combining two subexpressions with the Op functor
+   */
+  template<class Op,class L,class R>
+  class BinaryExpression
+    : public MatrixExpression< BinaryExpression<Op,L,R> > {
+  public:
+    typedef typename L::value_type value_type;
+
+    static_assert(std::is_same<value_type,
+                               typename R::value_type>::value,
+                  "Both operands must have the same type of elements");
+
+  protected:
+    /// Left operand
+    L _lhs;
+    /// Right operand
+    R _rhs;
+
+  public:
+    /// Construct the node with both operands
+    inline BinaryExpression(const L& lhs,const R& rhs)
+      : _lhs(lhs),_rhs(rhs) {
+      assert( (lhs.rows() == rhs.rows()) &&
+              (lhs.cols() == rhs.cols()) );
+    }
+
+    /// Left operand
+    inline const L& lhs() const { return _lhs; }
+    /// Right operand
+    inline const R& rhs() const { return _rhs; }
+
+    /// Number of rows
+    inline size_t rows() const { return _lhs.rows(); }
+    /// Number of columns
+    inline size_t cols() const { return _lhs.cols(); }
+
+    /// Contiguous evaluation is possible if both operands allow it
+    inline bool flat(const size_t dcols) const {
+      return _lhs.flat(dcols) && _rhs.flat(dcols);
+    }
+
+    /// Value at the given row and column
+    inline value_type coeff(const size_t row,const size_t col) const {
+      return Op::apply(_lhs.coeff(row,col),_rhs.coeff(row,col));
+    }
+  };
+
+  /**
+   * Expression node combining three subexpressions with the Op functor
+   */
+  template<class Op,class A,class B,class C>
+  class TernaryExpression
+    : public MatrixExpression< TernaryExpression<Op,A,B,C> > {
+  public:
+    typedef typename A::value_type value_type;
+
+    static_assert(std::is_same<value_type,typename B::value_type>::value &&
+                  std::is_same<value_type,typename C::value_type>::value,
+                  "All operands must have the same type of elements");
+
+  protected:
+    /// First operand
+    A _a;
+    /// Second operand
+    B _b;
+    /// Third operand
+    C _c;
+
+  public:
+    /// Construct the node with all operands
+    inline TernaryExpression(const A& a,const B& b,const C& c)
+      : _a(a),_b(b),_c(c) {
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) &&
+              (a.rows() == c.rows()) && (a.cols() == c.cols()) );
+    }
+
+    /// First operand
+    inline const A& first() const { return _a; }
+    /// Second operand
+    inline const B& second() const { return _b; }
+    /// Third operand
+    inline const C& third() const { return _c; }
+
+    /// Number of rows
+    inline size_t rows() const { return _a.rows(); }
+    /// Number of columns
+    inline size_t cols() const { return _a.cols(); }
+
+    /// Contiguous evaluation is possible if all operands allow it
+    inline bool flat(const size_t dcols) const {
+      return _a.flat(dcols) && _b.flat(dcols) && _c.flat(dcols);
+    }
+
+    /// Value at the given row and column
+    inline value_type coeff(const size_t row,const size_t col) const {
+      return Op::apply(_a.coeff(row,col),
+                       _b.coeff(row,col),
+                       _c.coeff(row,col));
+    }
+  };
+
+  /**
+   * Element-wise operations used in the expression nodes
+   */
+  namespace ops {
+    /// Element-wise addition
+    struct add {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return a+b; }
+    };
+
+    /// Element-wise subtraction
+    struct subtract {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return a-b; }
+    };
+
+    /// Element-wise (Hadamard) product
+    struct multiply {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return a*b; }
+    };
+
+    /// Element-wise division
+    struct divide {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return a/b; }
+    };
+
+    /// Element-wise minimum
+    struct min {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return (a<b) ? a : b; }
+    };
+
+    /// Element-wise maximum
+    struct max {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return (a>b) ? a : b; }
+    };
+
+    /// Element-wise multiply-add a*b+c
+    struct fma {
+      template<typename T>
+      static inline T apply(const T a,const T b,const T c) { return a*b+c; }
+
+      // 16 bit floats round only the final result
+      template<class Conv>
+      static inline detail::half_float<Conv>
+      apply(const detail::half_float<Conv> a,
+            const detail::half_float<Conv> b,
+            const detail::half_float<Conv> c) {
+        return detail::half_float<Conv>(float(a)*float(b) + float(c));
+      }
+    };
+
+    /*
+     * Unary maps applied on each entry by the reductions
+     */
+
+    /// The entry itself
+    struct identity {
+      template<typename T>
+      static inline T apply(const T a) { return a; }
+    };
+
+    /// Absolute value, or magnitude of complex numbers
+    struct absolute {
+      template<typename T>
+      static inline T apply(const T a) {
+        return apply(a,std::is_unsigned<T>());
+      }
+    private:
+      template<typename T>
+      static inline T apply(const T a,std::true_type) { return a; }
+
+      template<typename T>
+      static inline T apply(const T a,std::false_type) {
+        return static_cast<T>(std::abs(a));
+      }
+    };
+
+    /// Squared absolute value
+    struct square {
+      template<typename T>
+      static inline T apply(const T a) { return a*a; }
+
+      template<typename T>
+      static inline std::complex<T> apply(const std::complex<T> a) {
+        return std::norm(a);
+      }
+    };
+
+    /**
+     * Map on the entries a and b of the operands of a reduction.  The
+     * unary maps ignore b.
+     */
+    template<class Map>
+    struct map_entry {
+      template<typename T>
+      static inline T apply(const T a,const T) { return Map::apply(a); }
+    };
+
+    template<>
+    struct map_entry<multiply> {
+      template<typename T>
+      static inline T apply(const T a,const T b) { return a*b; }
+    };
+  } // namespace ops
+
+
+  /**
+   * Map the operands of the element-wise operators to the types
+   * stored in the expression trees.  Matrices are stored as
+   * references, and expressions are stored by value.
+   */
+  template<class M>
+  struct expression_operand {
+    static constexpr bool value = false;
+  };
+
+  // Any row-major matrix is refered with a MatrixReference
+  template<typename T,class Alloc>
+  struct expression_operand< Matrix<T,Alloc> > {
+    static constexpr bool value = true;
+    typedef MatrixReference<T> type;
+  };
+
+  // Expressions are copied as they are
+  template<typename T>
+  struct expression_operand< MatrixReference<T> > {
+    static constexpr bool value = true;
+    typedef MatrixReference<T> type;
+  };
+
+  // Expressions are copied as they are
+  template<typename T>
+  struct expression_operand< ScalarExpression<T> > {
+    static constexpr bool value = true;
+    typedef ScalarExpression<T> type;
+  };
+
+  // Expressions are copied as they are
+  template<class Op,class L,class R>
+  struct expression_operand< BinaryExpression<Op,L,R> > {
+    static constexpr bool value = true;
+    typedef BinaryExpression<Op,L,R> type;
+  };
+
+  // Expressions are copied as they are
+  template<class Op,class A,class B,class C>
+  struct expression_operand< TernaryExpression<Op,A,B,C> > {
+    static constexpr bool value = true;
+    typedef TernaryExpression<Op,A,B,C> type;
+  };
+
+  /**
+   * Type of the expression node resulting of applying Op on L and R,
+   * only defined if both are valid operands
+   */
+  template<class Op,class L,class R,
+           bool = (expression_operand<L>::value &&
+                   expression_operand<R>::value)>
+  struct binary_expression {
+  };
+
+  // Both operands are valid
+  template<class Op,class L,class R>
+  struct binary_expression<Op,L,R,true> {
+    typedef BinaryExpression<Op,
+                             typename expression_operand<L>::type,
+                             typename expression_operand<R>::type> type;
+  };
+
+  /**
+   * Type of the expression node resulting of applying Op on A, B and C,
+   * only defined if all are valid operands
+   */
+  template<class Op,class A,class B,class C,
+           bool = (expression_operand<A>::value &&
+                   expression_operand<B>::value &&
+                   expression_operand<C>::value)>
+  struct ternary_expression {
+  };
+
+  // All operands are valid
+  template<class Op,class A,class B,class C>
+  struct ternary_expression<Op,A,B,C,true> {
+    typedef TernaryExpression<Op,
+                              typename expression_operand<A>::type,
+                              typename expression_operand<B>::type,
+                              typename expression_operand<C>::type> type;
+  };
+
+  /**
+   * Type of the expression node resulting of applying Op on a scalar
+   * and the operand M, only defined if M is a valid operand
+   */
+  template<class Op,class M,bool = expression_operand<M>::value>
+  struct scalar_expression {
+  };
+
+  // Valid operand
+  template<class Op,class M>
+  struct scalar_expression<Op,M,true> {
+    typedef typename expression_operand<M>::type operand_type;
+    typedef typename operand_type::value_type value_type;
+    typedef ScalarExpression<value_type> scalar_type;
+
+    /// Node with the scalar as left operand
+    typedef BinaryExpression<Op,scalar_type,operand_type> left;
+    /// Node with the scalar as right operand
+    typedef BinaryExpression<Op,operand_type,scalar_type> right;
+  };
+
+  /**
+   * @name Lazy element-wise arithmetic operators
+   */
+  //@{
+
+  /// Sum of two matrices or expressions
+  template<class L,class R>
+  inline typename binary_expression<ops::add,L,R>::type
+  operator+(const L& a,const R& b) {
+    return typename binary_expression<ops::add,L,R>::type(a,b);
+  }
+
+  /// Difference of two matrices or expressions
+  template<class L,class R>
+  inline typename binary_expression<ops::subtract,L,R>::type
+  operator-(const L& a,const R& b) {
+    return typename binary_expression<ops::subtract,L,R>::type(a,b);
+  }
+
+  /// Element-wise quotient of two matrices or expressions
+  template<class L,class R>
+  inline typename binary_expression<ops::divide,L,R>::type
+  operator/(const L& a,const R& b) {
+    return typename binary_expression<ops::divide,L,R>::type(a,b);
+  }
+
+  /// Product of a scalar and a matrix or expression
+  template<class M>
+  inline typename scalar_expression<ops::multiply,M>::left
+  operator*(const typename scalar_expression<ops::multiply,M>::value_type s,
+            const M& m) {
+    typedef scalar_expression<ops::multiply,M> se;
+    const typename se::operand_type op(m);
+    return typename se::left(typename se::scalar_type(s,op.rows(),op.cols()),
+                             op);
+  }
+
+  /// Product of a matrix or expression and a scalar
+  template<class M>
+  inline typename scalar_expression<ops::multiply,M>::right
+  operator*(const M& m,
+            const typename scalar_expression<ops::multiply,M>::value_type s) {
+    typedef scalar_expression<ops::multiply,M> se;
+    const typename se::operand_type op(m);
+    return typename se::right(op,
+                              typename se::scalar_type(s,op.rows(),op.cols()));
+  }
+
+  /// Quotient of a matrix or expression and a scalar
+  template<class M>
+  inline typename scalar_expression<ops::divide,M>::right
+  operator/(const M& m,
+            const typename scalar_expression<ops::divide,M>::value_type s) {
+    typedef scalar_expression<ops::divide,M> se;
+    const typename se::operand_type op(m);
+    return typename se::right(op,
+                              typename se::scalar_type(s,op.rows(),op.cols()));
+  }
+  //@}
+
+  /**
+   * @name Lazy element-wise functions
+   *
+   * The element-wise product is not an operator, as the operator*
+   * between matrices is reserved for the matrix product.
+   */
+  //@{
+
+  /// Element-wise (Hadamard) product of two matrices or expressions
+  template<class L,class R>
+  inline typename binary_expression<ops::multiply,L,R>::type
+  multiply(const L& a,const R& b) {
+    return typename binary_expression<ops::multiply,L,R>::type(a,b);
+  }
+
+  /// Element-wise quotient of two matrices or expressions
+  template<class L,class R>
+  inline typename binary_expression<ops::divide,L,R>::type
+  divide(const L& a,const R& b) {
+    return typename binary_expression<ops::divide,L,R>::type(a,b);
+  }
+
+  /// Element-wise minimum of two matrices or expressions
+  template<class L,class R>
+  inline typename binary_expression<ops::min,L,R>::type
+  min(const L& a,const R& b) {
+    return typename binary_expression<ops::min,L,R>::type(a,b);
+  }
+
+  /// Element-wise maximum of two matrices or expressions
+  template<class L,class R>
+  inline typename binary_expression<ops::max,L,R>::type
+  max(const L& a,const R& b) {
+    return typename binary_expression<ops::max,L,R>::type(a,b);
+  }
+
+  /// Element-wise multiply-add a*b+c of three matrices or expressions
+  template<class A,class B,class C>
+  inline typename ternary_expression<ops::fma,A,B,C>::type
+  fma(const A& a,const B& b,const C& c) {
+    return typename ternary_expression<ops::fma,A,B,C>::type(a,b,c);
+  }
+  //@}
+
+  /**
+   * Type M of the result of an element-wise operation between an
+   * expiring matrix of type M and the operand O, only defined if O is
+   * a valid operand
+   */
+  template<class M,class O,bool = expression_operand<O>::value>
+  struct reusing_expression {
+  };
+
+  // Valid operand
+  template<class M,class O>
+  struct reusing_expression<M,O,true> {
+    typedef M type;
+  };
+
+  /// Check if an operand deduced by a forwarding reference expires
+  template<class M>
+  struct expiring_matrix {
+    static constexpr bool value = false;
+  };
+
+  // Rvalues are deduced as the plain matrix type
+  template<typename T,class Alloc>
+  struct expiring_matrix< Matrix<T,Alloc> > {
+    static constexpr bool value = true;
+  };
+
+  /**
+   * Position (0, 1 or 2) of the first temporary matrix among the
+   * operands of fma(), as deduced by forwarding references, and type
+   * of the result reusing it.  The type is only defined if some
+   * operand is a temporary matrix and all are valid operands.
+   */
+  template<class A,class B,class C,
+           int Operand = (expiring_matrix<A>::value ? 0 :
+                          expiring_matrix<B>::value ? 1 :
+                          expiring_matrix<C>::value ? 2 : -1),
+           bool = (expression_operand<typename std::decay<A>::type>::value &&
+                   expression_operand<typename std::decay<B>::type>::value &&
+                   expression_operand<typename std::decay<C>::type>::value)>
+  struct reusing_fma {
+  };
+
+  // The first operand expires
+  template<class A,class B,class C>
+  struct reusing_fma<A,B,C,0,true> {
+    static constexpr int operand = 0;
+    typedef A type;
+  };
+
+  // The second operand expires
+  template<class A,class B,class C>
+  struct reusing_fma<A,B,C,1,true> {
+    static constexpr int operand = 1;
+    typedef B type;
+  };
+
+  // The third operand expires
+  template<class A,class B,class C>
+  struct reusing_fma<A,B,C,2,true> {
+    static constexpr int operand = 2;
+    typedef C type;
+  };
+
+  namespace detail {
+    /// Evaluate e into the matrix m, which e may read, and give m away
+    template<typename T,class Alloc,class E>
+    inline Matrix<T,Alloc> reuse(Matrix<T,Alloc>& m,
+                                 const MatrixExpression<E>& e) {
+      m = e;
+      return std::move(m);
+    }
+
+    // Multiply-add into the memory of a
+    template<class A,class B,class C>
+    inline A reuseFma(std::integral_constant<int,0>,A& a,B& b,C& c) {
+      return reuse(a,::anpi::fma(a,b,c));
+    }
+
+    // Multiply-add into the memory of b
+    template<class A,class B,class C>
+    inline B reuseFma(std::integral_constant<int,1>,A& a,B& b,C& c) {
+      return reuse(b,::anpi::fma(a,b,c));
+    }
+
+    // Multiply-add into the memory of c
+    template<class A,class B,class C>
+    inline C reuseFma(std::integral_constant<int,2>,A& a,B& b,C& c) {
+      return reuse(c,::anpi::fma(a,b,c));
+    }
+  } // namespace detail
+
+  /**
+   * @name Element-wise operations on expiring matrices
+   *
+   * If an operand is a temporary matrix, as the result of a function
+   * or of a product, the operation is computed in place into its
+   * memory, which is then moved to the result.  In this way
+   *
+   * \code
+   * anpi::Matrix<float> d = a*b + c - e;
+   * \endcode
+   *
+   * allocates only the matrix product.  The operations on two lvalue
+   * operands remain lazy expressions.
+   */
+  //@{
+
+  /// Sum into the memory of the expiring matrix a
+  template<typename T,class Alloc,class R>
+  inline typename reusing_expression<Matrix<T,Alloc>,R>::type
+  operator+(Matrix<T,Alloc>&& a,const R& b) {
+    return detail::reuse(a,a + b);
+  }
+
+  /// Sum into the memory of the expiring matrix b
+  template<class L,typename T,class Alloc>
+  inline typename reusing_expression<Matrix<T,Alloc>,L>::type
+  operator+(const L& a,Matrix<T,Alloc>&& b) {
+    return detail::reuse(b,a + b);
+  }
+
+  /// Sum into the memory of the expiring matrix a
+  template<typename T,class LAlloc,class RAlloc>
+  inline Matrix<T,LAlloc> operator+(Matrix<T,LAlloc>&& a,Matrix<T,RAlloc>&& b) {
+    return detail::reuse(a,a + b);
+  }
+
+  /// Difference into the memory of the expiring matrix a
+  template<typename T,class Alloc,class R>
+  inline typename reusing_expression<Matrix<T,Alloc>,R>::type
+  operator-(Matrix<T,Alloc>&& a,const R& b) {
+    return detail::reuse(a,a - b);
+  }
+
+  /// Difference into the memory of the expiring matrix b
+  template<class L,typename T,class Alloc>
+  inline typename reusing_expression<Matrix<T,Alloc>,L>::type
+  operator-(const L& a,Matrix<T,Alloc>&& b) {
+    return detail::reuse(b,a - b);
+  }
+
+  /// Difference into the memory of the expiring matrix a
+  template<typename T,class LAlloc,class RAlloc>
+  inline Matrix<T,LAlloc> operator-(Matrix<T,LAlloc>&& a,Matrix<T,RAlloc>&& b) {
+    return detail::reuse(a,a - b);
+  }
+
+  /// Element-wise quotient into the memory of the expiring matrix a
+  template<typename T,class Alloc,class R>
+  inline typename reusing_expression<Matrix<T,Alloc>,R>::type
+  operator/(Matrix<T,Alloc>&& a,const R& b) {
+    return detail::reuse(a,a / b);
+  }
+
+  /// Element-wise quotient into the memory of the expiring matrix b
+  template<class L,typename T,class Alloc>
+  inline typename reusing_expression<Matrix<T,Alloc>,L>::type
+  operator/(const L& a,Matrix<T,Alloc>&& b) {
+    return detail::reuse(b,a / b);
+  }
+
+  /// Element-wise quotient into the memory of the expiring matrix a
+  template<typename T,class LAlloc,class RAlloc>
+  inline Matrix<T,LAlloc> operator/(Matrix<T,LAlloc>&& a,Matrix<T,RAlloc>&& b) {
+    return detail::reuse(a,a / b);
+  }
+
+  /// Product of a scalar and the expiring matrix m, in its memory
+  template<typename T,class Alloc>
+  inline Matrix<T,Alloc>
+  operator*(const typename Matrix<T,Alloc>::value_type s,
+            Matrix<T,Alloc>&& m) {
+    return detail::reuse(m,s*m);
+  }
+
+  /// Product of the expiring matrix m and a scalar, in its memory
+  template<typename T,class Alloc>
+  inline Matrix<T,Alloc>
+  operator*(Matrix<T,Alloc>&& m,
+            const typename Matrix<T,Alloc>::value_type s) {
+    return detail::reuse(m,m*s);
+  }
+
+  /// Quotient of the expiring matrix m and a scalar, in its memory
+  template<typename T,class Alloc>
+  inline Matrix<T,Alloc>
+  operator/(Matrix<T,Alloc>&& m,
+            const typename Matrix<T,Alloc>::value_type s) {
+    return detail::reuse(m,m/s);
+  }
+
+  /// Element-wise product into the memory of the expiring matrix a
+  template<typename T,class Alloc,class R>
+  inline typename reusing_expression<Matrix<T,Alloc>,R>::type
+  multiply(Matrix<T,Alloc>&& a,const R& b) {
+    return detail::reuse(a,::anpi::multiply(a,b));
+  }
+
+  /// Element-wise product into the memory of the expiring matrix b
+  template<class L,typename T,class Alloc>
+  inline typename reusing_expression<Matrix<T,Alloc>,L>::type
+  multiply(const L& a,Matrix<T,Alloc>&& b) {
+    return detail::reuse(b,::anpi::multiply(a,b));
+  }
+
+  /// Element-wise product into the memory of the expiring matrix a
+  template<typename T,class LAlloc,class RAlloc>
+  inline Matrix<T,LAlloc> multiply(Matrix<T,LAlloc>&& a,Matrix<T,RAlloc>&& b) {
+    return detail::reuse(a,::anpi::multiply(a,b));
+  }
+
+  /// Element-wise quotient into the memory of the expiring matrix a
+  template<typename T,class Alloc,class R>
+  inline typename reusing_expression<Matrix<T,Alloc>,R>::type
+  divide(Matrix<T,Alloc>&& a,const R& b) {
+    return detail::reuse(a,::anpi::divide(a,b));
+  }
+
+  /// Element-wise quotient into the memory of the expiring matrix b
+  template<class L,typename T,class Alloc>
+  inline typename reusing_expression<Matrix<T,Alloc>,L>::type
+  divide(const L& a,Matrix<T,Alloc>&& b) {
+    return detail::reuse(b,::anpi::divide(a,b));
+  }
+
+  /// Element-wise quotient into the memory of the expiring matrix a
+  template<typename T,class LAlloc,class RAlloc>
+  inline Matrix<T,LAlloc> divide(Matrix<T,LAlloc>&& a,Matrix<T,RAlloc>&& b) {
+    return detail::reuse(a,::anpi::divide(a,b));
+  }
+
+  /// Element-wise minimum into the memory of the expiring matrix a
+  template<typename T,class Alloc,class R>
+  inline typename reusing_expression<Matrix<T,Alloc>,R>::type
+  min(Matrix<T,Alloc>&& a,const R& b) {
+    return detail::reuse(a,::anpi::min(a,b));
+  }
+
+  /// Element-wise minimum into the memory of the expiring matrix b
+  template<class L,typename T,class Alloc>
+  inline typename reusing_expression<Matrix<T,Alloc>,L>::type
+  min(const L& a,Matrix<T,Alloc>&& b) {
+    return detail::reuse(b,::anpi::min(a,b));
+  }
+
+  /// Element-wise minimum into the memory of the expiring matrix a
+  template<typename T,class LAlloc,class RAlloc>
+  inline Matrix<T,LAlloc> min(Matrix<T,LAlloc>&& a,Matrix<T,RAlloc>&& b) {
+    return detail::reuse(a,::anpi::min(a,b));
+  }
+
+  /// Element-wise maximum into the memory of the expiring matrix a
+  template<typename T,class Alloc,class R>
+  inline typename reusing_expression<Matrix<T,Alloc>,R>::type
+  max(Matrix<T,Alloc>&& a,const R& b) {
+    return detail::reuse(a,::anpi::max(a,b));
+  }
+
+  /// Element-wise maximum into the memory of the expiring matrix b
+  template<class L,typename T,class Alloc>
+  inline typename reusing_expression<Matrix<T,Alloc>,L>::type
+  max(const L& a,Matrix<T,Alloc>&& b) {
+    return detail::reuse(b,::anpi::max(a,b));
+  }
+
+  /// Element-wise maximum into the memory of the expiring matrix a
+  template<typename T,class LAlloc,class RAlloc>
+  inline Matrix<T,LAlloc> max(Matrix<T,LAlloc>&& a,Matrix<T,RAlloc>&& b) {
+    return detail::reuse(a,::anpi::max(a,b));
+  }
+
+  /**
+   * Element-wise multiply-add a*b+c into the memory of the first
+   * expiring matrix among the operands.
+   *
+   * The operands are forwarded, so that this only takes part in the
+   * overload resolution if some of them is a temporary anpi::Matrix.
+   */
+  template<class A,class B,class C>
+  inline typename reusing_fma<A,B,C>::type
+  fma(A&& a,B&& b,C&& c) {
+    return detail::reuseFma(std::integral_constant<int,
+                              reusing_fma<A,B,C>::operand>(),a,b,c);
+  }
+  //@}
+
+} // namespace anpi
+
+#endif
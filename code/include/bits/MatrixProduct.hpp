@@ -0,0 +1,545 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_PRODUCT_HPP
+#define ANPI_MATRIX_PRODUCT_HPP
+
+#include "Intrinsics.hpp"
+#include "SimdDispatch.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace anpi
+{
+  /**
+   * Factor of a matrix product: rows x cols entries, with rows
+   * starting rs entries apart and columns cs entries apart.
+   *
+   * Matrices and views have cs=1, while transposed views have rs=1,
+   * so that the product kernels consume all of them without copies.
+   */
+  template<typename T>
+  struct gemm_operand {
+    /// First entry
+    const T* data;
+    /// Number of rows
+    size_t rows;
+    /// Number of columns
+    size_t cols;
+    /// Distance between the beginnings of two rows
+    size_t rs;
+    /// Distance between the beginnings of two columns
+    size_t cs;
+
+    /// Check if some entry lies in the memory block [begin,end)
+    inline bool overlaps(const T* begin,const T* end) const {
+      if ((rows == 0) || (cols == 0)) {
+        return false;
+      }
+      const T* last = data + ((rows-1)*rs + (cols-1)*cs);
+      return (data < end) && (begin <= last);
+    }
+
+    /**
+     * Check if some entry lies in the view c.
+     *
+     * The entries of the operand form lines of contiguous entries
+     * (its rows if cs=1, its columns if rs=1).  If the lines lie as
+     * far apart as the rows of c, as for two blocks of the same
+     * matrix, the blocks are compared by rows and columns, so that
+     * disjoint blocks do not overlap even if their memory ranges do.
+     */
+    inline bool overlaps(const MatrixView<T>& c) const {
+      if (c.empty() ||
+          !overlaps(c.data(),c[c.rows()-1] + c.cols())) {
+        return false;
+      }
+
+      const size_t lines  = (cs == 1) ? rows : cols;
+      const size_t length = (cs == 1) ? cols : rows;
+      const size_t stride = (cs == 1) ? rs : cs;
+      const std::ptrdiff_t d = static_cast<std::ptrdiff_t>(c.dcols());
+
+      if ( ((cs != 1) && (rs != 1)) ||
+           ((lines > 1) && (stride != c.dcols())) ||
+           (length > c.dcols()) ) {
+        return true;
+      }
+
+      // row and column of the first entry, relative to c
+      const std::ptrdiff_t off = data - c.data();
+      std::ptrdiff_t row = off/d;
+      std::ptrdiff_t col = off%d;
+      if (col < 0) {
+        col += d;
+        --row;
+      }
+
+      // rows [r0,r1) and columns [c0,c1) intersect those of c?
+      auto intersects = [&](const std::ptrdiff_t r0,const std::ptrdiff_t r1,
+                            const std::ptrdiff_t c0,const std::ptrdiff_t c1) {
+        return (r0 < std::ptrdiff_t(c.rows())) && (r1 > 0) &&
+               (c0 < std::ptrdiff_t(c.cols())) && (c1 > 0);
+      };
+
+      const std::ptrdiff_t l = static_cast<std::ptrdiff_t>(lines);
+      const std::ptrdiff_t end = col + static_cast<std::ptrdiff_t>(length);
+
+      // lines crossing the end of a row continue in the next one
+      return intersects(row,row+l,col,std::min(end,d)) ||
+             ((end > d) && intersects(row+1,row+l+1,0,end-d));
+    }
+  };
+
+  /**
+   * Map the types accepted as factors of the matrix product to their
+   * gemm_operand.  The value is false for all other types.
+   */
+  template<class M>
+  struct product_operand {
+    static constexpr bool value = false;
+  };
+
+  // Matrices are traversed by rows
+  template<typename T,class Alloc>
+  struct product_operand< Matrix<T,Alloc> > {
+    static constexpr bool value = true;
+    typedef T value_type;
+    static inline gemm_operand<T> get(const Matrix<T,Alloc>& m) {
+      return gemm_operand<T>{m.data(),m.rows(),m.cols(),m.dcols(),1};
+    }
+  };
+
+  // Views are traversed by rows
+  template<typename T>
+  struct product_operand< ConstMatrixView<T> > {
+    static constexpr bool value = true;
+    typedef T value_type;
+    static inline gemm_operand<T> get(const ConstMatrixView<T>& v) {
+      return gemm_operand<T>{v.data(),v.rows(),v.cols(),v.dcols(),1};
+    }
+  };
+
+  template<typename T>
+  struct product_operand< MatrixView<T> >
+    : public product_operand< ConstMatrixView<T> > {};
+
+  // Transposed views traverse the original by columns
+  template<typename T>
+  struct product_operand< TransposedView<T> > {
+    static constexpr bool value = true;
+    typedef T value_type;
+    static inline gemm_operand<T> get(const TransposedView<T>& v) {
+      const ConstMatrixView<T>& o = v.original();
+      return gemm_operand<T>{o.data(),v.rows(),v.cols(),1,o.dcols()};
+    }
+  };
+
+  /**
+   * Type returned by the product functions, only defined if both A and
+   * B are valid factors
+   */
+  template<class A,class B,
+           bool = (product_operand<A>::value &&
+                   product_operand<B>::value)>
+  struct product_enable {
+  };
+
+  // Both factors are valid
+  template<class A,class B>
+  struct product_enable<A,B,true> {
+    typedef void type;
+  };
+
+  namespace fallback {
+
+    /*
+     * General matrix product c = alpha*a*b + beta*c
+     */
+
+    // Prepare the view c for the accumulation of a product: c = beta*c
+    template<typename T>
+    inline void gemmScale(const T beta,const MatrixView<T>& c) {
+      if (beta == T(0)) {
+        // the previous content of c is ignored, even if it is NaN
+        c.fill(T(0));
+        return;
+      }
+
+      if (beta != T(1)) {
+        for (size_t i=0;i<c.rows();++i) {
+          T* ci = c[i];
+          for (size_t j=0;j<c.cols();++j) {
+            ci[j] *= beta;
+          }
+        }
+      }
+    }
+
+    // Prepare c for the accumulation of a product: c = beta*c
+    template<typename T,class Alloc>
+    inline void gemmScale(const T beta,
+                          const size_t rows,
+                          const size_t cols,
+                          Matrix<T,Alloc>& c) {
+      if (beta == T(0)) {
+        c.allocate(rows,cols);
+        c.fill(T(0));
+        return;
+      }
+
+      assert( (c.rows() == rows) && (c.cols() == cols) );
+      gemmScale(beta,c.view());
+    }
+
+    // Accumulate the product c += alpha*a*b
+    template<typename T>
+    inline void gemmUpdate(const T alpha,
+                           const gemm_operand<T>& a,
+                           const gemm_operand<T>& b,
+                           const MatrixView<T>& c) {
+      if (b.cs == 1) {
+        // The i-k-j order traverses the rows of b and c sequentially
+        for (size_t i=0;i<a.rows;++i) {
+          const T* ai = a.data + i*a.rs;
+          T* ci = c[i];
+          for (size_t p=0;p<a.cols;++p) {
+            const T aip = alpha*ai[p*a.cs];
+            const T* bp = b.data + p*b.rs;
+            for (size_t j=0;j<b.cols;++j) {
+              ci[j] += aip*bp[j];
+            }
+          }
+        }
+      } else {
+        // The columns of b are contiguous: one dot product per entry
+        for (size_t i=0;i<a.rows;++i) {
+          const T* ai = a.data + i*a.rs;
+          T* ci = c[i];
+          for (size_t j=0;j<b.cols;++j) {
+            const T* bj = b.data + j*b.cs;
+            T sum(0);
+            for (size_t p=0;p<a.cols;++p) {
+              sum += ai[p*a.cs]*bj[p*b.rs];
+            }
+            ci[j] += alpha*sum;
+          }
+        }
+      }
+    }
+
+    // Product c = alpha*a*b + beta*c into a view of the right size
+    template<typename T,class A,class B>
+    inline void gemm(const T alpha,
+                     const A& a,
+                     const B& b,
+                     const T beta,
+                     const MatrixView<T>& c) {
+
+      const gemm_operand<T> oa = product_operand<A>::get(a);
+      const gemm_operand<T> ob = product_operand<B>::get(b);
+
+      assert( (oa.cols == ob.rows) &&
+              (c.rows() == oa.rows) && (c.cols() == ob.cols) );
+
+      if (oa.overlaps(c) || ob.overlaps(c)) {
+        // the result cannot overwrite one of the factors
+        Matrix<T> tmp(c.rows(),c.cols(),DoNotInitialize);
+        tmp.view() = c;
+        ::anpi::fallback::gemm(alpha,a,b,beta,tmp.view());
+        c = tmp.view();
+        return;
+      }
+
+      gemmScale(beta,c);
+      gemmUpdate(alpha,oa,ob,c);
+    }
+
+    // Product c = alpha*a*b + beta*c
+    template<typename T,class A,class B,class Alloc>
+    inline void gemm(const T alpha,
+                     const A& a,
+                     const B& b,
+                     const T beta,
+                     Matrix<T,Alloc>& c) {
+
+      const gemm_operand<T> oa = product_operand<A>::get(a);
+      const gemm_operand<T> ob = product_operand<B>::get(b);
+
+      assert( oa.cols == ob.rows );
+
+      const T* cend = c.data() + c.rows()*c.dcols();
+      if (oa.overlaps(c.data(),cend) || ob.overlaps(c.data(),cend)) {
+        // the result cannot overwrite one of the factors
+        Matrix<T,Alloc> tmp(c);
+        ::anpi::fallback::gemm(alpha,a,b,beta,tmp);
+        c.swap(tmp);
+        return;
+      }
+
+      gemmScale(beta,oa.rows,ob.cols,c);
+      gemmUpdate(alpha,oa,ob,c.view());
+    }
+
+  } // namespace fallback
+
+  namespace simd
+  {
+    /**
+     * Cache blocking of the matrix product.
+     *
+     * The product is computed in blocks following Goto's algorithm:
+     * a kc x nc block of B is packed to stay in the L3 cache, and a
+     * mc x kc block of A is packed to stay in the L2 cache.  The
+     * micro-kernel then multiplies a panel of mr rows of the A block
+     * with a panel of nr columns of the B block (which stays in the L1
+     * cache), keeping the mr x nr block of C in registers.
+     */
+    struct gemm_blocking {
+      /// Common dimension of the packed blocks
+      static constexpr size_t kc = 256;
+      /// Rows of the packed block of A (multiple of all micro-kernel rows)
+      static constexpr size_t mc = 120;
+      /// Columns of the packed block of B (multiple of all register widths)
+      static constexpr size_t nc = 4096;
+    };
+
+    /*
+     * The packing functions receive the distance between consecutive
+     * rows (rs) and columns (cs) of the source, so that any strided
+     * layout can be packed.
+     */
+
+    // Pack the mc x kc block of a into panels of MR rows
+    template<size_t MR,typename T>
+    inline void gemmPackA(const size_t mc,
+                          const size_t kc,
+                          const T* a,
+                          const size_t rs,
+                          const size_t cs,
+                          T* buf) {
+      for (size_t i=0;i<mc;i+=MR) {
+        const size_t m = std::min(MR,mc-i);
+        const T* ai = a + i*rs;
+        for (size_t p=0;p<kc;++p) {
+          size_t r=0;
+          for (;r<m;++r) {
+            *buf++ = ai[r*rs + p*cs];
+          }
+          for (;r<MR;++r) {
+            *buf++ = T(0);
+          }
+        }
+      }
+    }
+
+    // Pack the kc x nc block of b into panels of NR columns
+    template<size_t NR,typename T>
+    inline void gemmPackB(const size_t kc,
+                          const size_t nc,
+                          const T* b,
+                          const size_t rs,
+                          const size_t cs,
+                          T* buf) {
+      for (size_t j=0;j<nc;j+=NR) {
+        const size_t n = std::min(NR,nc-j);
+        const T* bj = b + j*cs;
+        for (size_t p=0;p<kc;++p) {
+          size_t c=0;
+          for (;c<n;++c) {
+            *buf++ = bj[p*rs + c*cs];
+          }
+          for (;c<NR;++c) {
+            *buf++ = T(0);
+          }
+        }
+      }
+    }
+
+    // Blocked product c += alpha*a*b with the micro-kernel of Isa
+    template<typename T>
+    struct gemm_kernel {
+      template<class Isa>
+      struct supported : is_simd_op<ops::fma,Isa,T> {};
+
+      template<class Isa>
+      static void run(const size_t m,
+                      const size_t n,
+                      const size_t k,
+                      const T alpha,
+                      const T* a,const size_t rsa,const size_t csa,
+                      const T* b,const size_t rsb,const size_t csb,
+                      T* c,const size_t ldc) {
+
+        typedef typename kernels<Isa>::template gemm_tile<T> tile;
+        // local copies, as std::min takes its arguments by reference
+        const size_t mr = tile::mr;
+        const size_t nr = tile::nr;
+        const size_t kcb = gemm_blocking::kc;
+        const size_t mcb = gemm_blocking::mc;
+        const size_t ncb = gemm_blocking::nc;
+
+        // Aligned buffers for the packed blocks
+        const size_t kmax = std::min(k,kcb);
+        const size_t mmax = std::min(((m+mr-1)/mr)*mr,mcb);
+        const size_t nmax = std::min(((n+nr-1)/nr)*nr,ncb);
+        Matrix<T> abuf(1,mmax*kmax,DoNotInitialize);
+        Matrix<T> bbuf(1,nmax*kmax,DoNotInitialize);
+
+        for (size_t jc=0;jc<n;jc+=ncb) {
+          const size_t nc = std::min(ncb,n-jc);
+
+          for (size_t pc=0;pc<k;pc+=kcb) {
+            const size_t kc = std::min(kcb,k-pc);
+            gemmPackB<tile::nr>(kc,nc,b + pc*rsb + jc*csb,rsb,csb,
+                                bbuf.data());
+
+            for (size_t ic=0;ic<m;ic+=mcb) {
+              const size_t mc = std::min(mcb,m-ic);
+              gemmPackA<tile::mr>(mc,kc,a + ic*rsa + pc*csa,rsa,csa,
+                                  abuf.data());
+
+              // Each panel of B is reused for all panels of A
+              for (size_t jr=0;jr<nc;jr+=nr) {
+                for (size_t ir=0;ir<mc;ir+=mr) {
+                  kernels<Isa>::gemm(kc,alpha,
+                                     abuf.data() + ir*kc,
+                                     bbuf.data() + jr*kc,
+                                     c + (ic+ir)*ldc + jc + jr,ldc,
+                                     std::min(mr,mc-ir),
+                                     std::min(nr,nc-jr));
+                }
+              }
+            }
+          }
+        }
+      }
+    };
+
+    // Accumulate the product c += alpha*a*b
+    template<typename T>
+    inline void gemmUpdate(const T alpha,
+                           const gemm_operand<T>& a,
+                           const gemm_operand<T>& b,
+                           const MatrixView<T>& c) {
+      if (!dispatch< gemm_kernel<T> >(a.rows,b.cols,a.cols,alpha,
+                                      a.data,a.rs,a.cs,
+                                      b.data,b.rs,b.cs,
+                                      c.data(),c.dcols())) {
+        ::anpi::fallback::gemmUpdate(alpha,a,b,c);
+      }
+    }
+
+    // Product c = alpha*a*b + beta*c into a view of the right size
+    template<typename T,class A,class B>
+    inline void gemm(const T alpha,
+                     const A& a,
+                     const B& b,
+                     const T beta,
+                     const MatrixView<T>& c) {
+
+      const gemm_operand<T> oa = product_operand<A>::get(a);
+      const gemm_operand<T> ob = product_operand<B>::get(b);
+
+      assert( (oa.cols == ob.rows) &&
+              (c.rows() == oa.rows) && (c.cols() == ob.cols) );
+
+      if (oa.overlaps(c) || ob.overlaps(c)) {
+        // the result cannot overwrite one of the factors
+        Matrix<T> tmp(c.rows(),c.cols(),DoNotInitialize);
+        tmp.view() = c;
+        ::anpi::simd::gemm(alpha,a,b,beta,tmp.view());
+        c = tmp.view();
+        return;
+      }
+
+      ::anpi::fallback::gemmScale(beta,c);
+      ::anpi::simd::gemmUpdate(alpha,oa,ob,c);
+    }
+
+    // Product c = alpha*a*b + beta*c
+    template<typename T,class A,class B,class Alloc>
+    inline void gemm(const T alpha,
+                     const A& a,
+                     const B& b,
+                     const T beta,
+                     Matrix<T,Alloc>& c) {
+
+      const gemm_operand<T> oa = product_operand<A>::get(a);
+      const gemm_operand<T> ob = product_operand<B>::get(b);
+
+      assert( oa.cols == ob.rows );
+
+      const T* cend = c.data() + c.rows()*c.dcols();
+      if (oa.overlaps(c.data(),cend) || ob.overlaps(c.data(),cend)) {
+        // the result cannot overwrite one of the factors
+        Matrix<T,Alloc> tmp(c);
+        ::anpi::simd::gemm(alpha,a,b,beta,tmp);
+        c.swap(tmp);
+        return;
+      }
+
+      ::anpi::fallback::gemmScale(beta,oa.rows,ob.cols,c);
+      ::anpi::simd::gemmUpdate(alpha,oa,ob,c.view());
+    }
+
+  } // namespace simd
+
+  /**
+   * @name Matrix product
+   */
+  //@{
+
+  /**
+   * General matrix product c = alpha*a*b + beta*c
+   *
+   * The factors a and b can be matrices, views or transposed views
+   * (see anpi::transposed()).
+   *
+   * If beta is zero, the previous content of c is ignored and c is
+   * resized to the rows of a and the columns of b.  Otherwise c must
+   * already have that size.
+   */
+  template<typename T,class A,class B,class Alloc>
+  inline typename product_enable<A,B>::type gemm(const T alpha,
+                                                 const A& a,
+                                                 const B& b,
+                                                 const T beta,
+                                                 Matrix<T,Alloc>& c) {
+    ::anpi::aimpl::gemm(alpha,a,b,beta,c);
+  }
+
+  /**
+   * General matrix product c = alpha*a*b + beta*c into a view, which
+   * must have the rows of a and the columns of b
+   */
+  template<typename T,class A,class B>
+  inline typename product_enable<A,B>::type gemm(const T alpha,
+                                                 const A& a,
+                                                 const B& b,
+                                                 const T beta,
+                                                 const MatrixView<T>& c) {
+    ::anpi::aimpl::gemm(alpha,a,b,beta,c);
+  }
+
+  /// Matrix product a*b
+  template<typename T,class Alloc>
+  inline Matrix<T,Alloc> operator*(const Matrix<T,Alloc>& a,
+                                   const Matrix<T,Alloc>& b) {
+    Matrix<T,Alloc> c;
+    ::anpi::aimpl::gemm(T(1),a,b,T(0),c);
+    return c;
+  }
+  //@}
+
+} // namespace anpi
+
+#endif
@@ -0,0 +1,890 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_REDUCTION_HPP
+#define ANPI_MATRIX_REDUCTION_HPP
+
+#include "Intrinsics.hpp"
+#include "Parallel.hpp"
+#include "MatrixExpression.hpp"
+#include "SimdOperations.hpp"
+#include "SimdDispatch.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace anpi
+{
+  /**
+   * Summation algorithms of the reductions.
+   *
+   * The simple summation already spreads the entries on several
+   * accumulators, which reduces the error compared to a plain loop.
+   * Both other algorithms are more accurate for long sums in single
+   * precision, at the price of some speed.  Integer sums are always
+   * exact, and use the simple summation.
+   */
+  enum SummationType {
+    /// Several independent accumulators, added up at the end
+    SimpleSummation,
+    /// Kahan's compensated summation: error independent of the length
+    KahanSummation,
+    /// Pairwise summation: error growing with the log of the length
+    PairwiseSummation
+  };
+
+  namespace detail {
+    /// Type of the norms of matrices with entries of type T
+    template<typename T>
+    struct norm_type {
+      typedef typename std::conditional<std::is_integral<T>::value,
+                                        double,
+                                        typename compute_type<T>::type
+                                        >::type type;
+    };
+
+    template<typename T>
+    struct norm_type< std::complex<T> > {
+      typedef T type;
+    };
+
+    /// Real part of x, converted to the norm type
+    template<typename T>
+    inline typename norm_type<T>::type realPart(const T x) {
+      return static_cast<typename norm_type<T>::type>(x);
+    }
+
+    template<typename T>
+    inline T realPart(const std::complex<T> x) {
+      return x.real();
+    }
+
+    /// Largest real part of the n entries p[0], p[step], ...
+    template<typename T>
+    typename norm_type<T>::type maxRealPart(const T* p,const size_t n,
+                                            const size_t step=1) {
+      typename norm_type<T>::type m = realPart(p[0]);
+      for (size_t i=1;i<n;++i) {
+        m = std::max(m,realPart(p[i*step]));
+      }
+      return m;
+    }
+
+    /// Summation type actually used for entries of type T
+    template<typename T>
+    inline SummationType summation(const SummationType type) {
+      return std::is_integral<T>::value ? SimpleSummation : type;
+    }
+
+    /// s += x, with the compensation c if Kahan
+    template<bool Kahan,typename T>
+    inline void sumScalar(T& s,T& c,const T x) {
+      if (Kahan) {
+        const T y = x - c;
+        const T t = s + y;
+        c = (t - s) - y;
+        s = t;
+      } else {
+        s += x;
+      }
+    }
+
+    /// Running scalar sum with the given summation type
+    template<typename T>
+    struct accumulator {
+      T sum;
+      T err;
+      bool kahan;
+
+      inline explicit accumulator(const SummationType type)
+        : sum(0),err(0),kahan(type == KahanSummation) {}
+
+      inline void add(const T x) {
+        if (kahan) {
+          sumScalar<true>(sum,err,x);
+        } else {
+          sum += x;
+        }
+      }
+    };
+  } // namespace detail
+
+  namespace fallback {
+
+    /*
+     * Reductions
+     *
+     * The drivers below split the rows into one chunk per thread.  The
+     * partial results of the chunks are combined in order, so that the
+     * result does not depend on the scheduling of the threads.  The
+     * leaf computations are provided by a kernel policy, which is the
+     * scalar code here and the SIMD kernels in the simd namespace.
+     *
+     * Sums are accumulated in the compute type S of the entries, so
+     * that 16 bit floating point entries are summed in float.
+     */
+
+    /// Number of entries (or rows) summed directly by pairwise summation
+    struct reduction_blocking {
+      static constexpr size_t pairwise = 256;
+    };
+
+    /// Scalar kernels of the reductions
+    template<typename T>
+    struct reduction_kernels {
+      typedef typename compute_type<T>::type S;
+
+      // Sum of map(a[i],b[i]) for i in [0,n) with four accumulators
+      template<class Map,bool Kahan>
+      S reduce(const T* a,const T* b,const size_t n) const {
+        S s[4] = { S(0),S(0),S(0),S(0) };
+        S c[4] = { S(0),S(0),S(0),S(0) };
+        // the entries left over by the four accumulators
+        const size_t rem  = n % 4;
+        const size_t full = n - rem;
+        for (size_t i=0;i<full;i+=4) {
+          for (size_t k=0;k<4;++k) {
+            detail::sumScalar<Kahan>(s[k],c[k],
+                                     ops::map_entry<Map>::apply(S(a[i+k]),
+                                                                S(b[i+k])));
+          }
+        }
+        for (size_t i=full;i<n;++i) {
+          detail::sumScalar<Kahan>(s[0],c[0],
+                                   ops::map_entry<Map>::apply(S(a[i]),
+                                                              S(b[i])));
+        }
+        S r(0),e(0);
+        for (size_t k=0;k<4;++k) {
+          detail::sumScalar<Kahan>(r,e,s[k]);
+          if (Kahan) {
+            detail::sumScalar<Kahan>(r,e,S(-c[k]));
+          }
+        }
+        return r;
+      }
+
+      /*
+       * s[i] += map(x[i]) for i in [0,n), with compensations c if
+       * Kahan.  The entries x are of type T, or partial sums of type S.
+       */
+      template<class Map,bool Kahan,typename X>
+      void accumulate(S* s,S* c,const X* x,const size_t n) const {
+        for (size_t i=0;i<n;++i) {
+          const S xi = ops::map_entry<Map>::apply(S(x[i]),S(x[i]));
+          if (Kahan) {
+            detail::sumScalar<true>(s[i],c[i],xi);
+          } else {
+            s[i] += xi;
+          }
+        }
+      }
+
+      // Minimum or maximum of a[i] for i in [0,n), with n > 0
+      template<class Op>
+      T extremum(const T* a,const size_t n) const {
+        T m = a[0];
+        for (size_t i=1;i<n;++i) {
+          m = Op::apply(m,a[i]);
+        }
+        return m;
+      }
+    };
+
+    // Pairwise sum of map(a[i],b[i]) for i in [0,n)
+    template<class Map,typename T,class Kernels>
+    typename compute_type<T>::type
+    pairwise(const T* a,const T* b,const size_t n,const Kernels& k) {
+      const size_t block = reduction_blocking::pairwise;
+      if (n <= block) {
+        return k.template reduce<Map,false>(a,b,n);
+      }
+      // split at a multiple of the block size, so that the leaves are full
+      const size_t half = (n/2 + block - 1)/block*block;
+      return pairwise<Map>(a,b,half,k) + pairwise<Map>(a+half,b+half,n-half,k);
+    }
+
+    // Pairwise sum of the rows [first,last) of views with gaps
+    template<class Map,typename T,class Kernels>
+    typename compute_type<T>::type
+    pairwiseRows(const ConstMatrixView<T>& a,const ConstMatrixView<T>& b,
+                 const size_t first,const size_t last,const Kernels& k) {
+      if (last - first == 1) {
+        return pairwise<Map>(a[first],b[first],a.cols(),k);
+      }
+      const size_t half = first + (last-first)/2;
+      return pairwiseRows<Map>(a,b,first,half,k) +
+             pairwiseRows<Map>(a,b,half,last,k);
+    }
+
+    // Sum of map(a,b) over the rows [first,last) of the views
+    template<class Map,typename T,class Kernels>
+    typename compute_type<T>::type
+    reduceRows(const ConstMatrixView<T>& a,const ConstMatrixView<T>& b,
+               const size_t first,const size_t last,
+               const SummationType type,const Kernels& k) {
+      typedef typename compute_type<T>::type S;
+      const bool flat = a.contiguous() && b.contiguous();
+      const size_t n = (last-first)*a.cols();
+
+      switch (type) {
+      case KahanSummation:
+        if (flat) {
+          return k.template reduce<Map,true>(a[first],b[first],n);
+        } else {
+          detail::accumulator<S> acc(type);
+          for (size_t r=first;r<last;++r) {
+            acc.add(k.template reduce<Map,true>(a[r],b[r],a.cols()));
+          }
+          return acc.sum;
+        }
+      case PairwiseSummation:
+        return flat ? pairwise<Map>(a[first],b[first],n,k)
+                    : pairwiseRows<Map>(a,b,first,last,k);
+      default:
+        if (flat) {
+          return k.template reduce<Map,false>(a[first],b[first],n);
+        } else {
+          S s(0);
+          for (size_t r=first;r<last;++r) {
+            s += k.template reduce<Map,false>(a[r],b[r],a.cols());
+          }
+          return s;
+        }
+      }
+    }
+
+    /*
+     * Call f(c,first,last) for each of the chunks of rows [first,last),
+     * with the chunks distributed among the threads.
+     */
+    template<class F>
+    void forChunks(const size_t chunks,const size_t rows,const size_t cols,
+                   F f) {
+      parallelRows(chunks,(rows*cols)/chunks,[&](const size_t fc,
+                                                  const size_t lc) {
+        for (size_t c=fc;c<lc;++c) {
+          f(c,(rows*c)/chunks,(rows*(c+1))/chunks);
+        }
+      });
+    }
+
+    /// Sum of map(a,b) over all entries, with the given kernels
+    template<class Map,typename T,class Kernels>
+    typename compute_type<T>::type
+    reduce(const ConstMatrixView<T>& a,const ConstMatrixView<T>& b,
+           const SummationType type,const Kernels& k) {
+      typedef typename compute_type<T>::type S;
+      assert( (a.rows() == b.rows()) && (a.cols() == b.cols()) );
+      if (a.empty()) {
+        return S(0);
+      }
+
+      const SummationType t = detail::summation<T>(type);
+      std::vector<S> partial(parallelThreads(a.rows(),a.cols()),S(0));
+      forChunks(partial.size(),a.rows(),a.cols(),
+                [&](const size_t c,const size_t first,const size_t last) {
+        partial[c] = reduceRows<Map>(a,b,first,last,t,k);
+      });
+
+      detail::accumulator<S> acc(t);
+      for (const S& p : partial) {
+        acc.add(p);
+      }
+      return acc.sum;
+    }
+
+    /// Minimum or maximum of all entries, with the given kernels
+    template<class Op,typename T,class Kernels>
+    T extremum(const ConstMatrixView<T>& a,const Kernels& k) {
+      assert( !a.empty() );
+
+      std::vector<T> partial(parallelThreads(a.rows(),a.cols()),a(0,0));
+      forChunks(partial.size(),a.rows(),a.cols(),
+                [&](const size_t c,const size_t first,const size_t last) {
+        if (a.contiguous()) {
+          partial[c] = k.template extremum<Op>(a[first],
+                                               (last-first)*a.cols());
+        } else {
+          T m = a(first,0);
+          for (size_t r=first;r<last;++r) {
+            m = Op::apply(m,k.template extremum<Op>(a[r],a.cols()));
+          }
+          partial[c] = m;
+        }
+      });
+
+      return k.template extremum<Op>(partial.data(),partial.size());
+    }
+
+    /**
+     * Sums of map(a) along the rows of a (out = rows x 1) with the
+     * given kernels
+     */
+    template<class Map,typename T,class Kernels>
+    void rowReduce(const ConstMatrixView<T>& a,const MatrixView<T>& out,
+                   const SummationType type,const Kernels& k) {
+      assert( (out.rows() == a.rows()) && (out.cols() == 1) );
+
+      const SummationType t = detail::summation<T>(type);
+      parallelRows(a.rows(),a.cols(),[&](const size_t first,
+                                         const size_t last) {
+        for (size_t r=first;r<last;++r) {
+          out(r,0) = T(reduceRows<Map>(a,a,r,r+1,t,k));
+        }
+      });
+    }
+
+    /*
+     * Sums of map(a) along the columns of the rows [first,last) of a
+     * into s.  The rows are read one after the other, and added to s
+     * as a whole, instead of striding down each column.
+     */
+    template<class Map,typename T,class Kernels,typename S>
+    void colReduceRows(const ConstMatrixView<T>& a,
+                       const size_t first,const size_t last,
+                       const SummationType type,const Kernels& k,
+                       S* s) {
+      const size_t cols = a.cols();
+      std::fill(s,s+cols,S(0));
+
+      if (type == KahanSummation) {
+        std::vector<S> c(cols,S(0));
+        for (size_t r=first;r<last;++r) {
+          k.template accumulate<Map,true>(s,c.data(),a[r],cols);
+        }
+        // s - c is the best estimate of each sum
+        for (size_t j=0;j<cols;++j) {
+          s[j] -= c[j];
+        }
+      } else if ((type == PairwiseSummation) &&
+                 (last - first > reduction_blocking::pairwise)) {
+        /*
+         * Pairwise sums of groups of rows: a stack keeps the partial
+         * sums of 1,2,4,... groups, merging the two on top whenever
+         * they cover the same number of groups.
+         */
+        const size_t block = reduction_blocking::pairwise;
+        std::vector< std::vector<S> > stack;
+        std::vector<size_t> level;
+        for (size_t g=first;g<last;g+=block) {
+          std::vector<S> sum(cols,S(0));
+          for (size_t r=g;r<std::min(g+block,last);++r) {
+            k.template accumulate<Map,false>(sum.data(),nullptr,a[r],cols);
+          }
+          size_t l=0;
+          while (!level.empty() && (level.back() == l)) {
+            k.template accumulate<ops::identity,false>(stack.back().data(),
+                                                       nullptr,
+                                                       sum.data(),cols);
+            sum.swap(stack.back());
+            stack.pop_back();
+            level.pop_back();
+            ++l;
+          }
+          stack.push_back(std::move(sum));
+          level.push_back(l);
+        }
+        while (stack.size() > 1) {
+          k.template accumulate<ops::identity,false>(
+            stack[stack.size()-2].data(),nullptr,stack.back().data(),cols);
+          stack.pop_back();
+        }
+        std::copy(stack[0].begin(),stack[0].end(),s);
+      } else {
+        for (size_t r=first;r<last;++r) {
+          k.template accumulate<Map,false>(s,nullptr,a[r],cols);
+        }
+      }
+    }
+
+    /**
+     * Sums of map(a) along the columns of a (out = 1 x cols) with the
+     * given kernels
+     */
+    template<class Map,typename T,class Kernels>
+    void colReduce(const ConstMatrixView<T>& a,const MatrixView<T>& out,
+                   const SummationType type,const Kernels& k) {
+      assert( (out.rows() == 1) && (out.cols() == a.cols()) );
+      typedef typename compute_type<T>::type S;
+
+      const SummationType t = detail::summation<T>(type);
+      const size_t chunks = parallelThreads(a.rows(),a.cols());
+      std::vector<S> partial(chunks*a.cols());
+      forChunks(chunks,a.rows(),a.cols(),
+                [&](const size_t c,const size_t first,const size_t last) {
+        colReduceRows<Map>(a,first,last,t,k,partial.data() + c*a.cols());
+      });
+
+      // add the partial sums of the chunks in order to the first one
+      std::vector<S> comp(a.cols(),S(0));
+      S* s = partial.data();
+      for (size_t c=1;c<chunks;++c) {
+        if (t == KahanSummation) {
+          k.template accumulate<ops::identity,true>(
+            s,comp.data(),partial.data() + c*a.cols(),a.cols());
+        } else {
+          k.template accumulate<ops::identity,false>(
+            s,nullptr,partial.data() + c*a.cols(),a.cols());
+        }
+      }
+      T* o = out.data();
+      for (size_t j=0;j<a.cols();++j) {
+        o[j] = T(s[j]);
+      }
+    }
+
+    /// Sum of map(a,b) over all entries
+    template<class Map,typename T>
+    inline typename compute_type<T>::type
+    reduce(const ConstMatrixView<T>& a,const ConstMatrixView<T>& b,
+           const SummationType type) {
+      return ::anpi::fallback::reduce<Map>(a,b,type,reduction_kernels<T>());
+    }
+
+    /// Minimum or maximum of all entries
+    template<class Op,typename T>
+    inline T extremum(const ConstMatrixView<T>& a) {
+      return ::anpi::fallback::extremum<Op>(a,reduction_kernels<T>());
+    }
+
+    /// Sums of map(a) along the rows
+    template<class Map,typename T>
+    inline void rowReduce(const ConstMatrixView<T>& a,
+                          const MatrixView<T>& out,
+                          const SummationType type) {
+      ::anpi::fallback::rowReduce<Map>(a,out,type,reduction_kernels<T>());
+    }
+
+    /// Sums of map(a) along the columns
+    template<class Map,typename T>
+    inline void colReduce(const ConstMatrixView<T>& a,
+                          const MatrixView<T>& out,
+                          const SummationType type) {
+      ::anpi::fallback::colReduce<Map>(a,out,type,reduction_kernels<T>());
+    }
+
+  } // namespace fallback
+
+  namespace simd
+  {
+    // Sum of map(a[i],b[i]) for i in [0,n)
+    template<class Map,bool Kahan,typename T>
+    struct reduce_kernel {
+      template<class Isa>
+      struct supported {
+        static constexpr bool value =
+          mm_map<Map,Isa,T>::supported &&
+          is_simd_op<ops::add,Isa,T>::value &&
+          is_simd_op<ops::subtract,Isa,T>::value;
+      };
+
+      template<class Isa>
+      static void run(const T* a,const T* b,const size_t n,
+                      typename compute_type<T>::type* result) {
+        *result = kernels<Isa>::template reduce<Map,Kahan>(a,b,n);
+      }
+    };
+
+    // s[i] += map(x[i]) for i in [0,n)
+    template<class Map,bool Kahan,typename T>
+    struct accumulate_kernel {
+      template<class Isa>
+      struct supported : reduce_kernel<Map,Kahan,T>::template supported<Isa> {};
+
+      template<class Isa>
+      static void run(typename compute_type<T>::type* s,
+                      typename compute_type<T>::type* c,
+                      const T* x,const size_t n) {
+        kernels<Isa>::template accumulate<Map,Kahan>(s,c,x,n);
+      }
+    };
+
+    // Minimum or maximum of a[i] for i in [0,n)
+    template<class Op,typename T>
+    struct extremum_kernel {
+      template<class Isa>
+      struct supported : is_simd_op<Op,Isa,T> {};
+
+      template<class Isa>
+      static void run(const T* a,const size_t n,T* result) {
+        *result = kernels<Isa>::template extremum<Op>(a,n);
+      }
+    };
+
+    /// SIMD kernels of the reductions, falling back to the scalar ones
+    template<typename T>
+    struct reduction_kernels {
+      typedef typename compute_type<T>::type S;
+
+      template<class Map,bool Kahan>
+      S reduce(const T* a,const T* b,const size_t n) const {
+        S r;
+        if (!dispatch< reduce_kernel<Map,Kahan,T> >(a,b,n,&r)) {
+          r = ::anpi::fallback::reduction_kernels<T>().
+            template reduce<Map,Kahan>(a,b,n);
+        }
+        return r;
+      }
+
+      template<class Map,bool Kahan,typename X>
+      void accumulate(S* s,S* c,const X* x,const size_t n) const {
+        if (!dispatch< accumulate_kernel<Map,Kahan,X> >(s,c,x,n)) {
+          ::anpi::fallback::reduction_kernels<X>().
+            template accumulate<Map,Kahan>(s,c,x,n);
+        }
+      }
+
+      template<class Op>
+      T extremum(const T* a,const size_t n) const {
+        T r;
+        if (!dispatch< extremum_kernel<Op,T> >(a,n,&r)) {
+          r = ::anpi::fallback::reduction_kernels<T>().
+            template extremum<Op>(a,n);
+        }
+        return r;
+      }
+    };
+
+    /// Sum of map(a,b) over all entries
+    template<class Map,typename T>
+    inline typename compute_type<T>::type
+    reduce(const ConstMatrixView<T>& a,const ConstMatrixView<T>& b,
+           const SummationType type) {
+      if (!dispatchable< reduce_kernel<Map,false,T> >()) {
+        return ::anpi::fallback::reduce<Map>(a,b,type);
+      }
+      return ::anpi::fallback::reduce<Map>(a,b,type,reduction_kernels<T>());
+    }
+
+    /// Minimum or maximum of all entries
+    template<class Op,typename T>
+    inline T extremum(const ConstMatrixView<T>& a) {
+      if (!dispatchable< extremum_kernel<Op,T> >()) {
+        return ::anpi::fallback::extremum<Op>(a);
+      }
+      return ::anpi::fallback::extremum<Op>(a,reduction_kernels<T>());
+    }
+
+    /// Sums of map(a) along the rows
+    template<class Map,typename T>
+    inline void rowReduce(const ConstMatrixView<T>& a,
+                          const MatrixView<T>& out,
+                          const SummationType type) {
+      if (!dispatchable< reduce_kernel<Map,false,T> >()) {
+        ::anpi::fallback::rowReduce<Map>(a,out,type);
+        return;
+      }
+      ::anpi::fallback::rowReduce<Map>(a,out,type,reduction_kernels<T>());
+    }
+
+    /// Sums of map(a) along the columns
+    template<class Map,typename T>
+    inline void colReduce(const ConstMatrixView<T>& a,
+                          const MatrixView<T>& out,
+                          const SummationType type) {
+      if (!dispatchable< accumulate_kernel<Map,false,T> >()) {
+        ::anpi::fallback::colReduce<Map>(a,out,type);
+        return;
+      }
+      ::anpi::fallback::colReduce<Map>(a,out,type,reduction_kernels<T>());
+    }
+
+  } // namespace simd
+
+  /**
+   * @name Reductions
+   *
+   * All reductions accept matrices and views.  Large inputs are split
+   * among several threads; the partial results are always combined in
+   * the same order, so that the results only depend on the number of
+   * threads.
+   */
+  //@{
+
+  /**
+   * Sum of all entries.  The sums of 16 bit floating point entries
+   * are accumulated and returned in float.
+   */
+  template<typename T>
+  inline typename compute_type<T>::type
+  sum(const ConstMatrixView<T>& a,const SummationType type=SimpleSummation) {
+    return ::anpi::aimpl::reduce<ops::identity>(a,a,type);
+  }
+
+  /// Sum of all entries
+  template<typename T,class Alloc>
+  inline typename compute_type<T>::type
+  sum(const Matrix<T,Alloc>& a,const SummationType type=SimpleSummation) {
+    return ::anpi::sum(a.view(),type);
+  }
+
+  /**
+   * Sum of the products of corresponding entries of a and b (the
+   * Frobenius inner product), which must have the same size.  Complex
+   * entries are not conjugated.
+   */
+  template<typename T>
+  inline typename compute_type<T>::type
+  dot(const ConstMatrixView<T>& a,const ConstMatrixView<T>& b,
+      const SummationType type=SimpleSummation) {
+    return ::anpi::aimpl::reduce<ops::multiply>(a,b,type);
+  }
+
+  /// Sum of the products of corresponding entries of a and b
+  template<typename T,class Alloc>
+  inline typename compute_type<T>::type
+  dot(const Matrix<T,Alloc>& a,const Matrix<T,Alloc>& b,
+      const SummationType type=SimpleSummation) {
+    return ::anpi::dot(a.view(),b.view(),type);
+  }
+
+  /// Minimum entry of a non-empty matrix
+  template<typename T>
+  inline T min(const ConstMatrixView<T>& a) {
+    return ::anpi::aimpl::extremum<ops::min>(a);
+  }
+
+  /// Minimum entry of a non-empty matrix
+  template<typename T,class Alloc>
+  inline T min(const Matrix<T,Alloc>& a) {
+    return ::anpi::min(a.view());
+  }
+
+  /// Maximum entry of a non-empty matrix
+  template<typename T>
+  inline T max(const ConstMatrixView<T>& a) {
+    return ::anpi::aimpl::extremum<ops::max>(a);
+  }
+
+  /// Maximum entry of a non-empty matrix
+  template<typename T,class Alloc>
+  inline T max(const Matrix<T,Alloc>& a) {
+    return ::anpi::max(a.view());
+  }
+
+  /// Row and column of the first occurrence (in row-major order) of v
+  template<typename T>
+  inline std::pair<size_t,size_t> find(const ConstMatrixView<T>& a,
+                                       const T v) {
+    for (size_t r=0;r<a.rows();++r) {
+      const T* p = std::find(a[r],a[r]+a.cols(),v);
+      if (p != a[r]+a.cols()) {
+        return std::make_pair(r,size_t(p-a[r]));
+      }
+    }
+    return std::make_pair(a.rows(),a.cols());
+  }
+
+  /// Row and column of the first minimum entry of a non-empty matrix
+  template<typename T>
+  inline std::pair<size_t,size_t> argmin(const ConstMatrixView<T>& a) {
+    return ::anpi::find(a,::anpi::min(a));
+  }
+
+  /// Row and column of the first minimum entry of a non-empty matrix
+  template<typename T,class Alloc>
+  inline std::pair<size_t,size_t> argmin(const Matrix<T,Alloc>& a) {
+    return ::anpi::argmin(a.view());
+  }
+
+  /// Row and column of the first maximum entry of a non-empty matrix
+  template<typename T>
+  inline std::pair<size_t,size_t> argmax(const ConstMatrixView<T>& a) {
+    return ::anpi::find(a,::anpi::max(a));
+  }
+
+  /// Row and column of the first maximum entry of a non-empty matrix
+  template<typename T,class Alloc>
+  inline std::pair<size_t,size_t> argmax(const Matrix<T,Alloc>& a) {
+    return ::anpi::argmax(a.view());
+  }
+
+  /// Sums of each row of a into the column out (a.rows() x 1)
+  template<typename T>
+  inline void rowSums(const ConstMatrixView<T>& a,const MatrixView<T>& out,
+                      const SummationType type=SimpleSummation) {
+    ::anpi::aimpl::rowReduce<ops::identity>(a,out,type);
+  }
+
+  /// Column with the sums of each row of a
+  template<typename T,class Alloc>
+  inline Matrix<T,Alloc> rowSums(const Matrix<T,Alloc>& a,
+                                 const SummationType type=SimpleSummation) {
+    Matrix<T,Alloc> out(a.rows(),1,DoNotInitialize);
+    ::anpi::rowSums(a.view(),out.view(),type);
+    return out;
+  }
+
+  /**
+   * Sums of each column of a into the row out (1 x a.cols()).
+   *
+   * The rows of a are added one after the other, reading the memory
+   * contiguously.
+   */
+  template<typename T>
+  inline void colSums(const ConstMatrixView<T>& a,const MatrixView<T>& out,
+                      const SummationType type=SimpleSummation) {
+    ::anpi::aimpl::colReduce<ops::identity>(a,out,type);
+  }
+
+  /// Row with the sums of each column of a
+  template<typename T,class Alloc>
+  inline Matrix<T,Alloc> colSums(const Matrix<T,Alloc>& a,
+                                 const SummationType type=SimpleSummation) {
+    Matrix<T,Alloc> out(1,a.cols(),DoNotInitialize);
+    ::anpi::colSums(a.view(),out.view(),type);
+    return out;
+  }
+  //@}
+
+  /**
+   * @name Norms
+   *
+   * For row and column vectors these are the usual vector norms.  For
+   * other matrices, norm1(), norm2() and normInf() are the norms
+   * induced by the corresponding vector norms.  Integer matrices have
+   * norms of type double.
+   */
+  //@{
+
+  /// Frobenius norm: square root of the sum of the squared entries
+  template<typename T>
+  inline typename detail::norm_type<T>::type
+  frobenius(const ConstMatrixView<T>& a,
+            const SummationType type=SimpleSummation) {
+    return std::sqrt(detail::realPart(
+                       ::anpi::aimpl::reduce<ops::square>(a,a,type)));
+  }
+
+  /// Frobenius norm: square root of the sum of the squared entries
+  template<typename T,class Alloc>
+  inline typename detail::norm_type<T>::type
+  frobenius(const Matrix<T,Alloc>& a,
+            const SummationType type=SimpleSummation) {
+    return ::anpi::frobenius(a.view(),type);
+  }
+
+  /**
+   * 1-norm: sum of the absolute values of vectors, and maximum sum of
+   * the absolute values of a column of other matrices
+   */
+  template<typename T>
+  typename detail::norm_type<T>::type
+  norm1(const ConstMatrixView<T>& a,
+        const SummationType type=SimpleSummation) {
+    if (a.empty()) {
+      return 0;
+    }
+    if ((a.rows() == 1) || (a.cols() == 1)) {
+      return detail::realPart(::anpi::aimpl::reduce<ops::absolute>(a,a,type));
+    }
+    Matrix<T> sums(1,a.cols(),DoNotInitialize);
+    ::anpi::aimpl::colReduce<ops::absolute>(a,sums.view(),type);
+    return detail::maxRealPart(sums.data(),a.cols());
+  }
+
+  /// 1-norm of vectors, and maximum absolute column sum of matrices
+  template<typename T,class Alloc>
+  inline typename detail::norm_type<T>::type
+  norm1(const Matrix<T,Alloc>& a,const SummationType type=SimpleSummation) {
+    return ::anpi::norm1(a.view(),type);
+  }
+
+  /**
+   * Infinity norm: maximum absolute value of vectors, and maximum sum
+   * of the absolute values of a row of other matrices
+   */
+  template<typename T>
+  typename detail::norm_type<T>::type
+  normInf(const ConstMatrixView<T>& a,
+          const SummationType type=SimpleSummation) {
+    if (a.empty()) {
+      return 0;
+    }
+    if (a.rows() == 1) {
+      // the "column sums" of one row are its absolute values
+      Matrix<T> sums(1,a.cols(),DoNotInitialize);
+      ::anpi::aimpl::colReduce<ops::absolute>(a,sums.view(),type);
+      return detail::maxRealPart(sums.data(),a.cols());
+    }
+    Matrix<T> sums(a.rows(),1,DoNotInitialize);
+    ::anpi::aimpl::rowReduce<ops::absolute>(a,sums.view(),type);
+    return detail::maxRealPart(sums.data(),a.rows(),sums.dcols());
+  }
+
+  /// Infinity norm of vectors, and maximum absolute row sum of matrices
+  template<typename T,class Alloc>
+  inline typename detail::norm_type<T>::type
+  normInf(const Matrix<T,Alloc>& a,const SummationType type=SimpleSummation) {
+    return ::anpi::normInf(a.view(),type);
+  }
+
+  /**
+   * 2-norm: Euclidean norm of vectors, and largest singular value of
+   * other matrices.
+   *
+   * The singular value is computed with the power iteration on a^T a,
+   * which converges slowly if the two largest singular values are
+   * close.  Only real matrices are supported.
+   */
+  template<typename T>
+  T norm2(const ConstMatrixView<T>& a) {
+    static_assert(std::is_floating_point<T>::value,
+                  "The 2-norm requires real floating point entries");
+
+    if ((a.rows() == 1) || (a.cols() == 1) || a.empty()) {
+      return ::anpi::frobenius(a);
+    }
+
+    // start with a vector not orthogonal to most singular vectors
+    Matrix<T> x(a.cols(),1,DoNotInitialize);
+    for (size_t j=0;j<a.cols();++j) {
+      x(j,0) = T(1) + T(j % 7)/T(7);
+    }
+    x.view() = x/::anpi::frobenius(x);
+
+    Matrix<T> y(a.rows(),1,DoNotInitialize);
+    Matrix<T> z(a.cols(),1,DoNotInitialize);
+    const T eps = 4*std::numeric_limits<T>::epsilon();
+    T sigma(0);
+    for (size_t it=0;it<1000;++it) {
+      // z = a^T a x approximates sigma^2 x
+      ::anpi::gemm(T(1),a,ConstMatrixView<T>(x),T(0),y.view());
+      ::anpi::gemm(T(1),transposed(a),ConstMatrixView<T>(y),T(0),z.view());
+      const T nz = ::anpi::frobenius(z);
+      if (nz == T(0)) {
+        return T(0);
+      }
+      const T s = std::sqrt(nz);
+      x.view() = z/nz;
+      if (std::abs(s - sigma) <= eps*s) {
+        return s;
+      }
+      sigma = s;
+    }
+    return sigma;
+  }
+
+  /// 2-norm: Euclidean norm of vectors, and largest singular value
+  template<typename T,class Alloc>
+  inline T norm2(const Matrix<T,Alloc>& a) {
+    return ::anpi::norm2(a.view());
+  }
+  //@}
+
+} // namespace anpi
+
+#endif
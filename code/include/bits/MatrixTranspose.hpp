@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_TRANSPOSE_HPP
+#define ANPI_MATRIX_TRANSPOSE_HPP
+
+#include "Intrinsics.hpp"
+#include "Parallel.hpp"
+#include "SimdDispatch.hpp"
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+namespace anpi
+{
+  namespace fallback {
+
+    /*
+     * Transpose
+     *
+     * Reading a matrix by rows and writing it by columns misses the
+     * cache on every entry of large matrices.  The recursion below
+     * splits the matrix until the blocks of source and destination fit
+     * together in the L1 cache, independently of its size.  The blocks
+     * are then transposed by a leaf functor, which is the scalar loop
+     * here and a register shuffle in the SIMD implementation.
+     */
+
+    /// Size of the blocks transposed by the leaf functors
+    struct transpose_blocking {
+      static constexpr size_t block = 32;
+    };
+
+    // Scalar transpose of the rows x cols block src into dst
+    template<typename T>
+    struct transpose_leaf {
+      inline void operator()(const T* src,const size_t lds,
+                             T* dst,const size_t ldd,
+                             const size_t rows,const size_t cols) const {
+        for (size_t i=0;i<rows;++i) {
+          const T* si = src + i*lds;
+          T* di = dst + i;
+          for (size_t j=0;j<cols;++j,di+=ldd) {
+            *di = si[j];
+          }
+        }
+      }
+    };
+
+    // Split n entries in two halves, the first one with whole blocks
+    inline size_t splitBlocks(const size_t n) {
+      const size_t block = transpose_blocking::block;
+      return std::max(block,(n/block)/2*block);
+    }
+
+    // Cache-oblivious transpose of the rows x cols block src into dst
+    template<typename T,class Leaf>
+    void transposeRecursive(const T* src,const size_t lds,
+                            T* dst,const size_t ldd,
+                            const size_t rows,const size_t cols,
+                            const Leaf& leaf) {
+      const size_t block = transpose_blocking::block;
+
+      if ((rows <= block) && (cols <= block)) {
+        leaf(src,lds,dst,ldd,rows,cols);
+      } else if (rows >= cols) {
+        const size_t half = splitBlocks(rows);
+        transposeRecursive(src,lds,dst,ldd,half,cols,leaf);
+        transposeRecursive(src + half*lds,lds,dst + half,ldd,
+                           rows-half,cols,leaf);
+      } else {
+        const size_t half = splitBlocks(cols);
+        transposeRecursive(src,lds,dst,ldd,rows,half,leaf);
+        transposeRecursive(src + half,lds,dst + half*ldd,ldd,
+                           rows,cols-half,leaf);
+      }
+    }
+
+    // Transposed copy dst = src^T with the given leaf functor
+    template<typename T,class Leaf>
+    void transpose(const ConstMatrixView<T>& src,
+                   const MatrixView<T>& dst,
+                   const Leaf& leaf) {
+
+      assert( (src.rows() == dst.cols()) && (src.cols() == dst.rows()) );
+
+      // each thread writes a block of rows of dst
+      parallelRows(dst.rows(),dst.cols(),[&](const size_t first,
+                                             const size_t last) {
+        transposeRecursive(src.data() + first,src.dcols(),
+                           dst[first],dst.dcols(),
+                           src.rows(),last-first,leaf);
+      });
+    }
+
+    /*
+     * In-place transpose of a square matrix.  Each pair of blocks
+     * (I,J) and (J,I) is exchanged through a buffer, which holds the
+     * transpose of one of them.
+     */
+    template<typename T,class Leaf>
+    void transposeInPlace(const MatrixView<T>& a,const Leaf& leaf) {
+
+      assert( a.rows() == a.cols() );
+
+      const size_t block = transpose_blocking::block;
+      const size_t n = a.rows();
+      const size_t blocks = (n + block - 1)/block;
+
+      parallelRows(blocks,n*block,[&](const size_t first,
+                                      const size_t last) {
+        Matrix<T> buf(block,block,DoNotInitialize);
+        const MatrixView<T> tmp = buf.view();
+
+        for (size_t bi=first;bi<last;++bi) {
+          const size_t i  = bi*block;
+          const size_t mi = std::min(block,n-i);
+
+          for (size_t j=i;j<n;j+=block) {
+            const size_t mj = std::min(block,n-j);
+
+            // tmp = A(I,J)^T
+            leaf(a[i]+j,a.dcols(),tmp.data(),tmp.dcols(),mi,mj);
+
+            if (j != i) {
+              // A(I,J) = A(J,I)^T
+              leaf(a[j]+i,a.dcols(),a[i]+j,a.dcols(),mj,mi);
+            }
+
+            // A(J,I) = tmp
+            for (size_t r=0;r<mj;++r) {
+              std::copy(tmp[r],tmp[r]+mi,a[j+r]+i);
+            }
+          }
+        }
+      });
+    }
+
+    // Transposed copy dst = src^T
+    template<typename T>
+    inline void transpose(const ConstMatrixView<T>& src,
+                          const MatrixView<T>& dst) {
+      ::anpi::fallback::transpose(src,dst,transpose_leaf<T>());
+    }
+
+    // In-place transpose of the square view a
+    template<typename T>
+    inline void transposeInPlace(const MatrixView<T>& a) {
+      ::anpi::fallback::transposeInPlace(a,transpose_leaf<T>());
+    }
+
+  } // namespace fallback
+
+  namespace simd
+  {
+    // Transpose of a block with register tiles
+    template<typename T>
+    struct transpose_kernel {
+      template<class Isa>
+      struct supported {
+        static constexpr bool value =
+          std::is_trivially_copyable<T>::value &&
+          transpose_traits<Isa,sizeof(T)>::supported;
+      };
+
+      template<class Isa>
+      static void run(const T* src,const size_t lds,
+                      T* dst,const size_t ldd,
+                      const size_t rows,const size_t cols) {
+        kernels<Isa>::template transpose<sizeof(T)>(
+          reinterpret_cast<const char*>(src),lds*sizeof(T),
+          reinterpret_cast<char*>(dst),ldd*sizeof(T),
+          rows,cols);
+      }
+    };
+
+    // Leaf of the recursive transpose, running the SIMD kernel
+    template<typename T>
+    struct transpose_leaf {
+      inline void operator()(const T* src,const size_t lds,
+                             T* dst,const size_t ldd,
+                             const size_t rows,const size_t cols) const {
+        dispatch< transpose_kernel<T> >(src,lds,dst,ldd,rows,cols);
+      }
+    };
+
+    // Transposed copy dst = src^T
+    template<typename T>
+    inline void transpose(const ConstMatrixView<T>& src,
+                          const MatrixView<T>& dst) {
+      if (!dispatchable< transpose_kernel<T> >()) {
+        ::anpi::fallback::transpose(src,dst);
+        return;
+      }
+      ::anpi::fallback::transpose(src,dst,transpose_leaf<T>());
+    }
+
+    // In-place transpose of the square view a
+    template<typename T>
+    inline void transposeInPlace(const MatrixView<T>& a) {
+      if (!dispatchable< transpose_kernel<T> >()) {
+        ::anpi::fallback::transposeInPlace(a);
+        return;
+      }
+      ::anpi::fallback::transposeInPlace(a,transpose_leaf<T>());
+    }
+
+  } // namespace simd
+
+  /**
+   * @name Transpose
+   *
+   * The lazy alternative is anpi::transposed(), which does not move
+   * any data.
+   */
+  //@{
+
+  /**
+   * In-place transpose a = a^T
+   *
+   * Square matrices are transposed in their own memory, with a buffer
+   * of one block per thread.  Other matrices are transposed into a new
+   * memory block.
+   */
+  template<typename T,class Alloc>
+  inline void transposeInPlace(Matrix<T,Alloc>& a) {
+    if (a.rows() == a.cols()) {
+      ::anpi::aimpl::transposeInPlace(a.view());
+      return;
+    }
+    Matrix<T,Alloc> b(a.cols(),a.rows(),DoNotInitialize);
+    ::anpi::aimpl::transpose(a.view(),b.view());
+    a.swap(b);
+  }
+
+  /// In-place transpose a = a^T of a square view
+  template<typename T>
+  inline void transposeInPlace(const MatrixView<T>& a) {
+    ::anpi::aimpl::transposeInPlace(a);
+  }
+
+  /**
+   * Transposed copy b = a^T
+   *
+   * The matrix b is resized to the transposed size of a.  The padding
+   * of both matrices is never touched.
+   */
+  template<typename T,class Alloc>
+  inline void transpose(const Matrix<T,Alloc>& a,Matrix<T,Alloc>& b) {
+    if (&a == &b) {
+      ::anpi::transposeInPlace(b);
+      return;
+    }
+    b.allocate(a.cols(),a.rows());
+    ::anpi::aimpl::transpose(a.view(),b.view());
+  }
+
+  /**
+   * Transposed copy b = a^T of views
+   *
+   * The view b must have the transposed size of a, and must not
+   * overlap it.
+   */
+  template<typename T>
+  inline void transpose(const ConstMatrixView<T>& a,const MatrixView<T>& b) {
+    ::anpi::aimpl::transpose(a,b);
+  }
+  //@}
+
+} // namespace anpi
+
+#endif
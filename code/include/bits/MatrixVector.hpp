@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_MATRIX_VECTOR_HPP
+#define ANPI_MATRIX_VECTOR_HPP
+
+#include "Intrinsics.hpp"
+#include "Parallel.hpp"
+#include "SimdDispatch.hpp"
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+namespace anpi
+{
+  namespace fallback {
+
+    /**
+     * Blocking of the matrix-vector product with transposed matrices.
+     *
+     * The result is accumulated in segments of nc entries, which stay
+     * in the L1 cache while all rows of the matrix are added to them.
+     */
+    struct gemv_blocking {
+      /// Entries of each segment of the result
+      static constexpr size_t nc = 2048;
+    };
+
+    /**
+     * Scalar kernels of the matrix-vector products, on m rows of n
+     * entries, with rows lda entries apart.  Four rows are processed
+     * in each pass, so that each entry of the vector is read once for
+     * all of them.
+     */
+    template<typename T>
+    struct gemv_kernels {
+      // y[i] = alpha*(a_i . x) + beta*y[i]
+      void dot(const size_t m,const size_t n,const T alpha,
+               const T* a,const size_t lda,const T* x,
+               const T beta,T* y) const {
+        size_t i=0;
+        for (;i+4<=m;i+=4) {
+          const T* a0 = a + i*lda;
+          const T* a1 = a0 + lda;
+          const T* a2 = a1 + lda;
+          const T* a3 = a2 + lda;
+          T s0(0),s1(0),s2(0),s3(0);
+          for (size_t j=0;j<n;++j) {
+            const T xj = x[j];
+            s0 += a0[j]*xj;
+            s1 += a1[j]*xj;
+            s2 += a2[j]*xj;
+            s3 += a3[j]*xj;
+          }
+          const T s[4] = { s0,s1,s2,s3 };
+          for (size_t r=0;r<4;++r) {
+            y[i+r] = (beta == T(0)) ? alpha*s[r] : alpha*s[r] + beta*y[i+r];
+          }
+        }
+        for (;i<m;++i) {
+          const T* ai = a + i*lda;
+          T s(0);
+          for (size_t j=0;j<n;++j) {
+            s += ai[j]*x[j];
+          }
+          y[i] = (beta == T(0)) ? alpha*s : alpha*s + beta*y[i];
+        }
+      }
+
+      // y[j] += alpha*sum_i x[i]*a_i[j]
+      void axpy(const size_t m,const size_t n,const T alpha,
+                const T* a,const size_t lda,const T* x,T* y) const {
+        size_t i=0;
+        for (;i+4<=m;i+=4) {
+          const T* a0 = a + i*lda;
+          const T* a1 = a0 + lda;
+          const T* a2 = a1 + lda;
+          const T* a3 = a2 + lda;
+          const T x0 = alpha*x[i];
+          const T x1 = alpha*x[i+1];
+          const T x2 = alpha*x[i+2];
+          const T x3 = alpha*x[i+3];
+          for (size_t j=0;j<n;++j) {
+            y[j] += x0*a0[j] + x1*a1[j] + x2*a2[j] + x3*a3[j];
+          }
+        }
+        for (;i<m;++i) {
+          const T* ai = a + i*lda;
+          const T xi = alpha*x[i];
+          for (size_t j=0;j<n;++j) {
+            y[j] += xi*ai[j];
+          }
+        }
+      }
+    };
+
+    /**
+     * Matrix-vector product y = alpha*a*x + beta*y, with x of a.cols
+     * and y of a.rows entries, none of them overlapping y.  If beta is
+     * zero, the previous content of y is ignored.
+     *
+     * The entries of y are distributed among the threads in blocks.
+     * If the rows of a are contiguous (cs=1), each entry of y is the
+     * dot product of a row with x.  If its columns are contiguous
+     * (rs=1, as in transposed views), y accumulates the columns of a
+     * scaled by the entries of x.
+     */
+    template<typename T,class Kernels>
+    void gemv(const T alpha,
+              const gemm_operand<T>& a,
+              const T* x,
+              const T beta,
+              T* y,
+              const Kernels& kernels) {
+      const size_t m = a.rows;
+      const size_t n = a.cols;
+
+      if ((a.cs == 1) && ((a.rs != 1) || (n == 1))) {
+        parallelRows(m,n,[&](const size_t first,const size_t last) {
+          kernels.dot(last-first,n,alpha,a.data + first*a.rs,a.rs,x,
+                      beta,y + first);
+        });
+        return;
+      }
+
+      assert( a.rs == 1 );
+      const size_t nc = gemv_blocking::nc;
+      parallelRows(m,n,[&](const size_t first,const size_t last) {
+        if (beta == T(0)) {
+          std::fill(y+first,y+last,T(0));
+        } else if (beta != T(1)) {
+          for (size_t i=first;i<last;++i) {
+            y[i] *= beta;
+          }
+        }
+        for (size_t j=first;j<last;j+=nc) {
+          kernels.axpy(n,std::min(nc,last-j),alpha,a.data + j,a.cs,x,y + j);
+        }
+      });
+    }
+
+    /// Matrix-vector product with the scalar kernels
+    template<typename T>
+    inline void gemv(const T alpha,
+                     const gemm_operand<T>& a,
+                     const T* x,
+                     const T beta,
+                     T* y) {
+      ::anpi::fallback::gemv(alpha,a,x,beta,y,gemv_kernels<T>());
+    }
+
+  } // namespace fallback
+
+  namespace simd {
+
+    // y[i] = alpha*(a_i . x) + beta*y[i]
+    template<typename T>
+    struct gemv_kernel {
+      template<class Isa>
+      struct supported : is_simd_op<ops::fma,Isa,T> {};
+
+      template<class Isa>
+      static void run(const size_t m,const size_t n,const T alpha,
+                      const T* a,const size_t lda,const T* x,
+                      const T beta,T* y) {
+        kernels<Isa>::gemv(m,n,alpha,a,lda,x,beta,y);
+      }
+    };
+
+    // y[j] += alpha*sum_i x[i]*a_i[j]
+    template<typename T>
+    struct gemv_transposed_kernel {
+      template<class Isa>
+      struct supported : is_simd_op<ops::fma,Isa,T> {};
+
+      template<class Isa>
+      static void run(const size_t m,const size_t n,const T alpha,
+                      const T* a,const size_t lda,const T* x,T* y) {
+        kernels<Isa>::gemvTransposed(m,n,alpha,a,lda,x,y);
+      }
+    };
+
+    /// SIMD kernels of the matrix-vector products
+    template<typename T>
+    struct gemv_kernels {
+      void dot(const size_t m,const size_t n,const T alpha,
+               const T* a,const size_t lda,const T* x,
+               const T beta,T* y) const {
+        if (!dispatch< gemv_kernel<T> >(m,n,alpha,a,lda,x,beta,y)) {
+          ::anpi::fallback::gemv_kernels<T>().dot(m,n,alpha,a,lda,x,beta,y);
+        }
+      }
+
+      void axpy(const size_t m,const size_t n,const T alpha,
+                const T* a,const size_t lda,const T* x,T* y) const {
+        if (!dispatch< gemv_transposed_kernel<T> >(m,n,alpha,a,lda,x,y)) {
+          ::anpi::fallback::gemv_kernels<T>().axpy(m,n,alpha,a,lda,x,y);
+        }
+      }
+    };
+
+    /// Matrix-vector product with the SIMD kernels, if available
+    template<typename T>
+    inline void gemv(const T alpha,
+                     const gemm_operand<T>& a,
+                     const T* x,
+                     const T beta,
+                     T* y) {
+      if (!dispatchable< gemv_kernel<T> >()) {
+        ::anpi::fallback::gemv(alpha,a,x,beta,y);
+        return;
+      }
+      ::anpi::fallback::gemv(alpha,a,x,beta,y,gemv_kernels<T>());
+    }
+
+  } // namespace simd
+
+  /**
+   * @name Matrix-vector product
+   */
+  //@{
+
+  /**
+   * Matrix-vector product y = alpha*a*x + beta*y
+   *
+   * The matrix a can be a matrix, a view or a transposed view (see
+   * anpi::transposed()), so that a^T*x is computed without moving
+   * any data.
+   *
+   * If beta is zero, the previous content of y is ignored and y is
+   * resized to the rows of a.  Otherwise y must already have that
+   * size.
+   */
+  template<typename T,class A,class XAlloc,class YAlloc>
+  inline typename std::enable_if<product_operand<A>::value>::type
+  gemv(const T alpha,
+       const A& a,
+       const Vector<T,XAlloc>& x,
+       const T beta,
+       Vector<T,YAlloc>& y) {
+    const gemm_operand<T> oa = product_operand<A>::get(a);
+    assert( oa.cols == x.size() );
+
+    const T* ybegin = y.data();
+    const T* yend = ybegin + y.size();
+    if (!y.empty() &&
+        (oa.overlaps(ybegin,yend) ||
+         ((x.data() < yend) && (ybegin < x.data() + x.size())))) {
+      // the result cannot overwrite one of the factors
+      Vector<T,YAlloc> tmp(y);
+      ::anpi::gemv(alpha,a,x,beta,tmp);
+      y.swap(tmp);
+      return;
+    }
+
+    if (beta == T(0)) {
+      y.allocate(oa.rows);
+    }
+    assert( y.size() == oa.rows );
+    ::anpi::aimpl::gemv(alpha,oa,x.data(),beta,y.data());
+  }
+
+  /// Matrix-vector product a*x
+  template<class A,typename T,class Alloc>
+  inline typename std::enable_if<product_operand<A>::value,
+                                 Vector<T,Alloc> >::type
+  operator*(const A& a,const Vector<T,Alloc>& x) {
+    Vector<T,Alloc> y;
+    ::anpi::gemv(T(1),a,x,T(0),y);
+    return y;
+  }
+  //@}
+
+} // namespace anpi
+
+#endif
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_SIMD_DISPATCH_HPP
+#define ANPI_SIMD_DISPATCH_HPP
+
+#include "Intrinsics.hpp"
+#include "MatrixExpression.hpp"
+#include "SimdOperations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+namespace anpi
+{
+  namespace simd
+  {
+    /**
+     * Instruction sets, ordered by the width of their registers
+     */
+    enum class Isa : int {
+      None   = 0, ///< Scalar fallback code only
+      SSE2   = 1, ///< 128 bit registers
+      AVX    = 2, ///< 256 bit registers, requires AVX2 and FMA
+      AVX512 = 3  ///< 512 bit registers, requires AVX512F, BW and DQ
+    };
+
+    /// Name of the given instruction set
+    inline const char* isaName(const Isa isa) {
+      switch (isa) {
+      case Isa::SSE2:   return "sse2";
+      case Isa::AVX:    return "avx";
+      case Isa::AVX512: return "avx512";
+      default:          return "none";
+      }
+    }
+
+    /**
+     * Parse the name of an instruction set.
+     *
+     * Valid names are "none", "sse2", "avx" (or "avx2") and "avx512".
+     * The value def is returned if the name is not recognized.
+     */
+    inline Isa parseIsa(const char* name,const Isa def) {
+      if (name == nullptr) return def;
+      if ((std::strcmp(name,"none") == 0) ||
+          (std::strcmp(name,"fallback") == 0)) return Isa::None;
+      if  (std::strcmp(name,"sse2") == 0)     return Isa::SSE2;
+      if ((std::strcmp(name,"avx") == 0) ||
+          (std::strcmp(name,"avx2") == 0))    return Isa::AVX;
+      if  (std::strcmp(name,"avx512") == 0)   return Isa::AVX512;
+      return def;
+    }
+
+    namespace detail {
+      /// Ask the CPU for its best supported instruction set
+      inline Isa detectIsa() {
+#ifdef ANPI_SIMD_X86
+        __builtin_cpu_init();
+        const bool avx2 =
+          __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+          __builtin_cpu_supports("f16c");
+        if (avx2 &&
+            __builtin_cpu_supports("avx512f")  &&
+            __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512dq")) {
+          return Isa::AVX512;
+        }
+        if (avx2) {
+          return Isa::AVX;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+          return Isa::SSE2;
+        }
+#endif
+        return Isa::None;
+      }
+    } // namespace detail
+
+    /**
+     * Best instruction set supported by the CPU running this code
+     */
+    inline Isa supportedIsa() {
+      static const Isa best = detail::detectIsa();
+      return best;
+    }
+
+    namespace detail {
+      /// Restrict the requested instruction set to the supported ones
+      inline Isa clampIsa(const Isa isa) {
+        return (static_cast<int>(isa) < static_cast<int>(supportedIsa()))
+          ? isa : supportedIsa();
+      }
+
+      /// Currently active instruction set
+      inline std::atomic<int>& activeIsa() {
+        // The environment variable ANPI_SIMD may force a less capable set
+        static std::atomic<int> active(static_cast<int>(
+          clampIsa(parseIsa(std::getenv("ANPI_SIMD"),supportedIsa()))));
+        return active;
+      }
+    } // namespace detail
+
+    /**
+     * Instruction set used by all SIMD kernels.
+     *
+     * By default this is the best one supported by the CPU, unless the
+     * environment variable ANPI_SIMD names a less capable one.
+     */
+    inline Isa isa() {
+      return static_cast<Isa>(detail::activeIsa().load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Force the kernels to use the given instruction set, or the best
+     * supported one if the CPU cannot execute it.
+     *
+     * @return the instruction set actually in use
+     */
+    inline Isa setIsa(const Isa isa) {
+      const Isa used = detail::clampIsa(isa);
+      detail::activeIsa().store(static_cast<int>(used),
+                                std::memory_order_relaxed);
+      return used;
+    }
+
+    namespace detail {
+      /// Size of the last level cache, or 8 MiB if it is unknown
+      inline size_t cacheSize() {
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+        const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (l3 > 0) {
+          return static_cast<size_t>(l3);
+        }
+#endif
+        return size_t(8) << 20;
+      }
+
+      /// Minimum size of the blocks written with non-temporal stores
+      inline std::atomic<size_t>& streamingBytes() {
+        static std::atomic<size_t> bytes(cacheSize());
+        return bytes;
+      }
+    } // namespace detail
+
+    /**
+     * Minimum size in bytes of the memory blocks that fill and copy
+     * write with non-temporal stores.
+     *
+     * Blocks larger than the last level cache would evict all its
+     * content, and do not profit from it anyway.  By default this is
+     * the size of that cache.
+     */
+    inline size_t streamingThreshold() {
+      return detail::streamingBytes().load(std::memory_order_relaxed);
+    }
+
+    /// Set the minimum size of blocks written with non-temporal stores
+    inline void setStreamingThreshold(const size_t bytes) {
+      detail::streamingBytes().store(bytes,std::memory_order_relaxed);
+    }
+
+    /**
+     * Kernels compiled for the instruction set Isa.
+     *
+     * The specializations are generated from SimdKernels.tpp.  The
+     * rows of the micro-kernel of the matrix product (ANPI_SIMD_GEMM_MR)
+     * depend on the number of registers of each instruction set: 16 for
+     * SSE2 and AVX, 32 for AVX-512.
+     */
+    template<class Isa>
+    struct kernels;
+
+#ifdef ANPI_SIMD_X86
+ANPI_SIMD_BEGIN_SSE2
+#   define ANPI_SIMD_ISA sse2
+#   define ANPI_SIMD_GEMM_MR 4
+#   include "SimdKernels.tpp"
+#   undef  ANPI_SIMD_GEMM_MR
+#   undef  ANPI_SIMD_ISA
+ANPI_SIMD_END
+
+ANPI_SIMD_BEGIN_AVX
+#   define ANPI_SIMD_ISA avx
+#   define ANPI_SIMD_GEMM_MR 6
+#   include "SimdKernels.tpp"
+#   undef  ANPI_SIMD_GEMM_MR
+#   undef  ANPI_SIMD_ISA
+ANPI_SIMD_END
+
+ANPI_SIMD_BEGIN_AVX512
+#   define ANPI_SIMD_ISA avx512
+#   define ANPI_SIMD_GEMM_MR 12
+#   include "SimdKernels.tpp"
+#   undef  ANPI_SIMD_GEMM_MR
+#   undef  ANPI_SIMD_ISA
+ANPI_SIMD_END
+#endif
+
+    namespace detail {
+      // Run the kernel F for the instruction set Isa
+      template<class F,class Isa,class... Args>
+      inline bool run(std::true_type,const Args&... args) {
+        F::template run<Isa>(args...);
+        return true;
+      }
+
+      // F does not support the instruction set Isa
+      template<class F,class Isa,class... Args>
+      inline bool run(std::false_type,const Args&...) {
+        return false;
+      }
+
+      // Run F with Isa, if F supports it
+      template<class F,class Isa,class... Args>
+      inline bool run(const Args&... args) {
+        return run<F,Isa>(std::integral_constant<bool,
+                            F::template supported<Isa>::value>(),
+                          args...);
+      }
+    } // namespace detail
+
+    /**
+     * Check if dispatch<F>() would find an instruction set for F.
+     *
+     * This allows to choose between the SIMD and the fallback code
+     * before splitting a task among several threads.
+     */
+    template<class F>
+    inline bool dispatchable() {
+      const int active = static_cast<int>(isa());
+
+      return
+        ((active >= static_cast<int>(Isa::AVX512)) &&
+         F::template supported<avx512>::value) ||
+        ((active >= static_cast<int>(Isa::AVX)) &&
+         F::template supported<avx>::value) ||
+        ((active >= static_cast<int>(Isa::SSE2)) &&
+         F::template supported<sse2>::value);
+    }
+
+    /**
+     * Run the kernel F with the best active instruction set it supports.
+     *
+     * F must provide a template metafunction supported<Isa> with a
+     * boolean value, and a static method run<Isa>(args...) with the
+     * kernel.
+     *
+     * @return true if some SIMD kernel was used, false if the caller
+     *         has to compute the result with the fallback code.
+     */
+    template<class F,class... Args>
+    inline bool dispatch(const Args&... args) {
+      const int active = static_cast<int>(isa());
+
+      if ((active >= static_cast<int>(Isa::AVX512)) &&
+          detail::run<F,avx512>(args...)) return true;
+      if ((active >= static_cast<int>(Isa::AVX)) &&
+          detail::run<F,avx>(args...)) return true;
+      if ((active >= static_cast<int>(Isa::SSE2)) &&
+          detail::run<F,sse2>(args...)) return true;
+
+      return false;
+    }
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
@@ -0,0 +1,806 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+/*
+ * Kernels for the instruction set ANPI_SIMD_ISA.
+ *
+ * This file has no include guards on purpose: SimdDispatch.hpp includes
+ * it once for each instruction set, inside the namespace anpi::simd
+ * and inside the region compiled with the target options of that
+ * instruction set.  Do not include it directly.
+ */
+
+template<>
+struct kernels<ANPI_SIMD_ISA> {
+  /// Instruction set of these kernels
+  typedef ANPI_SIMD_ISA isa;
+
+  /*
+   * Element-wise operations on raw memory blocks
+   */
+
+  // c[i] = a[i] op b[i] for i in [0,n)
+  template<class Op,typename T>
+  static void binary(const T* a,const T* b,T* c,const size_t n) {
+    typedef register_traits<isa,T> traits;
+    constexpr size_t lanes = traits::lanes;
+
+    size_t i=0;
+    for (;i+lanes<=n;i+=lanes) {
+      traits::store(c+i,mm_op<Op,isa,T>::apply(traits::load(a+i),
+                                               traits::load(b+i)));
+    }
+
+    // remaining entries not filling a whole register
+    for (;i<n;++i) {
+      c[i] = Op::apply(a[i],b[i]);
+    }
+  }
+
+  // d[i] = op(a[i],b[i],c[i]) for i in [0,n)
+  template<class Op,typename T>
+  static void ternary(const T* a,const T* b,const T* c,T* d,const size_t n) {
+    typedef register_traits<isa,T> traits;
+    constexpr size_t lanes = traits::lanes;
+
+    size_t i=0;
+    for (;i+lanes<=n;i+=lanes) {
+      traits::store(d+i,mm_op<Op,isa,T>::apply(traits::load(a+i),
+                                               traits::load(b+i),
+                                               traits::load(c+i)));
+    }
+
+    for (;i<n;++i) {
+      d[i] = Op::apply(a[i],b[i],c[i]);
+    }
+  }
+
+  /*
+   * Expressions
+   *
+   * The registers of an expression tree are computed recursively.
+   */
+
+  // Matrices are loaded from memory, which may be unaligned
+  template<typename T>
+  static inline typename register_traits<isa,T>::reg_type
+  __attribute__((__always_inline__))
+  packet(const MatrixReference<T>& e,const size_t row,const size_t col) {
+    return register_traits<isa,T>::load(e.ptr(row,col));
+  }
+
+  // Scalars are broadcasted to all lanes
+  template<typename T>
+  static inline typename register_traits<isa,T>::reg_type
+  __attribute__((__always_inline__))
+  packet(const ScalarExpression<T>& e,const size_t,const size_t) {
+    return register_traits<isa,T>::set1(e.value());
+  }
+
+  // Inner nodes apply their operation on the registers of their operands
+  template<class Op,class L,class R>
+  static inline typename register_traits<isa,typename L::value_type>::reg_type
+  __attribute__((__always_inline__))
+  packet(const BinaryExpression<Op,L,R>& e,
+         const size_t row,
+         const size_t col) {
+    typedef typename L::value_type T;
+    return mm_op<Op,isa,T>::apply(packet(e.lhs(),row,col),
+                                  packet(e.rhs(),row,col));
+  }
+
+  template<class Op,class A,class B,class C>
+  static inline typename register_traits<isa,typename A::value_type>::reg_type
+  __attribute__((__always_inline__))
+  packet(const TernaryExpression<Op,A,B,C>& e,
+         const size_t row,
+         const size_t col) {
+    typedef typename A::value_type T;
+    return mm_op<Op,isa,T>::apply(packet(e.first(),row,col),
+                                  packet(e.second(),row,col),
+                                  packet(e.third(),row,col));
+  }
+
+  // Evaluate n entries of the given row of e into out
+  template<class E,typename T>
+  static void evaluate(const E& e,const size_t row,T* out,const size_t n) {
+    typedef register_traits<isa,T> traits;
+    constexpr size_t lanes = traits::lanes;
+
+    size_t col=0;
+    for (;col+lanes<=n;col+=lanes) {
+      traits::store(out+col,packet(e,row,col));
+    }
+
+    // remaining entries not filling a whole register
+    for (;col<n;++col) {
+      out[col] = e.coeff(row,col);
+    }
+  }
+
+  /*
+   * Memory transfers
+   *
+   * The non-temporal stores bypass the caches, which pays off for
+   * blocks that do not fit in them anyway.  They require aligned
+   * addresses, so the first bytes up to the next aligned address are
+   * written with normal stores.
+   */
+
+  // Bytes before the first address of dst aligned for streaming stores
+  static inline size_t streamHead(const char* dst,const size_t n) {
+    constexpr size_t bytes = memory_traits<isa>::bytes;
+    const size_t misalign = reinterpret_cast<std::uintptr_t>(dst) % bytes;
+    const size_t head = (misalign == 0) ? 0 : bytes - misalign;
+    return (head < n) ? head : n;
+  }
+
+  // Copy n bytes from src to dst with non-temporal stores
+  static void copy(const char* src,char* dst,const size_t n) {
+    typedef memory_traits<isa> traits;
+    constexpr size_t bytes = traits::bytes;
+
+    const size_t head = streamHead(dst,n);
+    std::memcpy(dst,src,head);
+
+    // four registers in flight hide the latency of the loads
+    size_t i=head;
+    for (;i+4*bytes<=n;i+=4*bytes) {
+      const typename traits::reg_type r0 = traits::load(src+i);
+      const typename traits::reg_type r1 = traits::load(src+i+bytes);
+      const typename traits::reg_type r2 = traits::load(src+i+2*bytes);
+      const typename traits::reg_type r3 = traits::load(src+i+3*bytes);
+      traits::stream(dst+i,r0);
+      traits::stream(dst+i+bytes,r1);
+      traits::stream(dst+i+2*bytes,r2);
+      traits::stream(dst+i+3*bytes,r3);
+    }
+    for (;i+bytes<=n;i+=bytes) {
+      traits::stream(dst+i,traits::load(src+i));
+    }
+    traits::fence();
+
+    std::memcpy(dst+i,src+i,n-i);
+  }
+
+  /*
+   * Fill n bytes of dst repeating a pattern, optionally with
+   * non-temporal stores.  The pattern has 128 bytes, and a period
+   * that divides 64.
+   */
+  static void fill(char* dst,const char* pattern,const size_t n,
+                   const bool stream) {
+    typedef memory_traits<isa> traits;
+    constexpr size_t bytes = traits::bytes;
+
+    const size_t head = stream ? streamHead(dst,n) : 0;
+    for (size_t i=0;i<head;++i) {
+      dst[i] = pattern[i];
+    }
+
+    // the register holds the pattern starting at the head
+    const typename traits::reg_type reg = traits::load(pattern + head);
+
+    size_t i=head;
+    if (stream) {
+      for (;i+bytes<=n;i+=bytes) {
+        traits::stream(dst+i,reg);
+      }
+      traits::fence();
+    } else {
+      for (;i+bytes<=n;i+=bytes) {
+        traits::store(dst+i,reg);
+      }
+    }
+
+    for (;i<n;++i) {
+      dst[i] = pattern[i % 64];
+    }
+  }
+
+  /*
+   * Transpose the rows x cols block src into dst, for elements of
+   * Bytes bytes.  The distances between rows (lds and ldd) are given in
+   * bytes.  The entries not filling a whole tile are copied one by one.
+   */
+  template<size_t Bytes>
+  static void transpose(const char* src,const size_t lds,
+                        char* dst,const size_t ldd,
+                        const size_t rows,const size_t cols) {
+    typedef transpose_traits<isa,Bytes> traits;
+    constexpr size_t size = traits::size;
+
+    size_t i=0;
+    for (;i+size<=rows;i+=size) {
+      size_t j=0;
+      for (;j+size<=cols;j+=size) {
+        traits::apply(src + i*lds + j*Bytes,lds,dst + j*ldd + i*Bytes,ldd);
+      }
+      for (;j<cols;++j) {
+        for (size_t r=i;r<i+size;++r) {
+          std::memcpy(dst + j*ldd + r*Bytes,src + r*lds + j*Bytes,Bytes);
+        }
+      }
+    }
+
+    for (;i<rows;++i) {
+      for (size_t j=0;j<cols;++j) {
+        std::memcpy(dst + j*ldd + i*Bytes,src + i*lds + j*Bytes,Bytes);
+      }
+    }
+  }
+
+  /*
+   * Reductions
+   *
+   * Four registers accumulate independent partial results, which
+   * hides the latency of the additions.  With Kahan's compensated
+   * summation, each accumulator carries the rounding error lost so
+   * far, which is subtracted from the next term.
+   */
+
+  // Entry maps of mm_map on the registers a and b
+  template<typename T,class R>
+  static inline R __attribute__((__always_inline__))
+  mapped(ops::identity,const R a,const R) {
+    return a;
+  }
+
+  template<typename T,class R>
+  static inline R __attribute__((__always_inline__))
+  mapped(ops::absolute,const R a,const R) {
+    const R zero = register_traits<isa,T>::set1(T(0));
+    return mm_op<ops::max,isa,T>::apply(
+             a,mm_op<ops::subtract,isa,T>::apply(zero,a));
+  }
+
+  template<typename T,class R>
+  static inline R __attribute__((__always_inline__))
+  mapped(ops::square,const R a,const R) {
+    return mm_op<ops::multiply,isa,T>::apply(a,a);
+  }
+
+  template<typename T,class R>
+  static inline R __attribute__((__always_inline__))
+  mapped(ops::multiply,const R a,const R b) {
+    return mm_op<ops::multiply,isa,T>::apply(a,b);
+  }
+
+  // s += x, with the compensation c if Kahan
+  template<typename T,bool Kahan,class R>
+  static inline void __attribute__((__always_inline__))
+  sumStep(R& s,R& c,const R x) {
+    typedef mm_op<ops::add,isa,T> add;
+    typedef mm_op<ops::subtract,isa,T> sub;
+    if (Kahan) {
+      const R y = sub::apply(x,c);
+      const R t = add::apply(s,y);
+      c = sub::apply(sub::apply(t,s),y);
+      s = t;
+    } else {
+      s = add::apply(s,x);
+    }
+  }
+
+  // Scalar version of sumStep
+  template<bool Kahan,typename T>
+  static inline void sumScalar(T& s,T& c,const T x) {
+    if (Kahan) {
+      const T y = x - c;
+      const T t = s + y;
+      c = (t - s) - y;
+      s = t;
+    } else {
+      s += x;
+    }
+  }
+
+  /*
+   * Sum of map(a[i],b[i]) for i in [0,n).  Unary maps ignore b.  The
+   * sum is accumulated in the scalar type of the registers.
+   */
+  template<class Map,bool Kahan,typename T>
+  static typename register_traits<isa,T>::scalar_type
+  reduce(const T* a,const T* b,const size_t n) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef typename traits::scalar_type S;
+    typedef mm_map<Map,isa,T> map;
+    constexpr size_t lanes = traits::lanes;
+    constexpr size_t acc = 4;
+
+    reg_type sum[acc],err[acc];
+    for (size_t k=0;k<acc;++k) {
+      sum[k] = err[k] = traits::set1(T(0));
+    }
+
+    size_t i=0;
+    for (;i+acc*lanes<=n;i+=acc*lanes) {
+      for (size_t k=0;k<acc;++k) {
+        const reg_type x = traits::load(a+i+k*lanes);
+        const reg_type y = map::binary ? traits::load(b+i+k*lanes) : x;
+        sumStep<T,Kahan>(sum[k],err[k],mapped<T>(Map(),x,y));
+      }
+    }
+    for (;i+lanes<=n;i+=lanes) {
+      const reg_type x = traits::load(a+i);
+      const reg_type y = map::binary ? traits::load(b+i) : x;
+      sumStep<T,Kahan>(sum[0],err[0],mapped<T>(Map(),x,y));
+    }
+
+    // combine the lanes of all accumulators
+    typedef register_traits<isa,S> sums;
+    S lane[acc][lanes],lerr[acc][lanes];
+    for (size_t k=0;k<acc;++k) {
+      sums::store(lane[k],sum[k]);
+      sums::store(lerr[k],err[k]);
+    }
+    S s(0),c(0);
+    for (size_t l=0;l<lanes;++l) {
+      for (size_t k=0;k<acc;++k) {
+        sumScalar<Kahan>(s,c,lane[k][l]);
+        if (Kahan) {
+          sumScalar<Kahan>(s,c,S(-lerr[k][l]));
+        }
+      }
+    }
+
+    // remaining entries not filling a whole register
+    for (;i<n;++i) {
+      sumScalar<Kahan>(s,c,ops::map_entry<Map>::apply(S(a[i]),S(b[i])));
+    }
+    return s;
+  }
+
+  /*
+   * s[i] += map(x[i]) for i in [0,n), with the compensations c if
+   * Kahan.  The sums have the scalar type S of the registers of T.
+   */
+  template<class Map,bool Kahan,typename S,typename T>
+  static void accumulate(S* s,S* c,const T* x,const size_t n) {
+    typedef register_traits<isa,T> traits;
+    typedef register_traits<isa,S> sums;
+    typedef typename traits::reg_type reg_type;
+    constexpr size_t lanes = traits::lanes;
+    static_assert( std::is_same<S,typename traits::scalar_type>::value,
+                   "Sums must have the scalar type of the registers" );
+
+    size_t i=0;
+    for (;i+lanes<=n;i+=lanes) {
+      reg_type si = sums::load(s+i);
+      reg_type ci = Kahan ? sums::load(c+i) : si;
+      const reg_type xi = traits::load(x+i);
+      sumStep<T,Kahan>(si,ci,mapped<T>(Map(),xi,xi));
+      sums::store(s+i,si);
+      if (Kahan) {
+        sums::store(c+i,ci);
+      }
+    }
+
+    S dummy(0);
+    for (;i<n;++i) {
+      sumScalar<Kahan>(s[i],Kahan ? c[i] : dummy,
+                       ops::map_entry<Map>::apply(S(x[i]),S(x[i])));
+    }
+  }
+
+  // Minimum (Op=ops::min) or maximum (Op=ops::max) of a[i], n > 0
+  template<class Op,typename T>
+  static T extremum(const T* a,const size_t n) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef mm_op<Op,isa,T> op;
+    constexpr size_t lanes = traits::lanes;
+    constexpr size_t acc = 4;
+
+    if (n < lanes) {
+      T m = a[0];
+      for (size_t i=1;i<n;++i) {
+        m = Op::apply(m,a[i]);
+      }
+      return m;
+    }
+
+    reg_type m[acc];
+    for (size_t k=0;k<acc;++k) {
+      m[k] = traits::load(a);
+    }
+
+    size_t i=0;
+    for (;i+acc*lanes<=n;i+=acc*lanes) {
+      for (size_t k=0;k<acc;++k) {
+        m[k] = op::apply(m[k],traits::load(a+i+k*lanes));
+      }
+    }
+    for (;i+lanes<=n;i+=lanes) {
+      m[0] = op::apply(m[0],traits::load(a+i));
+    }
+    // the last register may overlap entries already seen
+    m[1] = op::apply(m[1],traits::load(a+n-lanes));
+
+    T lane[acc][lanes];
+    for (size_t k=0;k<acc;++k) {
+      traits::store(lane[k],m[k]);
+    }
+    T r = lane[0][0];
+    for (size_t k=0;k<acc;++k) {
+      for (size_t l=0;l<lanes;++l) {
+        r = Op::apply(r,lane[k][l]);
+      }
+    }
+    return r;
+  }
+
+  /*
+   * Matrix product
+   */
+
+  // Size of the block of C kept in registers by the micro-kernel
+  template<typename T>
+  struct gemm_tile {
+    static constexpr size_t mr = ANPI_SIMD_GEMM_MR;
+    static constexpr size_t nr = 2*register_traits<isa,T>::lanes;
+  };
+
+  /*
+   * Micro-kernel c += alpha*a*b for a block of m<=mr rows and n<=nr
+   * columns of c.  The panel a holds kc columns of mr packed rows, and
+   * the panel b holds kc rows of nr packed columns, both zero padded.
+   */
+  template<typename T>
+  static void gemm(const size_t kc,
+                   const T alpha,
+                   const T* a,
+                   const T* b,
+                   T* c,
+                   const size_t ldc,
+                   const size_t m,
+                   const size_t n) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef mm_op<ops::fma,isa,T> fma;
+    constexpr size_t mr = gemm_tile<T>::mr;
+    constexpr size_t lanes = traits::lanes;
+
+    reg_type acc[mr][2];
+    for (size_t i=0;i<mr;++i) {
+      acc[i][0] = acc[i][1] = traits::set1(T(0));
+    }
+
+    // rank-1 updates with one row of b and the broadcasted column of a
+    for (size_t p=0;p<kc;++p,a+=mr,b+=2*lanes) {
+      const reg_type b0 = traits::load(b);
+      const reg_type b1 = traits::load(b+lanes);
+      for (size_t i=0;i<mr;++i) {
+        const reg_type ai = traits::set1(a[i]);
+        acc[i][0] = fma::apply(ai,b0,acc[i][0]);
+        acc[i][1] = fma::apply(ai,b1,acc[i][1]);
+      }
+    }
+
+    const reg_type valpha = traits::set1(alpha);
+    if ((m==mr) && (n==2*lanes)) {
+      for (size_t i=0;i<mr;++i,c+=ldc) {
+        traits::store(c,fma::apply(valpha,acc[i][0],traits::load(c)));
+        traits::store(c+lanes,
+                      fma::apply(valpha,acc[i][1],traits::load(c+lanes)));
+      }
+    } else {
+      // the block lies on the border of c
+      typedef typename traits::scalar_type S;
+      S tile[mr*2*lanes];
+      for (size_t i=0;i<m;++i) {
+        register_traits<isa,S>::store(tile+i*2*lanes,acc[i][0]);
+        register_traits<isa,S>::store(tile+i*2*lanes+lanes,acc[i][1]);
+      }
+      for (size_t i=0;i<m;++i,c+=ldc) {
+        for (size_t j=0;j<n;++j) {
+          c[j] = T(S(c[j]) + S(alpha)*tile[i*2*lanes+j]);
+        }
+      }
+    }
+  }
+
+  /*
+   * Matrix-vector products
+   *
+   * Several rows of the matrix are processed in each pass, so that
+   * each register of the vector is loaded once for all of them.
+   */
+
+  /*
+   * dots[r] = a_r . x for the R rows a_r of a, lda entries apart, in
+   * the scalar type S of the registers
+   */
+  template<size_t R,typename T,typename S>
+  static inline void __attribute__((__always_inline__))
+  gemvRows(const size_t n,const T* a,const size_t lda,const T* x,S* dots) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef mm_op<ops::fma,isa,T> fma;
+    constexpr size_t lanes = traits::lanes;
+
+    reg_type acc[R];
+    for (size_t r=0;r<R;++r) {
+      acc[r] = traits::set1(T(0));
+    }
+
+    size_t j=0;
+    for (;j+lanes<=n;j+=lanes) {
+      const reg_type xj = traits::load(x+j);
+      for (size_t r=0;r<R;++r) {
+        acc[r] = fma::apply(traits::load(a+r*lda+j),xj,acc[r]);
+      }
+    }
+
+    S lane[lanes];
+    for (size_t r=0;r<R;++r) {
+      register_traits<isa,S>::store(lane,acc[r]);
+      S s(0);
+      for (size_t l=0;l<lanes;++l) {
+        s += lane[l];
+      }
+      for (size_t k=j;k<n;++k) {
+        s += S(a[r*lda+k])*S(x[k]);
+      }
+      dots[r] = s;
+    }
+  }
+
+  // y[i] = alpha*(a_i . x) + beta*y[i] for the m rows a_i of a
+  template<typename T>
+  static void gemv(const size_t m,
+                   const size_t n,
+                   const T alpha,
+                   const T* a,
+                   const size_t lda,
+                   const T* x,
+                   const T beta,
+                   T* y) {
+    typedef typename register_traits<isa,T>::scalar_type S;
+    constexpr size_t rows = 4;
+    S dots[rows];
+    const S salpha(alpha),sbeta(beta);
+
+    size_t i=0;
+    for (;i+rows<=m;i+=rows) {
+      gemvRows<rows>(n,a+i*lda,lda,x,dots);
+      for (size_t r=0;r<rows;++r) {
+        y[i+r] = T((sbeta == S(0)) ? salpha*dots[r]
+                                   : salpha*dots[r] + sbeta*S(y[i+r]));
+      }
+    }
+    for (;i<m;++i) {
+      gemvRows<1>(n,a+i*lda,lda,x,dots);
+      y[i] = T((sbeta == S(0)) ? salpha*dots[0]
+                               : salpha*dots[0] + sbeta*S(y[i]));
+    }
+  }
+
+  /*
+   * y += ax[0]*a_0 + ... + ax[R-1]*a_(R-1) for the R rows a_r of a,
+   * with the factors ax in the scalar type S of the registers
+   */
+  template<size_t R,typename T,typename S>
+  static inline void __attribute__((__always_inline__))
+  gemvAxpyRows(const size_t n,const T* a,const size_t lda,const S* ax,T* y) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef mm_op<ops::fma,isa,T> fma;
+    constexpr size_t lanes = traits::lanes;
+
+    reg_type xr[R];
+    for (size_t r=0;r<R;++r) {
+      xr[r] = register_traits<isa,S>::set1(ax[r]);
+    }
+
+    size_t j=0;
+    for (;j+lanes<=n;j+=lanes) {
+      reg_type yj = traits::load(y+j);
+      for (size_t r=0;r<R;++r) {
+        yj = fma::apply(xr[r],traits::load(a+r*lda+j),yj);
+      }
+      traits::store(y+j,yj);
+    }
+    for (;j<n;++j) {
+      S yj(y[j]);
+      for (size_t r=0;r<R;++r) {
+        yj += ax[r]*S(a[r*lda+j]);
+      }
+      y[j] = T(yj);
+    }
+  }
+
+  // y[j] += alpha*sum_i x[i]*a_i[j] for the m rows a_i of a, of n entries
+  template<typename T>
+  static void gemvTransposed(const size_t m,
+                             const size_t n,
+                             const T alpha,
+                             const T* a,
+                             const size_t lda,
+                             const T* x,
+                             T* y) {
+    typedef typename register_traits<isa,T>::scalar_type S;
+    constexpr size_t rows = 4;
+    S ax[rows];
+
+    size_t i=0;
+    for (;i+rows<=m;i+=rows) {
+      for (size_t r=0;r<rows;++r) {
+        ax[r] = S(alpha)*S(x[i+r]);
+      }
+      gemvAxpyRows<rows>(n,a+i*lda,lda,ax,y);
+    }
+    for (;i<m;++i) {
+      ax[0] = S(alpha)*S(x[i]);
+      gemvAxpyRows<1>(n,a+i*lda,lda,ax,y);
+    }
+  }
+
+  /*
+   * Batched small matrices
+   *
+   * The entry (i,j) of all matrices of a batch with n columns is a row
+   * of lanes at p + (i*n + j)*ld, so that each register holds the same
+   * entry of several matrices, and each matrix is computed in its own
+   * lane.  These kernels only process whole registers: they return how
+   * many of the count lanes they computed, and the caller computes the
+   * remaining ones.
+   */
+
+  // c(i,j) = sum_p a(i,p)*b(p,j) for the R entries c(i,j+r) of a row of c
+  template<size_t R,typename T>
+  static inline void __attribute__((__always_inline__))
+  batchedProductRow(const size_t k,const size_t n,
+                    const T* a,const size_t lda,
+                    const T* b,const size_t ldb,
+                    T* c,const size_t ldc) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef mm_op<ops::fma,isa,T> fma;
+
+    reg_type acc[R];
+    for (size_t r=0;r<R;++r) {
+      acc[r] = traits::set1(T(0));
+    }
+    for (size_t p=0;p<k;++p) {
+      const reg_type ap = traits::load(a + p*lda);
+      const T* bp = b + p*n*ldb;
+      for (size_t r=0;r<R;++r) {
+        acc[r] = fma::apply(ap,traits::load(bp + r*ldb),acc[r]);
+      }
+    }
+    for (size_t r=0;r<R;++r) {
+      traits::store(c + r*ldc,acc[r]);
+    }
+  }
+
+  // c = a*b for m x k matrices a and k x n matrices b
+  template<typename T>
+  static size_t batchedProduct(const size_t m,
+                               const size_t k,
+                               const size_t n,
+                               const T* a,
+                               const size_t lda,
+                               const T* b,
+                               const size_t ldb,
+                               T* c,
+                               const size_t ldc,
+                               const size_t count) {
+    constexpr size_t lanes = register_traits<isa,T>::lanes;
+    constexpr size_t cols = 4;
+
+    size_t l=0;
+    for (;l+lanes<=count;l+=lanes) {
+      for (size_t i=0;i<m;++i) {
+        const T* ai = a + i*k*lda + l;
+        T* ci = c + i*n*ldc + l;
+        size_t j=0;
+        for (;j+cols<=n;j+=cols) {
+          batchedProductRow<cols>(k,n,ai,lda,b + j*ldb + l,ldb,ci + j*ldc,ldc);
+        }
+        for (;j<n;++j) {
+          batchedProductRow<1>(k,n,ai,lda,b + j*ldb + l,ldb,ci + j*ldc,ldc);
+        }
+      }
+    }
+    return l;
+  }
+
+  /*
+   * Step k of the LU factorization of n x n matrices a, whose pivots
+   * are already in row k: the multipliers replace the column k below
+   * the diagonal, and the rows below k are eliminated.
+   */
+  template<typename T>
+  static size_t batchedEliminate(const size_t n,
+                                 const size_t k,
+                                 T* a,
+                                 const size_t lda,
+                                 const size_t count) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef mm_op<ops::fma,isa,T> fma;
+    typedef mm_op<ops::divide,isa,T> div;
+    typedef mm_op<ops::subtract,isa,T> sub;
+    constexpr size_t lanes = traits::lanes;
+    const reg_type zero = traits::set1(T(0));
+
+    size_t l=0;
+    for (;l+lanes<=count;l+=lanes) {
+      const T* ak = a + k*n*lda + l;
+      const reg_type pivot = traits::load(ak + k*lda);
+      for (size_t i=k+1;i<n;++i) {
+        T* ai = a + i*n*lda + l;
+        const reg_type lik = div::apply(traits::load(ai + k*lda),pivot);
+        traits::store(ai + k*lda,lik);
+        const reg_type nlik = sub::apply(zero,lik);
+        for (size_t j=k+1;j<n;++j) {
+          traits::store(ai + j*lda,fma::apply(nlik,traits::load(ak + j*lda),
+                                              traits::load(ai + j*lda)));
+        }
+      }
+    }
+    return l;
+  }
+
+  /*
+   * Solution of L*U*X = B for the n x n factors packed in lu, with
+   * the n x m matrices b already permuted, overwritten with X.
+   */
+  template<typename T>
+  static size_t batchedSubstitute(const size_t n,
+                                  const size_t m,
+                                  const T* lu,
+                                  const size_t lda,
+                                  T* b,
+                                  const size_t ldb,
+                                  const size_t count) {
+    typedef register_traits<isa,T> traits;
+    typedef typename traits::reg_type reg_type;
+    typedef mm_op<ops::multiply,isa,T> mul;
+    typedef mm_op<ops::divide,isa,T> div;
+    typedef mm_op<ops::subtract,isa,T> sub;
+    constexpr size_t lanes = traits::lanes;
+
+    size_t l=0;
+    for (;l+lanes<=count;l+=lanes) {
+      // Y = L^-1 * B, with the unit diagonal of L
+      for (size_t i=1;i<n;++i) {
+        const T* li = lu + i*n*lda + l;
+        for (size_t j=0;j<m;++j) {
+          T* bij = b + (i*m + j)*ldb + l;
+          reg_type acc = traits::load(bij);
+          for (size_t p=0;p<i;++p) {
+            acc = sub::apply(acc,mul::apply(traits::load(li + p*lda),
+                                            traits::load(b + (p*m + j)*ldb + l)));
+          }
+          traits::store(bij,acc);
+        }
+      }
+
+      // X = U^-1 * Y
+      for (size_t i=n;i-- > 0;) {
+        const T* ui = lu + i*n*lda + l;
+        const reg_type uii = traits::load(ui + i*lda);
+        for (size_t j=0;j<m;++j) {
+          T* bij = b + (i*m + j)*ldb + l;
+          reg_type acc = traits::load(bij);
+          for (size_t p=i+1;p<n;++p) {
+            acc = sub::apply(acc,mul::apply(traits::load(ui + p*lda),
+                                            traits::load(b + (p*m + j)*ldb + l)));
+          }
+          traits::store(bij,div::apply(acc,uii));
+        }
+      }
+    }
+    return l;
+  }
+};
@@ -0,0 +1,765 @@
+/*
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, ITCR, Costa Rica
+ *
+ * This file is part of the numerical analysis lecture CE3102 at TEC
+ *
+ * @Author: Pablo Alvarado
+ * @Date:   28.12.2017
+ */
+
+#ifndef ANPI_SIMD_OPERATIONS_HPP
+#define ANPI_SIMD_OPERATIONS_HPP
+
+#include "Intrinsics.hpp"
+#include "MatrixExpression.hpp"
+
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+namespace anpi
+{
+  namespace simd
+  {
+    /**
+     * @name Instruction set tags
+     *
+     * Each tag identifies the set of registers used by the SIMD
+     * kernels.  On x86 all of them are compiled in, and the best one
+     * supported by the CPU is selected at runtime (see SimdDispatch.hpp).
+     */
+    //@{
+    /// No SIMD support at all
+    struct none   { };
+    /// 128 bit registers (SSE2)
+    struct sse2   { };
+    /// 256 bit registers (AVX2, FMA and F16C)
+    struct avx    { };
+    /// 512 bit registers (AVX512F, AVX512BW and AVX512DQ)
+    struct avx512 { };
+    //@}
+
+    /**
+     * Registers used for the elements of type T with the instruction
+     * set Isa.
+     *
+     * Each specialization provides the register type, the number of
+     * lanes, and methods to load, store and broadcast values.  Loads
+     * and stores do not require any alignment.
+     *
+     * The lanes hold values of scalar_type, which is T except for the
+     * 16 bit floating point types: their registers hold floats, which
+     * are converted from and to T by the loads and stores.
+     */
+    template<class Isa,typename T>
+    struct register_traits {
+      static constexpr bool supported = false;
+    };
+
+    /**
+     * Table of element-wise operations on registers.
+     *
+     * The primary template marks a combination of operation,
+     * instruction set and element type as unsupported, in which case
+     * the kernels use the scalar fallback.  Each entry of the table
+     * below specializes this with the corresponding intrinsic.
+     */
+    template<class Op,class Isa,typename T>
+    struct mm_op {
+      static constexpr bool supported = false;
+    };
+
+    /**
+     * Raw memory transfers with the widest registers of the
+     * instruction set Isa, regardless of the element type.
+     *
+     * Besides unaligned loads and stores, each specialization provides
+     * non-temporal (streaming) stores, which bypass the caches and
+     * require an address aligned to the register size.  They must be
+     * followed by fence() before other threads read the memory.
+     */
+    template<class Isa>
+    struct memory_traits {
+      static constexpr bool supported = false;
+    };
+
+    /**
+     * Transpose of square tiles held in registers, for elements of the
+     * given number of bytes.
+     *
+     * A transpose only moves bits around, so that the same shuffles
+     * serve all element types of the same width.  Each specialization
+     * provides the size of the tile, and the method apply(), which
+     * transposes the size x size tile at src into dst.  The distances
+     * between rows (lds and ldd) are given in bytes.
+     */
+    template<class Isa,size_t Bytes>
+    struct transpose_traits {
+      static constexpr bool supported = false;
+    };
+
+    /*
+     * Register traits of each instruction set
+     */
+#define ANPI_SIMD_MEMORY(ISA,REG,LOADU,STOREU,STREAM)                   \
+    template<>                                                          \
+    struct memory_traits<ISA> {                                         \
+      static constexpr bool supported = true;                           \
+      typedef REG reg_type;                                             \
+      static constexpr size_t bytes = sizeof(REG);                      \
+                                                                        \
+      static inline reg_type __attribute__((__always_inline__))         \
+      load(const char* p) {                                             \
+        return LOADU(reinterpret_cast<const REG*>(p));                  \
+      }                                                                 \
+      static inline void __attribute__((__always_inline__))             \
+      store(char* p,const reg_type r) {                                 \
+        STOREU(reinterpret_cast<REG*>(p),r);                            \
+      }                                                                 \
+      static inline void __attribute__((__always_inline__))             \
+      stream(char* p,const reg_type r) {                                \
+        STREAM(reinterpret_cast<REG*>(p),r);                            \
+      }                                                                 \
+      static inline void __attribute__((__always_inline__))             \
+      fence() {                                                         \
+        _mm_sfence();                                                   \
+      }                                                                 \
+    }
+
+#define ANPI_SIMD_REGISTER(ISA,T,REG,SET1,CAST)                         \
+    template<>                                                          \
+    struct register_traits<ISA,T> {                                     \
+      static constexpr bool supported = true;                           \
+      typedef REG reg_type;                                             \
+      typedef T scalar_type;                                            \
+      static constexpr size_t lanes = sizeof(REG)/sizeof(T);            \
+                                                                        \
+      static inline reg_type __attribute__((__always_inline__))         \
+      load(const T* p) {                                                \
+        reg_type r;                                                     \
+        std::memcpy(&r,p,sizeof(reg_type));                             \
+        return r;                                                       \
+      }                                                                 \
+      static inline void __attribute__((__always_inline__))             \
+      store(T* p,const reg_type r) {                                    \
+        std::memcpy(p,&r,sizeof(reg_type));                             \
+      }                                                                 \
+      static inline reg_type __attribute__((__always_inline__))         \
+      set1(const T v) {                                                 \
+        return SET1(static_cast<CAST>(v));                              \
+      }                                                                 \
+    }
+
+    /*
+     * Registers of floats for the 16 bit floating point types.  LOAD
+     * converts lanes entries at p to floats, and STORE rounds the
+     * floats back to T.
+     */
+#define ANPI_SIMD_HALF(ISA,T,REG,SET1,LOAD,STORE)                       \
+    template<>                                                          \
+    struct register_traits<ISA,T> {                                     \
+      static constexpr bool supported = true;                           \
+      typedef REG reg_type;                                             \
+      typedef float scalar_type;                                        \
+      static constexpr size_t lanes = sizeof(REG)/sizeof(float);        \
+                                                                        \
+      static inline reg_type __attribute__((__always_inline__))         \
+      load(const T* p) {                                                \
+        return LOAD(p);                                                 \
+      }                                                                 \
+      static inline void __attribute__((__always_inline__))             \
+      store(T* p,const reg_type r) {                                    \
+        STORE(p,r);                                                     \
+      }                                                                 \
+      static inline reg_type __attribute__((__always_inline__))         \
+      set1(const T v) {                                                 \
+        return SET1(float(v));                                          \
+      }                                                                 \
+    }
+
+    /*
+     * Binary and ternary entries of the operation table
+     */
+#define ANPI_SIMD_BINARY(OP,ISA,T,REG,INTRINSIC)                        \
+    template<>                                                          \
+    struct mm_op<ops::OP,ISA,T> {                                       \
+      static constexpr bool supported = true;                           \
+      static inline REG __attribute__((__always_inline__))              \
+      apply(const REG a,const REG b) {                                  \
+        return INTRINSIC(a,b);                                          \
+      }                                                                 \
+    }
+
+#define ANPI_SIMD_FMA(ISA,T,REG,MUL,ADD)                                \
+    template<>                                                          \
+    struct mm_op<ops::fma,ISA,T> {                                      \
+      static constexpr bool supported = true;                           \
+      static inline REG __attribute__((__always_inline__))              \
+      apply(const REG a,const REG b,const REG c) {                      \
+        return ADD(MUL(a,b),c);                                         \
+      }                                                                 \
+    }
+
+#define ANPI_SIMD_FUSED(ISA,T,REG,FMADD)                                \
+    template<>                                                          \
+    struct mm_op<ops::fma,ISA,T> {                                      \
+      static constexpr bool supported = true;                           \
+      static inline REG __attribute__((__always_inline__))              \
+      apply(const REG a,const REG b,const REG c) {                      \
+        return FMADD(a,b,c);                                            \
+      }                                                                 \
+    }
+
+    /*
+     * Operations shared by all integer types of the same width, since
+     * the two-complement representation makes them sign agnostic
+     */
+#define ANPI_SIMD_INTEGER(OP,ISA,BITS,REG,INTRINSIC)                    \
+    ANPI_SIMD_BINARY(OP,ISA,std::int##BITS##_t,REG,INTRINSIC);          \
+    ANPI_SIMD_BINARY(OP,ISA,std::uint##BITS##_t,REG,INTRINSIC)
+
+
+#ifdef ANPI_SIMD_X86
+    /*
+     * SSE2: 128 bit registers
+     */
+ANPI_SIMD_BEGIN_SSE2
+    ANPI_SIMD_MEMORY(sse2,__m128i,_mm_loadu_si128,_mm_storeu_si128,
+                     _mm_stream_si128);
+
+    ANPI_SIMD_REGISTER(sse2,double       ,__m128d,_mm_set1_pd   ,double);
+    ANPI_SIMD_REGISTER(sse2,float        ,__m128 ,_mm_set1_ps   ,float);
+    ANPI_SIMD_REGISTER(sse2,std::int64_t ,__m128i,_mm_set1_epi64x,long long);
+    ANPI_SIMD_REGISTER(sse2,std::uint64_t,__m128i,_mm_set1_epi64x,long long);
+    ANPI_SIMD_REGISTER(sse2,std::int32_t ,__m128i,_mm_set1_epi32,int);
+    ANPI_SIMD_REGISTER(sse2,std::uint32_t,__m128i,_mm_set1_epi32,int);
+    ANPI_SIMD_REGISTER(sse2,std::int16_t ,__m128i,_mm_set1_epi16,short);
+    ANPI_SIMD_REGISTER(sse2,std::uint16_t,__m128i,_mm_set1_epi16,short);
+    ANPI_SIMD_REGISTER(sse2,std::int8_t  ,__m128i,_mm_set1_epi8 ,char);
+    ANPI_SIMD_REGISTER(sse2,std::uint8_t ,__m128i,_mm_set1_epi8 ,char);
+
+    /*
+     * bfloat16 is the upper half of a float: loads shift the entries
+     * into place, and stores round to nearest even with integer
+     * arithmetic, keeping NaNs quiet.  SSE2 has no fp16 conversions,
+     * which use the scalar code.
+     */
+    static inline __m128 __attribute__((__always_inline__))
+    sse2LoadBf16(const bf16* p) {
+      const __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+      return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(),h));
+    }
+
+    static inline __m128i __attribute__((__always_inline__))
+    sse2RoundBf16(const __m128 r) {
+      const __m128i u = _mm_castps_si128(r);
+      const __m128i odd = _mm_and_si128(_mm_srli_epi32(u,16),
+                                        _mm_set1_epi32(1));
+      const __m128i rounded =
+        _mm_add_epi32(u,_mm_add_epi32(_mm_set1_epi32(0x7fff),odd));
+      const __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(r,r));
+      const __m128i quiet = _mm_or_si128(u,_mm_set1_epi32(0x400000));
+      // the upper halves, sign extended so that packs keeps them
+      return _mm_srai_epi32(_mm_or_si128(_mm_and_si128(nan,quiet),
+                                         _mm_andnot_si128(nan,rounded)),16);
+    }
+
+    static inline void __attribute__((__always_inline__))
+    sse2StoreBf16(bf16* p,const __m128 r) {
+      const __m128i h = sse2RoundBf16(r);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(p),_mm_packs_epi32(h,h));
+    }
+
+    ANPI_SIMD_HALF(sse2,bf16,__m128,_mm_set1_ps,sse2LoadBf16,sse2StoreBf16);
+
+    ANPI_SIMD_BINARY(add     ,sse2,double,__m128d,_mm_add_pd);
+    ANPI_SIMD_BINARY(subtract,sse2,double,__m128d,_mm_sub_pd);
+    ANPI_SIMD_BINARY(multiply,sse2,double,__m128d,_mm_mul_pd);
+    ANPI_SIMD_BINARY(divide  ,sse2,double,__m128d,_mm_div_pd);
+    ANPI_SIMD_BINARY(min     ,sse2,double,__m128d,_mm_min_pd);
+    ANPI_SIMD_BINARY(max     ,sse2,double,__m128d,_mm_max_pd);
+    ANPI_SIMD_FMA   (         sse2,double,__m128d,_mm_mul_pd,_mm_add_pd);
+
+    ANPI_SIMD_BINARY(add     ,sse2,float,__m128,_mm_add_ps);
+    ANPI_SIMD_BINARY(subtract,sse2,float,__m128,_mm_sub_ps);
+    ANPI_SIMD_BINARY(multiply,sse2,float,__m128,_mm_mul_ps);
+    ANPI_SIMD_BINARY(divide  ,sse2,float,__m128,_mm_div_ps);
+    ANPI_SIMD_BINARY(min     ,sse2,float,__m128,_mm_min_ps);
+    ANPI_SIMD_BINARY(max     ,sse2,float,__m128,_mm_max_ps);
+    ANPI_SIMD_FMA   (         sse2,float,__m128,_mm_mul_ps,_mm_add_ps);
+
+    ANPI_SIMD_INTEGER(add     ,sse2,64,__m128i,_mm_add_epi64);
+    ANPI_SIMD_INTEGER(subtract,sse2,64,__m128i,_mm_sub_epi64);
+    ANPI_SIMD_INTEGER(add     ,sse2,32,__m128i,_mm_add_epi32);
+    ANPI_SIMD_INTEGER(subtract,sse2,32,__m128i,_mm_sub_epi32);
+    ANPI_SIMD_INTEGER(add     ,sse2,16,__m128i,_mm_add_epi16);
+    ANPI_SIMD_INTEGER(subtract,sse2,16,__m128i,_mm_sub_epi16);
+    ANPI_SIMD_INTEGER(multiply,sse2,16,__m128i,_mm_mullo_epi16);
+    ANPI_SIMD_INTEGER(add     ,sse2, 8,__m128i,_mm_add_epi8);
+    ANPI_SIMD_INTEGER(subtract,sse2, 8,__m128i,_mm_sub_epi8);
+
+    ANPI_SIMD_FMA   (sse2,std::int16_t ,__m128i,_mm_mullo_epi16,_mm_add_epi16);
+    ANPI_SIMD_FMA   (sse2,std::uint16_t,__m128i,_mm_mullo_epi16,_mm_add_epi16);
+
+    ANPI_SIMD_BINARY(min,sse2,std::int16_t,__m128i,_mm_min_epi16);
+    ANPI_SIMD_BINARY(max,sse2,std::int16_t,__m128i,_mm_max_epi16);
+    ANPI_SIMD_BINARY(min,sse2,std::uint8_t,__m128i,_mm_min_epu8);
+    ANPI_SIMD_BINARY(max,sse2,std::uint8_t,__m128i,_mm_max_epu8);
+
+    /*
+     * The 32 bit products and the remaining integer extrema need
+     * SSE4.1, which is not part of this level: on CPUs without AVX2
+     * they use the scalar code.
+     */
+ANPI_SIMD_END
+
+    /*
+     * AVX: 256 bit registers, including the integer arithmetic of AVX2
+     */
+ANPI_SIMD_BEGIN_AVX
+    ANPI_SIMD_MEMORY(avx,__m256i,_mm256_loadu_si256,_mm256_storeu_si256,
+                     _mm256_stream_si256);
+
+    ANPI_SIMD_REGISTER(avx,double       ,__m256d,_mm256_set1_pd   ,double);
+    ANPI_SIMD_REGISTER(avx,float        ,__m256 ,_mm256_set1_ps   ,float);
+    ANPI_SIMD_REGISTER(avx,std::int64_t ,__m256i,_mm256_set1_epi64x,long long);
+    ANPI_SIMD_REGISTER(avx,std::uint64_t,__m256i,_mm256_set1_epi64x,long long);
+    ANPI_SIMD_REGISTER(avx,std::int32_t ,__m256i,_mm256_set1_epi32,int);
+    ANPI_SIMD_REGISTER(avx,std::uint32_t,__m256i,_mm256_set1_epi32,int);
+    ANPI_SIMD_REGISTER(avx,std::int16_t ,__m256i,_mm256_set1_epi16,short);
+    ANPI_SIMD_REGISTER(avx,std::uint16_t,__m256i,_mm256_set1_epi16,short);
+    ANPI_SIMD_REGISTER(avx,std::int8_t  ,__m256i,_mm256_set1_epi8 ,char);
+    ANPI_SIMD_REGISTER(avx,std::uint8_t ,__m256i,_mm256_set1_epi8 ,char);
+
+    // fp16 with the F16C conversions, bf16 as with SSE2
+    static inline __m256 __attribute__((__always_inline__))
+    avxLoadFp16(const fp16* p) {
+      return _mm256_cvtph_ps(
+               _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    static inline void __attribute__((__always_inline__))
+    avxStoreFp16(fp16* p,const __m256 r) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                       _mm256_cvtps_ph(r,_MM_FROUND_TO_NEAREST_INT |
+                                         _MM_FROUND_NO_EXC));
+    }
+
+    static inline __m256 __attribute__((__always_inline__))
+    avxLoadBf16(const bf16* p) {
+      const __m256i h = _mm256_cvtepu16_epi32(
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+      return _mm256_castsi256_ps(_mm256_slli_epi32(h,16));
+    }
+
+    static inline void __attribute__((__always_inline__))
+    avxStoreBf16(bf16* p,const __m256 r) {
+      const __m256i u = _mm256_castps_si256(r);
+      const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u,16),
+                                           _mm256_set1_epi32(1));
+      const __m256i rounded =
+        _mm256_add_epi32(u,_mm256_add_epi32(_mm256_set1_epi32(0x7fff),odd));
+      const __m256i nan =
+        _mm256_castps_si256(_mm256_cmp_ps(r,r,_CMP_UNORD_Q));
+      const __m256i quiet = _mm256_or_si256(u,_mm256_set1_epi32(0x400000));
+      const __m256i h =
+        _mm256_srai_epi32(_mm256_blendv_epi8(rounded,quiet,nan),16);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                       _mm_packs_epi32(_mm256_castsi256_si128(h),
+                                       _mm256_extracti128_si256(h,1)));
+    }
+
+    ANPI_SIMD_HALF(avx,fp16,__m256,_mm256_set1_ps,avxLoadFp16,avxStoreFp16);
+    ANPI_SIMD_HALF(avx,bf16,__m256,_mm256_set1_ps,avxLoadBf16,avxStoreBf16);
+
+    ANPI_SIMD_BINARY(add     ,avx,double,__m256d,_mm256_add_pd);
+    ANPI_SIMD_BINARY(subtract,avx,double,__m256d,_mm256_sub_pd);
+    ANPI_SIMD_BINARY(multiply,avx,double,__m256d,_mm256_mul_pd);
+    ANPI_SIMD_BINARY(divide  ,avx,double,__m256d,_mm256_div_pd);
+    ANPI_SIMD_BINARY(min     ,avx,double,__m256d,_mm256_min_pd);
+    ANPI_SIMD_BINARY(max     ,avx,double,__m256d,_mm256_max_pd);
+
+    ANPI_SIMD_BINARY(add     ,avx,float,__m256,_mm256_add_ps);
+    ANPI_SIMD_BINARY(subtract,avx,float,__m256,_mm256_sub_ps);
+    ANPI_SIMD_BINARY(multiply,avx,float,__m256,_mm256_mul_ps);
+    ANPI_SIMD_BINARY(divide  ,avx,float,__m256,_mm256_div_ps);
+    ANPI_SIMD_BINARY(min     ,avx,float,__m256,_mm256_min_ps);
+    ANPI_SIMD_BINARY(max     ,avx,float,__m256,_mm256_max_ps);
+
+    ANPI_SIMD_FUSED (avx,double,__m256d,_mm256_fmadd_pd);
+    ANPI_SIMD_FUSED (avx,float ,__m256 ,_mm256_fmadd_ps);
+
+    ANPI_SIMD_INTEGER(add     ,avx,64,__m256i,_mm256_add_epi64);
+    ANPI_SIMD_INTEGER(subtract,avx,64,__m256i,_mm256_sub_epi64);
+    ANPI_SIMD_INTEGER(add     ,avx,32,__m256i,_mm256_add_epi32);
+    ANPI_SIMD_INTEGER(subtract,avx,32,__m256i,_mm256_sub_epi32);
+    ANPI_SIMD_INTEGER(multiply,avx,32,__m256i,_mm256_mullo_epi32);
+    ANPI_SIMD_INTEGER(add     ,avx,16,__m256i,_mm256_add_epi16);
+    ANPI_SIMD_INTEGER(subtract,avx,16,__m256i,_mm256_sub_epi16);
+    ANPI_SIMD_INTEGER(multiply,avx,16,__m256i,_mm256_mullo_epi16);
+    ANPI_SIMD_INTEGER(add     ,avx, 8,__m256i,_mm256_add_epi8);
+    ANPI_SIMD_INTEGER(subtract,avx, 8,__m256i,_mm256_sub_epi8);
+
+    ANPI_SIMD_FMA   (avx,std::int32_t ,__m256i,_mm256_mullo_epi32,_mm256_add_epi32);
+    ANPI_SIMD_FMA   (avx,std::uint32_t,__m256i,_mm256_mullo_epi32,_mm256_add_epi32);
+    ANPI_SIMD_FMA   (avx,std::int16_t ,__m256i,_mm256_mullo_epi16,_mm256_add_epi16);
+    ANPI_SIMD_FMA   (avx,std::uint16_t,__m256i,_mm256_mullo_epi16,_mm256_add_epi16);
+
+    ANPI_SIMD_BINARY(min,avx,std::int32_t ,__m256i,_mm256_min_epi32);
+    ANPI_SIMD_BINARY(max,avx,std::int32_t ,__m256i,_mm256_max_epi32);
+    ANPI_SIMD_BINARY(min,avx,std::uint32_t,__m256i,_mm256_min_epu32);
+    ANPI_SIMD_BINARY(max,avx,std::uint32_t,__m256i,_mm256_max_epu32);
+    ANPI_SIMD_BINARY(min,avx,std::int16_t ,__m256i,_mm256_min_epi16);
+    ANPI_SIMD_BINARY(max,avx,std::int16_t ,__m256i,_mm256_max_epi16);
+    ANPI_SIMD_BINARY(min,avx,std::uint16_t,__m256i,_mm256_min_epu16);
+    ANPI_SIMD_BINARY(max,avx,std::uint16_t,__m256i,_mm256_max_epu16);
+    ANPI_SIMD_BINARY(min,avx,std::int8_t  ,__m256i,_mm256_min_epi8);
+    ANPI_SIMD_BINARY(max,avx,std::int8_t  ,__m256i,_mm256_max_epi8);
+    ANPI_SIMD_BINARY(min,avx,std::uint8_t ,__m256i,_mm256_min_epu8);
+    ANPI_SIMD_BINARY(max,avx,std::uint8_t ,__m256i,_mm256_max_epu8);
+ANPI_SIMD_END
+
+    /*
+     * AVX-512: 512 bit registers, with the 8 and 16 bit integers of
+     * AVX512BW and the 64 bit multiplication of AVX512DQ
+     */
+ANPI_SIMD_BEGIN_AVX512
+    ANPI_SIMD_MEMORY(avx512,__m512i,_mm512_loadu_si512,_mm512_storeu_si512,
+                     _mm512_stream_si512);
+
+    ANPI_SIMD_REGISTER(avx512,double       ,__m512d,_mm512_set1_pd   ,double);
+    ANPI_SIMD_REGISTER(avx512,float        ,__m512 ,_mm512_set1_ps   ,float);
+    ANPI_SIMD_REGISTER(avx512,std::int64_t ,__m512i,_mm512_set1_epi64,long long);
+    ANPI_SIMD_REGISTER(avx512,std::uint64_t,__m512i,_mm512_set1_epi64,long long);
+    ANPI_SIMD_REGISTER(avx512,std::int32_t ,__m512i,_mm512_set1_epi32,int);
+    ANPI_SIMD_REGISTER(avx512,std::uint32_t,__m512i,_mm512_set1_epi32,int);
+    ANPI_SIMD_REGISTER(avx512,std::int16_t ,__m512i,_mm512_set1_epi16,short);
+    ANPI_SIMD_REGISTER(avx512,std::uint16_t,__m512i,_mm512_set1_epi16,short);
+    ANPI_SIMD_REGISTER(avx512,std::int8_t  ,__m512i,_mm512_set1_epi8 ,char);
+    ANPI_SIMD_REGISTER(avx512,std::uint8_t ,__m512i,_mm512_set1_epi8 ,char);
+
+    // The 16 bit floats of a register fill half a 512 bit register
+    static inline __m512 __attribute__((__always_inline__))
+    avx512LoadFp16(const fp16* p) {
+      return _mm512_cvtph_ps(
+               _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    }
+
+    static inline void __attribute__((__always_inline__))
+    avx512StoreFp16(fp16* p,const __m512 r) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(p),
+                          _mm512_cvtps_ph(r,_MM_FROUND_TO_NEAREST_INT |
+                                            _MM_FROUND_NO_EXC));
+    }
+
+    static inline __m512 __attribute__((__always_inline__))
+    avx512LoadBf16(const bf16* p) {
+      const __m512i h = _mm512_cvtepu16_epi32(
+                          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+      return _mm512_castsi512_ps(_mm512_slli_epi32(h,16));
+    }
+
+    static inline void __attribute__((__always_inline__))
+    avx512StoreBf16(bf16* p,const __m512 r) {
+      const __m512i u = _mm512_castps_si512(r);
+      const __m512i odd = _mm512_and_si512(_mm512_srli_epi32(u,16),
+                                           _mm512_set1_epi32(1));
+      const __m512i rounded =
+        _mm512_add_epi32(u,_mm512_add_epi32(_mm512_set1_epi32(0x7fff),odd));
+      const __mmask16 nan = _mm512_cmp_ps_mask(r,r,_CMP_UNORD_Q);
+      const __m512i quiet = _mm512_or_si512(u,_mm512_set1_epi32(0x400000));
+      const __m512i h =
+        _mm512_srli_epi32(_mm512_mask_blend_epi32(nan,rounded,quiet),16);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(p),
+                          _mm512_cvtepi32_epi16(h));
+    }
+
+    ANPI_SIMD_HALF(avx512,fp16,__m512,_mm512_set1_ps,
+                   avx512LoadFp16,avx512StoreFp16);
+    ANPI_SIMD_HALF(avx512,bf16,__m512,_mm512_set1_ps,
+                   avx512LoadBf16,avx512StoreBf16);
+
+    ANPI_SIMD_BINARY(add     ,avx512,double,__m512d,_mm512_add_pd);
+    ANPI_SIMD_BINARY(subtract,avx512,double,__m512d,_mm512_sub_pd);
+    ANPI_SIMD_BINARY(multiply,avx512,double,__m512d,_mm512_mul_pd);
+    ANPI_SIMD_BINARY(divide  ,avx512,double,__m512d,_mm512_div_pd);
+    ANPI_SIMD_BINARY(min     ,avx512,double,__m512d,_mm512_min_pd);
+    ANPI_SIMD_BINARY(max     ,avx512,double,__m512d,_mm512_max_pd);
+    ANPI_SIMD_FUSED (         avx512,double,__m512d,_mm512_fmadd_pd);
+
+    ANPI_SIMD_BINARY(add     ,avx512,float,__m512,_mm512_add_ps);
+    ANPI_SIMD_BINARY(subtract,avx512,float,__m512,_mm512_sub_ps);
+    ANPI_SIMD_BINARY(multiply,avx512,float,__m512,_mm512_mul_ps);
+    ANPI_SIMD_BINARY(divide  ,avx512,float,__m512,_mm512_div_ps);
+    ANPI_SIMD_BINARY(min     ,avx512,float,__m512,_mm512_min_ps);
+    ANPI_SIMD_BINARY(max     ,avx512,float,__m512,_mm512_max_ps);
+    ANPI_SIMD_FUSED (         avx512,float,__m512,_mm512_fmadd_ps);
+
+    ANPI_SIMD_INTEGER(add     ,avx512,64,__m512i,_mm512_add_epi64);
+    ANPI_SIMD_INTEGER(subtract,avx512,64,__m512i,_mm512_sub_epi64);
+    ANPI_SIMD_INTEGER(add     ,avx512,32,__m512i,_mm512_add_epi32);
+    ANPI_SIMD_INTEGER(subtract,avx512,32,__m512i,_mm512_sub_epi32);
+    ANPI_SIMD_INTEGER(multiply,avx512,32,__m512i,_mm512_mullo_epi32);
+
+    ANPI_SIMD_FMA   (avx512,std::int32_t ,__m512i,_mm512_mullo_epi32,_mm512_add_epi32);
+    ANPI_SIMD_FMA   (avx512,std::uint32_t,__m512i,_mm512_mullo_epi32,_mm512_add_epi32);
+
+    ANPI_SIMD_BINARY(min,avx512,std::int64_t ,__m512i,_mm512_min_epi64);
+    ANPI_SIMD_BINARY(max,avx512,std::int64_t ,__m512i,_mm512_max_epi64);
+    ANPI_SIMD_BINARY(min,avx512,std::uint64_t,__m512i,_mm512_min_epu64);
+    ANPI_SIMD_BINARY(max,avx512,std::uint64_t,__m512i,_mm512_max_epu64);
+    ANPI_SIMD_BINARY(min,avx512,std::int32_t ,__m512i,_mm512_min_epi32);
+    ANPI_SIMD_BINARY(max,avx512,std::int32_t ,__m512i,_mm512_max_epi32);
+    ANPI_SIMD_BINARY(min,avx512,std::uint32_t,__m512i,_mm512_min_epu32);
+    ANPI_SIMD_BINARY(max,avx512,std::uint32_t,__m512i,_mm512_max_epu32);
+
+    ANPI_SIMD_INTEGER(multiply,avx512,64,__m512i,_mm512_mullo_epi64);
+    ANPI_SIMD_FMA   (avx512,std::int64_t ,__m512i,_mm512_mullo_epi64,_mm512_add_epi64);
+    ANPI_SIMD_FMA   (avx512,std::uint64_t,__m512i,_mm512_mullo_epi64,_mm512_add_epi64);
+
+    ANPI_SIMD_INTEGER(add     ,avx512,16,__m512i,_mm512_add_epi16);
+    ANPI_SIMD_INTEGER(subtract,avx512,16,__m512i,_mm512_sub_epi16);
+    ANPI_SIMD_INTEGER(multiply,avx512,16,__m512i,_mm512_mullo_epi16);
+    ANPI_SIMD_INTEGER(add     ,avx512, 8,__m512i,_mm512_add_epi8);
+    ANPI_SIMD_INTEGER(subtract,avx512, 8,__m512i,_mm512_sub_epi8);
+
+    ANPI_SIMD_FMA   (avx512,std::int16_t ,__m512i,_mm512_mullo_epi16,_mm512_add_epi16);
+    ANPI_SIMD_FMA   (avx512,std::uint16_t,__m512i,_mm512_mullo_epi16,_mm512_add_epi16);
+
+    ANPI_SIMD_BINARY(min,avx512,std::int16_t ,__m512i,_mm512_min_epi16);
+    ANPI_SIMD_BINARY(max,avx512,std::int16_t ,__m512i,_mm512_max_epi16);
+    ANPI_SIMD_BINARY(min,avx512,std::uint16_t,__m512i,_mm512_min_epu16);
+    ANPI_SIMD_BINARY(max,avx512,std::uint16_t,__m512i,_mm512_max_epu16);
+    ANPI_SIMD_BINARY(min,avx512,std::int8_t  ,__m512i,_mm512_min_epi8);
+    ANPI_SIMD_BINARY(max,avx512,std::int8_t  ,__m512i,_mm512_max_epi8);
+    ANPI_SIMD_BINARY(min,avx512,std::uint8_t ,__m512i,_mm512_min_epu8);
+    ANPI_SIMD_BINARY(max,avx512,std::uint8_t ,__m512i,_mm512_max_epu8);
+ANPI_SIMD_END
+#endif
+
+#ifdef ANPI_SIMD_X86
+    /*
+     * Register tiles of the transpose
+     */
+ANPI_SIMD_BEGIN_SSE2
+    // 4x4 tile of 32 bit elements
+    template<>
+    struct transpose_traits<sse2,4> {
+      static constexpr bool supported = true;
+      static constexpr size_t size = 4;
+
+      static inline void __attribute__((__always_inline__))
+      apply(const char* src,const size_t lds,char* dst,const size_t ldd) {
+        __m128 r0 = _mm_loadu_ps(reinterpret_cast<const float*>(src));
+        __m128 r1 = _mm_loadu_ps(reinterpret_cast<const float*>(src+lds));
+        __m128 r2 = _mm_loadu_ps(reinterpret_cast<const float*>(src+2*lds));
+        __m128 r3 = _mm_loadu_ps(reinterpret_cast<const float*>(src+3*lds));
+        _MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst),r0);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst+ldd),r1);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst+2*ldd),r2);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst+3*ldd),r3);
+      }
+    };
+
+    // 2x2 tile of 64 bit elements
+    template<>
+    struct transpose_traits<sse2,8> {
+      static constexpr bool supported = true;
+      static constexpr size_t size = 2;
+
+      static inline void __attribute__((__always_inline__))
+      apply(const char* src,const size_t lds,char* dst,const size_t ldd) {
+        const __m128d r0 = _mm_loadu_pd(reinterpret_cast<const double*>(src));
+        const __m128d r1 =
+          _mm_loadu_pd(reinterpret_cast<const double*>(src+lds));
+        _mm_storeu_pd(reinterpret_cast<double*>(dst),_mm_unpacklo_pd(r0,r1));
+        _mm_storeu_pd(reinterpret_cast<double*>(dst+ldd),
+                      _mm_unpackhi_pd(r0,r1));
+      }
+    };
+ANPI_SIMD_END
+
+ANPI_SIMD_BEGIN_AVX
+    // 8x8 tile of 32 bit elements
+    template<>
+    struct transpose_traits<avx,4> {
+      static constexpr bool supported = true;
+      static constexpr size_t size = 8;
+
+      static inline void __attribute__((__always_inline__))
+      apply(const char* src,const size_t lds,char* dst,const size_t ldd) {
+        __m256 r[8];
+        for (size_t i=0;i<8;++i) {
+          r[i] = _mm256_loadu_ps(reinterpret_cast<const float*>(src+i*lds));
+        }
+
+        // interleave pairs of rows, then pairs of pairs
+        __m256 t[8];
+        for (size_t i=0;i<8;i+=2) {
+          t[i]   = _mm256_unpacklo_ps(r[i],r[i+1]);
+          t[i+1] = _mm256_unpackhi_ps(r[i],r[i+1]);
+        }
+        for (size_t i=0;i<8;i+=4) {
+          r[i]   = _mm256_shuffle_ps(t[i],t[i+2],_MM_SHUFFLE(1,0,1,0));
+          r[i+1] = _mm256_shuffle_ps(t[i],t[i+2],_MM_SHUFFLE(3,2,3,2));
+          r[i+2] = _mm256_shuffle_ps(t[i+1],t[i+3],_MM_SHUFFLE(1,0,1,0));
+          r[i+3] = _mm256_shuffle_ps(t[i+1],t[i+3],_MM_SHUFFLE(3,2,3,2));
+        }
+
+        // and finally exchange the 128 bit lanes
+        for (size_t i=0;i<4;++i) {
+          _mm256_storeu_ps(reinterpret_cast<float*>(dst+i*ldd),
+                           _mm256_permute2f128_ps(r[i],r[i+4],0x20));
+          _mm256_storeu_ps(reinterpret_cast<float*>(dst+(i+4)*ldd),
+                           _mm256_permute2f128_ps(r[i],r[i+4],0x31));
+        }
+      }
+    };
+
+    // 4x4 tile of 64 bit elements
+    template<>
+    struct transpose_traits<avx,8> {
+      static constexpr bool supported = true;
+      static constexpr size_t size = 4;
+
+      static inline void __attribute__((__always_inline__))
+      apply(const char* src,const size_t lds,char* dst,const size_t ldd) {
+        __m256d r[4];
+        for (size_t i=0;i<4;++i) {
+          r[i] = _mm256_loadu_pd(reinterpret_cast<const double*>(src+i*lds));
+        }
+
+        const __m256d t0 = _mm256_unpacklo_pd(r[0],r[1]);
+        const __m256d t1 = _mm256_unpackhi_pd(r[0],r[1]);
+        const __m256d t2 = _mm256_unpacklo_pd(r[2],r[3]);
+        const __m256d t3 = _mm256_unpackhi_pd(r[2],r[3]);
+
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst),
+                         _mm256_permute2f128_pd(t0,t2,0x20));
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst+ldd),
+                         _mm256_permute2f128_pd(t1,t3,0x20));
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst+2*ldd),
+                         _mm256_permute2f128_pd(t0,t2,0x31));
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst+3*ldd),
+                         _mm256_permute2f128_pd(t1,t3,0x31));
+      }
+    };
+ANPI_SIMD_END
+
+    // AVX-512 CPUs reuse the tiles of AVX2
+    template<>
+    struct transpose_traits<avx512,4> : transpose_traits<avx,4> {};
+
+    template<>
+    struct transpose_traits<avx512,8> : transpose_traits<avx,8> {};
+#endif
+
+#undef ANPI_SIMD_INTEGER
+#undef ANPI_SIMD_FUSED
+#undef ANPI_SIMD_FMA
+#undef ANPI_SIMD_BINARY
+#undef ANPI_SIMD_HALF
+#undef ANPI_SIMD_REGISTER
+#undef ANPI_SIMD_MEMORY
+
+    /// The registers of 16 bit floating point types compute in float
+    template<class Op,class Isa>
+    struct mm_op<Op,Isa,fp16> : mm_op<Op,Isa,float> {};
+
+    template<class Op,class Isa>
+    struct mm_op<Op,Isa,bf16> : mm_op<Op,Isa,float> {};
+
+    /**
+     * Check if the operation Op can be computed for elements of type T
+     * with the registers of the instruction set Isa
+     */
+    template<class Op,class Isa,typename T>
+    struct is_simd_op {
+      static constexpr bool value =
+        register_traits<Isa,T>::supported && mm_op<Op,Isa,T>::supported;
+    };
+
+    /**
+     * Maps applied on each entry by the reductions.
+     *
+     * The table tells which maps the instruction set Isa supports for
+     * entries of type T, and whether they read a second operand.  The
+     * maps themselves are computed by the kernels, with the operations
+     * of the table above.
+     */
+    template<class Map,class Isa,typename T>
+    struct mm_map {
+      static constexpr bool supported = false;
+      static constexpr bool binary = false;
+    };
+
+    template<class Isa,typename T>
+    struct mm_map<ops::identity,Isa,T> {
+      static constexpr bool supported = register_traits<Isa,T>::supported;
+      static constexpr bool binary = false;
+    };
+
+    // |a| = max(a,0-a), for signed types only
+    template<class Isa,typename T>
+    struct mm_map<ops::absolute,Isa,T> {
+      static constexpr bool supported =
+        !std::is_unsigned<T>::value &&
+        is_simd_op<ops::subtract,Isa,T>::value &&
+        is_simd_op<ops::max,Isa,T>::value;
+      static constexpr bool binary = false;
+    };
+
+    template<class Isa,typename T>
+    struct mm_map<ops::square,Isa,T> {
+      static constexpr bool supported = is_simd_op<ops::multiply,Isa,T>::value;
+      static constexpr bool binary = false;
+    };
+
+    template<class Isa,typename T>
+    struct mm_map<ops::multiply,Isa,T> {
+      static constexpr bool supported = is_simd_op<ops::multiply,Isa,T>::value;
+      static constexpr bool binary = true;
+    };
+
+    /**
+     * Check if a complete expression tree can be evaluated with the
+     * registers of the instruction set Isa
+     */
+    template<class Isa,class E>
+    struct is_simd_expression {
+      static constexpr bool value = false;
+    };
+
+    template<class Isa,typename T>
+    struct is_simd_expression< Isa,MatrixReference<T> > {
+      static constexpr bool value = register_traits<Isa,T>::supported;
+    };
+
+    template<class Isa,typename T>
+    struct is_simd_expression< Isa,ScalarExpression<T> > {
+      static constexpr bool value = register_traits<Isa,T>::supported;
+    };
+
+    template<class Isa,class Op,class L,class R>
+    struct is_simd_expression< Isa,BinaryExpression<Op,L,R> > {
+      static constexpr bool value =
+        is_simd_op<Op,Isa,typename L::value_type>::value &&
+        is_simd_expression<Isa,L>::value &&
+        is_simd_expression<Isa,R>::value;
+    };
+
+    template<class Isa,class Op,class A,class B,class C>
+    struct is_simd_expression< Isa,TernaryExpression<Op,A,B,C> > {
+      static constexpr bool value =
+        is_simd_op<Op,Isa,typename A::value_type>::value &&
+        is_simd_expression<Isa,A>::value &&
+        is_simd_expression<Isa,B>::value &&
+        is_simd_expression<Isa,C>::value;
+    };
+
+  } // namespace simd
+} // namespace anpi
+
+#endif
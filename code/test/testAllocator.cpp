@@ -10,6 +10,7 @@
 
 #include <boost/test/unit_test.hpp>
 #include <Allocator.hpp>
+#include <Matrix.hpp>
 
 #define COMMA ,
 
@@ -38,7 +39,39 @@ BOOST_AUTO_TEST_CASE( Allocation ) {
     
     alloc.deallocate(ptr,1024);
   }
-  
+
+  {
+    typedef anpi::hugepage_allocator<float,32> alloc_type;
+    alloc_type alloc;
+
+    // small blocks are just aligned
+    alloc_type::pointer ptr = alloc.allocate(1000);
+    BOOST_CHECK( reinterpret_cast<size_t>(ptr) % 32 == 0);
+    alloc.deallocate(ptr,1000);
+
+    // large blocks start at a huge page
+    const size_t n = 3*alloc_type::hugePageSize/sizeof(float) + 7;
+    ptr = alloc.allocate(n);
+    BOOST_CHECK( reinterpret_cast<size_t>(ptr) %
+                 alloc_type::hugePageSize == 0);
+    ptr[0] = ptr[n-1] = 1.f;
+    BOOST_CHECK( ptr[0] + ptr[n-1] == 2.f );
+    alloc.deallocate(ptr,n);
+  }
+
+  {
+    // rows padded as with the aligned_row_allocator
+    typedef anpi::hugepage_row_allocator<double> alloc_type;
+    anpi::Matrix<double,alloc_type> a(1024,513,1.0);
+    BOOST_CHECK( a.dcols()*sizeof(double) % anpi::DefaultAlignment == 0 );
+    anpi::Matrix<double,alloc_type> b = a + a;
+    BOOST_CHECK( b(1023,512) == 2.0 );
+
+    // released with fewer entries than allocated
+    anpi::Matrix<double,anpi::hugepage_allocator<double> >
+      c(1,(size_t(2)<<20)/sizeof(double) - 1,anpi::DoNotInitialize);
+    c.clear();
+  }
 }
 
 BOOST_AUTO_TEST_CASE( Checks ) {
@@ -69,7 +102,23 @@ BOOST_AUTO_TEST_CASE( Checks ) {
     BOOST_CHECK(ext::row_aligned == true );
   }
 
-  
+  {
+    typedef anpi::hugepage_allocator<float,64> alloc;
+    typedef anpi::extract_alignment<alloc> ext;
+    BOOST_CHECK( anpi::is_aligned_alloc<alloc>::value );
+    BOOST_CHECK(ext::value==64);
+    BOOST_CHECK(ext::aligned == true );
+    BOOST_CHECK(ext::row_aligned == false );
+  }
+
+  {
+    typedef anpi::hugepage_row_allocator<double,32> alloc;
+    typedef anpi::extract_alignment<alloc> ext;
+    BOOST_CHECK( anpi::is_aligned_alloc<alloc>::value );
+    BOOST_CHECK(ext::value==32);
+    BOOST_CHECK(ext::aligned == true );
+    BOOST_CHECK(ext::row_aligned == true );
+  }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
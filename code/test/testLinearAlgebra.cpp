@@ -0,0 +1,382 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+/**
+ * Unit tests for the matrix factorizations
+ */
+
+#include "Matrix.hpp"
+#include "BatchedMatrix.hpp"
+#include "LU.hpp"
+#include "MixedLU.hpp"
+#include "QR.hpp"
+
+namespace anpi {
+  namespace test {
+
+    /// Matrix with entries uniformly distributed in [-1,1]
+    template<typename T>
+    Matrix<T> randomMatrix(const size_t rows,
+                           const size_t cols,
+                           const unsigned int seed) {
+      std::mt19937 gen(seed);
+      std::uniform_real_distribution<T> dist(T(-1),T(1));
+      Matrix<T> m(rows,cols,DoNotInitialize);
+      for (size_t r=0;r<rows;++r) {
+        for (size_t c=0;c<cols;++c) {
+          m(r,c) = dist(gen);
+        }
+      }
+      return m;
+    }
+
+    /// Largest absolute difference of the entries of a and b
+    template<typename T>
+    T maxDifference(const Matrix<T>& a,const Matrix<T>& b) {
+      BOOST_CHECK( (a.rows() == b.rows()) && (a.cols() == b.cols()) );
+      T diff(0);
+      for (size_t r=0;r<a.rows();++r) {
+        for (size_t c=0;c<a.cols();++c) {
+          diff = std::max(diff,std::abs(a(r,c) - b(r,c)));
+        }
+      }
+      return diff;
+    }
+
+    /// Identity matrix of size n
+    template<typename T>
+    Matrix<T> identity(const size_t n) {
+      Matrix<T> m(n,n,T(0));
+      for (size_t i=0;i<n;++i) {
+        m(i,i) = T(1);
+      }
+      return m;
+    }
+
+    /// Check the factorization and the solutions with a random matrix
+    template<typename T>
+    void testLU(const size_t n,const T eps) {
+      const Matrix<T> a = randomMatrix<T>(n,n,unsigned(n));
+      const LU<T> lu(a);
+
+      BOOST_CHECK( lu.size() == n );
+      BOOST_CHECK( !lu.singular() );
+
+      // P*A = L*U
+      const std::vector<size_t> perm = lu.permutation();
+      Matrix<T> pa(n,n,DoNotInitialize);
+      for (size_t i=0;i<n;++i) {
+        for (size_t j=0;j<n;++j) {
+          pa(i,j) = a(perm[i],j);
+        }
+      }
+      BOOST_CHECK( maxDifference(pa,Matrix<T>(lu.lower()*lu.upper())) < eps );
+
+      // The pivots are the largest entries of their columns
+      const Matrix<T> l = lu.lower();
+      for (size_t i=0;i<n;++i) {
+        for (size_t j=0;j<i;++j) {
+          BOOST_CHECK( std::abs(l(i,j)) <= T(1) );
+        }
+      }
+
+      // One and many right hand sides, solved with the same factors
+      for (size_t k : { size_t(1), size_t(7) }) {
+        const Matrix<T> b = randomMatrix<T>(n,k,unsigned(n+k));
+        const Matrix<T> x = lu.solve(b);
+        BOOST_CHECK( maxDifference(Matrix<T>(a*x),b) < eps );
+        BOOST_CHECK( maxDifference(solve(a,b),x) == T(0) );
+      }
+
+      // Inverse
+      const Matrix<T> ai = inverse(a);
+      BOOST_CHECK( maxDifference(Matrix<T>(a*ai),identity<T>(n)) < eps );
+
+      // The determinant is the product of the eigenvalues
+      Matrix<T> d(n,n,T(0));
+      for (size_t i=0;i<n;++i) {
+        d(i,i) = T(1) + T(i%3)/T(4);
+      }
+      const Matrix<T> sd = Matrix<T>(a*d)*lu.inverse();
+      T det(1);
+      for (size_t i=0;i<n;++i) {
+        det *= d(i,i);
+      }
+      BOOST_CHECK( std::abs(determinant(sd) - det) < eps*det );
+    }
+
+    /// Check the factorization and the least squares solutions
+    template<typename T>
+    void testQR(const size_t m,const size_t n,const T eps) {
+      const Matrix<T> a = randomMatrix<T>(m,n,unsigned(m*n));
+      const QR<T> qr(a);
+      const size_t k = std::min(m,n);
+
+      BOOST_CHECK( (qr.rows() == m) && (qr.cols() == n) );
+
+      // A = Q*R, with orthonormal columns in Q
+      const Matrix<T> q = qr.thinQ();
+      const Matrix<T> r = qr.upper();
+      BOOST_CHECK( (q.rows() == m) && (q.cols() == k) && (r.rows() == k) );
+      BOOST_CHECK( maxDifference(Matrix<T>(q*r),a) < eps );
+      Matrix<T> qtq;
+      gemm(T(1),transposed(q),q,T(0),qtq);
+      BOOST_CHECK( maxDifference(qtq,identity<T>(k)) < eps );
+      for (size_t i=0;i<k;++i) {
+        for (size_t j=0;j<i;++j) {
+          BOOST_CHECK( r(i,j) == T(0) );
+        }
+      }
+
+      // The same reflectors as without blocking
+      Matrix<T> unblocked(a);
+      std::vector<T> tau(k);
+      detail::householderQR(unblocked.view(),tau.data());
+      BOOST_CHECK( maxDifference(unblocked,qr.packed()) < eps );
+
+      // Q^T undoes Q
+      const Matrix<T> b = randomMatrix<T>(m,3,unsigned(m+n));
+      Matrix<T> c(b);
+      qr.applyQ(c.view());
+      qr.applyQTransposed(c.view());
+      BOOST_CHECK( maxDifference(c,b) < eps );
+
+      if (m >= n) {
+        // The residual of the least squares solution is orthogonal to A
+        const Matrix<T> x = qr.solve(b);
+        BOOST_CHECK( (x.rows() == n) && (x.cols() == b.cols()) );
+        const Matrix<T> res = Matrix<T>(a*x) - b;
+        Matrix<T> atr;
+        gemm(T(1),transposed(a),res,T(0),atr);
+        BOOST_CHECK( maxDifference(atr,Matrix<T>(n,b.cols(),T(0))) < eps );
+
+        // Consistent systems are solved exactly
+        const Matrix<T> x0 = randomMatrix<T>(n,2,unsigned(n));
+        const Matrix<T> ax0 = a*x0;
+        BOOST_CHECK( maxDifference(leastSquares(a,ax0),x0) < eps );
+      } else {
+        BOOST_CHECK_THROW( qr.solve(b),anpi::Exception );
+      }
+    }
+
+    /// Check the batched factorizations against the ones of anpi::LU
+    template<typename T>
+    void testBatchedLU(const size_t n,const size_t batch,const T eps) {
+      std::vector< Matrix<T> > a,b;
+      for (size_t i=0;i<batch;++i) {
+        a.push_back(randomMatrix<T>(n,n,unsigned(n*batch + i)));
+        b.push_back(randomMatrix<T>(n,2,unsigned(i)));
+      }
+      const BatchedMatrix<T> ba(a);
+      const BatchedMatrix<T> bb(b);
+      const BatchedLU<T> lu(ba);
+
+      BOOST_CHECK( (lu.size() == n) && (lu.batch() == batch) );
+      BOOST_CHECK( !lu.singular() );
+
+      // Same pivots and factors as each matrix on its own
+      const std::vector< Matrix<T> > packed = lu.packed().matrices();
+      const std::vector< Matrix<T> > x = lu.solve(bb).matrices();
+      for (size_t i=0;i<batch;++i) {
+        const LU<T> single(a[i]);
+        for (size_t k=0;k<n;++k) {
+          BOOST_CHECK( lu.pivot(i,k) == single.pivots()[k] );
+        }
+        BOOST_CHECK( maxDifference(packed[i],single.packed()) < eps );
+        BOOST_CHECK( maxDifference(Matrix<T>(a[i]*x[i]),b[i]) < eps );
+      }
+
+      // The scalar kernels solve the same systems
+      BatchedMatrix<T> flu(ba);
+      std::vector<size_t> piv(n*batch);
+      std::vector<char> singular(batch);
+      fallback::batchedLU(n,flu.storage().data(),flu.stride(),
+                          piv.data(),batch,singular.data(),batch);
+      BatchedMatrix<T> fx(bb);
+      fallback::batchedSolve(n,fx.cols(),flu.storage().data(),flu.stride(),
+                             piv.data(),batch,
+                             fx.storage().data(),fx.stride(),batch);
+      const std::vector< Matrix<T> > y = fx.matrices();
+      for (size_t i=0;i<batch;++i) {
+        BOOST_CHECK( maxDifference(Matrix<T>(a[i]*y[i]),b[i]) < eps );
+      }
+    }
+  } // namespace test
+} // namespace anpi
+
+BOOST_AUTO_TEST_SUITE( LinearAlgebra )
+
+BOOST_AUTO_TEST_CASE( LU ) {
+  // Small systems, which require pivoting
+  {
+    const anpi::Matrix<double> a = { {0.,2.,1.},
+                                     {3.,4.,0.},
+                                     {1.,0.,0.} };
+    const anpi::LU<double> lu(a);
+    BOOST_CHECK( lu.determinant() == -4. );
+    BOOST_CHECK( lu.pivots()[0] == 1 );
+
+    const anpi::Matrix<double> b = { {3.},{7.},{1.} };
+    const anpi::Matrix<double> x = lu.solve(b);
+    const anpi::Matrix<double> ex = { {1.},{1.},{1.} };
+    BOOST_CHECK( anpi::test::maxDifference(x,ex) < 1.e-15 );
+  }
+
+  // Singular and non-square matrices
+  {
+    const anpi::Matrix<double> a = { {1.,2.},{2.,4.} };
+    const anpi::LU<double> lu(a);
+    BOOST_CHECK( lu.singular() );
+    BOOST_CHECK( lu.determinant() == 0. );
+    anpi::Matrix<double> b(2,1,1.);
+    BOOST_CHECK_THROW( lu.solve(b),anpi::Exception );
+    BOOST_CHECK_THROW( anpi::LU<double>(anpi::Matrix<double>(2,3,1.)),
+                       anpi::Exception );
+  }
+
+  // Sizes around the blocks, in one and several threads
+  const size_t threshold = anpi::parallelThreshold();
+  for (size_t entries : { threshold, size_t(64) }) {
+    anpi::setParallelThreshold(entries);
+    for (size_t n : { 1, 5, 63, 64, 65, 150 }) {
+      anpi::test::testLU<double>(n,1.e-10);
+      anpi::test::testLU<float>(n,1.e-3f);
+    }
+  }
+  anpi::setParallelThreshold(threshold);
+}
+
+BOOST_AUTO_TEST_CASE( BatchedLU ) {
+  // Singular matrices are detected one by one
+  {
+    std::vector< anpi::Matrix<double> > a(9,anpi::Matrix<double>(2,2,0.));
+    for (size_t i=0;i<a.size();++i) {
+      a[i](0,0) = a[i](1,1) = 1.;
+    }
+    a[5](1,1) = 0.;
+    const anpi::BatchedMatrix<double> ba(a);
+    const anpi::BatchedLU<double> lu(ba);
+    BOOST_CHECK( lu.singular() && lu.singular(5) && !lu.singular(4) );
+    BOOST_CHECK_THROW( lu.solve(ba),anpi::Exception );
+    BOOST_CHECK_THROW( anpi::BatchedLU<double>(
+                         anpi::BatchedMatrix<double>(2,3,4,1.)),
+                       anpi::Exception );
+  }
+
+  // Small sizes, register tails and several chunks, in one and several
+  // threads
+  const size_t threshold = anpi::parallelThreshold();
+  for (size_t entries : { threshold, size_t(64) }) {
+    anpi::setParallelThreshold(entries);
+    for (size_t n : { 1, 4, 7, 16 }) {
+      for (size_t batch : { 1, 13, 150 }) {
+        anpi::test::testBatchedLU<double>(n,batch,1.e-10);
+        anpi::test::testBatchedLU<float>(n,batch,1.e-3f);
+      }
+    }
+  }
+  anpi::setParallelThreshold(threshold);
+}
+
+BOOST_AUTO_TEST_CASE( MixedLU ) {
+  using anpi::test::maxDifference;
+  typedef anpi::Matrix<double> dmatrix;
+
+  // Well conditioned systems reach double precision after a few steps
+  const size_t threshold = anpi::parallelThreshold();
+  for (size_t entries : { threshold, size_t(64) }) {
+    anpi::setParallelThreshold(entries);
+    for (size_t n : { 1, 5, 65, 150 }) {
+      dmatrix a = anpi::test::randomMatrix<double>(n,n,unsigned(n));
+      for (size_t i=0;i<n;++i) {
+        a(i,i) += double(n);
+      }
+      anpi::MixedLU<> lu(a);
+      BOOST_CHECK( lu.size() == n );
+      for (size_t k : { size_t(1), size_t(7) }) {
+        const dmatrix b = anpi::test::randomMatrix<double>(n,k,unsigned(n+k));
+        const dmatrix x = lu.solve(b);
+        BOOST_CHECK( !lu.usedFallback() );
+        BOOST_CHECK( (lu.iterations() >= 1) && (lu.iterations() <= 5) );
+        BOOST_CHECK( maxDifference(dmatrix(a*x),b) < 1.e-13 );
+        BOOST_CHECK( maxDifference(x,anpi::solve(a,b)) < 1.e-13 );
+      }
+    }
+  }
+  anpi::setParallelThreshold(threshold);
+
+  // Ill-conditioned matrices fall back to the double factorization
+  {
+    const size_t n = 12;
+    dmatrix h(n,n,anpi::DoNotInitialize);
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<n;++j) {
+        h(i,j) = 1./double(i+j+1);
+      }
+    }
+    const dmatrix b(n,1,1.);
+    size_t steps = 0;
+    const dmatrix x = anpi::solveMixed(h,b,&steps);
+    anpi::MixedLU<> lu(h);
+    BOOST_CHECK( maxDifference(lu.solve(b),x) == 0. );
+    BOOST_CHECK( lu.usedFallback() && (lu.iterations() == steps) );
+    BOOST_CHECK( maxDifference(x,anpi::solve(h,b)) == 0. );
+  }
+
+  // So do matrices beyond the range of float
+  {
+    const dmatrix a = { {1.e300,1.},{1.,1.} };
+    const dmatrix b = { {1.e300},{2.} };
+    anpi::MixedLU<> lu(a);
+    const dmatrix x = lu.solve(b);
+    BOOST_CHECK( lu.usedFallback() && (lu.iterations() == 0) );
+    BOOST_CHECK( std::abs(x(0,0) - 1.) < 1.e-15 );
+  }
+
+  // Singular and non-square matrices
+  {
+    const dmatrix a = { {1.,2.},{2.,4.} };
+    anpi::MixedLU<> lu(a);
+    dmatrix b(2,1,1.);
+    BOOST_CHECK_THROW( lu.solve(b),anpi::Exception );
+    BOOST_CHECK_THROW( anpi::MixedLU<>(dmatrix(2,3,1.)),anpi::Exception );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( QR ) {
+  // Dependent columns cannot be solved
+  {
+    const anpi::Matrix<double> a = { {1.,2.},{2.,4.},{3.,6.} };
+    const anpi::Matrix<double> b(3,1,1.);
+    BOOST_CHECK_THROW( anpi::leastSquares(a,b),anpi::Exception );
+  }
+
+  // Tall, square and wide matrices around the blocks, in one and
+  // several threads
+  const size_t threshold = anpi::parallelThreshold();
+  for (size_t entries : { threshold, size_t(64) }) {
+    anpi::setParallelThreshold(entries);
+    for (size_t n : { 1, 5, 31, 32, 33, 70 }) {
+      anpi::test::testQR<double>(150,n,1.e-10);
+      anpi::test::testQR<float>(150,n,1.e-3f);
+    }
+    anpi::test::testQR<double>(97,97,1.e-10);
+    anpi::test::testQR<double>(40,70,1.e-10);
+  }
+  anpi::setParallelThreshold(threshold);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,13 +12,27 @@
 #include <exception>
 #include <cstdlib>
 #include <complex>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
 /**
  * Unit tests for the matrix class
  */
 
 #include "Matrix.hpp"
+#include "MappedMatrix.hpp"
 #include "Allocator.hpp"
+#include "ArenaAllocator.hpp"
+#include "FixedMatrix.hpp"
+#include "SparseMatrix.hpp"
+#include "Vector.hpp"
+#include "BatchedMatrix.hpp"
+#include "Deferred.hpp"
+
+#include <boost/filesystem.hpp>
 
 // Explicit instantiation of all methods of Matrix
 
@@ -61,11 +75,40 @@ template class anpi::Matrix<double  ,aralloc>;
 template class anpi::Matrix<float   ,aralloc>;
 template class anpi::Matrix<int     ,aralloc>;
 
+template class anpi::Matrix<double  ,aralloc,anpi::column_major>;
+template class anpi::Matrix<float   ,aralloc,anpi::tiled<> >;
+
 typedef anpi::Matrix<dcomplex,aralloc> arcmatrix;
 typedef anpi::Matrix<double  ,aralloc> ardmatrix;
 typedef anpi::Matrix<float   ,aralloc> arfmatrix;
 typedef anpi::Matrix<int     ,aralloc> arimatrix;
 
+// arena allocator
+typedef anpi::arena_allocator<float> bumpalloc;
+
+template class anpi::Matrix<dcomplex,bumpalloc>;
+template class anpi::Matrix<double  ,bumpalloc>;
+template class anpi::Matrix<float   ,bumpalloc>;
+template class anpi::Matrix<int     ,bumpalloc>;
+
+typedef anpi::Matrix<dcomplex,bumpalloc> bcmatrix;
+typedef anpi::Matrix<double  ,bumpalloc> bdmatrix;
+typedef anpi::Matrix<float   ,bumpalloc> bfmatrix;
+typedef anpi::Matrix<int     ,bumpalloc> bimatrix;
+
+// copy-on-write allocator
+typedef anpi::shared_row_allocator<float> salloc;
+
+template class anpi::Matrix<dcomplex,salloc>;
+template class anpi::Matrix<double  ,salloc>;
+template class anpi::Matrix<float   ,salloc>;
+template class anpi::Matrix<int     ,salloc>;
+
+typedef anpi::Matrix<dcomplex,salloc> scmatrix;
+typedef anpi::Matrix<double  ,salloc> sdmatrix;
+typedef anpi::Matrix<float   ,salloc> sfmatrix;
+typedef anpi::Matrix<int     ,salloc> simatrix;
+
 #if 1
 # define dispatchTest(func) \
   func<cmatrix>();          \
@@ -87,6 +130,20 @@ typedef anpi::Matrix<int     ,aralloc> arimatrix;
 # define dispatchTest(func) func<arfmatrix>(); 
 #endif
 
+// Only types with an ordering relation
+#define dispatchRealTest(func) \
+  func<dmatrix>();             \
+  func<fmatrix>();             \
+  func<imatrix>();             \
+                               \
+  func<admatrix>();            \
+  func<afmatrix>();            \
+  func<aimatrix>();            \
+                               \
+  func<ardmatrix>();           \
+  func<arfmatrix>();           \
+  func<arimatrix>();
+
 
 
 
@@ -275,5 +332,1747 @@ void testArithmetic() {
 BOOST_AUTO_TEST_CASE(Arithmetic) {
   dispatchTest(testArithmetic);  
 }
+
+template<class M>
+void testExpressions() {
+
+  {
+    M a = { {1,2,3},{ 4, 5, 6} };
+    M b = { {7,8,9},{10,11,12} };
+    M c = { {3,1,4},{ 1, 5, 9} };
+    M e = { {2,7,1},{ 8, 2, 8} };
+    M r = { {7,16,9},{21,13,17} };
+
+    M d = a + b - c + e;
+    BOOST_CHECK( d==r );
+
+    d = (a + b) - (c - e);
+    BOOST_CHECK( d==r );
+
+    // aliasing with the destination
+    d = a;
+    d = d + b - c + e;
+    BOOST_CHECK( d==r );
+
+    d = a;
+    d += b - c + e;
+    BOOST_CHECK( d==r );
+
+    d = r;
+    d -= b - c + e;
+    BOOST_CHECK( d==a );
+  }
+
+  {
+    // size not multiple of any register width
+    M a(7,13,typename M::value_type(3));
+    M b(7,13,typename M::value_type(2));
+    M r(7,13,typename M::value_type(10));
+    
+    M d = a + b + a - b - a + b + b + a;
+    BOOST_CHECK( d==r );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Expressions) {
+  dispatchTest(testExpressions);  
+}
+
+/// Number of memory blocks reserved by all counting_allocator
+static size_t countedAllocations = 0;
+
+/// Standard allocator counting the memory blocks it reserves
+template<typename T>
+class counting_allocator : public std::allocator<T> {
+public:
+  typedef T value_type;
+
+  counting_allocator() = default;
+  template<typename U>
+  counting_allocator(const counting_allocator<U>&) {}
+
+  /// Change the stored type
+  template<class U>
+  struct rebind {
+    typedef counting_allocator<U> other;
+  };
+
+  /// Allocate n entries, counting the block
+  T* allocate(const size_t n) {
+    ++countedAllocations;
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+/// Matrix computed by a function, returned as a temporary
+template<class M>
+M twice(const M& m) {
+  return m + m;
+}
+
+template<typename T>
+void testReuse() {
+  typedef anpi::Matrix<T,counting_allocator<T> > M;
+
+  const M a = { {1,2,3},{ 4, 5, 6} };
+  const M b = { {7,8,9},{10,11,12} };
+  const M a2 = a + a;
+  const M b2 = b + b;
+
+  // the comparisons with expressions would allocate
+  const M r[] = { M(a2 + b - a), M(b - a2), M(a2 / b), M(T(3)*a2),
+                  M(a2*T(3) + a), M(anpi::multiply(a,b2)),
+                  M(anpi::divide(b2,a)), M(a2 - b2),
+                  M(anpi::multiply(a2,b2)), M(2,2,T(0)),
+                  M(anpi::min(a2,b)), M(anpi::max(a,b2)),
+                  M(anpi::fma(a,b2,a)), M(anpi::fma(a2,b2,a2)),
+                  M(a2 + a2) };
+  const M t = { {1,0},{0,1},{1,1} };
+
+  // each line allocates only the temporary returned by twice()
+  size_t count = countedAllocations;
+  M d = twice(a) + b - a;
+  BOOST_CHECK( d == r[0] );
+  BOOST_CHECK( countedAllocations == count + 1 );
+
+  count = countedAllocations;
+  d = b - twice(a);
+  BOOST_CHECK( d == r[1] );
+  d = twice(a) / b;
+  BOOST_CHECK( d == r[2] );
+  d = T(3)*twice(a);
+  BOOST_CHECK( d == r[3] );
+  d = twice(a)*T(3) + a;
+  BOOST_CHECK( d == r[4] );
+  d = twice(a)/T(2);
+  BOOST_CHECK( d == a );
+  d = anpi::multiply(a,twice(b));
+  BOOST_CHECK( d == r[5] );
+  d = anpi::divide(twice(b),a);
+  BOOST_CHECK( d == r[6] );
+  BOOST_CHECK( countedAllocations == count + 7 );
+
+  // two temporaries: the second one is released
+  count = countedAllocations;
+  d = twice(a) - twice(b);
+  BOOST_CHECK( d == r[7] );
+  d = anpi::multiply(twice(a),twice(b));
+  BOOST_CHECK( d == r[8] );
+  BOOST_CHECK( countedAllocations == count + 4 );
+
+  // the element-wise extrema and the multiply-add
+  count = countedAllocations;
+  d = anpi::min(twice(a),b);
+  BOOST_CHECK( d == r[10] );
+  d = anpi::max(a,twice(b));
+  BOOST_CHECK( d == r[11] );
+  d = anpi::fma(a,twice(b),a);
+  BOOST_CHECK( d == r[12] );
+  d = anpi::fma(twice(a),twice(b),twice(a));
+  BOOST_CHECK( d == r[13] );
+  BOOST_CHECK( countedAllocations == count + 6 );
+
+  // temporaries with different allocators
+  typedef anpi::Matrix<T> N;
+  const N n(a);
+  const N n4(r[14]);
+  count = countedAllocations;
+  d = twice(a) + twice(n);
+  BOOST_CHECK( d == r[14] );
+  N e = twice(n) + twice(a);
+  BOOST_CHECK( e == n4 );
+  e = anpi::fma(twice(n),twice(b),twice(a)) - anpi::fma(a2,b2,a2);
+  BOOST_CHECK( e == N(2,3,T(0)) );
+  BOOST_CHECK( countedAllocations == count + 4 );
+
+  // products give temporaries too
+  count = countedAllocations;
+  d = a*t + a*t - twice(a*t);
+  BOOST_CHECK( d == r[9] );
+  BOOST_CHECK( countedAllocations == count + 4 );
+
+  // lvalue operands are still evaluated lazily, in one pass
+  d = M(2,3,T(0));
+  count = countedAllocations;
+  d = a + b - a;
+  BOOST_CHECK( d == b );
+  BOOST_CHECK( countedAllocations == count );
+}
+
+BOOST_AUTO_TEST_CASE(Reuse) {
+  testReuse<double>();
+  testReuse<float>();
+  testReuse<int>();
+}
+
+template<class M>
+void testElementwise() {
+  typedef typename M::value_type T;
+  
+  const M a = { {1,2,3,4,5},{ 6, 7, 8, 9,10},{11,12,13,14,15} };
+  const M b = { {2,2,3,2,5},{ 3, 7, 2, 3, 5},{11, 3,13, 7, 3} };
+  const M c = { {1,1,1,1,1},{ 2, 2, 2, 2, 2},{ 3, 3, 3, 3, 3} };
+  
+  { // Hadamard product
+    const M r = { {2,4,9,8,25},{18,49,16,27,50},{121,36,169,98,45} };
+    M d;
+    anpi::fallback::multiply(a,b,d);
+    BOOST_CHECK( d==r );
+    anpi::simd::multiply(a,b,d);
+    BOOST_CHECK( d==r );
+    d = a;
+    anpi::simd::multiply(d,b);
+    BOOST_CHECK( d==r );
+    d = anpi::multiply(a,b);
+    BOOST_CHECK( d==r );
+  }
+
+  { // division
+    const M r = { {0,1,1,2,1},{ 2, 1, 4, 3, 2},{ 1, 4, 1, 2, 5} };
+    const M n = anpi::multiply(r,b);
+    M d;
+    anpi::fallback::divide(n,b,d);
+    BOOST_CHECK( d==r );
+    anpi::simd::divide(n,b,d);
+    BOOST_CHECK( d==r );
+    d = n / b;
+    BOOST_CHECK( d==r );
+    d = anpi::divide(n,b);
+    BOOST_CHECK( d==r );
+  }
+
+  { // multiply-add
+    const M r = { {3,5,10,9,26},{20,51,18,29,52},{124,39,172,101,48} };
+    M d;
+    anpi::fallback::fma(a,b,c,d);
+    BOOST_CHECK( d==r );
+    anpi::simd::fma(a,b,c,d);
+    BOOST_CHECK( d==r );
+    d = c;
+    anpi::simd::fma(a,b,d);
+    BOOST_CHECK( d==r );
+    d = anpi::fma(a,b,c);
+    BOOST_CHECK( d==r );
+    d = anpi::multiply(a,b) + c;
+    BOOST_CHECK( d==r );
+  }
+
+  { // scalars
+    const M r = { {3,4,5,6,7},{ 8, 9,10,11,12},{13,14,15,16,17} };
+    M d = T(2)*c + a - c*T(2) + T(2)*M(3,5,T(1));
+    BOOST_CHECK( d==r );
+    d = (T(4)*a)/T(4);
+    BOOST_CHECK( d==a );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Elementwise) {
+  dispatchTest(testElementwise);  
+}
+
+template<class M>
+void testMinMax() {
+  const M a = { {1,2,3,4,5},{ 6, 7, 8, 9,10},{11,12,13,14,15} };
+  const M b = { {5,4,3,2,1},{10, 9, 8, 7, 6},{15,14,13,12,11} };
+  const M l = { {1,2,3,2,1},{ 6, 7, 8, 7, 6},{11,12,13,12,11} };
+  const M h = { {5,4,3,4,5},{10, 9, 8, 9,10},{15,14,13,14,15} };
+
+  M d;
+  anpi::fallback::min(a,b,d);
+  BOOST_CHECK( d==l );
+  anpi::simd::min(a,b,d);
+  BOOST_CHECK( d==l );
+  d = anpi::min(a,b);
+  BOOST_CHECK( d==l );
+
+  anpi::fallback::max(a,b,d);
+  BOOST_CHECK( d==h );
+  anpi::simd::max(a,b,d);
+  BOOST_CHECK( d==h );
+  d = a;
+  anpi::simd::max(d,b);
+  BOOST_CHECK( d==h );
+  d = anpi::max(a,b);
+  BOOST_CHECK( d==h );
+
+  d = anpi::max(a,b) - anpi::min(a,b);
+  BOOST_CHECK( d==(h-l) );
+}
+
+BOOST_AUTO_TEST_CASE(MinMax) {
+  dispatchRealTest(testMinMax);  
+}
+
+// Reference product with the textbook triple loop
+template<class M>
+M naiveProduct(const M& a,const M& b) {
+  M c(a.rows(),b.cols(),typename M::value_type(0));
+  for (size_t i=0;i<a.rows();++i) {
+    for (size_t j=0;j<b.cols();++j) {
+      for (size_t p=0;p<a.cols();++p) {
+        c(i,j) += a(i,p)*b(p,j);
+      }
+    }
+  }
+  return c;
+}
+
+// Matrix with small integer entries, so that all products are exact
+template<class M>
+M patternMatrix(const size_t rows,const size_t cols,const int seed) {
+  M m(rows,cols,anpi::DoNotInitialize);
+  for (size_t i=0;i<rows;++i) {
+    for (size_t j=0;j<cols;++j) {
+      m(i,j) = typename M::value_type(int((i*7 + j*3 + seed) % 7) - 3);
+    }
+  }
+  return m;
+}
+
+template<class M>
+void testProduct() {
+  typedef typename M::value_type T;
+  {
+    const M a = { {1,2,3},{4,5,6} };
+    const M b = { {1,2},{3,4},{5,6} };
+    const M r = { {22,28},{49,64} };
+
+    M c = a*b;
+    BOOST_CHECK( c==r );
+
+    anpi::fallback::gemm(T(1),a,b,T(0),c);
+    BOOST_CHECK( c==r );
+    anpi::simd::gemm(T(1),a,b,T(0),c);
+    BOOST_CHECK( c==r );
+
+    // c = 2*a*b - c
+    anpi::gemm(T(2),a,b,T(-1),c);
+    BOOST_CHECK( c==r );
+
+    // the result may alias one of the factors
+    M s = { {1,2},{3,4} };
+    const M s2 = { {7,10},{15,22} };
+    anpi::gemm(T(1),s,s,T(0),s);
+    BOOST_CHECK( s==s2 );
+  }
+
+  {
+    // sizes crossing the borders of the registers and cache blocks
+    const size_t sizes[][3] = { {  1,  1,  1}, {  5,  7,  3},
+                                { 13, 17, 11}, { 31, 33, 65},
+                                {127, 41,263}, { 50,300, 20} };
+
+    for (const auto& s : sizes) {
+      const M a = patternMatrix<M>(s[0],s[2],1);
+      const M b = patternMatrix<M>(s[2],s[1],2);
+      const M r = naiveProduct(a,b);
+
+      M c;
+      anpi::fallback::gemm(T(1),a,b,T(0),c);
+      BOOST_CHECK( c==r );
+      anpi::simd::gemm(T(1),a,b,T(0),c);
+      BOOST_CHECK( c==r );
+
+      M d = patternMatrix<M>(s[0],s[1],3);
+      const M e = T(2)*r + T(3)*d;
+      anpi::simd::gemm(T(2),a,b,T(3),d);
+      BOOST_CHECK( d==e );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Product) {
+  dispatchTest(testProduct);
+}
+
+template<class M>
+void testFill() {
+  typedef typename M::value_type T;
+
+  // sizes below and above the register widths, with odd padding
+  const size_t sizes[][2] = { {1,1}, {3,5}, {7,13}, {33,17}, {64,64} };
+
+  const size_t threshold = anpi::simd::streamingThreshold();
+
+  // with and without non-temporal stores
+  for (size_t stream=0;stream<2;++stream) {
+    anpi::simd::setStreamingThreshold(stream ? 0 : threshold);
+
+    for (const auto& s : sizes) {
+      M a(s[0],s[1],anpi::DoNotInitialize);
+      a.fill(T(5));
+      bool ok = true;
+      for (size_t r=0;r<a.rows();++r) {
+        for (size_t c=0;c<a.dcols();++c) {
+          ok = ok && (a[r][c] == T(5));
+        }
+      }
+      BOOST_CHECK( ok );
+
+      const M b = patternMatrix<M>(s[0],s[1],4);
+      M c(b);
+      BOOST_CHECK( c==b );
+      a = b;
+      BOOST_CHECK( a==b );
+      M d(s[0],s[1],b.data());
+      BOOST_CHECK( d==b );
+    }
+  }
+
+  anpi::simd::setStreamingThreshold(threshold);
+}
+
+BOOST_AUTO_TEST_CASE(Fill) {
+  dispatchTest(testFill);
+
+  // entries wider than some of the registers
+  using namespace anpi::simd;
+  typedef std::complex<long double> T;
+  const Isa active = isa();
+  for (int i=static_cast<int>(Isa::None);
+       i<=static_cast<int>(supportedIsa());++i) {
+    setIsa(static_cast<Isa>(i));
+    anpi::Matrix<T> a(7,13,anpi::DoNotInitialize);
+    a.fill(T(1.5,-2.5));
+    BOOST_CHECK( std::count(a.data(),a.data()+a.entries(),T(1.5,-2.5)) ==
+                 std::ptrdiff_t(a.entries()) );
+  }
+  setIsa(active);
+}
+
+template<class M>
+void testViews() {
+  typedef typename M::value_type T;
+
+  const M a = patternMatrix<M>(13,11,1);
+  const M b = patternMatrix<M>(13,11,2);
+
+  // blocks refer to the entries of the matrix
+  const anpi::ConstMatrixView<T> va = a.block(2,3,7,5);
+  BOOST_CHECK( (va.rows() == 7) && (va.cols() == 5) );
+  BOOST_CHECK( va.dcols() == a.dcols() );
+  BOOST_CHECK( va.data() == &a(2,3) );
+  BOOST_CHECK( va(1,2) == a(3,5) );
+  BOOST_CHECK( va.block(1,1,2,3)(1,2) == a(4,6) );
+  const anpi::ConstMatrixView<T> vb = b.block(6,6,7,5);
+
+  // the reference result is computed entry by entry
+  M c(13,11,T(9));
+  M ref(c);
+  const anpi::MatrixView<T> tile = c.block(4,2,7,5);
+
+  anpi::aimpl::add(va,vb,tile);
+  for (size_t i=0;i<7;++i) {
+    for (size_t j=0;j<5;++j) {
+      ref(4+i,2+j) = va(i,j) + vb(i,j);
+    }
+  }
+  BOOST_CHECK( c == ref );
+
+  tile -= vb;
+  tile += va;
+  anpi::aimpl::fma(va,vb,tile);
+  for (size_t i=0;i<7;++i) {
+    for (size_t j=0;j<5;++j) {
+      ref(4+i,2+j) = T(2)*va(i,j) + va(i,j)*vb(i,j);
+    }
+  }
+  BOOST_CHECK( c == ref );
+
+  // expressions mixing views of different matrices
+  c.block(0,6,7,5) = va - T(2)*vb + anpi::multiply(va,vb);
+  for (size_t i=0;i<7;++i) {
+    for (size_t j=0;j<5;++j) {
+      ref(i,6+j) = va(i,j) - T(2)*vb(i,j) + va(i,j)*vb(i,j);
+    }
+  }
+  BOOST_CHECK( c == ref );
+
+  // fill and copy only write into the block
+  c.block(1,1,3,9).fill(T(7));
+  c.block(10,0,3,11) = a.block(0,0,3,11);
+  for (size_t i=0;i<3;++i) {
+    for (size_t j=0;j<9;++j) {
+      ref(1+i,1+j) = T(7);
+    }
+    for (size_t j=0;j<11;++j) {
+      ref(10+i,j) = a(i,j);
+    }
+  }
+  BOOST_CHECK( c == ref );
+
+  // views of whole matrices behave as the matrices
+  M d(13,11,T(0));
+  d.view() = a + b;
+  BOOST_CHECK( d == M(a + b) );
+  d.view() = a;
+  BOOST_CHECK( d == a );
+}
+
+BOOST_AUTO_TEST_CASE(Views) {
+  dispatchTest(testViews);
+}
+
+// Reference transpose, entry by entry
+template<class M>
+M naiveTranspose(const M& a) {
+  M t(a.cols(),a.rows(),anpi::DoNotInitialize);
+  for (size_t i=0;i<a.rows();++i) {
+    for (size_t j=0;j<a.cols();++j) {
+      t(j,i) = a(i,j);
+    }
+  }
+  return t;
+}
+
+template<class M>
+void testTranspose() {
+  typedef typename M::value_type T;
+
+  // sizes crossing the borders of the register tiles and the blocks
+  const size_t sizes[][2] = { {  1,  1}, {  3,  5}, {  7, 13}, { 33, 17},
+                              { 64, 64}, { 70, 70}, { 65, 31}, {100,  2} };
+
+  for (const auto& s : sizes) {
+    const M a = patternMatrix<M>(s[0],s[1],1);
+    const M r = naiveTranspose(a);
+
+    M b;
+    anpi::transpose(a,b);
+    BOOST_CHECK( b==r );
+
+    M c(a);
+    anpi::transposeInPlace(c);
+    BOOST_CHECK( c==r );
+    anpi::transpose(c,c);
+    BOOST_CHECK( c==a );
+
+    // the lazy transpose refers to the same entries
+    const anpi::TransposedView<T> t = anpi::transposed(a);
+    BOOST_CHECK( (t.rows() == a.cols()) && (t.cols() == a.rows()) );
+    BOOST_CHECK( t(s[1]-1,0) == a(0,s[1]-1) );
+    BOOST_CHECK( anpi::transposed(t).data() == a.data() );
+  }
+
+  {
+    // transpose of blocks, without touching the rest
+    const M a = patternMatrix<M>(40,50,2);
+    M b(60,60,T(9));
+    M r(b);
+    anpi::transpose(a.block(3,5,35,37),b.block(10,20,37,35));
+    anpi::transposeInPlace(b.block(0,0,9,9));
+    for (size_t i=0;i<35;++i) {
+      for (size_t j=0;j<37;++j) {
+        r(10+j,20+i) = a(3+i,5+j);
+      }
+    }
+    BOOST_CHECK( b==r );
+  }
+
+  {
+    // products with transposed factors do not copy them
+    const size_t sizes[][3] = { {  1,  1,  1}, {  5,  7,  3},
+                                { 31, 33, 65}, {127, 41,263} };
+
+    for (const auto& s : sizes) {
+      const M a = patternMatrix<M>(s[2],s[0],1); // a^T is s[0] x s[2]
+      const M b = patternMatrix<M>(s[1],s[2],2); // b^T is s[2] x s[1]
+      const M at = naiveTranspose(a);
+      const M bt = naiveTranspose(b);
+
+      M c;
+      anpi::gemm(T(1),anpi::transposed(a),bt,T(0),c);
+      BOOST_CHECK( c==naiveProduct(at,bt) );
+      anpi::gemm(T(1),at,anpi::transposed(b),T(0),c);
+      BOOST_CHECK( c==naiveProduct(at,bt) );
+      anpi::fallback::gemm(T(1),anpi::transposed(a),anpi::transposed(b),
+                           T(0),c);
+      BOOST_CHECK( c==naiveProduct(at,bt) );
+      anpi::simd::gemm(T(1),anpi::transposed(a),anpi::transposed(b),
+                       T(0),c);
+      BOOST_CHECK( c==naiveProduct(at,bt) );
+
+      // product into a block of a larger matrix
+      M d(s[0]+2,s[1]+3,T(1));
+      M e(d);
+      anpi::gemm(T(1),at.view(),bt.view(),T(1),d.block(1,2,s[0],s[1]));
+      const M p = naiveProduct(at,bt);
+      for (size_t i=0;i<s[0];++i) {
+        for (size_t j=0;j<s[1];++j) {
+          e(1+i,2+j) += p(i,j);
+        }
+      }
+      BOOST_CHECK( d==e );
+    }
+
+    // the result may alias a transposed factor
+    M s = { {1,2},{3,4} };
+    const M s2 = { {10,14},{14,20} };
+    anpi::gemm(T(1),anpi::transposed(s),s,T(0),s);
+    BOOST_CHECK( s==s2 );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Transpose) {
+  dispatchTest(testTranspose);
+}
+
+template<class M>
+void testReductions() {
+  typedef typename M::value_type T;
+  typedef typename anpi::detail::norm_type<T>::type R;
+
+  const anpi::SummationType types[] = { anpi::SimpleSummation,
+                                        anpi::KahanSummation,
+                                        anpi::PairwiseSummation };
+
+  // vectors, and matrices longer than the pairwise leaves
+  const size_t sizes[][2] = { {  1,  1}, {  3,  5}, {  7, 13}, { 33, 17},
+                              {100,  2}, {  1,300}, {300,  1}, {600, 37} };
+
+  for (const auto& s : sizes) {
+    const M a = patternMatrix<M>(s[0],s[1],1);
+    const M b = patternMatrix<M>(s[0],s[1],2);
+
+    // the pattern holds small integers: all sums are exact
+    T sum(0),dot(0),sq(0);
+    M rows(s[0],1),cols(1,s[1]);
+    for (size_t i=0;i<s[0];++i) {
+      for (size_t j=0;j<s[1];++j) {
+        sum += a(i,j);
+        dot += a(i,j)*b(i,j);
+        sq  += a(i,j)*a(i,j);
+        rows(i,0) += a(i,j);
+        cols(0,j) += a(i,j);
+      }
+    }
+    // vector norms for vectors, induced norms for other matrices
+    const bool isVector = (s[0] == 1) || (s[1] == 1);
+    R norm1(0),normInf(0),absSum(0);
+    std::vector<R> colAbs(s[1],R(0));
+    for (size_t i=0;i<s[0];++i) {
+      R rowAbs(0);
+      for (size_t j=0;j<s[1];++j) {
+        absSum += std::abs(a(i,j));
+        rowAbs += std::abs(a(i,j));
+        colAbs[j] += std::abs(a(i,j));
+        normInf = std::max(normInf,isVector ? R(std::abs(a(i,j))) : rowAbs);
+      }
+    }
+    norm1 = isVector ? absSum : *std::max_element(colAbs.begin(),colAbs.end());
+
+    for (const anpi::SummationType t : types) {
+      BOOST_CHECK( anpi::sum(a,t) == sum );
+      BOOST_CHECK( anpi::dot(a,b,t) == dot );
+      BOOST_CHECK( anpi::rowSums(a,t) == rows );
+      BOOST_CHECK( anpi::colSums(a,t) == cols );
+      BOOST_CHECK( anpi::frobenius(a,t) ==
+                   std::sqrt(anpi::detail::realPart(sq)) );
+      BOOST_CHECK( anpi::norm1(a,t) == norm1 );
+      BOOST_CHECK( anpi::normInf(a,t) == normInf );
+    }
+
+    if ((s[0] > 2) && (s[1] > 2)) {
+      // views with gaps between the rows
+      const anpi::ConstMatrixView<T> v = a.block(1,1,s[0]-2,s[1]-1);
+      T vsum(0);
+      M vcols(1,v.cols());
+      for (size_t i=0;i<v.rows();++i) {
+        for (size_t j=0;j<v.cols();++j) {
+          vsum += v(i,j);
+          vcols(0,j) += v(i,j);
+        }
+      }
+      M c(1,v.cols());
+      for (const anpi::SummationType t : types) {
+        BOOST_CHECK( anpi::sum(v,t) == vsum );
+        anpi::colSums(v,c.view(),t);
+        BOOST_CHECK( c == vcols );
+      }
+    }
+  }
+}
+
+template<class M>
+void testExtrema() {
+  const size_t sizes[][2] = { {  1,  1}, {  3,  5}, {  7, 13}, { 33, 17},
+                              {  1,300}, {300,  1}, {600, 37} };
+
+  for (const auto& s : sizes) {
+    M a = patternMatrix<M>(s[0],s[1],1);
+    a(s[0]/2,s[1]-1) = 9;
+    a(s[0]-1,s[1]/2) = -9;
+    if (s[0]*s[1] == 1) {
+      a(0,0) = 9;
+      BOOST_CHECK( anpi::min(a) == 9 && anpi::max(a) == 9 );
+      continue;
+    }
+    BOOST_CHECK( anpi::max(a) == 9 );
+    BOOST_CHECK( anpi::min(a) == -9 );
+    BOOST_CHECK( anpi::argmax(a) == std::make_pair(s[0]/2,s[1]-1) );
+    BOOST_CHECK( anpi::argmin(a) == std::make_pair(s[0]-1,s[1]/2) );
+
+    // the first occurrence in row-major order
+    a(s[0]-1,s[1]-1) = 9;
+    BOOST_CHECK( anpi::argmax(a) == std::make_pair(s[0]/2,s[1]-1) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Reductions) {
+  dispatchTest(testReductions);
+  dispatchRealTest(testExtrema);
+
+  {
+    // compensated sums of many single precision entries
+    const size_t n = size_t(1) << 22;
+    const fmatrix a(1,n,0.1f);
+    const double exact = n*double(0.1f);
+    BOOST_CHECK_CLOSE( anpi::sum(a,anpi::KahanSummation), exact, 1e-4 );
+    BOOST_CHECK_CLOSE( anpi::sum(a,anpi::PairwiseSummation), exact, 1e-4 );
+    BOOST_CHECK_CLOSE( anpi::sum(a), exact, 1e-1 );
+    BOOST_CHECK_CLOSE( anpi::norm1(a,anpi::KahanSummation), exact, 1e-4 );
+  }
+
+  {
+    // the spectral norm of u*v^T is |u|*|v|
+    const dmatrix u = patternMatrix<dmatrix>(40,1,1);
+    const dmatrix v = patternMatrix<dmatrix>(1,30,2);
+    const dmatrix a = u*v;
+    BOOST_CHECK_CLOSE( anpi::norm2(a),
+                       anpi::norm2(u)*anpi::norm2(v), 1e-8 );
+
+    const fmatrix d = { {3,0,0},{0,-5,0},{0,0,1},{0,0,0} };
+    BOOST_CHECK_CLOSE( anpi::norm2(d), 5.f, 1e-4 );
+    BOOST_CHECK( anpi::norm2(fmatrix(3,4)) == 0.f );
+  }
+}
+
+template<class M>
+void testMappedMatrix() {
+  typedef typename M::value_type T;
+  namespace fs = boost::filesystem;
+
+  const fs::path file = fs::temp_directory_path() / fs::unique_path();
+
+  // the padded layout of the matrix survives a round trip
+  const M a = patternMatrix<M>(37,29,1);
+  anpi::save(file.string(),a);
+  M b;
+  anpi::load(file.string(),b);
+  BOOST_CHECK( b==a );
+
+  {
+    const anpi::MappedMatrix<T> m(file.string());
+    BOOST_CHECK( (m.rows() == a.rows()) && (m.cols() == a.cols()) );
+    BOOST_CHECK( m.dcols() == a.dcols() );
+    BOOST_CHECK( m(36,28) == a(36,28) );
+    M c(m.rows(),m.cols(),anpi::DoNotInitialize);
+    c.view() = m.view();
+    BOOST_CHECK( c==a );
+
+    // single pass through all rows
+    size_t rows = 0;
+    for (const auto& row : m) {
+      BOOST_CHECK( std::equal(row.data(),row.data()+row.cols(),a[rows]) );
+      ++rows;
+    }
+    BOOST_CHECK( rows == a.rows() );
+
+    m.advise(anpi::RandomAccess);
+    c.view() = m.view() + a;
+    BOOST_CHECK( c == M(a + a) );
+  }
+
+  {
+    // new files start with zeros, and keep the written entries
+    anpi::MappedMatrix<T> m(file.string(),5,13);
+    BOOST_CHECK( m.writable() );
+    BOOST_CHECK( m(4,12) == T(0) );
+    m.block(1,2,3,4) = a.block(0,0,3,4);
+    m.flush();
+    m.close();
+    BOOST_CHECK( !m.isOpen() );
+
+    anpi::load(file.string(),b);
+    BOOST_CHECK( (b.rows() == 5) && (b.cols() == 13) );
+    BOOST_CHECK( b(3,5) == a(2,3) );
+    BOOST_CHECK( b(0,0) == T(0) );
+  }
+
+  {
+    // files with entries of another type are rejected
+    anpi::Matrix<char> c(2,2);
+    anpi::save(file.string(),c);
+    BOOST_CHECK_THROW( anpi::MappedMatrix<T> m(file.string()),
+                       anpi::Exception );
+    BOOST_CHECK_THROW( anpi::load(file.string(),b),anpi::Exception );
+  }
+
+  {
+    // corrupted headers, also with sizes that overflow
+    const anpi::matrix_file_header h =
+      anpi::detail::fileHeader<T>(3,4,4,sizeof(T));
+    const size_t size = h.offset + 12*sizeof(T);
+    BOOST_CHECK( anpi::detail::checkHeader<T>(h,size).empty() );
+    BOOST_CHECK( !anpi::detail::checkHeader<T>(h,size-1).empty() );
+
+    anpi::matrix_file_header g(h);
+    g.rows = g.dcols = g.cols = uint64_t(1) << 62;
+    BOOST_CHECK( !anpi::detail::checkHeader<T>(g,size).empty() );
+    g = h;
+    g.rows = ~uint64_t(0)/sizeof(T) + 1;
+    BOOST_CHECK( !anpi::detail::checkHeader<T>(g,size).empty() );
+    g = h;
+    g.offset += 1;
+    BOOST_CHECK( !anpi::detail::checkHeader<T>(g,size).empty() );
+    g = h;
+    g.offset = ~uint64_t(0) - 3;
+    BOOST_CHECK( !anpi::detail::checkHeader<T>(g,size).empty() );
+    g = h;
+    g.alignment = 0;
+    BOOST_CHECK( !anpi::detail::checkHeader<T>(g,size).empty() );
+  }
+
+  fs::remove(file);
+}
+
+BOOST_AUTO_TEST_CASE(MappedMatrix) {
+  dispatchTest(testMappedMatrix);
+}
+
+template<class M>
+void testArena() {
+  typedef typename M::value_type T;
+
+  testConstructors<M>();
+  testAssignment<M>();
+  testArithmetic<M>();
+  testExpressions<M>();
+  testProduct<M>();
+  testTranspose<M>();
+
+  // rows are padded as with the aligned_row_allocator
+  const M a = patternMatrix<M>(7,5,1);
+  BOOST_CHECK( a.dcols()*sizeof(T) % anpi::DefaultAlignment == 0 );
+  BOOST_CHECK( reinterpret_cast<std::uintptr_t>(a.data()) %
+               anpi::DefaultAlignment == 0 );
+}
+
+BOOST_AUTO_TEST_CASE(ArenaAllocator) {
+  typedef anpi::Arena Arena;
+
+  // without an arena the memory comes from the heap
+  BOOST_CHECK( Arena::active() == nullptr );
+  testArena<bcmatrix>();
+  testArena<bfmatrix>();
+
+  {
+    Arena arena(4096);
+    BOOST_CHECK( Arena::active() == &arena );
+    testArena<bcmatrix>();
+    testArena<bdmatrix>();
+    testArena<bfmatrix>();
+    testArena<bimatrix>();
+    BOOST_CHECK( arena.live() == 0 );
+
+    // the last block is reused right away
+    const bfmatrix a(10,10,1.f);
+    const float* p;
+    {
+      bfmatrix b(a);
+      p = b.data();
+      BOOST_CHECK( arena.live() == 2 );
+    }
+    bfmatrix c(a);
+    BOOST_CHECK( c.data() == p );
+
+    // heap and arena matrices exchange their memory
+    bfmatrix d;
+    {
+      Arena inner;
+      BOOST_CHECK( Arena::active() == &inner );
+      bfmatrix e(a + c);
+      d = std::move(e);
+      BOOST_CHECK( inner.live() == 1 );
+      d.clear();
+      BOOST_CHECK( inner.live() == 0 );
+    }
+    BOOST_CHECK( Arena::active() == &arena );
+
+    // the arena grows when full
+    c.clear();
+    const size_t capacity = arena.capacity();
+    {
+      bfmatrix big(capacity/256 + 1,64,anpi::DoNotInitialize);
+      BOOST_CHECK( arena.capacity() > capacity );
+    }
+    BOOST_CHECK( arena.live() == 1 );
+  }
+  BOOST_CHECK( Arena::active() == nullptr );
+}
+
+template<class M>
+void testShared() {
+  typedef typename M::value_type T;
+
+  testConstructors<M>();
+  testAssignment<M>();
+  testArithmetic<M>();
+  testExpressions<M>();
+  testProduct<M>();
+  testViews<M>();
+  testTranspose<M>();
+
+  const M a = patternMatrix<M>(13,11,1);
+  const M r = patternMatrix<M>(13,11,1);
+
+  // copies share the memory block until they are written
+  M b(a);
+  BOOST_CHECK( static_cast<const M&>(b).data() == a.data() );
+  b(2,3) = T(9);
+  BOOST_CHECK( static_cast<const M&>(b).data() != a.data() );
+  BOOST_CHECK( a == r );
+  BOOST_CHECK( b(2,3) == T(9) && b(2,4) == a(2,4) );
+
+  // each non-const accessor gives the matrix its own block
+  {
+    M c(a);
+    c[0][0] = T(5);
+    BOOST_CHECK( a == r && c(0,0) == T(5) );
+  }
+  {
+    M c;
+    c = a;
+    BOOST_CHECK( static_cast<const M&>(c).data() == a.data() );
+    c.fill(T(1));
+    BOOST_CHECK( a == r && c == M(13,11,T(1)) );
+  }
+  {
+    M c(a);
+    c.block(1,1,2,2) = a.block(0,0,2,2);
+    BOOST_CHECK( a == r && c(1,1) == a(0,0) );
+  }
+  {
+    M c(a);
+    c += a;
+    BOOST_CHECK( a == r && c == a*T(2) );
+  }
+  {
+    // allocate() leaves its own block, even with the same size
+    M c(a);
+    c.allocate(a.rows(),a.cols());
+    const T* p = static_cast<const M&>(c).data();
+    BOOST_CHECK( p != a.data() );
+    const_cast<T*>(p)[0] = T(7);
+    BOOST_CHECK( a == r );
+  }
+  {
+    // in-place operations read the shared block before replacing it
+    M c(a);
+    anpi::aimpl::add(c,a);
+    BOOST_CHECK( a == r && c == a*T(2) );
+    M d(a);
+    anpi::aimpl::fma(a,a,d);
+    BOOST_CHECK( a == r && d == M(anpi::multiply(a,a) + a) );
+  }
+  {
+    // the block survives its first owner
+    M c(a);
+    M d(c);
+    c = M(2,2,T(0));
+    BOOST_CHECK( d == r );
+  }
+
+  // the copies of one matrix are written concurrently
+  const size_t threads = anpi::threads();
+  anpi::setThreads(4);
+  std::vector<M> copies(16,a);
+  anpi::parallelTasks(copies.size(),[&](const size_t i) {
+    M c(copies[i]);
+    c(0,0) = T(int(i));
+    copies[i] = c;
+  });
+  anpi::setThreads(threads);
+  bool ok = (a == r);
+  for (size_t i=0;i<copies.size();++i) {
+    ok = ok && (copies[i](0,0) == T(int(i))) && (copies[i](1,1) == a(1,1));
+  }
+  BOOST_CHECK( ok );
+}
+
+BOOST_AUTO_TEST_CASE(SharedAllocator) {
+  testShared<scmatrix>();
+  testShared<sdmatrix>();
+  testShared<sfmatrix>();
+  testShared<simatrix>();
+}
+
+template<typename T>
+void testFixedMatrix() {
+  typedef anpi::FixedMatrix<T,2,3> mat23;
+  typedef anpi::FixedMatrix<T,3,2> mat32;
+  typedef anpi::FixedMatrix<T,3,3> mat33;
+  typedef anpi::Matrix<T> matrix;
+
+  // the entries are stored inside the object, without padding
+  BOOST_CHECK( sizeof(mat33) == 9*sizeof(T) );
+  BOOST_CHECK( (mat23::rows() == 2) && (mat23::cols() == 3) );
+
+  const mat23 a = { {1,2,3},{4,5,6} };
+  const mat32 b = { {1,2},{3,4},{5,6} };
+  BOOST_CHECK( mat23()(1,2) == T(0) );
+  BOOST_CHECK( mat23(T(4))(1,2) == T(4) );
+  BOOST_CHECK( (a(1,0) == T(4)) && (a[0][2] == T(3)) );
+
+  // arithmetic agrees with the dynamic matrices
+  const matrix da = a.toMatrix();
+  const matrix db = transpose(b).toMatrix();
+  BOOST_CHECK( (a + transpose(b)).toMatrix() == matrix(da + db) );
+  BOOST_CHECK( (a - transpose(b)).toMatrix() == matrix(da - db) );
+  BOOST_CHECK( (a*T(2)).toMatrix() == matrix(da*T(2)) );
+  BOOST_CHECK( (T(2)*a) == (a*T(2)) );
+  BOOST_CHECK( (a*T(2))/T(2) == a );
+  BOOST_CHECK( -a + a == mat23() );
+
+  const mat33 c = b*a;
+  const mat33 r = { {9,12,15},{19,26,33},{29,40,51} };
+  BOOST_CHECK( c == r );
+  BOOST_CHECK( c.toMatrix() == b.toMatrix()*da );
+
+  mat23 d(a);
+  d += a;
+  d -= a;
+  d *= T(3);
+  d /= T(3);
+  BOOST_CHECK( d == a );
+  BOOST_CHECK( d != a*T(2) );
+
+  // views and products mixing fixed and dynamic matrices
+  BOOST_CHECK( mat23(da) == a );
+  BOOST_CHECK( anpi::sum(a.view()) == T(21) );
+  matrix e;
+  anpi::gemm(T(1),b,da,T(0),e);
+  BOOST_CHECK( e == r.toMatrix() );
+  mat33 f;
+  anpi::gemm(T(1),da,anpi::transposed(a.view()),T(0),
+             f.view().block(0,0,2,2));
+  BOOST_CHECK( (f(0,0) == T(14)) && (f(1,1) == T(77)) && (f(2,2) == T(0)) );
+}
+
+BOOST_AUTO_TEST_CASE(FixedMatrix) {
+  testFixedMatrix<float>();
+  testFixedMatrix<double>();
+  testFixedMatrix<int>();
+  testFixedMatrix<dcomplex>();
+}
+
+/// Allocator given as template argument of a matrix type
+template<class M>
+struct allocator_argument;
+
+template<typename T,class Alloc>
+struct allocator_argument< anpi::Matrix<T,Alloc> > {
+  typedef Alloc type;
+};
+
+template<class M>
+void testSparseMatrix() {
+  typedef typename M::value_type T;
+  typedef typename allocator_argument<M>::type Alloc;
+  typedef anpi::SparseMatrix<T> sparse;
+
+  const size_t sizes[][2] = { {  1,  1}, {  7, 13}, { 33, 17},
+                              {100,  2}, {300, 40} };
+
+  for (const auto& s : sizes) {
+    // about one entry in five is not zero
+    M d = patternMatrix<M>(s[0],s[1],1);
+    size_t nnz = 0;
+    for (size_t i=0;i<s[0];++i) {
+      for (size_t j=0;j<s[1];++j) {
+        if ((i + 2*j) % 5 != 0) {
+          d(i,j) = T(0);
+        }
+        nnz += (d(i,j) != T(0)) ? 1 : 0;
+      }
+    }
+
+    const sparse a(d);
+    BOOST_CHECK( (a.rows() == s[0]) && (a.cols() == s[1]) );
+    BOOST_CHECK( a.nonZeros() == nnz );
+    BOOST_CHECK( a.template toMatrix<Alloc>() == d );
+    BOOST_CHECK( a(s[0]-1,s[1]-1) == d(s[0]-1,s[1]-1) );
+
+    // products with vectors and matrices agree with the dense ones
+    const M x = patternMatrix<M>(s[1],1,2);
+    BOOST_CHECK( a*x == d*x );
+    const M b = patternMatrix<M>(s[1],5,3);
+    BOOST_CHECK( a*b == d*b );
+
+    M y = patternMatrix<M>(s[0],5,4);
+    M r(y);
+    anpi::spmv(T(2),a,b.view(),T(3),y.view());
+    anpi::gemm(T(2),d,b,T(3),r);
+    BOOST_CHECK( y == r );
+
+    // sums with dense matrices
+    const M e = patternMatrix<M>(s[0],s[1],5);
+    BOOST_CHECK( a + e == M(d + e) );
+    BOOST_CHECK( e + a == M(d + e) );
+  }
+
+  {
+    // entries in any order, adding the repeated ones
+    std::vector< anpi::sparse_entry<T> > entries = {
+      {2,1,T(4)},{0,0,T(1)},{2,1,T(-1)},{0,3,T(2)},{1,2,T(5)} };
+    const sparse a(3,4,entries);
+    const M r = { {1,0,0,2},{0,0,5,0},{0,3,0,0} };
+    BOOST_CHECK( a.nonZeros() == 4 );
+    BOOST_CHECK( a.template toMatrix<Alloc>() == r );
+    BOOST_CHECK( sparse(3,4).template toMatrix<Alloc>() == M(3,4,T(0)) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SparseMatrix) {
+  dispatchTest(testSparseMatrix);
+}
+
+template<class M>
+void testVector() {
+  typedef typename M::value_type T;
+  typedef anpi::Vector<T> vector;
+
+  {
+    const vector a = { 1,2,3 };
+    BOOST_CHECK( (a.size() == 3) && (a[2] == T(3)) );
+    BOOST_CHECK( reinterpret_cast<std::uintptr_t>(a.data()) %
+                 anpi::DefaultAlignment == 0 );
+    BOOST_CHECK( vector(3,T(2)) == vector({ 2,2,2 }) );
+    BOOST_CHECK( vector(a.column()) == a );
+    BOOST_CHECK( anpi::sum(a.view()) == T(6) );
+
+    vector b(a);
+    b += a;
+    b -= a;
+    b *= T(2);
+    BOOST_CHECK( b == vector({ 2,4,6 }) );
+    BOOST_CHECK( b != a );
+  }
+
+  // rows around the blocks of four, and tails of all register widths
+  const size_t sizes[][2] = { {  1,  1}, {  3,  5}, {  4,  8},
+                              {  7, 17}, { 33, 70}, {130, 41} };
+
+  for (const auto& s : sizes) {
+    const M a = patternMatrix<M>(s[0],s[1],1);
+    const M xm = patternMatrix<M>(s[1],1,2);
+    const M zm = patternMatrix<M>(s[0],1,3);
+    const vector x(xm.view());
+    const vector z(zm.view());
+
+    // a*x and a^T*z agree with the matrix products
+    const vector y = a*x;
+    BOOST_CHECK( y == vector(M(a*xm).view()) );
+    vector t;
+    anpi::gemv(T(1),anpi::transposed(a),z,T(0),t);
+    M tm;
+    anpi::gemm(T(1),anpi::transposed(a),zm,T(0),tm);
+    BOOST_CHECK( t == vector(tm.view()) );
+    BOOST_CHECK( anpi::transposed(a)*z == t );
+
+    // both scale factors
+    vector u(y);
+    anpi::gemv(T(2),a,x,T(3),u);
+    BOOST_CHECK( u == vector(M(T(5)*M(a*xm)).view()) );
+    vector v(t);
+    anpi::gemv(T(2),anpi::transposed(a),z,T(-1),v);
+    BOOST_CHECK( v == t );
+
+    // views of blocks
+    if (s[0] > 1) {
+      const vector x1(xm.block(0,0,s[1]-1,1));
+      vector w;
+      anpi::gemv(T(1),a.block(1,0,s[0]-1,s[1]-1),x1,T(0),w);
+      M wm;
+      anpi::gemm(T(1),a.block(1,0,s[0]-1,s[1]-1),xm.block(0,0,s[1]-1,1),
+                 T(0),wm);
+      BOOST_CHECK( w == vector(wm.view()) );
+    }
+  }
+
+  {
+    // the result may be the factor
+    const M a = patternMatrix<M>(9,9,1);
+    const M xm = patternMatrix<M>(9,1,2);
+    vector x(xm.view());
+    anpi::gemv(T(1),a,x,T(0),x);
+    BOOST_CHECK( x == vector(M(a*xm).view()) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Vector) {
+  dispatchTest(testVector);
+}
+
+// Same size and entries, regardless of the allocators
+template<class A,class B>
+bool sameEntries(const A& a,const B& b) {
+  if ((a.rows() != b.rows()) || (a.cols() != b.cols())) {
+    return false;
+  }
+  for (size_t i=0;i<a.rows();++i) {
+    for (size_t j=0;j<a.cols();++j) {
+      if (a(i,j) != b(i,j)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template<class M>
+void testBatchedMatrix() {
+  typedef typename M::value_type T;
+  typedef anpi::BatchedMatrix<T> batched;
+
+  // register tails, several chunks, and shapes around the product tiles
+  const size_t batches[] = { 1, 7, 19, 100 };
+  const size_t shapes[][3] = { { 1, 1, 1}, { 3, 4, 5}, { 8, 8, 8},
+                               {16,16, 1}, { 2, 9,13} };
+
+  for (const size_t n : batches) {
+    for (const auto& s : shapes) {
+      std::vector<M> a,b;
+      for (size_t i=0;i<n;++i) {
+        a.push_back(patternMatrix<M>(s[0],s[1],int(i)));
+        b.push_back(patternMatrix<M>(s[1],s[2],int(3*i+1)));
+      }
+
+      const batched ba(a);
+      const batched bb(b);
+      BOOST_CHECK( (ba.rows() == s[0]) && (ba.cols() == s[1]) &&
+                   (ba.batch() == n) );
+      BOOST_CHECK( ba(n-1,s[0]-1,s[1]-1) == a[n-1](s[0]-1,s[1]-1) );
+      BOOST_CHECK( reinterpret_cast<std::uintptr_t>(ba.entry(0,0)) %
+                   anpi::DefaultAlignment == 0 );
+
+      // conversions in both directions
+      const std::vector< anpi::Matrix<T> > ra = ba.matrices();
+      bool ok = ra.size() == n;
+      for (size_t i=0;ok && (i<n);++i) {
+        ok = sameEntries(ra[i],a[i]);
+      }
+      BOOST_CHECK( ok );
+      BOOST_CHECK( sameEntries(ba.matrix(n/2),a[n/2]) );
+
+      // products and sums of each pair
+      const batched bc = ba*bb;
+      const std::vector< anpi::Matrix<T> > c = bc.matrices();
+      for (size_t i=0;i<n;++i) {
+        ok = ok && sameEntries(c[i],M(a[i]*b[i]));
+      }
+      BOOST_CHECK( ok );
+
+      const batched bs = ba + ba;
+      batched bd(bs);
+      bd -= ba;
+      BOOST_CHECK( bd == ba );
+      BOOST_CHECK( bs - ba == ba );
+      ok = true;
+      for (size_t i=0;i<n;++i) {
+        ok = ok && sameEntries(bs.matrix(i),M(a[i]+a[i]));
+      }
+      BOOST_CHECK( ok );
+
+      // the product may overwrite a factor
+      if (s[0] == s[1]) {
+        batched be(ba);
+        anpi::multiply(be,bb,be);
+        BOOST_CHECK( be == bc );
+      }
+    }
+  }
+
+  {
+    batched e(2,3,5,T(1));
+    e.setMatrix(4,patternMatrix<M>(2,3,1));
+    BOOST_CHECK( sameEntries(e.matrix(4),patternMatrix<M>(2,3,1)) );
+    BOOST_CHECK( sameEntries(e.matrix(3),M(2,3,T(1))) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BatchedMatrix) {
+  dispatchTest(testBatchedMatrix);
+}
+
+template<class M,class Layout>
+void testLayout() {
+  typedef typename M::value_type T;
+  typedef anpi::Matrix<T,typename M::allocator_type,Layout> L;
+  typedef anpi::Matrix<T,typename M::allocator_type,anpi::tiled<4> > tiles;
+
+  // empty, smaller and larger than the tiles, and not multiple of them
+  const size_t shapes[][2] = { { 0, 0}, { 1, 1}, { 3, 5}, {37,29},
+                               {64,64}, {70,33} };
+
+  for (const auto& s : shapes) {
+    const M a = patternMatrix<M>(s[0],s[1],1);
+    const M b = patternMatrix<M>(s[0],s[1],2);
+
+    // conversions from and to the row-major layout
+    L la(a);
+    const L lb(b);
+    BOOST_CHECK( (la.rows() == s[0]) && (la.cols() == s[1]) );
+    BOOST_CHECK( sameEntries(la,a) );
+    BOOST_CHECK( M(la) == a );
+    BOOST_CHECK( sameEntries(tiles(la),a) );
+    BOOST_CHECK( sameEntries(L(tiles(a)),a) );
+
+    bool ok = true;
+    for (size_t i=0;i<s[0];++i) {
+      for (size_t j=0;j<s[1];++j) {
+        ok = ok && (la[i][j] == a[i][j]);
+      }
+    }
+    BOOST_CHECK( ok );
+
+    // element-wise arithmetic
+    BOOST_CHECK( sameEntries(la + lb,M(a + b)) );
+    BOOST_CHECK( sameEntries(la - lb,M(a - b)) );
+    BOOST_CHECK( sameEntries(la*T(2),M(a*T(2))) );
+    BOOST_CHECK( sameEntries(T(2)*la,M(a*T(2))) );
+
+    L c(la);
+    BOOST_CHECK( c == la );
+    c += lb;
+    c -= la;
+    BOOST_CHECK( c == lb );
+    BOOST_CHECK( (c != la) == (a != b) );
+
+    L f(s[0],s[1],T(3));
+    BOOST_CHECK( sameEntries(f,M(s[0],s[1],T(3))) );
+
+    // only the common block is filled
+    if (s[0] > 2) {
+      L g(2,3,T(0));
+      g.fill(a);
+      BOOST_CHECK( sameEntries(g,a.block(0,0,2,3)) );
+      M h(2,3,T(0));
+      h.fill(la);
+      BOOST_CHECK( sameEntries(h,g) );
+    }
+
+    la.swap(c);
+    BOOST_CHECK( (la == lb) && sameEntries(c,a) );
+  }
+
+  L m = { {T(1),T(2),T(3)}, {T(4),T(5),T(6)} };
+  BOOST_CHECK( (m.rows() == 2) && (m.cols() == 3) );
+  BOOST_CHECK( (m(1,2) == T(6)) && (m[0][1] == T(2)) );
+  m[1][0] = T(7);
+  BOOST_CHECK( m(1,0) == T(7) );
+
+  L n(std::move(m));
+  BOOST_CHECK( m.empty() && (n(1,0) == T(7)) );
+  m = std::move(n);
+  BOOST_CHECK( n.empty() && (m(0,2) == T(3)) );
+}
+
+template<class M>
+void testLayouts() {
+  testLayout<M,anpi::column_major>();
+  testLayout<M,anpi::tiled<4> >();
+  testLayout<M,anpi::tiled<> >();
+}
+
+BOOST_AUTO_TEST_CASE(Layouts) {
+  dispatchTest(testLayouts);
+}
+
+template<class M>
+void testDeferred() {
+  typedef typename M::value_type T;
+  typedef typename allocator_argument<M>::type Alloc;
+  typedef anpi::DeferredGraph<T,Alloc> graph;
+
+  M a = patternMatrix<M>(37,29,1);
+  M b = patternMatrix<M>(37,29,2);
+  const M c = patternMatrix<M>(29,37,3);
+
+  {
+    graph g;
+    auto da = g.input(a);
+    auto db = g.input(b);
+    auto dc = g.input(c);
+    BOOST_CHECK( g.input(a).node() == da.node() );
+
+    // the same operation on the same operands is recorded once
+    auto s = da + db;
+    BOOST_CHECK( (da + db).node() == s.node() );
+    BOOST_CHECK( (db + da).node() == s.node() );
+    BOOST_CHECK( (s*dc).rows() == 37 && (s*dc).cols() == 37 );
+
+    M e,p,q;
+    g.output(anpi::multiply(s,s) - s*T(2),e);
+    g.output(s*dc,p);
+    g.output(T(3)*(da - db),q);
+    g.eval();
+
+    const M sr = a + b;
+    BOOST_CHECK( e == anpi::multiply(sr,sr) - sr*T(2) );
+    BOOST_CHECK( p == sr*c );
+    BOOST_CHECK( q == T(3)*(a - b) );
+
+    // the outputs follow the changes of the inputs, in the same buffers
+    a.fill(b);
+    g.eval();
+    const M tr = b + b;
+    BOOST_CHECK( e == anpi::multiply(tr,tr) - tr*T(2) );
+    BOOST_CHECK( p == tr*c );
+    BOOST_CHECK( g.statistics().allocations == 0 );
+
+    // the inputs must keep their size
+    a = patternMatrix<M>(3,3,1);
+    BOOST_CHECK_THROW( g.eval(),anpi::Exception );
+  }
+
+  a = patternMatrix<M>(37,29,1);
+  {
+    // a chain of element-wise operations is one single pass
+    graph g;
+    auto da = g.input(a);
+    auto db = g.input(b);
+    const M r = g.eval(((da + db)*T(2) - db)/T(1) + anpi::multiply(da,db));
+    BOOST_CHECK( r == ((a + b)*T(2) - b)/T(1) + anpi::multiply(a,b) );
+    BOOST_CHECK( g.statistics().tasks == 1 );
+    BOOST_CHECK( g.statistics().allocations == 1 );
+  }
+
+  {
+    // the buffers of a chain of products are recycled
+    const M sq = patternMatrix<M>(16,16,1);
+    graph g;
+    auto d = g.input(sq);
+    const M r = g.eval(((d*d)*d)*d);
+    BOOST_CHECK( r == ((sq*sq)*sq)*sq );
+    BOOST_CHECK( g.statistics().tasks == 3 );
+    BOOST_CHECK( g.statistics().buffers == 2 );
+    BOOST_CHECK( g.statistics().allocations == 2 );
+  }
+
+  {
+    // an input may also receive an output
+    graph g;
+    auto da = g.input(a);
+    auto db = g.input(b);
+    const M r = a - b;
+    g.output(da - db,a);
+    g.eval();
+    BOOST_CHECK( a == r );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Deferred) {
+  dispatchTest(testDeferred);
+}
+
+template<typename H>
+void testHalfMatrices() {
+  typedef anpi::Matrix<H> M;
+  const float eps = float(std::numeric_limits<H>::epsilon());
+
+  const size_t sizes[] = { 1, 5, 16, 37 };
+  for (const size_t n : sizes) {
+    const size_t m = n+9;
+    M a(n,m,anpi::DoNotInitialize);
+    M b(n,m,anpi::DoNotInitialize);
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<m;++j) {
+        a(i,j) = H(float(int((i*7+j*3)%23) - 11)/4.f + 0.3f);
+        b(i,j) = H(float((i+2*j)%13 + 1)/8.f);
+      }
+    }
+
+    // entry-wise results are the float results, rounded once
+    const M s = a + b;
+    const M d = a - b;
+    const M p = anpi::multiply(a,b);
+    const M q = anpi::divide(a,b);
+    const M f = anpi::fma(a,b,s);
+    const M e = H(2.f)*a + b;
+    bool ok = true;
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<m;++j) {
+        const float x = a(i,j), y = b(i,j);
+        ok = ok && (s(i,j).bits() == H(x+y).bits());
+        ok = ok && (d(i,j).bits() == H(x-y).bits());
+        ok = ok && (p(i,j).bits() == H(x*y).bits());
+        ok = ok && (q(i,j).bits() == H(x/y).bits());
+        ok = ok && (f(i,j).bits() == H(x*y + float(s(i,j))).bits());
+        ok = ok && (e(i,j).bits() == H(2.f*x + y).bits());
+      }
+    }
+    BOOST_CHECK( ok );
+
+    // reductions accumulate in float
+    double sum(0),dot(0),sq(0);
+    float mn = a(0,0), mx = a(0,0);
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<m;++j) {
+        sum += float(a(i,j));
+        dot += double(float(a(i,j)))*float(b(i,j));
+        sq  += double(float(a(i,j)))*float(a(i,j));
+        mn = std::min(mn,float(a(i,j)));
+        mx = std::max(mx,float(a(i,j)));
+      }
+    }
+    BOOST_CHECK( std::abs(anpi::sum(a) - sum) <= 1e-5*(1+std::abs(sum)) );
+    BOOST_CHECK( std::abs(anpi::dot(a,b) - dot) <= 1e-5*(1+std::abs(dot)) );
+    BOOST_CHECK( std::abs(anpi::frobenius(a) - std::sqrt(sq)) <=
+                 1e-5*std::sqrt(sq) );
+    BOOST_CHECK( float(anpi::min(a)) == mn );
+    BOOST_CHECK( float(anpi::max(a)) == mx );
+
+    // products accumulate in registers of floats
+    M c;
+    anpi::gemm(H(1.f),a,anpi::transposed(b),H(0.f),c);
+    ok = true;
+    for (size_t i=0;i<n;++i) {
+      for (size_t j=0;j<n;++j) {
+        float r(0),bound(0);
+        for (size_t k=0;k<m;++k) {
+          r += float(a(i,k))*float(b(j,k));
+          bound += std::abs(float(a(i,k))*float(b(j,k)));
+        }
+        ok = ok && (std::abs(float(c(i,j)) - r) <= 2*eps*bound);
+      }
+    }
+    BOOST_CHECK( ok );
+  }
+
+  { // 16384 does not fit in the 11 bits of a fp16 sum
+    const M ones(128,128,H(1.f));
+    BOOST_CHECK( anpi::sum(ones) == 16384.f );
+    BOOST_CHECK( anpi::sum(ones,anpi::KahanSummation) == 16384.f );
+    BOOST_CHECK( anpi::sum(ones,anpi::PairwiseSummation) == 16384.f );
+    BOOST_CHECK( anpi::dot(ones,ones) == 16384.f );
+    BOOST_CHECK( anpi::frobenius(ones) == 128.f );
+    BOOST_CHECK( anpi::colSums(ones) == M(1,128,H(128.f)) );
+    BOOST_CHECK( anpi::rowSums(ones) == M(128,1,H(128.f)) );
+  }
+
+  { // loads and stores keep all values, including infinities and NaNs
+    M all(256,256,anpi::DoNotInitialize);
+    for (size_t i=0;i<256;++i) {
+      for (size_t j=0;j<256;++j) {
+        all(i,j) = H::fromBits(std::uint16_t(i*256+j));
+      }
+    }
+    const M r = anpi::multiply(all,M(256,256,H(1.f)));
+    bool ok = true;
+    for (size_t i=0;i<256;++i) {
+      for (size_t j=0;j<256;++j) {
+        const float x = all(i,j);
+        ok = ok && ((x != x) ? (r(i,j) != r(i,j))
+                             : (r(i,j).bits() == all(i,j).bits()));
+      }
+    }
+    BOOST_CHECK( ok );
+
+    const M big(3,40,std::numeric_limits<H>::max());
+    const M inf = big + big;
+    BOOST_CHECK( inf == M(3,40,std::numeric_limits<H>::infinity()) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(HalfFloat) {
+  using anpi::fp16;
+  using anpi::bf16;
+
+  // rounding to nearest even, overflow and subnormals
+  BOOST_CHECK( fp16(1.f).bits() == 0x3c00 );
+  BOOST_CHECK( fp16(-2.f).bits() == 0xc000 );
+  BOOST_CHECK( fp16(-0.f).bits() == 0x8000 );
+  BOOST_CHECK( fp16(65504.f).bits() == 0x7bff );
+  BOOST_CHECK( fp16(65520.f).bits() == 0x7c00 );
+  BOOST_CHECK( fp16(1.f + std::ldexp(1.f,-11)).bits() == 0x3c00 );
+  BOOST_CHECK( fp16(1.f + 3*std::ldexp(1.f,-11)).bits() == 0x3c02 );
+  BOOST_CHECK( fp16(std::ldexp(1.f,-24)).bits() == 0x0001 );
+  BOOST_CHECK( fp16(std::ldexp(1.f,-25)).bits() == 0x0000 );
+  BOOST_CHECK( fp16(std::ldexp(3.f,-26)).bits() == 0x0001 );
+  BOOST_CHECK( float(fp16::fromBits(0x0001)) == std::ldexp(1.f,-24) );
+  BOOST_CHECK( float(fp16::fromBits(0x7c00)) ==
+               std::numeric_limits<float>::infinity() );
+
+  BOOST_CHECK( bf16(1.f).bits() == 0x3f80 );
+  BOOST_CHECK( bf16(1.f + std::ldexp(1.f,-8)).bits() == 0x3f80 );
+  BOOST_CHECK( bf16(1.f + 3*std::ldexp(1.f,-8)).bits() == 0x3f82 );
+  BOOST_CHECK( bf16(3.4e38f).bits() == 0x7f80 );
+  BOOST_CHECK( float(bf16(1e-40f)) == float(bf16::fromBits(0x0001)) );
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  BOOST_CHECK( float(fp16(nan)) != float(fp16(nan)) );
+  BOOST_CHECK( float(bf16(nan)) != float(bf16(nan)) );
+
+  // all values survive the conversion to float and back
+  bool ok = true;
+  for (unsigned int u=0;u<0x10000;++u) {
+    const fp16 h = fp16::fromBits(std::uint16_t(u));
+    const bf16 b = bf16::fromBits(std::uint16_t(u));
+    ok = ok && ((h != h) || (fp16(float(h)).bits() == u));
+    ok = ok && ((b != b) || (bf16(float(b)).bits() == u));
+  }
+  BOOST_CHECK( ok );
+
+  // arithmetic rounds once
+  BOOST_CHECK( (fp16(1.f) + fp16(std::ldexp(1.f,-11))).bits() == 0x3c00 );
+  BOOST_CHECK( float(fp16(3.f)*fp16(0.5f)) == 1.5f );
+
+  testHalfMatrices<fp16>();
+  testHalfMatrices<bf16>();
+}
+
+BOOST_AUTO_TEST_CASE(Numa) {
+  std::vector<unsigned long> mask;
+  BOOST_CHECK( anpi::detail::parseNodeList("0\n",mask) == 1 );
+  BOOST_CHECK( (mask.size() == 1) && (mask[0] == 1ul) );
+  BOOST_CHECK( anpi::detail::parseNodeList("0-2,5",mask) == 4 );
+  BOOST_CHECK( (mask.size() == 1) && (mask[0] == 0x27ul) );
+  BOOST_CHECK( anpi::detail::parseNodeList("1,70",mask) == 2 );
+  BOOST_CHECK( (mask.size() == 2) && (mask[1] == 0x40ul) );
+  BOOST_CHECK( anpi::detail::parseNodeList("",mask) == 0 );
+
+  BOOST_CHECK( anpi::numaNodes() >= 1 );
+
+  // the placement does not change the results
+  const anpi::NumaPlacement placement = anpi::numaPlacement();
+  const size_t threshold = anpi::parallelThreshold();
+  anpi::setParallelThreshold(1);
+  const anpi::NumaPlacement placements[] = { anpi::NumaLocal,
+                                             anpi::NumaInterleave };
+  for (const anpi::NumaPlacement p : placements) {
+    anpi::setNumaPlacement(p);
+    BOOST_CHECK( anpi::numaPlacement() == p );
+    dispatchTest(testArithmetic);
+    dispatchTest(testFill);
+
+    // binding the pages keeps their contents
+    arfmatrix a = patternMatrix<arfmatrix>(300,300,1);
+    const arfmatrix b(a);
+    anpi::detail::bindPages(reinterpret_cast<char*>(a.data()),
+                            a.rows()*a.dcols()*sizeof(float),p);
+    BOOST_CHECK( a==b );
+  }
+  anpi::setParallelThreshold(threshold);
+  anpi::setNumaPlacement(placement);
+}
+
+BOOST_AUTO_TEST_CASE(Parallel) {
+  const size_t threads = anpi::threads();
+  const size_t threshold = anpi::parallelThreshold();
+
+  // the row blocks cover each row exactly once
+  anpi::setThreads(3);
+  anpi::setParallelThreshold(1);
+  {
+    std::vector<int> hits(10,0);
+    anpi::parallelRows(hits.size(),1,[&](const size_t first,
+                                         const size_t last) {
+      for (size_t r=first;r<last;++r) {
+        ++hits[r];
+      }
+    });
+    BOOST_CHECK( std::count(hits.begin(),hits.end(),1) == 10 );
+  }
+
+  // small tasks stay in the calling thread
+  anpi::setParallelThreshold(100);
+  BOOST_CHECK( anpi::parallelThreads(10,10) == 1 );
+  BOOST_CHECK( anpi::parallelThreads(10,30) <= 3 );
+  anpi::setParallelThreshold(1);
+
+  // all element-wise operations split every matrix among threads
+  dispatchTest(testArithmetic);
+  dispatchTest(testExpressions);
+  dispatchTest(testElementwise);
+  dispatchRealTest(testMinMax);
+  dispatchTest(testFill);
+  dispatchTest(testViews);
+  dispatchTest(testTranspose);
+  dispatchTest(testReductions);
+  dispatchRealTest(testExtrema);
+  dispatchTest(testSparseMatrix);
+  dispatchTest(testVector);
+  dispatchTest(testBatchedMatrix);
+  dispatchTest(testLayouts);
+  dispatchTest(testDeferred);
+
+  {
+    // rows not evenly split among the threads
+    const fmatrix a = patternMatrix<fmatrix>(37,29,1);
+    const fmatrix b = patternMatrix<fmatrix>(37,29,2);
+    const arfmatrix ar = patternMatrix<arfmatrix>(37,29,1);
+    const arfmatrix br = patternMatrix<arfmatrix>(37,29,2);
+
+    anpi::setThreads(1);
+    const fmatrix c = a + b - a*2.f;
+    const arfmatrix cr = ar + br - ar*2.f;
+    fmatrix f(37,29,anpi::DoNotInitialize);
+    f.fill(3.f);
+
+    anpi::setThreads(3);
+    BOOST_CHECK( fmatrix(a + b - a*2.f) == c );
+    BOOST_CHECK( arfmatrix(ar + br - ar*2.f) == cr );
+    fmatrix d(a);
+    d+=b;
+    d-=a*2.f;
+    BOOST_CHECK( d == c );
+    fmatrix g(37,29,anpi::DoNotInitialize);
+    g.fill(3.f);
+    BOOST_CHECK( g == f );
+  }
+
+  anpi::setThreads(threads);
+  anpi::setParallelThreshold(threshold);
+}
+
+BOOST_AUTO_TEST_CASE(Dispatch) {
+  using namespace anpi::simd;
+
+  BOOST_CHECK( parseIsa("none",Isa::AVX) == Isa::None );
+  BOOST_CHECK( parseIsa("sse2",Isa::None) == Isa::SSE2 );
+  BOOST_CHECK( parseIsa("avx2",Isa::None) == Isa::AVX );
+  BOOST_CHECK( parseIsa("avx512",Isa::None) == Isa::AVX512 );
+  BOOST_CHECK( parseIsa("mmx",Isa::SSE2) == Isa::SSE2 );
+  BOOST_CHECK( parseIsa(nullptr,Isa::SSE2) == Isa::SSE2 );
+
+  // run the arithmetic tests with every instruction set in this CPU
+  const Isa active = isa();
+  for (int i=static_cast<int>(Isa::None);
+       i<=static_cast<int>(supportedIsa());++i) {
+    const Isa used = setIsa(static_cast<Isa>(i));
+    BOOST_CHECK( used == static_cast<Isa>(i) );
+    BOOST_TEST_MESSAGE("Instruction set " << isaName(used));
+
+    dispatchTest(testArithmetic);
+    dispatchTest(testExpressions);
+    dispatchTest(testElementwise);
+    dispatchRealTest(testMinMax);
+    dispatchTest(testProduct);
+    dispatchTest(testFill);
+    dispatchTest(testViews);
+    dispatchTest(testTranspose);
+    dispatchTest(testReductions);
+    dispatchRealTest(testExtrema);
+    dispatchTest(testVector);
+    dispatchTest(testBatchedMatrix);
+    dispatchTest(testLayouts);
+    dispatchTest(testDeferred);
+    testHalfMatrices<anpi::fp16>();
+    testHalfMatrices<anpi::bf16>();
+  }
+  setIsa(active);
+  BOOST_CHECK( isa() == active );
+}
   
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2017-2018
+ * Área Académica de Ingeniería en Computadoras, TEC, Costa Rica
+ *
+ * This file is part of the CE3102 Numerical Analysis lecture at TEC
+ *
+ * Tests of the library built without OpenMP.  This file is compiled
+ * into its own executable, without the OpenMP flags of the tester.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <Matrix.hpp>
+#include <Deferred.hpp>
+#include <Parallel.hpp>
+
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#  error "testSerial.cpp has to be compiled without OpenMP"
+#endif
+
+BOOST_AUTO_TEST_SUITE( Serial )
+
+BOOST_AUTO_TEST_CASE( Rows ) {
+  const size_t threads = anpi::threads();
+  const size_t threshold = anpi::parallelThreshold();
+
+  // more threads requested than available: all runs in this thread
+  anpi::setThreads(4);
+  anpi::setParallelThreshold(1);
+  BOOST_CHECK( anpi::parallelThreads(512,512) == 1 );
+
+  {
+    std::vector<int> hits(10,0);
+    anpi::parallelRows(hits.size(),1,[&](const size_t first,
+                                         const size_t last) {
+      for (size_t r=first;r<last;++r) {
+        ++hits[r];
+      }
+    });
+    BOOST_CHECK( std::count(hits.begin(),hits.end(),1) == 10 );
+  }
+
+  {
+    const anpi::Matrix<double> a(512,512,1.0);
+    const anpi::Matrix<double> b(512,512,2.0);
+    BOOST_CHECK( a(511,511) == 1.0 );
+
+    const anpi::Matrix<double> c = a + b;
+    BOOST_CHECK( c(0,0) == 3.0 && c(511,511) == 3.0 );
+
+    anpi::Matrix<double> d(512,512,anpi::DoNotInitialize);
+    d.fill(0.5);
+    BOOST_CHECK( d(0,0) == 0.5 && d(511,511) == 0.5 );
+    BOOST_CHECK( anpi::sum(d) == 0.5*512*512 );
+  }
+
+  anpi::setParallelThreshold(threshold);
+  anpi::setThreads(threads);
+}
+
+BOOST_AUTO_TEST_CASE( Tasks ) {
+  const size_t threads = anpi::threads();
+  const size_t threshold = anpi::parallelThreshold();
+  anpi::setThreads(4);
+  anpi::setParallelThreshold(1);
+
+  {
+    std::vector<int> hits(10,0);
+    anpi::parallelTasks(hits.size(),[&](const size_t i) {
+      ++hits[i];
+    });
+    BOOST_CHECK( std::count(hits.begin(),hits.end(),1) == 10 );
+  }
+
+  {
+    // independent products of the graph run as parallel tasks
+    const anpi::Matrix<double> a(64,64,1.0);
+    const anpi::Matrix<double> b(64,64,2.0);
+    anpi::DeferredGraph<double> g;
+    auto da = g.input(a);
+    auto db = g.input(b);
+    anpi::Matrix<double> p,q;
+    g.output(da*db,p);
+    g.output(db*db,q);
+    g.eval();
+    BOOST_CHECK( p(0,0) == 128.0 && p(63,63) == 128.0 );
+    BOOST_CHECK( q(0,0) == 256.0 && q(63,63) == 256.0 );
+  }
+
+  anpi::setParallelThreshold(threshold);
+  anpi::setThreads(threads);
+}
+
+BOOST_AUTO_TEST_SUITE_END()